@@ -0,0 +1,110 @@
+// I420 -> RGB32 conversion micro-benchmark.
+// Reports ns/frame for every backend available on this machine at 720p, 1080p and 1440p.
+
+#include "controller/ColorConverter.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace {
+
+struct Resolution
+{
+    const char *name;
+    int width;
+    int height;
+};
+
+struct I420Buffer
+{
+    std::vector<std::uint8_t> y;
+    std::vector<std::uint8_t> u;
+    std::vector<std::uint8_t> v;
+    controller::I420FrameView view;
+};
+
+I420Buffer makeFrame(int width, int height)
+{
+    I420Buffer buffer;
+    const int chromaWidth = (width + 1) / 2;
+    const int chromaHeight = (height + 1) / 2;
+    buffer.y.resize(static_cast<std::size_t>(width) * height);
+    buffer.u.resize(static_cast<std::size_t>(chromaWidth) * chromaHeight);
+    buffer.v.resize(buffer.u.size());
+
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> dist(0, 255);
+    for (auto *plane : {&buffer.y, &buffer.u, &buffer.v}) {
+        for (auto &value : *plane) {
+            value = static_cast<std::uint8_t>(dist(rng));
+        }
+    }
+
+    buffer.view.y = buffer.y.data();
+    buffer.view.u = buffer.u.data();
+    buffer.view.v = buffer.v.data();
+    buffer.view.strideY = width;
+    buffer.view.strideUV = chromaWidth;
+    buffer.view.width = width;
+    buffer.view.height = height;
+    return buffer;
+}
+
+double measureNsPerFrame(const controller::I420FrameView &frame, controller::ColorConversionBackend backend)
+{
+    using Clock = std::chrono::steady_clock;
+    QImage target;
+    controller::convertI420ToRgb32(frame, target, backend); // allocate + warm caches
+
+    constexpr auto kBudget = std::chrono::milliseconds(500);
+    int iterations = 0;
+    const auto start = Clock::now();
+    auto elapsed = Clock::duration::zero();
+    do {
+        controller::convertI420ToRgb32(frame, target, backend);
+        ++iterations;
+        elapsed = Clock::now() - start;
+    } while (elapsed < kBudget || iterations < 10);
+
+    return std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+}
+
+} // namespace
+
+int main()
+{
+    using controller::ColorConversionBackend;
+
+    const Resolution resolutions[] = {
+        {"720p", 1280, 720},
+        {"1080p", 1920, 1080},
+        {"1440p", 2560, 1440},
+    };
+    const ColorConversionBackend backends[] = {
+        ColorConversionBackend::LibYuv,
+        ColorConversionBackend::Avx2,
+        ColorConversionBackend::Sse2,
+        ColorConversionBackend::Scalar,
+    };
+
+    std::printf("auto backend: %s\n",
+                controller::colorConversionBackendName(controller::resolveColorConversionBackend(ColorConversionBackend::Auto)));
+    std::printf("%-8s %-7s %14s %10s\n", "backend", "size", "ns/frame", "Mpix/s");
+
+    for (const auto &resolution : resolutions) {
+        const I420Buffer buffer = makeFrame(resolution.width, resolution.height);
+        for (const auto backend : backends) {
+            if (!controller::isColorConversionBackendAvailable(backend)) {
+                continue;
+            }
+            const double ns = measureNsPerFrame(buffer.view, backend);
+            const double megapixelsPerSecond = (static_cast<double>(resolution.width) * resolution.height) / ns * 1000.0;
+            std::printf("%-8s %-7s %14.0f %10.1f\n", controller::colorConversionBackendName(backend), resolution.name, ns,
+                        megapixelsPerSecond);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,127 @@
+// Round-trip benchmark for input event encoding: binary wire format vs the
+// JSON fallback. Reports ns/event and heap allocations per event.
+
+#include "common/InputProtocol.h"
+#include "common/Protocol.h"
+
+#include <QJsonDocument>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+namespace {
+std::atomic<std::uint64_t> g_allocations{0};
+} // namespace
+
+void *operator new(std::size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+namespace {
+
+using Protocol::InputEvent;
+using Protocol::InputEventType;
+
+std::vector<InputEvent> makeEvents(std::size_t count)
+{
+    std::vector<InputEvent> events;
+    events.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        InputEvent event;
+        switch (i % 8) {
+        case 0:
+            event.type = InputEventType::MouseClick;
+            event.button = 1;
+            break;
+        case 1:
+            event.type = InputEventType::MouseWheel;
+            event.deltaY = -120;
+            break;
+        case 2:
+            event.type = InputEventType::Key;
+            event.keyCode = static_cast<std::uint16_t>(1 + i % std::size(Protocol::kKeyCodeNames));
+            event.keyDown = (i & 1) != 0;
+            break;
+        default:
+            event.type = InputEventType::MouseMove;
+            break;
+        }
+        event.x = static_cast<double>(i % 1920) / 1920.0;
+        event.y = static_cast<double>(i % 1080) / 1080.0;
+        events.push_back(event);
+    }
+    return events;
+}
+
+struct Result
+{
+    double nsPerEvent = 0.0;
+    double allocationsPerEvent = 0.0;
+    std::uint64_t checksum = 0;
+};
+
+template <typename Fn>
+Result run(const std::vector<InputEvent> &events, int rounds, Fn &&roundTrip)
+{
+    using Clock = std::chrono::steady_clock;
+    Result result;
+    const std::uint64_t allocationsBefore = g_allocations.load();
+    const auto start = Clock::now();
+    for (int round = 0; round < rounds; ++round) {
+        for (const auto &event : events) {
+            result.checksum += roundTrip(event);
+        }
+    }
+    const auto elapsed = Clock::now() - start;
+    const double total = static_cast<double>(events.size()) * rounds;
+    result.nsPerEvent = std::chrono::duration<double, std::nano>(elapsed).count() / total;
+    result.allocationsPerEvent = static_cast<double>(g_allocations.load() - allocationsBefore) / total;
+    return result;
+}
+
+} // namespace
+
+int main()
+{
+    const auto events = makeEvents(4096);
+    constexpr int kRounds = 200;
+
+    const Result binary = run(events, kRounds, [](const InputEvent &event) -> std::uint64_t {
+        std::uint8_t buffer[Protocol::kMaxInputMessageSize];
+        const std::size_t size = Protocol::encodeInputEvent(event, buffer, sizeof(buffer));
+        InputEvent decoded;
+        Protocol::decodeInputEvent(buffer, size, decoded);
+        return size + static_cast<std::uint64_t>(decoded.type);
+    });
+
+    const Result json = run(events, kRounds / 20, [](const InputEvent &event) -> std::uint64_t {
+        const QByteArray encoded = Protocol::toJson(Protocol::makeInputPayload(event));
+        const QJsonObject decoded = QJsonDocument::fromJson(encoded).object();
+        return static_cast<std::uint64_t>(encoded.size() + decoded.size());
+    });
+
+    std::printf("%-8s %12s %14s\n", "format", "ns/event", "allocs/event");
+    std::printf("%-8s %12.1f %14.2f\n", "binary", binary.nsPerEvent, binary.allocationsPerEvent);
+    std::printf("%-8s %12.1f %14.2f\n", "json", json.nsPerEvent, json.allocationsPerEvent);
+    std::printf("checksum %llu\n", static_cast<unsigned long long>(binary.checksum + json.checksum));
+    return 0;
+}
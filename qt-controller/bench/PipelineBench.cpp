@@ -0,0 +1,818 @@
+// End-to-end benchmark of the receive pipeline over loopback, no network needed.
+//
+// A host PeerConnection in the same process streams a canned H.264 + Opus
+// session (encoded once up front, so encoding is not measured) to a real
+// WebRtcPeer, stamps every access unit with a capture-time SEI, echoes
+// latency probes and swallows the simulated input the controller sends.
+// Both sides share the steady clock, so glass-to-glass needs no offset.
+//
+// Reports throughput, per-stage latency (decode, convert, glass-to-glass,
+// input round trip) and CPU time per frame for the whole process.
+//
+// With --impairment, received media and sent input go through the seeded
+// impairment profile, so lossy runs are reproducible too.
+//
+//   controller_bench [--seconds 10] [--width 1920] [--height 1080] [--fps 60] [--bitrate 8000]
+//                    [--impairment bench/profiles/wifi.ini]
+
+#include "common/InputProtocol.h"
+#include "common/Protocol.h"
+#include "controller/H264Sei.h"
+#include "controller/Metrics.h"
+#include "controller/NetworkImpairment.h"
+#include "controller/RtpPacket.h"
+#include "controller/WebRtcPeer.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QTimer>
+
+#include <rtc/rtc.hpp>
+
+#include <opus/opus.h>
+#include <wels/codec_api.h>
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using controller::appendCaptureTimestampSei;
+using controller::readBigEndian16;
+
+// As negotiated by WebRtcPeer.
+constexpr int kH264PayloadType = 96;
+constexpr int kOpusPayloadType = 111;
+constexpr auto kVideoMid = "video";
+constexpr auto kAudioMid = "audio";
+
+constexpr std::uint32_t kVideoSsrc = 0x1000;
+constexpr std::uint32_t kAudioSsrc = 0x2000;
+constexpr int kVideoClockRate = 90000;
+constexpr int kAudioSampleRate = 48000;
+constexpr int kAudioFrameSamples = kAudioSampleRate / 50; // 20 ms
+constexpr std::size_t kMaxRtpPayload = 1200;
+constexpr std::size_t kRtpHeaderSize = 12;
+constexpr std::uint8_t kNalTypeFuA = 28;
+
+// Measurements start once the first keyframe and the jitter buffers have settled.
+constexpr int kWarmupMs = 1000;
+constexpr int kConnectTimeoutMs = 10000;
+constexpr int kProbeIntervalMs = 100;
+constexpr int kInputIntervalMs = 2; // a 500 Hz mouse
+
+std::int64_t steadyNowUs()
+{
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+std::int64_t processCpuUs()
+{
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    const auto toUs = [](const timeval &tv) { return static_cast<std::int64_t>(tv.tv_sec) * 1000000 + tv.tv_usec; };
+    return toUs(usage.ru_utime) + toUs(usage.ru_stime);
+}
+
+struct Options
+{
+    int seconds = 10;
+    int width = 1920;
+    int height = 1080;
+    int fps = 60;
+    int bitrateKbps = 8000;
+};
+
+struct CannedFrame
+{
+    std::vector<std::uint8_t> data; // Annex B access unit
+    bool keyframe = false;
+};
+
+// A scrolling page with a window dragged across it: mostly static content
+// with one moving region, like a desktop.
+void drawTestPattern(int frame, int width, int height, std::vector<std::uint8_t> &i420)
+{
+    const int chromaWidth = (width + 1) / 2;
+    const int chromaHeight = (height + 1) / 2;
+    std::uint8_t *y = i420.data();
+    std::uint8_t *u = y + static_cast<std::size_t>(width) * height;
+    std::uint8_t *v = u + static_cast<std::size_t>(chromaWidth) * chromaHeight;
+
+    const int scroll = frame * 2;
+    for (int row = 0; row < height; ++row) {
+        const bool textLine = ((row + scroll) / 6) % 4 != 0;
+        for (int col = 0; col < width; ++col) {
+            const bool glyph = textLine && ((col / 4 + (row + scroll) / 24) % 5) < 3;
+            y[static_cast<std::size_t>(row) * width + col] = glyph ? 40 : 235;
+        }
+    }
+    std::fill(u, u + static_cast<std::size_t>(chromaWidth) * chromaHeight, 128);
+    std::fill(v, v + static_cast<std::size_t>(chromaWidth) * chromaHeight, 128);
+
+    const int boxWidth = width / 4;
+    const int boxHeight = height / 4;
+    const int boxX = (frame * 8) % std::max(width - boxWidth, 1);
+    const int boxY = height / 3;
+    for (int row = boxY; row < boxY + boxHeight; ++row) {
+        std::fill_n(y + static_cast<std::size_t>(row) * width + boxX, boxWidth,
+                    static_cast<std::uint8_t>(90 + frame % 64));
+    }
+    for (int row = boxY / 2; row < (boxY + boxHeight) / 2; ++row) {
+        std::fill_n(u + static_cast<std::size_t>(row) * chromaWidth + boxX / 2, boxWidth / 2, std::uint8_t{170});
+        std::fill_n(v + static_cast<std::size_t>(row) * chromaWidth + boxX / 2, boxWidth / 2, std::uint8_t{90});
+    }
+}
+
+// Encodes `count` frames with OpenH264; only the first one is a keyframe,
+// so the loop restarts cleanly at frame 0.
+std::vector<CannedFrame> encodeVideo(const Options &options, int count)
+{
+    std::vector<CannedFrame> frames;
+    ISVCEncoder *encoder = nullptr;
+    if (WelsCreateSVCEncoder(&encoder) != 0 || !encoder) {
+        return frames;
+    }
+
+    SEncParamExt param;
+    encoder->GetDefaultParams(&param);
+    param.iUsageType = SCREEN_CONTENT_REAL_TIME;
+    param.iPicWidth = options.width;
+    param.iPicHeight = options.height;
+    param.iTargetBitrate = options.bitrateKbps * 1000;
+    param.iMaxBitrate = options.bitrateKbps * 1500;
+    param.iRCMode = RC_BITRATE_MODE;
+    param.fMaxFrameRate = static_cast<float>(options.fps);
+    param.bEnableFrameSkip = false;
+    param.uiIntraPeriod = static_cast<unsigned int>(count);
+    param.eSpsPpsIdStrategy = CONSTANT_ID;
+    param.iMultipleThreadIdc = 1;
+    param.iSpatialLayerNum = 1;
+    SSpatialLayerConfig &layer = param.sSpatialLayers[0];
+    layer.iVideoWidth = options.width;
+    layer.iVideoHeight = options.height;
+    layer.fFrameRate = static_cast<float>(options.fps);
+    layer.iSpatialBitrate = param.iTargetBitrate;
+    layer.iMaxSpatialBitrate = param.iMaxBitrate;
+    layer.sSliceArgument.uiSliceMode = SM_SINGLE_SLICE;
+    if (encoder->InitializeExt(&param) != cmResultSuccess) {
+        WelsDestroySVCEncoder(encoder);
+        return frames;
+    }
+    int format = videoFormatI420;
+    encoder->SetOption(ENCODER_OPTION_DATAFORMAT, &format);
+
+    const int chromaWidth = (options.width + 1) / 2;
+    const int chromaHeight = (options.height + 1) / 2;
+    std::vector<std::uint8_t> i420(static_cast<std::size_t>(options.width) * options.height
+                                   + 2 * static_cast<std::size_t>(chromaWidth) * chromaHeight);
+    SSourcePicture picture{};
+    picture.iColorFormat = videoFormatI420;
+    picture.iPicWidth = options.width;
+    picture.iPicHeight = options.height;
+    picture.iStride[0] = options.width;
+    picture.iStride[1] = chromaWidth;
+    picture.iStride[2] = chromaWidth;
+    picture.pData[0] = i420.data();
+    picture.pData[1] = picture.pData[0] + static_cast<std::size_t>(options.width) * options.height;
+    picture.pData[2] = picture.pData[1] + static_cast<std::size_t>(chromaWidth) * chromaHeight;
+
+    for (int i = 0; i < count; ++i) {
+        drawTestPattern(i, options.width, options.height, i420);
+        picture.uiTimeStamp = static_cast<long long>(i) * 1000 / options.fps;
+        SFrameBSInfo info{};
+        if (encoder->EncodeFrame(&picture, &info) != cmResultSuccess || info.eFrameType == videoFrameTypeSkip) {
+            continue;
+        }
+        CannedFrame frame;
+        frame.keyframe = info.eFrameType == videoFrameTypeIDR;
+        for (int l = 0; l < info.iLayerNum; ++l) {
+            const SLayerBSInfo &bs = info.sLayerInfo[l];
+            int size = 0;
+            for (int n = 0; n < bs.iNalCount; ++n) {
+                size += bs.pNalLengthInByte[n];
+            }
+            frame.data.insert(frame.data.end(), bs.pBsBuf, bs.pBsBuf + size);
+        }
+        frames.push_back(std::move(frame));
+    }
+
+    encoder->Uninitialize();
+    WelsDestroySVCEncoder(encoder);
+    return frames;
+}
+
+// One second of a stereo 440 Hz tone in 20 ms Opus packets.
+std::vector<std::vector<std::uint8_t>> encodeAudio()
+{
+    std::vector<std::vector<std::uint8_t>> packets;
+    int error = 0;
+    OpusEncoder *encoder = opus_encoder_create(kAudioSampleRate, 2, OPUS_APPLICATION_RESTRICTED_LOWDELAY, &error);
+    if (error != OPUS_OK || !encoder) {
+        return packets;
+    }
+    opus_encoder_ctl(encoder, OPUS_SET_BITRATE(96000));
+
+    std::int16_t pcm[kAudioFrameSamples * 2];
+    std::uint8_t packet[1500];
+    constexpr double kTwoPi = 6.283185307179586;
+    for (int frame = 0; frame < 50; ++frame) {
+        for (int i = 0; i < kAudioFrameSamples; ++i) {
+            const double t = static_cast<double>(frame * kAudioFrameSamples + i) / kAudioSampleRate;
+            const auto sample = static_cast<std::int16_t>(8000.0 * std::sin(kTwoPi * 440.0 * t));
+            pcm[2 * i] = sample;
+            pcm[2 * i + 1] = sample;
+        }
+        const int size = opus_encode(encoder, pcm, kAudioFrameSamples, packet, sizeof(packet));
+        if (size > 0) {
+            packets.emplace_back(packet, packet + size);
+        }
+    }
+    opus_encoder_destroy(encoder);
+    return packets;
+}
+
+void writeRtpHeader(std::uint8_t *out, int payloadType, bool marker, std::uint16_t sequence, std::uint32_t timestamp,
+                    std::uint32_t ssrc)
+{
+    out[0] = 0x80; // version 2
+    out[1] = static_cast<std::uint8_t>((marker ? 0x80 : 0) | payloadType);
+    out[2] = static_cast<std::uint8_t>(sequence >> 8);
+    out[3] = static_cast<std::uint8_t>(sequence);
+    for (int i = 0; i < 4; ++i) {
+        out[4 + i] = static_cast<std::uint8_t>(timestamp >> (24 - 8 * i));
+        out[8 + i] = static_cast<std::uint8_t>(ssrc >> (24 - 8 * i));
+    }
+}
+
+// Calls `onNal(data, size)` for each NAL unit of an Annex B stream, without start codes.
+template <typename Fn>
+void forEachNal(const std::uint8_t *data, std::size_t size, Fn &&onNal)
+{
+    std::size_t start = size;
+    for (std::size_t i = 0; i + 3 <= size; ++i) {
+        if (data[i] == 0 && data[i + 1] == 0 && data[i + 2] == 1) {
+            if (start < size) {
+                std::size_t end = i;
+                while (end > start && data[end - 1] == 0) {
+                    --end;
+                }
+                onNal(data + start, end - start);
+            }
+            start = i + 3;
+            i += 2;
+        }
+    }
+    if (start < size) {
+        onNal(data + start, size - start);
+    }
+}
+
+template <typename T, typename = void>
+struct HasBindAddressField : std::false_type {};
+
+template <typename T>
+struct HasBindAddressField<T, std::void_t<decltype(std::declval<T &>().bindAddress)>> : std::true_type {};
+
+// Keeps ICE on the loopback interface where this libdatachannel allows it.
+template <typename ConfigurationT>
+void bindToLoopback(ConfigurationT &config)
+{
+    if constexpr (HasBindAddressField<ConfigurationT>::value) {
+        config.bindAddress = "127.0.0.1";
+    }
+}
+
+// The sending side: answers the controller's offer and streams the canned
+// session on its own thread, paced in real time.
+class LoopbackHost
+{
+public:
+    struct Stats
+    {
+        std::atomic<std::uint64_t> videoFrames{0};
+        std::atomic<std::uint64_t> videoBytes{0};
+        std::atomic<std::uint64_t> audioFrames{0};
+        std::atomic<std::uint64_t> inputEvents{0};
+        std::atomic<std::uint64_t> probesEchoed{0};
+        std::atomic<std::uint64_t> keyframeRequests{0};
+    };
+
+    std::function<void(const std::string &type, const std::string &sdp)> onDescription;
+    std::function<void(const std::string &candidate, const std::string &mid)> onCandidate;
+
+    LoopbackHost(std::vector<CannedFrame> video, std::vector<std::vector<std::uint8_t>> audio, int fps)
+        : m_video(std::move(video))
+        , m_audio(std::move(audio))
+        , m_fps(fps)
+    {
+        rtc::Configuration config;
+        bindToLoopback(config);
+        m_peerConnection = std::make_shared<rtc::PeerConnection>(config);
+
+        m_peerConnection->onLocalDescription([this](const rtc::Description &description) {
+            if (onDescription) {
+                onDescription(description.typeString(), std::string(description));
+            }
+        });
+        m_peerConnection->onLocalCandidate([this](const rtc::Candidate &candidate) {
+            if (onCandidate) {
+                onCandidate(candidate.candidate(), candidate.mid());
+            }
+        });
+        m_peerConnection->onTrack([this](std::shared_ptr<rtc::Track> track) { bindTrack(std::move(track)); });
+        m_peerConnection->onDataChannel(
+            [this](std::shared_ptr<rtc::DataChannel> channel) { bindChannel(std::move(channel)); });
+    }
+
+    ~LoopbackHost()
+    {
+        stop();
+        m_peerConnection->close();
+    }
+
+    void setRemoteDescription(const std::string &type, const std::string &sdp)
+    {
+        m_peerConnection->setRemoteDescription(rtc::Description(sdp, type));
+    }
+
+    void addRemoteCandidate(const std::string &candidate, const std::string &mid)
+    {
+        m_peerConnection->addRemoteCandidate(rtc::Candidate(candidate, mid));
+    }
+
+    bool mediaReady() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_videoTrack && m_videoTrack->isOpen() && m_audioTrack && m_audioTrack->isOpen();
+    }
+
+    void startStreaming()
+    {
+        m_running = true;
+        m_thread = std::thread([this]() { run(); });
+    }
+
+    void stop()
+    {
+        m_running = false;
+        if (m_thread.joinable()) {
+            m_thread.join();
+        }
+    }
+
+    const Stats &stats() const { return m_stats; }
+
+private:
+    void bindTrack(std::shared_ptr<rtc::Track> track)
+    {
+        const bool video = track->mid() == kVideoMid;
+        auto description = track->description();
+        description.addSSRC(video ? kVideoSsrc : kAudioSsrc, std::string("bench-") + track->mid());
+        track->setDescription(std::move(description));
+
+        if (video) {
+            // Incoming RTCP; a PLI restarts the loop at its keyframe.
+            track->onMessage(
+                [this](rtc::binary message) {
+                    const auto *data = reinterpret_cast<const std::uint8_t *>(message.data());
+                    for (std::size_t offset = 0; offset + 4 <= message.size();) {
+                        const std::size_t length = (readBigEndian16(data + offset + 2) + 1) * 4;
+                        if (data[offset + 1] == 206 && (data[offset] & 0x1F) == 1) {
+                            m_keyframeRequested = true;
+                            ++m_stats.keyframeRequests;
+                        }
+                        offset += length;
+                    }
+                },
+                nullptr);
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        (video ? m_videoTrack : m_audioTrack) = std::move(track);
+    }
+
+    void bindChannel(std::shared_ptr<rtc::DataChannel> channel)
+    {
+        const bool reliable = channel->label() == Protocol::kInputChannelName;
+        std::weak_ptr<rtc::DataChannel> weakChannel = channel;
+        if (reliable) {
+            channel->onOpen([weakChannel]() {
+                if (const auto dc = weakChannel.lock()) {
+                    Protocol::InputEvent ack;
+                    ack.type = Protocol::InputEventType::HelloAck;
+                    std::uint8_t buffer[Protocol::kMaxInputMessageSize];
+                    const std::size_t size = Protocol::encodeInputEvent(ack, buffer, sizeof(buffer));
+                    dc->send(reinterpret_cast<const std::byte *>(buffer), size);
+                }
+            });
+        }
+        channel->onMessage(
+            [this, weakChannel](rtc::binary message) {
+                const auto *data = reinterpret_cast<const std::uint8_t *>(message.data());
+                Protocol::InputEventType type;
+                Protocol::LatencyProbe probe;
+                if (Protocol::decodeLatencyProbe(data, message.size(), type, probe)) {
+                    const auto dc = weakChannel.lock();
+                    if (type != Protocol::InputEventType::LatencyProbe || !dc) {
+                        return;
+                    }
+                    probe.hostUs = static_cast<std::uint64_t>(steadyNowUs());
+                    std::uint8_t buffer[Protocol::kMaxLatencyProbeSize];
+                    const std::size_t size = Protocol::encodeLatencyProbe(Protocol::InputEventType::LatencyProbeEcho,
+                                                                          probe, buffer, sizeof(buffer));
+                    dc->send(reinterpret_cast<const std::byte *>(buffer), size);
+                    ++m_stats.probesEchoed;
+                    return;
+                }
+                Protocol::forEachInputEvent(data, message.size(),
+                                            [this](const Protocol::InputEvent &) { ++m_stats.inputEvents; });
+            },
+            [this](rtc::string) { ++m_stats.inputEvents; });
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_channels.push_back(std::move(channel));
+    }
+
+    void run()
+    {
+        const auto videoPeriod = std::chrono::microseconds(1000000 / m_fps);
+        const auto audioPeriod = std::chrono::milliseconds(20);
+        auto nextVideo = Clock::now();
+        auto nextAudio = nextVideo;
+        std::size_t videoIndex = 0;
+        std::size_t audioIndex = 0;
+        std::uint32_t videoTimestamp = 0;
+        std::uint32_t audioTimestamp = 0;
+
+        while (m_running) {
+            const auto now = Clock::now();
+            if (now >= nextVideo && !m_video.empty()) {
+                if (m_keyframeRequested.exchange(false)) {
+                    videoIndex = 0;
+                }
+                sendVideoFrame(m_video[videoIndex], videoTimestamp);
+                videoIndex = (videoIndex + 1) % m_video.size();
+                videoTimestamp += static_cast<std::uint32_t>(kVideoClockRate / m_fps);
+                nextVideo += videoPeriod;
+            }
+            if (now >= nextAudio && !m_audio.empty()) {
+                sendAudioFrame(m_audio[audioIndex], audioTimestamp);
+                audioIndex = (audioIndex + 1) % m_audio.size();
+                audioTimestamp += kAudioFrameSamples;
+                nextAudio += audioPeriod;
+            }
+            std::this_thread::sleep_until(std::min(nextVideo, nextAudio));
+        }
+    }
+
+    void sendVideoFrame(const CannedFrame &frame, std::uint32_t timestamp)
+    {
+        // The capture timestamp goes in front, where a host encoder puts its SEI.
+        m_accessUnit.clear();
+        appendCaptureTimestampSei(steadyNowUs(), m_accessUnit);
+        m_accessUnit.insert(m_accessUnit.end(), frame.data.begin(), frame.data.end());
+
+        m_nals.clear();
+        forEachNal(m_accessUnit.data(), m_accessUnit.size(),
+                   [this](const std::uint8_t *data, std::size_t size) { m_nals.emplace_back(data, size); });
+
+        for (std::size_t i = 0; i < m_nals.size(); ++i) {
+            const auto [nal, size] = m_nals[i];
+            const bool lastNal = i + 1 == m_nals.size();
+            if (size <= kMaxRtpPayload) {
+                sendVideoPacket(timestamp, lastNal, nullptr, 0, nal, size);
+                continue;
+            }
+            // FU-A: the NAL header is split into indicator and FU header.
+            const std::uint8_t indicator = static_cast<std::uint8_t>((nal[0] & 0xE0) | kNalTypeFuA);
+            for (std::size_t offset = 1; offset < size;) {
+                const std::size_t chunk = std::min(kMaxRtpPayload - 2, size - offset);
+                const bool first = offset == 1;
+                const bool last = offset + chunk == size;
+                const std::uint8_t fu[2] = {
+                    indicator,
+                    static_cast<std::uint8_t>((first ? 0x80 : 0) | (last ? 0x40 : 0) | (nal[0] & 0x1F)),
+                };
+                sendVideoPacket(timestamp, lastNal && last, fu, sizeof(fu), nal + offset, chunk);
+                offset += chunk;
+            }
+        }
+        ++m_stats.videoFrames;
+    }
+
+    void sendVideoPacket(std::uint32_t timestamp, bool marker, const std::uint8_t *prefix, std::size_t prefixSize,
+                         const std::uint8_t *payload, std::size_t payloadSize)
+    {
+        m_packet.resize(kRtpHeaderSize + prefixSize + payloadSize);
+        writeRtpHeader(m_packet.data(), kH264PayloadType, marker, m_videoSequence++, timestamp, kVideoSsrc);
+        std::copy_n(prefix, prefixSize, m_packet.data() + kRtpHeaderSize);
+        std::copy_n(payload, payloadSize, m_packet.data() + kRtpHeaderSize + prefixSize);
+        if (send(m_videoTrack)) {
+            m_stats.videoBytes += m_packet.size();
+        }
+    }
+
+    void sendAudioFrame(const std::vector<std::uint8_t> &frame, std::uint32_t timestamp)
+    {
+        m_packet.resize(kRtpHeaderSize + frame.size());
+        writeRtpHeader(m_packet.data(), kOpusPayloadType, false, m_audioSequence++, timestamp, kAudioSsrc);
+        std::copy(frame.begin(), frame.end(), m_packet.data() + kRtpHeaderSize);
+        if (send(m_audioTrack)) {
+            ++m_stats.audioFrames;
+        }
+    }
+
+    bool send(const std::shared_ptr<rtc::Track> &track)
+    {
+        std::shared_ptr<rtc::Track> target;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            target = track;
+        }
+        return target && target->isOpen()
+               && target->send(reinterpret_cast<const std::byte *>(m_packet.data()), m_packet.size());
+    }
+
+    const std::vector<CannedFrame> m_video;
+    const std::vector<std::vector<std::uint8_t>> m_audio;
+    const int m_fps;
+
+    std::shared_ptr<rtc::PeerConnection> m_peerConnection;
+    mutable std::mutex m_mutex;
+    std::shared_ptr<rtc::Track> m_videoTrack;
+    std::shared_ptr<rtc::Track> m_audioTrack;
+    std::vector<std::shared_ptr<rtc::DataChannel>> m_channels;
+
+    std::thread m_thread;
+    std::atomic<bool> m_running{false};
+    std::atomic<bool> m_keyframeRequested{false};
+    Stats m_stats;
+
+    // Sender thread only.
+    std::vector<std::uint8_t> m_accessUnit;
+    std::vector<std::pair<const std::uint8_t *, std::size_t>> m_nals;
+    std::vector<std::uint8_t> m_packet;
+    std::uint16_t m_videoSequence = 0;
+    std::uint16_t m_audioSequence = 0;
+};
+
+// Counters at the start of the measured window.
+struct Baseline
+{
+    std::int64_t wallUs = 0;
+    std::int64_t cpuUs = 0;
+    std::uint64_t videoFrames = 0;
+    std::uint64_t videoBytes = 0;
+    std::uint64_t audioFrames = 0;
+    std::uint64_t framesDecoded = 0;
+    std::uint64_t decodeErrors = 0;
+    std::uint64_t inputEventsIn = 0;
+    std::uint64_t inputEventsHost = 0;
+};
+
+Baseline takeBaseline(const LoopbackHost &host, const controller::WebRtcPeer &peer,
+                      const controller::MetricsRegistry &metrics)
+{
+    Baseline baseline;
+    baseline.wallUs = steadyNowUs();
+    baseline.cpuUs = processCpuUs();
+    baseline.videoFrames = host.stats().videoFrames;
+    baseline.videoBytes = host.stats().videoBytes;
+    baseline.audioFrames = host.stats().audioFrames;
+    baseline.framesDecoded = metrics.counter(controller::MetricCounter::FramesDecoded);
+    baseline.decodeErrors = metrics.counter(controller::MetricCounter::DecodeErrors);
+    baseline.inputEventsIn = peer.inputStats().eventsIn;
+    baseline.inputEventsHost = host.stats().inputEvents;
+    return baseline;
+}
+
+void printImpairment(const char *path, const controller::ImpairmentStats &stats)
+{
+    std::printf("  %-16s %8llu %8llu %8llu %8llu %8llu\n", path, static_cast<unsigned long long>(stats.packets),
+                static_cast<unsigned long long>(stats.lost), static_cast<unsigned long long>(stats.queueDropped),
+                static_cast<unsigned long long>(stats.reordered), static_cast<unsigned long long>(stats.duplicated));
+}
+
+void printLatency(const char *stage, const controller::HistogramSummary &summary)
+{
+    std::printf("  %-16s %8.2f %8.2f %8.2f %8.2f %8llu\n", stage, summary.p50Ms, summary.p95Ms, summary.p99Ms,
+                summary.maxMs, static_cast<unsigned long long>(summary.count));
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Loopback benchmark of the controller receive pipeline"));
+    parser.addHelpOption();
+    const QCommandLineOption secondsOption(QStringLiteral("seconds"), QStringLiteral("Measured duration."),
+                                           QStringLiteral("s"), QStringLiteral("10"));
+    const QCommandLineOption widthOption(QStringLiteral("width"), QStringLiteral("Video width."), QStringLiteral("px"),
+                                         QStringLiteral("1920"));
+    const QCommandLineOption heightOption(QStringLiteral("height"), QStringLiteral("Video height."),
+                                          QStringLiteral("px"), QStringLiteral("1080"));
+    const QCommandLineOption fpsOption(QStringLiteral("fps"), QStringLiteral("Frame rate."), QStringLiteral("fps"),
+                                       QStringLiteral("60"));
+    const QCommandLineOption bitrateOption(QStringLiteral("bitrate"), QStringLiteral("Video bitrate."),
+                                           QStringLiteral("kbps"), QStringLiteral("8000"));
+    const QCommandLineOption impairmentOption(QStringLiteral("impairment"),
+                                              QStringLiteral("Network impairment profile for media and input."),
+                                              QStringLiteral("file"));
+    parser.addOptions({secondsOption, widthOption, heightOption, fpsOption, bitrateOption, impairmentOption});
+    parser.process(app);
+
+    Options options;
+    options.seconds = std::max(parser.value(secondsOption).toInt(), 1);
+    options.width = std::max(parser.value(widthOption).toInt(), 16) & ~1;
+    options.height = std::max(parser.value(heightOption).toInt(), 16) & ~1;
+    options.fps = std::clamp(parser.value(fpsOption).toInt(), 1, 240);
+    options.bitrateKbps = std::max(parser.value(bitrateOption).toInt(), 100);
+
+    std::optional<controller::ImpairmentProfile> impairment;
+    if (parser.isSet(impairmentOption)) {
+        controller::ImpairmentProfile profile;
+        std::string error;
+        if (!controller::loadImpairmentProfile(parser.value(impairmentOption).toStdString(), profile, &error)) {
+            std::fprintf(stderr, "impairment profile: %s\n", error.c_str());
+            return 1;
+        }
+        impairment = profile;
+    }
+
+    std::printf("encoding %dx%d test stream...\n", options.width, options.height);
+    std::vector<CannedFrame> video = encodeVideo(options, options.fps * 2);
+    std::vector<std::vector<std::uint8_t>> audio = encodeAudio();
+    if (video.empty() || !video.front().keyframe || audio.empty()) {
+        std::fprintf(stderr, "failed to encode the canned stream\n");
+        return 1;
+    }
+
+    auto metrics = std::make_shared<controller::MetricsRegistry>();
+    controller::WebRtcPeer peer;
+    peer.setMetrics(metrics);
+    peer.setNetworkImpairment(impairment);
+    LoopbackHost host(std::move(video), std::move(audio), options.fps);
+
+    // Signalling: peer signals arrive on libdatachannel threads and are
+    // queued to this thread, as they are for the real signalling client.
+    QObject::connect(&peer, &controller::WebRtcPeer::localDescriptionReady, &app,
+                     [&host](const QString &type, const QString &sdp) {
+                         host.setRemoteDescription(type.toStdString(), sdp.toStdString());
+                     });
+    QObject::connect(&peer, &controller::WebRtcPeer::localIceCandidate, &app,
+                     [&host](const QString &candidate, const QString &mid, int) {
+                         host.addRemoteCandidate(candidate.toStdString(), mid.toStdString());
+                     });
+    host.onDescription = [&peer](const std::string &type, const std::string &sdp) {
+        QMetaObject::invokeMethod(
+            &peer,
+            [&peer, type, sdp]() {
+                peer.setRemoteDescription(QString::fromStdString(type), QString::fromStdString(sdp));
+            },
+            Qt::QueuedConnection);
+    };
+    host.onCandidate = [&peer](const std::string &candidate, const std::string &mid) {
+        QMetaObject::invokeMethod(
+            &peer,
+            [&peer, candidate, mid]() {
+                peer.addRemoteIceCandidate(QString::fromStdString(candidate), QString::fromStdString(mid), -1);
+            },
+            Qt::QueuedConnection);
+    };
+
+    std::uint64_t framesPresented = 0;
+    QObject::connect(&peer, &controller::WebRtcPeer::videoFrameReady, &app, [&framesPresented](const QImage &) {
+        ++framesPresented;
+    });
+
+    // Simulated user: circles with the pointer, clicks and types now and then.
+    QTimer inputTimer;
+    inputTimer.setTimerType(Qt::PreciseTimer);
+    inputTimer.setInterval(kInputIntervalMs);
+    int inputTick = 0;
+    QObject::connect(&inputTimer, &QTimer::timeout, &app, [&peer, &inputTick]() {
+        const double angle = inputTick * 0.01;
+        const double x = 0.5 + 0.3 * std::cos(angle);
+        const double y = 0.5 + 0.3 * std::sin(angle);
+        peer.sendMouseMove(x, y);
+        if (inputTick % 100 == 0) {
+            peer.sendMouseClick(x, y, 1);
+        }
+        if (inputTick % 150 == 0) {
+            peer.sendKey(QStringLiteral("KeyA"), true);
+            peer.sendKey(QStringLiteral("KeyA"), false);
+        }
+        ++inputTick;
+    });
+
+    Baseline baseline;
+    int exitCode = 0;
+    const auto finish = [&]() {
+        inputTimer.stop();
+        host.stop();
+
+        const Baseline end = takeBaseline(host, peer, *metrics);
+        const double seconds = (end.wallUs - baseline.wallUs) / 1e6;
+        const std::uint64_t sent = end.videoFrames - baseline.videoFrames;
+        const std::uint64_t decoded = end.framesDecoded - baseline.framesDecoded;
+        const double cpuMs = (end.cpuUs - baseline.cpuUs) / 1000.0;
+        const controller::LatencyReport latency = peer.latencyReport();
+
+        std::printf("\n%dx%d @ %d fps, %d kbps, %.1f s over loopback\n\n", options.width, options.height, options.fps,
+                    options.bitrateKbps, seconds);
+        std::printf("throughput\n");
+        std::printf("  video sent        %8llu frames  %7.1f fps  %6.2f Mbps\n", static_cast<unsigned long long>(sent),
+                    sent / seconds, (end.videoBytes - baseline.videoBytes) * 8 / seconds / 1e6);
+        std::printf("  video decoded     %8llu frames  %7.1f fps  %llu errors\n",
+                    static_cast<unsigned long long>(decoded), decoded / seconds,
+                    static_cast<unsigned long long>(end.decodeErrors - baseline.decodeErrors));
+        std::printf("  video presented   %8llu frames  %7.1f fps\n", static_cast<unsigned long long>(framesPresented),
+                    framesPresented / seconds);
+        std::printf("  audio sent        %8llu frames\n",
+                    static_cast<unsigned long long>(end.audioFrames - baseline.audioFrames));
+        std::printf("  input events      %8llu in      %8llu at host\n",
+                    static_cast<unsigned long long>(end.inputEventsIn - baseline.inputEventsIn),
+                    static_cast<unsigned long long>(end.inputEventsHost - baseline.inputEventsHost));
+
+        std::printf("\nlatency (ms)            p50      p95      p99      max    count\n");
+        printLatency("decode", metrics->take(controller::MetricTimer::Decode));
+        printLatency("convert", metrics->take(controller::MetricTimer::Convert));
+        printLatency("glass-to-glass", latency.glassToGlass);
+        printLatency("input RTT", latency.inputRtt);
+
+        if (impairment) {
+            const controller::NetworkImpairmentStats stats = peer.networkImpairmentStats();
+            std::printf("\nimpairment, seed %llu (whole run)\n", static_cast<unsigned long long>(impairment->seed));
+            std::printf("  %-16s %8s %8s %8s %8s %8s\n", "", "packets", "lost", "dropped", "reorder", "dup");
+            printImpairment("video", stats.video);
+            printImpairment("audio", stats.audio);
+            printImpairment("input", stats.input);
+            printImpairment("motion", stats.motion);
+        }
+
+        std::printf("\ncpu (whole process, host side included)\n");
+        std::printf("  %.0f ms total, %.1f%% of one core, %.2f ms per decoded frame\n", cpuMs,
+                    100.0 * cpuMs / (seconds * 1000.0), decoded > 0 ? cpuMs / decoded : 0.0);
+
+        exitCode = decoded > 0 ? 0 : 1;
+        QCoreApplication::quit();
+    };
+
+    const auto measure = [&]() {
+        metrics->take(controller::MetricTimer::Decode);
+        metrics->take(controller::MetricTimer::Convert);
+        peer.resetLatencyMeasurement();
+        framesPresented = 0;
+        baseline = takeBaseline(host, peer, *metrics);
+        inputTimer.start();
+        QTimer::singleShot(options.seconds * 1000, &app, finish);
+    };
+
+    // Wait for ICE/DTLS, both tracks and the binary input handshake.
+    QTimer connectTimer;
+    connectTimer.setInterval(10);
+    const std::int64_t connectStartUs = steadyNowUs();
+    QObject::connect(&connectTimer, &QTimer::timeout, &app, [&]() {
+        if (host.mediaReady() && peer.binaryInputActive()) {
+            connectTimer.stop();
+            std::printf("connected in %.0f ms, warming up...\n", (steadyNowUs() - connectStartUs) / 1000.0);
+            host.startStreaming();
+            QTimer::singleShot(kWarmupMs, &app, measure);
+        } else if (steadyNowUs() - connectStartUs > kConnectTimeoutMs * 1000) {
+            std::fprintf(stderr, "loopback connection timed out\n");
+            exitCode = 1;
+            QCoreApplication::quit();
+        }
+    });
+
+    peer.createPeer();
+    peer.setLatencyMeasurementEnabled(true, kProbeIntervalMs);
+    peer.createOffer();
+    connectTimer.start();
+
+    app.exec();
+    host.stop();
+    peer.closePeer();
+    return exitCode;
+}
@@ -0,0 +1,249 @@
+// Signalling throughput over recorded Supabase Realtime traffic: the
+// QJsonDocument round trips SignalingClient used to do vs the single-pass
+// Phoenix codec. Decode runs every recorded frame the way
+// onSocketTextMessage() handles it; encode re-sends the offer/answer and
+// candidates found in the recording the way sendSignal() frames them.
+// Reports messages/sec and heap allocations per message.
+//
+//   signaling_codec_bench [bench/traffic/realtime_session.jsonl]
+
+#include "controller/PhoenixCodec.h"
+#include "controller/SignalingClient.h"
+
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QString>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+std::atomic<std::uint64_t> g_allocations{0};
+} // namespace
+
+#if defined(__GLIBC__)
+// Qt containers allocate with malloc(), not operator new, so count there;
+// operator new ends up here as well.
+extern "C" {
+void *__libc_malloc(std::size_t size);
+void *__libc_calloc(std::size_t count, std::size_t size);
+void *__libc_realloc(void *p, std::size_t size);
+void __libc_free(void *p);
+
+void *malloc(std::size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+void *calloc(std::size_t count, std::size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *p, std::size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(p, size);
+}
+
+void free(void *p)
+{
+    __libc_free(p);
+}
+}
+#else
+void *operator new(std::size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+#endif
+
+namespace {
+
+constexpr auto kDefaultTraffic = "bench/traffic/realtime_session.jsonl";
+constexpr auto kTopic = "realtime:remote:bench";
+
+struct Result
+{
+    double messagesPerSecond = 0.0;
+    double allocationsPerMessage = 0.0;
+    std::uint64_t checksum = 0;
+};
+
+template <typename Item, typename Fn>
+Result run(const std::vector<Item> &items, int rounds, Fn &&handle)
+{
+    using Clock = std::chrono::steady_clock;
+    Result result;
+    const std::uint64_t allocationsBefore = g_allocations.load();
+    const auto start = Clock::now();
+    for (int round = 0; round < rounds; ++round) {
+        for (const auto &item : items) {
+            result.checksum += handle(item);
+        }
+    }
+    const auto elapsed = Clock::now() - start;
+    const double total = static_cast<double>(items.size()) * rounds;
+    result.messagesPerSecond = total / std::chrono::duration<double>(elapsed).count();
+    result.allocationsPerMessage = static_cast<double>(g_allocations.load() - allocationsBefore) / total;
+    return result;
+}
+
+// What onSocketTextMessage() did before the codec.
+std::uint64_t decodeWithQJson(const QString &message)
+{
+    const auto obj = QJsonDocument::fromJson(message.toUtf8()).object();
+    const QString event = obj.value("event").toString();
+    if (event == "phx_reply") {
+        const auto payload = obj.value("payload").toObject();
+        return static_cast<std::uint64_t>(obj.value("ref").toString().size() + payload.value("status").toString().size());
+    }
+    if (event == "broadcast") {
+        const auto p = obj.value("payload").toObject();
+        if (p.value("type").toString() == "broadcast" && p.value("event").toString() == "signal") {
+            const auto inner = p.value("payload").toObject();
+            SignalEnvelope env{inner.value("type").toString(), inner};
+            env.data.remove("type");
+            return static_cast<std::uint64_t>(env.type.size() + env.data.size());
+        }
+    }
+    return 0;
+}
+
+std::uint64_t decodeWithCodec(const QString &message)
+{
+    const QByteArray utf8 = message.toUtf8();
+    controller::PhoenixFrame frame;
+    if (!controller::parsePhoenixFrame(std::string_view(utf8.constData(), static_cast<std::size_t>(utf8.size())),
+                                       frame)) {
+        return 0;
+    }
+    if (controller::jsonStringEquals(frame.event, "phx_reply")) {
+        std::string ref;
+        controller::decodeJsonString(frame.ref, ref);
+        return ref.size() + controller::jsonField(frame.payload, "status").size();
+    }
+    if (controller::jsonStringEquals(frame.event, "broadcast")) {
+        SignalEnvelope env;
+        if (controller::jsonStringEquals(controller::jsonField(frame.payload, "event"), "signal")
+            && SignalingClient::decodeSignalPayload(controller::jsonField(frame.payload, "payload"), env)) {
+            return static_cast<std::uint64_t>(env.type.size() + env.data.size());
+        }
+    }
+    return 0;
+}
+
+// What sendSignal() -> sendBroadcast() -> sendRaw() did before the codec.
+std::uint64_t encodeWithQJson(const SignalEnvelope &env, int ref)
+{
+    QJsonObject inner = env.data;
+    inner.insert("type", env.type);
+    const QJsonObject obj{
+        {"topic", kTopic},
+        {"event", "broadcast"},
+        {"payload", QJsonObject{{"type", "broadcast"}, {"event", "signal"}, {"payload", inner}}},
+        {"ref", QString::number(ref)},
+    };
+    const auto text = QString::fromUtf8(QJsonDocument(obj).toJson(QJsonDocument::Compact));
+    return static_cast<std::uint64_t>(text.size());
+}
+
+std::uint64_t encodeWithCodec(const SignalEnvelope &env, int ref, std::string &payload, std::string &frame)
+{
+    payload.assign("{\"type\":\"broadcast\",\"event\":\"signal\",\"payload\":");
+    SignalingClient::appendSignalPayload(payload, env);
+    payload.push_back('}');
+    frame.clear();
+    controller::appendPhoenixFrame(frame, kTopic, "broadcast", payload, std::to_string(ref));
+    const auto text = QString::fromUtf8(frame.data(), static_cast<int>(frame.size()));
+    return static_cast<std::uint64_t>(text.size());
+}
+
+void print(const char *name, const Result &result)
+{
+    std::printf("%-14s %14.0f %16.2f\n", name, result.messagesPerSecond, result.allocationsPerMessage);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const std::string path = argc > 1 ? argv[1] : kDefaultTraffic;
+    std::ifstream file(path);
+    if (!file) {
+        std::fprintf(stderr, "cannot open %s\n", path.c_str());
+        return 1;
+    }
+
+    std::vector<QString> messages;
+    std::size_t bytes = 0;
+    for (std::string line; std::getline(file, line);) {
+        if (!line.empty()) {
+            bytes += line.size();
+            messages.push_back(QString::fromStdString(line));
+        }
+    }
+    std::vector<SignalEnvelope> envelopes;
+    for (const QString &message : messages) {
+        const QByteArray utf8 = message.toUtf8();
+        controller::PhoenixFrame frame;
+        SignalEnvelope env;
+        if (controller::parsePhoenixFrame(std::string_view(utf8.constData(), static_cast<std::size_t>(utf8.size())),
+                                          frame)
+            && controller::jsonStringEquals(frame.event, "broadcast")
+            && SignalingClient::decodeSignalPayload(controller::jsonField(frame.payload, "payload"), env)) {
+            envelopes.push_back(env);
+        }
+    }
+    if (messages.empty() || envelopes.empty()) {
+        std::fprintf(stderr, "%s holds no signalling traffic\n", path.c_str());
+        return 1;
+    }
+    std::printf("%zu frames (%zu bytes), %zu signals\n\n", messages.size(), bytes, envelopes.size());
+
+    constexpr int kRounds = 2000;
+    const Result qjsonDecode = run(messages, kRounds, decodeWithQJson);
+    const Result codecDecode = run(messages, kRounds, decodeWithCodec);
+
+    int ref = 1;
+    const Result qjsonEncode = run(envelopes, kRounds, [&ref](const SignalEnvelope &env) {
+        return encodeWithQJson(env, ref++);
+    });
+    std::string payload;
+    std::string frame;
+    const Result codecEncode = run(envelopes, kRounds, [&](const SignalEnvelope &env) {
+        return encodeWithCodec(env, ref++, payload, frame);
+    });
+
+    std::printf("%-14s %14s %16s\n", "path", "messages/s", "allocs/message");
+    print("decode qjson", qjsonDecode);
+    print("decode codec", codecDecode);
+    print("encode qjson", qjsonEncode);
+    print("encode codec", codecEncode);
+    std::printf("checksum %llu\n", static_cast<unsigned long long>(qjsonDecode.checksum + codecDecode.checksum
+                                                                     + qjsonEncode.checksum + codecEncode.checksum));
+    return 0;
+}
@@ -0,0 +1,188 @@
+// SignalingClient against LocalRealtimeServer on the loopback interface:
+//
+//   join       time to phx_join ok, then heartbeat RTT over a few beats
+//   outage     every connection dropped and refused for a while; signals sent
+//              meanwhile must reach the server in order once the client rejoins
+//   heartbeat  heartbeat acks withheld; the client must notice within
+//              interval + ack timeout and rejoin without the TCP timeout
+//   join       joins rejected, then unanswered; the client must reconnect
+//              with backoff each time and join once the server accepts again
+//
+// Timers are shortened so a run takes a couple of seconds; exits non-zero if
+// a scenario fails.
+//
+//   signaling_resilience_bench [signals-during-outage]
+
+#include "controller/LocalRealtimeServer.h"
+#include "controller/PhoenixCodec.h"
+#include "controller/SignalingClient.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QEventLoop>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr int kHeartbeatIntervalMs = 200;
+constexpr int kHeartbeatTimeoutMs = 300;
+constexpr int kJoinTimeoutMs = 300;
+constexpr int kBackoffInitialMs = 50;
+constexpr int kBackoffMaxMs = 400;
+constexpr int kOutageMs = 600;
+constexpr int kScenarioTimeoutMs = 5000;
+
+bool waitFor(const std::function<bool()> &done, int timeoutMs = kScenarioTimeoutMs)
+{
+    QElapsedTimer timer;
+    timer.start();
+    while (!done()) {
+        if (timer.elapsed() > timeoutMs) {
+            return false;
+        }
+        QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents, 5);
+    }
+    return true;
+}
+
+void spin(int ms)
+{
+    waitFor([] { return false; }, ms);
+}
+
+double medianMs(std::vector<qint64> samplesUs)
+{
+    if (samplesUs.empty()) {
+        return -1.0;
+    }
+    std::sort(samplesUs.begin(), samplesUs.end());
+    return samplesUs[samplesUs.size() / 2] / 1000.0;
+}
+
+bool report(const char *scenario, bool ok, const char *detail)
+{
+    std::printf("%-10s %-4s %s\n", scenario, ok ? "ok" : "FAIL", detail);
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+    const int outageSignals = argc > 1 ? std::max(1, std::atoi(argv[1])) : 50;
+
+    controller::LocalRealtimeServer server;
+    if (!server.listen()) {
+        std::fprintf(stderr, "cannot listen on 127.0.0.1\n");
+        return 1;
+    }
+
+    // Sequence numbers of the signals the server saw, in arrival order.
+    std::vector<int> received;
+    QObject::connect(&server, &controller::LocalRealtimeServer::broadcastReceived, &app,
+                     [&received](const QString &, const QByteArray &payloadJson) {
+                         SignalEnvelope env;
+                         const std::string_view payload(payloadJson.constData(),
+                                                        static_cast<std::size_t>(payloadJson.size()));
+                         if (SignalingClient::decodeSignalPayload(controller::jsonField(payload, "payload"), env)) {
+                             received.push_back(env.data.value("seq").toInt(-1));
+                         }
+                     });
+
+    SignalingClient client;
+    client.setReconnectBackoff(kBackoffInitialMs, kBackoffMaxMs);
+    client.setHeartbeat(kHeartbeatIntervalMs, kHeartbeatTimeoutMs);
+    client.setJoinTimeout(kJoinTimeoutMs);
+    client.setCredentials(RealtimeCredentials{server.endpoint(), "local", "realtime:remote:bench", {}});
+
+    int joins = 0;
+    std::vector<qint64> rttUs;
+    QObject::connect(&client, &SignalingClient::joined, &app, [&joins] { ++joins; });
+    QObject::connect(&client, &SignalingClient::heartbeatRtt, &app, [&rttUs](qint64 us) { rttUs.push_back(us); });
+
+    std::printf("heartbeat %d ms, ack timeout %d ms, backoff %d..%d ms\n\n", kHeartbeatIntervalMs,
+                kHeartbeatTimeoutMs, kBackoffInitialMs, kBackoffMaxMs);
+    bool ok = true;
+    char detail[160];
+
+    // join
+    QElapsedTimer timer;
+    timer.start();
+    client.connectToRealtime();
+    bool passed = waitFor([&] { return joins == 1; });
+    const qint64 joinMs = timer.elapsed();
+    passed = passed && waitFor([&] { return rttUs.size() >= 5; });
+    std::snprintf(detail, sizeof(detail), "joined in %lld ms, heartbeat RTT median %.3f ms over %zu beats",
+                  static_cast<long long>(joinMs), medianMs(rttUs), rttUs.size());
+    ok &= report("join", passed, detail);
+
+    // outage
+    server.setAcceptConnections(false);
+    server.dropConnections();
+    timer.restart();
+    // Only what is sent after the client has seen the drop is queued; a signal
+    // written into the dying socket is gone, as it would be on a real network.
+    passed = waitFor([&] { return !client.isJoined(); });
+    for (int seq = 0; seq < outageSignals; ++seq) {
+        client.sendSignal(SignalEnvelope{"ice", QJsonObject{{"seq", seq}}});
+    }
+    const int queued = client.queuedSignals();
+    spin(kOutageMs);
+    server.setAcceptConnections(true);
+    passed = passed && waitFor([&] { return joins == 2 && static_cast<int>(received.size()) >= outageSignals; });
+    bool inOrder = static_cast<int>(received.size()) == outageSignals;
+    for (int seq = 0; inOrder && seq < outageSignals; ++seq) {
+        inOrder = received[static_cast<std::size_t>(seq)] == seq;
+    }
+    std::snprintf(detail, sizeof(detail), "rejoined %lld ms after the drop (%d ms refused), %d/%d queued signals in order",
+                  static_cast<long long>(timer.elapsed()), kOutageMs, inOrder ? queued : 0, outageSignals);
+    ok &= report("outage", passed && inOrder && queued == outageSignals, detail);
+
+    // heartbeat
+    const quint64 missedBefore = client.stats().missedHeartbeats;
+    server.setAckHeartbeats(false);
+    timer.restart();
+    passed = waitFor([&] { return client.stats().missedHeartbeats > missedBefore; });
+    const qint64 detectMs = timer.elapsed();
+    server.setAckHeartbeats(true);
+    passed = passed && waitFor([&] { return joins == 3; });
+    std::snprintf(detail, sizeof(detail), "missed ack noticed after %lld ms, rejoined after %lld ms",
+                  static_cast<long long>(detectMs), static_cast<long long>(timer.elapsed()));
+    ok &= report("heartbeat", passed && detectMs <= kHeartbeatIntervalMs + kHeartbeatTimeoutMs + 100, detail);
+
+    // join failures: rejected, then unanswered
+    int reconnectAttempts = 0;
+    const auto attempts = QObject::connect(&client, &SignalingClient::reconnecting, &app,
+                                           [&reconnectAttempts](int, int) { ++reconnectAttempts; });
+    const quint64 failuresBefore = client.stats().joinFailures;
+    server.setJoinReply(controller::LocalRealtimeServer::JoinReply::Error);
+    server.dropConnections();
+    timer.restart();
+    passed = waitFor([&] { return client.stats().joinFailures >= failuresBefore + 2; });
+    server.setJoinReply(controller::LocalRealtimeServer::JoinReply::None);
+    passed = passed && waitFor([&] { return client.stats().joinFailures >= failuresBefore + 4; });
+    server.setJoinReply(controller::LocalRealtimeServer::JoinReply::Ok);
+    passed = passed && waitFor([&] { return joins == 4; });
+    QObject::disconnect(attempts);
+    std::snprintf(detail, sizeof(detail), "%llu failed joins, %d reconnects, joined after %lld ms",
+                  static_cast<unsigned long long>(client.stats().joinFailures - failuresBefore), reconnectAttempts,
+                  static_cast<long long>(timer.elapsed()));
+    ok &= report("join-fail", passed && reconnectAttempts >= 4, detail);
+
+    const SignalingStats stats = client.stats();
+    std::printf("\nreconnects %llu, missed heartbeats %llu, queued %llu, dropped %llu, smoothed RTT %.3f ms\n",
+                static_cast<unsigned long long>(stats.reconnects),
+                static_cast<unsigned long long>(stats.missedHeartbeats),
+                static_cast<unsigned long long>(stats.queuedSignals),
+                static_cast<unsigned long long>(stats.droppedSignals), stats.smoothedRttUs / 1000.0);
+
+    client.disconnectFromRealtime();
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,255 @@
+// Signalling session setup at scale, with no network: every session is a
+// controller-side and a host-side SignalingClient joined to their own topic on
+// a LocalRealtimeServer. Hosts join first; then all controllers connect at once
+// and send their offer straight away (it waits in the outbound queue until the
+// join), the host answers with the SDP and one ice-batch signal.
+//
+// time to joined     connectToRealtime() -> phx_join ok
+// time to connected  connectToRealtime() -> answer and host candidates received
+//
+//   signaling_setup_bench [--sessions N] [--transport loopback|websocket] [--multiplex]
+//
+// loopback goes through LoopbackSignalingTransport in process; websocket
+// through the real RealtimeWebSocketTransport to the server on 127.0.0.1.
+// --multiplex runs all controllers over one RealtimeMultiplexer, i.e. one
+// connection of the chosen kind instead of one each.
+
+#include "controller/IceCandidateBatcher.h"
+#include "controller/LocalRealtimeServer.h"
+#include "controller/RealtimeMultiplexer.h"
+#include "controller/SignalingClient.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QEventLoop>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr int kDefaultSessions = 500;
+constexpr int kTimeoutMs = 60000;
+
+const char *const kOfferSdp =
+    "v=0\r\no=- 4611731400430051336 2 IN IP4 127.0.0.1\r\ns=-\r\nt=0 0\r\n"
+    "a=group:BUNDLE video audio input\r\na=msid-semantic: WMS\r\n"
+    "m=video 9 UDP/TLS/RTP/SAVPF 96\r\nc=IN IP4 0.0.0.0\r\na=ice-ufrag:Zx1q\r\n"
+    "a=ice-pwd:3l8Yq4vN2pJ0bXgS9kR1tW7m\r\na=ice-options:trickle\r\n"
+    "a=fingerprint:sha-256 6B:8B:F0:65:5F:78:E2:51:3B:AC:6F:F3:3F:46:1B:35:DC:B8:5F:64:1A:24:C2:43:F0:A1:58:D0:A1:2C:19:08\r\n"
+    "a=setup:actpass\r\na=mid:video\r\na=recvonly\r\na=rtcp-mux\r\na=rtpmap:96 H264/90000\r\n"
+    "a=rtcp-fb:96 nack\r\na=rtcp-fb:96 nack pli\r\n"
+    "a=fmtp:96 level-asymmetry-allowed=1;packetization-mode=1;profile-level-id=42e01f\r\n"
+    "m=audio 9 UDP/TLS/RTP/SAVPF 111\r\nc=IN IP4 0.0.0.0\r\na=mid:audio\r\na=recvonly\r\n"
+    "a=rtcp-mux\r\na=rtpmap:111 opus/48000/2\r\na=fmtp:111 minptime=10;useinbandfec=1\r\n"
+    "m=application 9 UDP/DTLS/SCTP webrtc-datachannel\r\nc=IN IP4 0.0.0.0\r\na=mid:input\r\n"
+    "a=sctp-port:5000\r\na=max-message-size:262144\r\n";
+
+const char *const kAnswerSdp =
+    "v=0\r\no=- 1718023447 2 IN IP4 127.0.0.1\r\ns=-\r\nt=0 0\r\n"
+    "a=group:BUNDLE video audio input\r\na=msid-semantic: WMS host\r\n"
+    "m=video 9 UDP/TLS/RTP/SAVPF 96\r\nc=IN IP4 0.0.0.0\r\na=ice-ufrag:p7Rk\r\n"
+    "a=ice-pwd:Hq2vL9zT4nB6xW1cF8mJ3sYd\r\na=ice-options:trickle\r\n"
+    "a=fingerprint:sha-256 1F:0C:9E:43:77:D2:8A:6B:5E:01:C4:39:AF:62:E8:1D:90:3B:7C:55:A8:0E:D6:24:B1:F7:39:C2:6A:08:E5:4D\r\n"
+    "a=setup:active\r\na=mid:video\r\na=sendonly\r\na=rtcp-mux\r\na=rtpmap:96 H264/90000\r\n"
+    "a=rtcp-fb:96 nack\r\na=rtcp-fb:96 nack pli\r\n"
+    "a=fmtp:96 level-asymmetry-allowed=1;packetization-mode=1;profile-level-id=42e01f\r\n"
+    "m=audio 9 UDP/TLS/RTP/SAVPF 111\r\nc=IN IP4 0.0.0.0\r\na=mid:audio\r\na=sendonly\r\n"
+    "a=rtcp-mux\r\na=rtpmap:111 opus/48000/2\r\na=fmtp:111 minptime=10;useinbandfec=1\r\n"
+    "m=application 9 UDP/DTLS/SCTP webrtc-datachannel\r\nc=IN IP4 0.0.0.0\r\na=mid:input\r\n"
+    "a=sctp-port:5000\r\na=max-message-size:262144\r\n";
+
+struct Session
+{
+    std::unique_ptr<SignalingClient> host;
+    std::unique_ptr<SignalingClient> controller;
+    qint64 startUs = -1;
+    qint64 joinedUs = -1;
+    qint64 connectedUs = -1;
+    bool answered = false;
+    bool candidates = false;
+};
+
+bool waitFor(const std::function<bool()> &done)
+{
+    QElapsedTimer timer;
+    timer.start();
+    while (!done()) {
+        if (timer.elapsed() > kTimeoutMs) {
+            return false;
+        }
+        QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents, 5);
+    }
+    return true;
+}
+
+double percentileMs(std::vector<qint64> samplesUs, double p)
+{
+    if (samplesUs.empty()) {
+        return -1.0;
+    }
+    std::sort(samplesUs.begin(), samplesUs.end());
+    const auto index = std::min(samplesUs.size() - 1, static_cast<std::size_t>(p * samplesUs.size()));
+    return samplesUs[index] / 1000.0;
+}
+
+void printRow(const char *name, const std::vector<qint64> &samplesUs)
+{
+    std::printf("%-18s %9.3f %9.3f %9.3f %9.3f\n", name, percentileMs(samplesUs, 0.50),
+                percentileMs(samplesUs, 0.95), percentileMs(samplesUs, 0.99), percentileMs(samplesUs, 1.0));
+}
+
+std::vector<controller::IceCandidate> hostCandidates()
+{
+    return {
+        {"candidate:1 1 UDP 2122252543 192.168.1.20 50812 typ host", "video", 0},
+        {"candidate:2 1 UDP 1686052863 203.0.113.7 50812 typ srflx raddr 192.168.1.20 rport 50812", "video", 0},
+        {"candidate:3 1 UDP 41885439 198.51.100.9 3478 typ relay raddr 203.0.113.7 rport 50812", "video", 0},
+    };
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+    int sessionCount = kDefaultSessions;
+    bool websocket = false;
+    bool multiplex = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--sessions") == 0 && i + 1 < argc) {
+            sessionCount = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--transport") == 0 && i + 1 < argc) {
+            websocket = std::strcmp(argv[++i], "websocket") == 0;
+        } else if (std::strcmp(argv[i], "--multiplex") == 0) {
+            multiplex = true;
+        } else {
+            std::fprintf(stderr, "usage: %s [--sessions N] [--transport loopback|websocket] [--multiplex]\n",
+                         argv[0]);
+            return 1;
+        }
+    }
+
+    controller::LocalRealtimeServer server;
+    if (websocket && !server.listen()) {
+        std::fprintf(stderr, "cannot listen on 127.0.0.1\n");
+        return 1;
+    }
+
+    controller::RealtimeMultiplexer multiplexer;
+    if (!websocket) {
+        multiplexer.setTransport(std::make_unique<controller::LoopbackSignalingTransport>(&server));
+    }
+
+    QElapsedTimer clock;
+    clock.start();
+    const auto nowUs = [&clock] { return clock.nsecsElapsed() / 1000; };
+    // Both sides advertise "ice-batch", so the host answers with one batch.
+    QJsonObject answerData{{"sdp", kAnswerSdp}};
+    controller::IceCandidateBatcher::advertise(answerData);
+    const SignalEnvelope answer{"answer", answerData};
+    const SignalEnvelope candidates = controller::IceCandidateBatcher::makeSignal(hostCandidates());
+
+    std::vector<Session> sessions(static_cast<std::size_t>(sessionCount));
+    int hostsJoined = 0;
+    int connected = 0;
+    for (int i = 0; i < sessionCount; ++i) {
+        Session &session = sessions[static_cast<std::size_t>(i)];
+        const RealtimeCredentials credentials{server.endpoint(), "local",
+                                              QStringLiteral("realtime:remote:setup-%1").arg(i), {}};
+        session.host = std::make_unique<SignalingClient>();
+        session.controller = std::make_unique<SignalingClient>();
+        for (SignalingClient *client : {session.host.get(), session.controller.get()}) {
+            if (!websocket) {
+                client->setTransport(std::make_unique<controller::LoopbackSignalingTransport>(&server));
+            }
+            client->setCredentials(credentials);
+        }
+        if (multiplex) {
+            session.controller->setTransport(multiplexer.createTransport());
+        }
+
+        SignalingClient *host = session.host.get();
+        QObject::connect(host, &SignalingClient::joined, &app, [&hostsJoined] { ++hostsJoined; });
+        QObject::connect(host, &SignalingClient::signalReceived, &app,
+                         [host, &answer, &candidates](const SignalEnvelope &env) {
+                             if (env.type == QLatin1String("offer")) {
+                                 host->sendSignal(answer);
+                                 host->sendSignal(candidates);
+                             }
+                         });
+        QObject::connect(session.controller.get(), &SignalingClient::joined, &app, [&session, &nowUs] {
+            session.joinedUs = nowUs() - session.startUs;
+        });
+        QObject::connect(session.controller.get(), &SignalingClient::signalReceived, &app,
+                         [&session, &connected, &nowUs](const SignalEnvelope &env) {
+                             session.answered |= env.type == QLatin1String("answer");
+                             session.candidates |= !controller::IceCandidateBatcher::candidatesFromSignal(env).empty();
+                             if (session.answered && session.candidates && session.connectedUs < 0) {
+                                 session.connectedUs = nowUs() - session.startUs;
+                                 ++connected;
+                             }
+                         });
+    }
+
+    for (Session &session : sessions) {
+        session.host->connectToRealtime();
+    }
+    if (!waitFor([&] { return hostsJoined == sessionCount; })) {
+        std::fprintf(stderr, "only %d of %d hosts joined\n", hostsJoined, sessionCount);
+        return 1;
+    }
+
+    QJsonObject offerData{{"sdp", kOfferSdp}};
+    controller::IceCandidateBatcher::advertise(offerData);
+    const SignalEnvelope offer{"offer", offerData};
+    const qint64 runStartUs = nowUs();
+    for (Session &session : sessions) {
+        session.startUs = nowUs();
+        session.controller->connectToRealtime();
+        session.controller->sendSignal(offer);
+    }
+    const bool finished = waitFor([&] { return connected == sessionCount; });
+    const double wallMs = (nowUs() - runStartUs) / 1000.0;
+
+    std::vector<qint64> joinUs;
+    std::vector<qint64> connectUs;
+    for (const Session &session : sessions) {
+        if (session.joinedUs >= 0) {
+            joinUs.push_back(session.joinedUs);
+        }
+        if (session.connectedUs >= 0) {
+            connectUs.push_back(session.connectedUs);
+        }
+    }
+
+    const controller::LocalRealtimeStats stats = server.stats();
+    std::printf("%d sessions over %s%s, %d connected in %.1f ms (%.0f sessions/s)\n", sessionCount,
+                websocket ? "websocket" : "loopback", multiplex ? " (multiplexed)" : "", connected, wallMs,
+                connected / (wallMs / 1000.0));
+    std::printf("server: %llu connections, %llu joins, %llu broadcasts\n\n",
+                static_cast<unsigned long long>(stats.connections), static_cast<unsigned long long>(stats.joins),
+                static_cast<unsigned long long>(stats.broadcasts));
+    if (multiplex) {
+        const controller::RealtimeMultiplexerStats muxStats = multiplexer.stats();
+        std::printf("multiplexer: %llu connections, %llu frames out, %llu in\n\n",
+                    static_cast<unsigned long long>(muxStats.connections),
+                    static_cast<unsigned long long>(muxStats.framesSent),
+                    static_cast<unsigned long long>(muxStats.framesReceived));
+    }
+    std::printf("%-18s %9s %9s %9s %9s\n", "ms", "p50", "p95", "p99", "max");
+    printRow("time to joined", joinUs);
+    printRow("time to connected", connectUs);
+
+    for (Session &session : sessions) {
+        session.controller->disconnectFromRealtime();
+        session.host->disconnectFromRealtime();
+    }
+    return finished ? 0 : 1;
+}
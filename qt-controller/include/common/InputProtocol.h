@@ -0,0 +1,439 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string_view>
+
+#include <QJsonObject>
+#include <QLatin1String>
+#include <QString>
+
+#include "common/Protocol.h"
+
+// Compact binary wire format for the "input" DataChannel.
+//
+// Every message starts with [version:u8][type:u8] followed by a fixed-size,
+// little-endian body. Pointer coordinates are normalised to the remote
+// screen (0..1) and quantised to u16. The controller opens the channel with
+// kInputBinaryProtocol as its DataChannel protocol; a host that understands
+// it answers with a HelloAck, and until then input is sent as JSON.
+//
+// Once binary input is active, pointer motion moves to the unreliable,
+// unordered kInputMotionChannelName channel as MotionMove messages. Each one
+// carries a sequence number so the host can drop moves that arrive after a
+// newer one (see isNewerInputSequence()); everything else stays on the
+// reliable channel.
+//
+// For latency measurements the controller sends LatencyProbe messages on the
+// reliable channel; the host answers each with a LatencyProbeEcho carrying
+// the probe unchanged plus its own clock at receipt. That clock must be the
+// one used for the capture timestamps embedded in the video (H264Sei.h).
+namespace Protocol {
+
+inline constexpr auto kInputBinaryProtocol = "remotedesk-input-bin/1";
+inline constexpr std::uint8_t kInputBinaryVersion = 1;
+
+enum class InputEventType : std::uint8_t
+{
+    MouseMove = 1,
+    MouseClick = 2,
+    MouseWheel = 3,
+    Key = 4,
+    Batch = 5,
+    MotionMove = 6,
+    LatencyProbe = 0x10,     // not an input event, see encodeLatencyProbe()
+    LatencyProbeEcho = 0x11,
+    HelloAck = 0x7F,
+};
+
+struct InputEvent
+{
+    InputEventType type = InputEventType::MouseMove;
+    double x = 0.0;       // normalised 0..1
+    double y = 0.0;       // normalised 0..1
+    int button = 0;
+    double deltaY = 0.0;
+    std::uint16_t keyCode = 0; // index into kKeyCodeNames, 0 = unknown
+    bool keyDown = true;
+    std::uint16_t sequence = 0; // MotionMove only
+};
+
+struct LatencyProbe
+{
+    std::uint32_t id = 0;
+    std::uint64_t sentUs = 0; // controller clock
+    std::uint64_t hostUs = 0; // host clock at receipt; echo only
+};
+
+inline constexpr std::size_t kInputHeaderSize = 2;
+inline constexpr std::size_t kMaxInputMessageSize = 8;
+// A batch is [version][Batch][count:u8] followed by `count` x [type:u8][body].
+inline constexpr std::size_t kMaxInputBatchEvents = 32;
+inline constexpr std::size_t kMaxInputBatchSize = kInputHeaderSize + 1 + kMaxInputBatchEvents * (kMaxInputMessageSize - 1);
+inline constexpr std::size_t kMaxLatencyProbeSize = kInputHeaderSize + 20;
+
+inline constexpr std::size_t inputBodySize(InputEventType type)
+{
+    switch (type) {
+    case InputEventType::MouseMove:
+        return 4;  // x:u16 y:u16
+    case InputEventType::MouseClick:
+        return 5;  // x:u16 y:u16 button:u8
+    case InputEventType::MouseWheel:
+        return 2;  // deltaY:i16
+    case InputEventType::Key:
+        return 3;  // code:u16 down:u8
+    case InputEventType::MotionMove:
+        return 6;  // seq:u16 x:u16 y:u16
+    case InputEventType::HelloAck:
+        return 1;  // highest version supported by the host
+    case InputEventType::Batch:
+        break;     // variable size, see encodeInputBatch()
+    case InputEventType::LatencyProbe:
+    case InputEventType::LatencyProbeEcho:
+        break;     // not input events, see encodeLatencyProbe()
+    }
+    return 0;
+}
+
+inline constexpr std::size_t latencyProbeBodySize(InputEventType type)
+{
+    if (type == InputEventType::LatencyProbe) {
+        return 12; // id:u32 sentUs:u64
+    }
+    if (type == InputEventType::LatencyProbeEcho) {
+        return 20; // id:u32 sentUs:u64 hostUs:u64
+    }
+    return 0;
+}
+
+// DOM KeyboardEvent.code values. The position in this table is the wire key
+// code (offset by one), so entries may only ever be appended.
+inline constexpr std::string_view kKeyCodeNames[] = {
+    "KeyA", "KeyB", "KeyC", "KeyD", "KeyE", "KeyF", "KeyG", "KeyH", "KeyI", "KeyJ", "KeyK", "KeyL", "KeyM",
+    "KeyN", "KeyO", "KeyP", "KeyQ", "KeyR", "KeyS", "KeyT", "KeyU", "KeyV", "KeyW", "KeyX", "KeyY", "KeyZ",
+    "Digit0", "Digit1", "Digit2", "Digit3", "Digit4", "Digit5", "Digit6", "Digit7", "Digit8", "Digit9",
+    "F1", "F2", "F3", "F4", "F5", "F6", "F7", "F8", "F9", "F10", "F11", "F12",
+    "Escape", "Tab", "CapsLock", "ShiftLeft", "ShiftRight", "ControlLeft", "ControlRight",
+    "AltLeft", "AltRight", "MetaLeft", "MetaRight", "Space", "Enter", "Backspace", "Delete", "Insert",
+    "Home", "End", "PageUp", "PageDown", "ArrowUp", "ArrowDown", "ArrowLeft", "ArrowRight",
+    "Minus", "Equal", "BracketLeft", "BracketRight", "Backslash", "Semicolon", "Quote", "Backquote",
+    "Comma", "Period", "Slash", "IntlBackslash", "ContextMenu", "PrintScreen", "ScrollLock", "Pause",
+    "NumLock", "Numpad0", "Numpad1", "Numpad2", "Numpad3", "Numpad4", "Numpad5", "Numpad6", "Numpad7",
+    "Numpad8", "Numpad9", "NumpadAdd", "NumpadSubtract", "NumpadMultiply", "NumpadDivide",
+    "NumpadDecimal", "NumpadEnter",
+};
+
+inline std::uint16_t keyCodeFromName(const QString &name)
+{
+    for (std::size_t i = 0; i < std::size(kKeyCodeNames); ++i) {
+        const auto &entry = kKeyCodeNames[i];
+        if (name == QLatin1String(entry.data(), static_cast<qsizetype>(entry.size()))) {
+            return static_cast<std::uint16_t>(i + 1);
+        }
+    }
+    return 0;
+}
+
+inline std::string_view keyNameFromCode(std::uint16_t code)
+{
+    if (code == 0 || code > std::size(kKeyCodeNames)) {
+        return {};
+    }
+    return kKeyCodeNames[code - 1];
+}
+
+namespace detail {
+
+inline std::uint16_t quantizeUnit(double value)
+{
+    const double clamped = value < 0.0 ? 0.0 : (value > 1.0 ? 1.0 : value);
+    return static_cast<std::uint16_t>(std::lround(clamped * 65535.0));
+}
+
+inline double dequantizeUnit(std::uint16_t value)
+{
+    return value / 65535.0;
+}
+
+inline void writeLe16(std::uint8_t *out, std::uint16_t value)
+{
+    out[0] = static_cast<std::uint8_t>(value & 0xFF);
+    out[1] = static_cast<std::uint8_t>(value >> 8);
+}
+
+inline std::uint16_t readLe16(const std::uint8_t *in)
+{
+    return static_cast<std::uint16_t>(in[0] | (in[1] << 8));
+}
+
+inline void writeLe32(std::uint8_t *out, std::uint32_t value)
+{
+    writeLe16(out, static_cast<std::uint16_t>(value & 0xFFFF));
+    writeLe16(out + 2, static_cast<std::uint16_t>(value >> 16));
+}
+
+inline std::uint32_t readLe32(const std::uint8_t *in)
+{
+    return static_cast<std::uint32_t>(readLe16(in)) | (static_cast<std::uint32_t>(readLe16(in + 2)) << 16);
+}
+
+inline void writeLe64(std::uint8_t *out, std::uint64_t value)
+{
+    writeLe32(out, static_cast<std::uint32_t>(value & 0xFFFFFFFFu));
+    writeLe32(out + 4, static_cast<std::uint32_t>(value >> 32));
+}
+
+inline std::uint64_t readLe64(const std::uint8_t *in)
+{
+    return static_cast<std::uint64_t>(readLe32(in)) | (static_cast<std::uint64_t>(readLe32(in + 4)) << 32);
+}
+
+} // namespace detail
+
+// Writes [type][body] for a single event; shared by plain and batched messages.
+inline std::size_t encodeInputBody(const InputEvent &event, std::uint8_t *out, std::size_t capacity)
+{
+    const std::size_t bodySize = inputBodySize(event.type);
+    if (bodySize == 0 || capacity < 1 + bodySize || (event.type == InputEventType::Key && event.keyCode == 0)) {
+        return 0;
+    }
+
+    out[0] = static_cast<std::uint8_t>(event.type);
+    std::uint8_t *body = out + 1;
+
+    switch (event.type) {
+    case InputEventType::MouseMove:
+        detail::writeLe16(body, detail::quantizeUnit(event.x));
+        detail::writeLe16(body + 2, detail::quantizeUnit(event.y));
+        break;
+    case InputEventType::MouseClick:
+        detail::writeLe16(body, detail::quantizeUnit(event.x));
+        detail::writeLe16(body + 2, detail::quantizeUnit(event.y));
+        body[4] = static_cast<std::uint8_t>(event.button);
+        break;
+    case InputEventType::MouseWheel: {
+        const long delta = std::lround(event.deltaY);
+        const auto clamped = static_cast<std::int16_t>(delta < -32768 ? -32768 : (delta > 32767 ? 32767 : delta));
+        detail::writeLe16(body, static_cast<std::uint16_t>(clamped));
+        break;
+    }
+    case InputEventType::Key:
+        detail::writeLe16(body, event.keyCode);
+        body[2] = event.keyDown ? 1 : 0;
+        break;
+    case InputEventType::MotionMove:
+        detail::writeLe16(body, event.sequence);
+        detail::writeLe16(body + 2, detail::quantizeUnit(event.x));
+        detail::writeLe16(body + 4, detail::quantizeUnit(event.y));
+        break;
+    case InputEventType::HelloAck:
+        body[0] = kInputBinaryVersion;
+        break;
+    case InputEventType::Batch:
+    case InputEventType::LatencyProbe:
+    case InputEventType::LatencyProbeEcho:
+        return 0;
+    }
+    return 1 + bodySize;
+}
+
+// Parses [type][body]. Returns the number of bytes consumed, or 0.
+inline std::size_t decodeInputBody(const std::uint8_t *data, std::size_t size, InputEvent &event)
+{
+    if (size < 1) {
+        return 0;
+    }
+    const auto type = static_cast<InputEventType>(data[0]);
+    const std::size_t bodySize = inputBodySize(type);
+    if (bodySize == 0 || size < 1 + bodySize) {
+        return 0;
+    }
+
+    const std::uint8_t *body = data + 1;
+    event = InputEvent();
+    event.type = type;
+
+    switch (type) {
+    case InputEventType::MouseMove:
+        event.x = detail::dequantizeUnit(detail::readLe16(body));
+        event.y = detail::dequantizeUnit(detail::readLe16(body + 2));
+        break;
+    case InputEventType::MouseClick:
+        event.x = detail::dequantizeUnit(detail::readLe16(body));
+        event.y = detail::dequantizeUnit(detail::readLe16(body + 2));
+        event.button = body[4];
+        break;
+    case InputEventType::MouseWheel:
+        event.deltaY = static_cast<std::int16_t>(detail::readLe16(body));
+        break;
+    case InputEventType::Key:
+        event.keyCode = detail::readLe16(body);
+        event.keyDown = body[2] != 0;
+        break;
+    case InputEventType::MotionMove:
+        event.sequence = detail::readLe16(body);
+        event.x = detail::dequantizeUnit(detail::readLe16(body + 2));
+        event.y = detail::dequantizeUnit(detail::readLe16(body + 4));
+        break;
+    case InputEventType::HelloAck:
+    case InputEventType::Batch:
+    case InputEventType::LatencyProbe:
+    case InputEventType::LatencyProbeEcho:
+        break;
+    }
+    return 1 + bodySize;
+}
+
+// Writes one event into `out`. Returns the number of bytes written, or 0 if
+// `capacity` is too small or the event cannot be expressed (unknown key).
+inline std::size_t encodeInputEvent(const InputEvent &event, std::uint8_t *out, std::size_t capacity)
+{
+    if (capacity < kInputHeaderSize) {
+        return 0;
+    }
+    out[0] = kInputBinaryVersion;
+    const std::size_t written = encodeInputBody(event, out + 1, capacity - 1);
+    return written > 0 ? written + 1 : 0;
+}
+
+// Packs up to kMaxInputBatchEvents events into one message. Events that
+// cannot be expressed are skipped; returns 0 if none could be.
+inline std::size_t encodeInputBatch(const InputEvent *events, std::size_t count, std::uint8_t *out, std::size_t capacity)
+{
+    if (capacity < kInputHeaderSize + 1 || count > kMaxInputBatchEvents) {
+        return 0;
+    }
+    out[0] = kInputBinaryVersion;
+    out[1] = static_cast<std::uint8_t>(InputEventType::Batch);
+    std::size_t offset = kInputHeaderSize + 1;
+    std::uint8_t encoded = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        const std::size_t written = encodeInputBody(events[i], out + offset, capacity - offset);
+        if (written > 0) {
+            offset += written;
+            ++encoded;
+        }
+    }
+    out[kInputHeaderSize] = encoded;
+    return encoded > 0 ? offset : 0;
+}
+
+// Parses one single-event message. Returns the number of bytes consumed, or
+// 0 when the data is truncated, of another version, a batch or of an unknown type.
+inline std::size_t decodeInputEvent(const std::uint8_t *data, std::size_t size, InputEvent &event)
+{
+    if (size < kInputHeaderSize || data[0] != kInputBinaryVersion) {
+        return 0;
+    }
+    const std::size_t consumed = decodeInputBody(data + 1, size - 1, event);
+    return consumed > 0 ? consumed + 1 : 0;
+}
+
+// Calls `onEvent(const InputEvent &)` for every event in a single or batched
+// message, in order. Returns false on malformed data.
+template <typename Fn>
+inline bool forEachInputEvent(const std::uint8_t *data, std::size_t size, Fn &&onEvent)
+{
+    if (size < kInputHeaderSize || data[0] != kInputBinaryVersion) {
+        return false;
+    }
+
+    InputEvent event;
+    if (static_cast<InputEventType>(data[1]) != InputEventType::Batch) {
+        if (decodeInputBody(data + 1, size - 1, event) == 0) {
+            return false;
+        }
+        onEvent(event);
+        return true;
+    }
+
+    if (size < kInputHeaderSize + 1) {
+        return false;
+    }
+    const std::size_t count = data[kInputHeaderSize];
+    std::size_t offset = kInputHeaderSize + 1;
+    for (std::size_t i = 0; i < count; ++i) {
+        const std::size_t consumed = decodeInputBody(data + offset, size - offset, event);
+        if (consumed == 0) {
+            return false;
+        }
+        onEvent(event);
+        offset += consumed;
+    }
+    return true;
+}
+
+// Writes a LatencyProbe or LatencyProbeEcho message. Returns the number of
+// bytes written, or 0 for another type or a too small `capacity`.
+inline std::size_t encodeLatencyProbe(InputEventType type, const LatencyProbe &probe, std::uint8_t *out,
+                                      std::size_t capacity)
+{
+    const std::size_t bodySize = latencyProbeBodySize(type);
+    if (bodySize == 0 || capacity < kInputHeaderSize + bodySize) {
+        return 0;
+    }
+    out[0] = kInputBinaryVersion;
+    out[1] = static_cast<std::uint8_t>(type);
+    detail::writeLe32(out + 2, probe.id);
+    detail::writeLe64(out + 6, probe.sentUs);
+    if (type == InputEventType::LatencyProbeEcho) {
+        detail::writeLe64(out + 14, probe.hostUs);
+    }
+    return kInputHeaderSize + bodySize;
+}
+
+// Parses a LatencyProbe or LatencyProbeEcho message into `type` and `probe`.
+inline bool decodeLatencyProbe(const std::uint8_t *data, std::size_t size, InputEventType &type, LatencyProbe &probe)
+{
+    if (size < kInputHeaderSize || data[0] != kInputBinaryVersion) {
+        return false;
+    }
+    type = static_cast<InputEventType>(data[1]);
+    const std::size_t bodySize = latencyProbeBodySize(type);
+    if (bodySize == 0 || size < kInputHeaderSize + bodySize) {
+        return false;
+    }
+    probe = LatencyProbe();
+    probe.id = detail::readLe32(data + 2);
+    probe.sentUs = detail::readLe64(data + 6);
+    if (type == InputEventType::LatencyProbeEcho) {
+        probe.hostUs = detail::readLe64(data + 14);
+    }
+    return true;
+}
+
+// Serial-number comparison (RFC 1982) for MotionMove sequence numbers.
+inline bool isNewerInputSequence(std::uint16_t sequence, std::uint16_t reference)
+{
+    return sequence != reference && static_cast<std::uint16_t>(sequence - reference) < 0x8000;
+}
+
+// JSON form of an event, for hosts that did not acknowledge the binary format.
+inline QJsonObject makeInputPayload(const InputEvent &event)
+{
+    switch (event.type) {
+    case InputEventType::MouseMove:
+    case InputEventType::MotionMove:
+        return makeMouseMovePayload(event.x, event.y);
+    case InputEventType::MouseClick:
+        return makeMouseClickPayload(event.x, event.y, event.button);
+    case InputEventType::MouseWheel:
+        return makeMouseWheelPayload(event.deltaY);
+    case InputEventType::Key: {
+        const auto name = keyNameFromCode(event.keyCode);
+        return makeKeyPayload(QString::fromLatin1(name.data(), static_cast<qsizetype>(name.size())),
+                              event.keyDown ? QStringLiteral("down") : QStringLiteral("up"));
+    }
+    case InputEventType::HelloAck:
+    case InputEventType::Batch:
+    case InputEventType::LatencyProbe:
+    case InputEventType::LatencyProbeEcho:
+        break;
+    }
+    return QJsonObject();
+}
+
+} // namespace Protocol
@@ -8,6 +8,7 @@ namespace Protocol {
 
 inline constexpr auto kApiBase = "https://www.ruoshui.fun";
 inline constexpr auto kInputChannelName = "input";
+inline constexpr auto kInputMotionChannelName = "input-motion";
 
 inline QJsonObject makeMouseMovePayload(double x, double y)
 {
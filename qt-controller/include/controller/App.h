@@ -7,6 +7,9 @@
 
 namespace controller {
 
+class AuthClient;
+class MetricsCollector;
+class SessionManager;
 class UiMainWindow;
 
 class App : public QObject
@@ -20,8 +23,13 @@ public:
     int run();
 
 private:
+    void bindSessions();
+
     QApplication m_app;
     std::unique_ptr<UiMainWindow> m_mainWindow;
+    std::unique_ptr<AuthClient> m_auth;
+    std::unique_ptr<MetricsCollector> m_metrics;
+    std::unique_ptr<SessionManager> m_sessions;
 };
 
 } // namespace controller
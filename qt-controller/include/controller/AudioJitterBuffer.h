@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "controller/RtpPacket.h"
+
+namespace controller {
+
+struct AudioJitterBufferConfig
+{
+    std::size_t capacity = 64;        // packets, rounded up to a power of two
+    std::size_t maxPacketSize = 1500; // bytes per ring slot
+    int clockRate = 48000;
+    int minDelayMs = 10;
+    int maxDelayMs = 120;
+    double jitterMultiplier = 2.0;    // target delay = multiplier * inter-arrival jitter
+};
+
+struct AudioJitterStats
+{
+    std::uint64_t packetsInserted = 0;
+    std::uint64_t packetsDuplicate = 0;
+    std::uint64_t packetsLate = 0;
+    std::uint64_t framesPlayed = 0;
+    std::uint64_t framesLost = 0;       // handed to the decoder for concealment/FEC
+    std::uint64_t framesDropped = 0;    // skipped to bring the delay back to the target
+    std::uint64_t underruns = 0;
+    double jitterMs = 0.0;
+    double targetDelayMs = 0.0;
+    double bufferedMs = 0.0;
+};
+
+struct AudioPacket
+{
+    std::uint32_t timestamp = 0;
+    const std::uint8_t *payload = nullptr; // null for a lost frame
+    std::size_t payloadSize = 0;
+    // Payload of the following packet when it is already here: Opus in-band
+    // FEC in it can rebuild a lost frame better than plain concealment.
+    const std::uint8_t *nextPayload = nullptr;
+    std::size_t nextPayloadSize = 0;
+};
+
+// Playout buffer for single-frame audio packets (Opus). Unlike the video
+// jitter buffer it is pulled at the audio device's pace: every pop() yields
+// the next frame, a lost frame to conceal, or nothing (underrun). An underrun
+// lets the caller conceal without advancing, which grows the delay by one
+// frame; when more than the target is buffered, a frame is dropped to shrink
+// it again. Playout starts once the target delay is buffered.
+//
+// Times are caller-supplied microseconds from a monotonic clock, so recorded
+// RTP can be replayed deterministically. Not thread safe.
+class AudioJitterBuffer
+{
+public:
+    enum class InsertResult
+    {
+        Inserted,
+        Duplicate,
+        Late,
+        Invalid,
+    };
+
+    enum class PopResult
+    {
+        Frame,
+        Lost,
+        Empty,
+    };
+
+    explicit AudioJitterBuffer(const AudioJitterBufferConfig &config = AudioJitterBufferConfig());
+
+    InsertResult insert(const std::uint8_t *data, std::size_t size, std::int64_t arrivalUs);
+
+    // Pointers in `out` stay valid until the next insert() or pop().
+    PopResult pop(AudioPacket &out);
+
+    void reset();
+
+    const AudioJitterStats &stats() const { return m_stats; }
+    std::int64_t targetDelayUs() const;
+    std::int64_t bufferedUs() const;
+    // RTP duration of one frame, learnt from the stream (20 ms until known).
+    std::uint32_t frameDuration() const { return m_frameDuration; }
+
+private:
+    struct Slot
+    {
+        bool used = false;
+        std::int64_t sequence = 0;
+        std::uint32_t timestamp = 0;
+        std::size_t size = 0;
+    };
+
+    std::int64_t unwrapSequence(std::uint16_t sequence);
+    std::int64_t frameDurationUs() const;
+    void updateJitter(const RtpPacketView &packet, std::int64_t arrivalUs);
+    Slot *findSlot(std::int64_t sequence);
+    const std::uint8_t *slotData(std::int64_t sequence) const;
+    void releaseHead();
+    void updateBufferedStats();
+
+    AudioJitterBufferConfig m_config;
+    std::size_t m_mask = 0;
+    std::vector<Slot> m_slots;
+    std::vector<std::uint8_t> m_storage;
+
+    bool m_started = false;
+    bool m_playing = false;
+    std::uint32_t m_ssrc = 0;
+    std::int64_t m_head = 0;    // next sequence number to play
+    std::int64_t m_highest = 0; // highest sequence number seen
+    std::int64_t m_lastSequence = 0;
+    std::uint32_t m_frameDuration = 0;
+    int m_framesSinceDrop = 0;
+
+    bool m_hasTransit = false;
+    std::int64_t m_lastTransitUs = 0;
+    std::uint32_t m_lastTimestamp = 0;
+    double m_jitterUs = 0.0;
+    double m_underrunFloorUs = 0.0;
+
+    AudioJitterStats m_stats;
+};
+
+} // namespace controller
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <memory>
+
+#include <QObject>
+
+#include "controller/PcmRingBuffer.h"
+
+class QAudioSink;
+
+namespace controller {
+
+class PcmRingDevice;
+
+// Plays the decoded audio in a PcmRingBuffer through the default output
+// device. The sink pulls from the ring, so the device clock paces playback;
+// when the ring runs dry the device gets silence instead of stalling.
+class AudioOutput : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int kDefaultBufferMs = 20;
+
+    explicit AudioOutput(std::shared_ptr<PcmRingBuffer> ring, QObject *parent = nullptr);
+    ~AudioOutput() override;
+
+    // Device-side buffer. Smaller means lower latency but more risk of
+    // glitches on a busy machine; takes effect on the next start().
+    void setBufferDurationMs(int ms);
+    int bufferDurationMs() const;
+
+    void start();
+    void stop();
+
+    // Samples of silence played because no decoded audio was ready.
+    quint64 underrunSamples() const;
+
+private:
+    std::shared_ptr<PcmRingBuffer> m_ring;
+    PcmRingDevice *m_device = nullptr;
+    QAudioSink *m_sink = nullptr;
+    int m_bufferMs = kDefaultBufferMs;
+};
+
+} // namespace controller
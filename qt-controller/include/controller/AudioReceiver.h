@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "controller/AudioJitterBuffer.h"
+#include "controller/AvSync.h"
+#include "controller/PcmRingBuffer.h"
+
+namespace controller {
+
+struct AudioReceiverStats
+{
+    AudioJitterStats jitter;
+    std::uint64_t framesConcealed = 0; // PLC for lost frames and underruns
+    std::uint64_t framesRecovered = 0; // lost frames rebuilt from in-band FEC
+    double playoutBufferedMs = 0.0;    // decoded audio waiting for the device
+};
+
+// Opus receive path: RTP packets from the network callback thread go into an
+// adaptive jitter buffer; a dedicated decode thread keeps `output` topped up
+// to the playout buffer duration, concealing lost frames, and the audio device
+// drains it. Nothing here touches the video or input threads, and nothing
+// needs a sound device, so a recorded stream can be pushed through and the
+// ring read back directly.
+class AudioReceiver
+{
+public:
+    static constexpr int kDefaultPlayoutBufferMs = 20;
+
+    explicit AudioReceiver(std::shared_ptr<PcmRingBuffer> output,
+                           const AudioJitterBufferConfig &jitterConfig = AudioJitterBufferConfig());
+    ~AudioReceiver();
+
+    AudioReceiver(const AudioReceiver &) = delete;
+    AudioReceiver &operator=(const AudioReceiver &) = delete;
+
+    // Set before start(). Audio is the master clock: every decoded frame
+    // reports when it will be heard.
+    void setAvSync(std::shared_ptr<AvSync> avSync);
+
+    void start();
+    void stop();
+
+    // Decoded audio kept queued ahead of the device, on top of the jitter buffer.
+    void setPlayoutBufferMs(int ms);
+    // Buffering in the device after the ring, for playout time estimates.
+    void setOutputLatencyMs(int ms);
+    // Muted: packets are dropped on arrival and the jitter buffer emptied, so
+    // nothing is decoded and the device can be closed. Sender reports still
+    // reach AvSync, which leaves video alone while no audio plays.
+    void setMuted(bool muted);
+
+    // Called from the libdatachannel track callback for every incoming packet.
+    void handleRtpPacket(const std::byte *data, std::size_t size);
+
+    AudioReceiverStats stats() const;
+
+private:
+    void decodeLoop();
+    std::size_t playoutTargetSamples() const;
+
+    std::shared_ptr<PcmRingBuffer> m_output;
+    std::atomic<int> m_playoutBufferMs{kDefaultPlayoutBufferMs};
+    std::atomic<int> m_outputLatencyMs{0};
+    std::shared_ptr<AvSync> m_avSync;
+    std::atomic<std::uint64_t> m_framesConcealed{0};
+    std::atomic<std::uint64_t> m_framesRecovered{0};
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wakeup;
+    AudioJitterBuffer m_jitterBuffer;
+    bool m_running = false;
+    bool m_muted = false;
+    std::thread m_thread;
+};
+
+} // namespace controller
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <functional>
+#include <vector>
 
 #include <QDateTime>
 #include <QJsonObject>
@@ -8,6 +9,8 @@
 #include <QObject>
 #include <QUrl>
 
+#include "controller/IceServer.h"
+
 class QNetworkReply;
 
 namespace controller {
@@ -43,11 +46,15 @@ public:
 public slots:
     void startDeviceFlow();
     void pollDeviceCode(const QString &deviceCode);
+    // STUN/TURN servers for the next PeerConnection. Start it alongside the
+    // session request so WebRtcPeer::prewarm() does not wait on it.
+    void fetchIceServers();
 
 signals:
     void deviceFlowStarted(const controller::DeviceStartResponse &response);
     void deviceFlowPending();
     void deviceFlowApproved(const controller::DevicePollApproved &response);
+    void iceServersReady(const std::vector<controller::IceServer> &servers);
     void requestFailed(const QString &context, const QString &errorString);
 
 private:
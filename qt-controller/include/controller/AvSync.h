@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <optional>
+
+#include "controller/Rtcp.h"
+
+namespace controller {
+
+struct AvSyncStats
+{
+    bool synchronized = false;   // both streams mapped and audio playing
+    double offsetMs = 0.0;       // smoothed; video minus audio at presentation, > 0 = video early
+    double lastOffsetMs = 0.0;
+    std::uint64_t framesHeld = 0;
+    std::uint64_t framesDropped = 0;
+};
+
+// Lip-sync with audio as the master clock. Each stream's RTP timestamps are
+// mapped onto the sender's wallclock through its latest RTCP sender report;
+// the audio path reports when each frame will actually be heard, and video
+// frames are held or dropped against that. Without an SR on both streams, or
+// while no audio is playing, video is left alone. Thread safe.
+class AvSync
+{
+public:
+    enum class Stream
+    {
+        Audio,
+        Video,
+    };
+
+    static constexpr int kAudioClockRate = 48000;
+    static constexpr int kVideoClockRate = 90000;
+
+    void onSenderReport(Stream stream, const RtcpSenderReport &report);
+
+    // Audio decode thread: the frame with `rtpTimestamp` reaches the speaker
+    // at `playoutUs` (local monotonic clock).
+    void onAudioScheduled(std::uint32_t rtpTimestamp, std::int64_t playoutUs);
+
+    // How far the video frame is ahead of the audio being heard at `nowUs`:
+    // > 0 means hold it that long, < 0 means it is late. Empty when the
+    // streams cannot be related (yet).
+    std::optional<std::int64_t> videoLeadUs(std::uint32_t rtpTimestamp, std::int64_t nowUs) const;
+
+    void onVideoPresented(std::uint32_t rtpTimestamp, std::int64_t nowUs);
+    void onVideoHeld();
+    void onVideoDropped();
+
+    void reset();
+    AvSyncStats stats() const;
+
+private:
+    struct ClockMapping
+    {
+        bool valid = false;
+        std::int64_t senderUs = 0;
+        std::uint32_t rtpTimestamp = 0;
+    };
+
+    struct AudioAnchor
+    {
+        bool valid = false;
+        std::int64_t senderUs = 0;
+        std::int64_t localUs = 0;
+    };
+
+    static std::optional<std::int64_t> toSenderUs(const ClockMapping &mapping, std::uint32_t rtpTimestamp, int clockRate);
+    std::optional<std::int64_t> audioClockUs(std::int64_t nowUs) const;
+    std::optional<std::int64_t> leadLocked(std::uint32_t rtpTimestamp, std::int64_t nowUs) const;
+
+    mutable std::mutex m_mutex;
+    ClockMapping m_audioMapping;
+    ClockMapping m_videoMapping;
+    AudioAnchor m_audioAnchor;
+    AvSyncStats m_stats;
+    bool m_hasOffset = false;
+};
+
+} // namespace controller
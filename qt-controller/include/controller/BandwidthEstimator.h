@@ -0,0 +1,128 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace controller {
+
+struct BandwidthEstimatorConfig
+{
+    int clockRate = 90000;
+    std::int64_t minBitrateBps = 300000;
+    std::int64_t maxBitrateBps = 50000000;
+    std::int64_t startBitrateBps = 5000000;
+    std::size_t trendlineWindow = 20;  // packet groups in the delay regression
+    double trendlineSmoothing = 0.9;
+    double trendlineGain = 4.0;
+};
+
+enum class BandwidthUsage
+{
+    Normal,
+    Underusing,
+    Overusing,
+};
+
+struct BandwidthEstimatorStats
+{
+    std::int64_t estimateBps = 0;
+    std::int64_t incomingBps = 0;
+    BandwidthUsage usage = BandwidthUsage::Normal;
+    double trend = 0.0;       // modified delay trend, compared against the threshold
+    double thresholdMs = 0.0; // adaptive overuse threshold
+    std::uint64_t overuseEvents = 0;
+};
+
+// Receive-side, delay-based congestion estimate in the style of Google
+// Congestion Control: packets are grouped per frame (RTP timestamp), the
+// growth of the one-way delay between groups is fitted with a trendline, an
+// adaptive threshold classifies the link as over-/underused, and an AIMD
+// controller turns that into a bitrate for REMB.
+//
+// The RTP timestamp stands in for the send time (no abs-send-time extension
+// is negotiated), so hosts should pace packets of a frame promptly.
+//
+// Times are caller-supplied microseconds, so recorded or simulated arrival
+// traces can be replayed deterministically. Not thread safe.
+class BandwidthEstimator
+{
+public:
+    explicit BandwidthEstimator(const BandwidthEstimatorConfig &config = BandwidthEstimatorConfig());
+
+    void onPacket(std::int64_t arrivalUs, std::uint32_t rtpTimestamp, std::size_t bytes);
+    void setRttUs(std::int64_t rttUs);
+    void reset();
+
+    std::int64_t estimateBps() const { return m_estimateBps; }
+    const BandwidthEstimatorStats &stats() const { return m_stats; }
+
+private:
+    struct PacketGroup
+    {
+        bool valid = false;
+        std::int64_t sendUs = 0;         // from the unwrapped RTP timestamp
+        std::int64_t firstArrivalUs = 0;
+        std::int64_t lastArrivalUs = 0;
+    };
+
+    struct TrendPoint
+    {
+        double arrivalMs = 0.0;
+        double smoothedDelayMs = 0.0;
+    };
+
+    // Incoming rate over a sliding window of fixed buckets.
+    static constexpr std::size_t kRateBuckets = 50;
+    static constexpr std::int64_t kRateBucketUs = 10000;
+
+    std::int64_t unwrapTimestamp(std::uint32_t timestamp);
+    void updateIncomingRate(std::int64_t arrivalUs, std::size_t bytes);
+    void onGroupComplete(const PacketGroup &previous, const PacketGroup &current);
+    void updateTrendline(double delayVariationMs, double arrivalMs);
+    void detect(double deltaMs, std::int64_t nowUs);
+    void updateThreshold(double trend, std::int64_t nowUs);
+    void updateEstimate(std::int64_t nowUs);
+
+    BandwidthEstimatorConfig m_config;
+
+    bool m_hasTimestamp = false;
+    std::int64_t m_lastTimestamp = 0;
+    PacketGroup m_current;
+    PacketGroup m_previous;
+
+    // Trendline over a ring of the last `trendlineWindow` groups.
+    std::array<TrendPoint, 64> m_trend{};
+    std::size_t m_trendCount = 0;
+    std::size_t m_trendNext = 0;
+    std::size_t m_groupCount = 0;
+    double m_firstArrivalMs = -1.0;
+    double m_accumulatedDelayMs = 0.0;
+    double m_smoothedDelayMs = 0.0;
+    double m_slope = 0.0;
+
+    // Overuse detector.
+    double m_threshold = 12.5;
+    std::int64_t m_lastThresholdUpdateUs = -1;
+    double m_overuseTimeMs = -1.0;
+    int m_overuseCount = 0;
+    double m_previousTrend = 0.0;
+    BandwidthUsage m_usage = BandwidthUsage::Normal;
+
+    // AIMD rate control.
+    std::int64_t m_estimateBps = 0;
+    std::int64_t m_lastEstimateUpdateUs = -1;
+    std::int64_t m_lastDecreaseUs = -1;
+    bool m_nearMax = false;            // increase additively near the last congested rate
+    std::int64_t m_congestedIncomingBps = 0;
+    std::int64_t m_rttUs = 100000;
+
+    std::array<std::int64_t, kRateBuckets> m_rateBytes{};
+    std::int64_t m_rateFirstBucket = -1;
+    std::int64_t m_rateNewestBucket = -1;
+    std::int64_t m_rateSum = 0;
+
+    BandwidthEstimatorStats m_stats;
+};
+
+} // namespace controller
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <QImage>
+
+#include "controller/VideoFrame.h"
+
+namespace controller {
+
+enum class ColorConversionBackend
+{
+    Auto,   // best available: libyuv, then AVX2, SSE2, scalar
+    LibYuv,
+    Avx2,
+    Sse2,
+    Scalar,
+};
+
+// Converts a BT.601 limited-range I420 picture into `target`
+// (QImage::Format_RGB32). `target` is only reallocated when the size or
+// format changes, so a caller-owned image is reused frame after frame.
+void convertI420ToRgb32(const I420FrameView &frame, QImage &target,
+                        ColorConversionBackend backend = ColorConversionBackend::Auto);
+
+// Shrinks `frame` by an integer `factor` in both directions into `storage`
+// (reused from call to call) and returns a view of the smaller picture, e.g.
+// for thumbnails: converting it costs 1/factor² of the full frame. Box
+// filtered with libyuv, nearest neighbour without it. Factors below 2 return
+// `frame` unchanged.
+I420FrameView downscaleI420(const I420FrameView &frame, int factor, std::vector<std::uint8_t> &storage);
+
+bool isColorConversionBackendAvailable(ColorConversionBackend backend);
+ColorConversionBackend resolveColorConversionBackend(ColorConversionBackend backend);
+const char *colorConversionBackendName(ColorConversionBackend backend);
+
+} // namespace controller
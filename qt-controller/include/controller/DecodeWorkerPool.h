@@ -0,0 +1,84 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace controller {
+
+// Work that a DecodeWorkerPool runs whenever it is due.
+class DecodeJob
+{
+public:
+    virtual ~DecodeJob() = default;
+
+    // Does what is due at `nowUs` (steady clock) and returns when to run
+    // again: a time in microseconds (<= nowUs for right away), or -1 to sleep
+    // until DecodeWorkerPool::wake().
+    virtual std::int64_t runDue(std::int64_t nowUs) = 0;
+};
+
+struct DecodeWorkerPoolStats
+{
+    std::size_t threads = 0;
+    std::size_t jobs = 0;
+    std::uint64_t runs = 0;
+    std::uint64_t busyUs = 0; // summed over all threads
+};
+
+// A fixed set of threads, one per core by default, shared by the decode work
+// of every stream instead of a thread per stream. A job runs on one thread at
+// a time and only when due, the earliest due first; between runs it costs
+// nothing. Jobs are expected to do one bounded piece of work per run (one
+// access unit) and ask to run again, so one busy stream cannot starve the
+// others.
+class DecodeWorkerPool
+{
+public:
+    using JobId = std::uint64_t;
+
+    // 0 = std::thread::hardware_concurrency().
+    explicit DecodeWorkerPool(std::size_t threads = 0);
+    ~DecodeWorkerPool();
+
+    DecodeWorkerPool(const DecodeWorkerPool &) = delete;
+    DecodeWorkerPool &operator=(const DecodeWorkerPool &) = delete;
+
+    std::size_t threadCount() const { return m_threads.size(); }
+
+    // The job must stay alive until remove() returns. It starts out due.
+    JobId add(DecodeJob *job);
+    // Waits for a run in progress to finish. Not from inside the job.
+    void remove(JobId id);
+    // Due now; a job that is running runs again right after.
+    void wake(JobId id);
+
+    DecodeWorkerPoolStats stats() const;
+
+private:
+    struct Entry
+    {
+        DecodeJob *job = nullptr;
+        std::int64_t dueUs = -1;
+        bool running = false;
+        bool rerun = false;
+    };
+
+    void workerLoop();
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wakeup;
+    std::condition_variable m_finished; // a run ended; remove() waits on it
+    std::unordered_map<JobId, Entry> m_jobs;
+    JobId m_nextId = 1;
+    bool m_stopping = false;
+    std::uint64_t m_runs = 0;
+    std::uint64_t m_busyUs = 0;
+    std::vector<std::thread> m_threads;
+};
+
+} // namespace controller
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace controller {
+
+// Lock-free single-producer/single-consumer "latest value wins" handoff
+// (triple buffer). The producer fills back() and publishes it; the consumer
+// picks up whatever was published last. Neither side ever waits, and values
+// the consumer did not get to in time are overwritten rather than queued, so
+// a stalled consumer cannot build up latency.
+template <typename T>
+class FrameMailbox
+{
+public:
+    FrameMailbox() = default;
+    FrameMailbox(const FrameMailbox &) = delete;
+    FrameMailbox &operator=(const FrameMailbox &) = delete;
+
+    // Producer side.
+    T &back() { return m_slots[m_back]; }
+
+    // Makes back() visible to the consumer. Returns true when the previously
+    // published value was never taken and has therefore been overwritten.
+    bool publish()
+    {
+        const std::uint8_t previous = m_middle.exchange(static_cast<std::uint8_t>(m_back | kFreshBit), std::memory_order_acq_rel);
+        m_back = previous & kIndexMask;
+        const bool overwritten = (previous & kFreshBit) != 0;
+        if (overwritten) {
+            m_overwritten.fetch_add(1, std::memory_order_relaxed);
+        }
+        return overwritten;
+    }
+
+    // Consumer side: swaps in the newest published value, if there is one.
+    bool take()
+    {
+        if ((m_middle.load(std::memory_order_relaxed) & kFreshBit) == 0) {
+            return false;
+        }
+        const std::uint8_t previous = m_middle.exchange(m_front, std::memory_order_acq_rel);
+        m_front = previous & kIndexMask;
+        return true;
+    }
+
+    T &front() { return m_slots[m_front]; }
+
+    std::uint64_t overwritten() const { return m_overwritten.load(std::memory_order_relaxed); }
+
+    // Drops all held values. Only valid while neither side is active.
+    void clear()
+    {
+        for (auto &slot : m_slots) {
+            slot = T();
+        }
+        m_middle.store(kInitialMiddle, std::memory_order_relaxed);
+        m_back = kInitialBack;
+        m_front = kInitialFront;
+    }
+
+private:
+    static constexpr std::uint8_t kIndexMask = 0x3;
+    static constexpr std::uint8_t kFreshBit = 0x4;
+    static constexpr std::uint8_t kInitialMiddle = 0;
+    static constexpr std::uint8_t kInitialBack = 1;
+    static constexpr std::uint8_t kInitialFront = 2;
+
+    std::array<T, 3> m_slots{};
+    std::atomic<std::uint8_t> m_middle{kInitialMiddle};
+    std::atomic<std::uint64_t> m_overwritten{0};
+    alignas(64) std::uint8_t m_back = kInitialBack;   // producer only
+    alignas(64) std::uint8_t m_front = kInitialFront; // consumer only
+};
+
+} // namespace controller
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "controller/VideoFrame.h"
+
+class ISVCDecoder;
+
+namespace controller {
+
+// Thin wrapper around the OpenH264 decoder. Not thread safe: one thread at a
+// time. It need not stay on the same one; pool workers take turns.
+class H264Decoder
+{
+public:
+    enum class Result
+    {
+        Frame,    // `frame` holds a decoded picture
+        NoOutput, // accepted, nothing to display yet (e.g. parameter sets only)
+        Error,    // bitstream error; references are unusable until the next keyframe
+    };
+
+    H264Decoder();
+    ~H264Decoder();
+
+    H264Decoder(const H264Decoder &) = delete;
+    H264Decoder &operator=(const H264Decoder &) = delete;
+
+    bool isValid() const { return m_decoder != nullptr; }
+    Result decode(const std::uint8_t *data, std::size_t size, std::uint32_t rtpTimestamp, I420FrameView &frame);
+
+private:
+    ISVCDecoder *m_decoder = nullptr;
+};
+
+} // namespace controller
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "controller/RtpPacket.h"
+
+namespace controller {
+
+struct H264AccessUnit
+{
+    std::vector<std::uint8_t> data; // Annex-B byte stream (start code prefixed NAL units)
+    std::uint32_t rtpTimestamp = 0;
+    bool keyframe = false;
+    bool complete = true;
+    // Some NAL unit has nal_ref_idc != 0. A complete unit without one is a
+    // disposable picture: nothing decoded later refers to it.
+    bool referenced = false;
+
+    void clear()
+    {
+        data.clear();
+        rtpTimestamp = 0;
+        keyframe = false;
+        complete = true;
+        referenced = false;
+    }
+};
+
+// Reassembles RFC 6184 payloads (single NAL, STAP-A, FU-A) into access units.
+// Packets must be pushed in sequence order; gaps mark the current unit incomplete.
+class H264Depacketizer
+{
+public:
+    H264Depacketizer();
+
+    // Returns true when `out` has been filled with a finished access unit. The
+    // unit is finished by the marker bit or, if that packet was lost, by the
+    // first packet of the next timestamp (which is then carried into the next unit).
+    bool push(const RtpPacketView &packet, H264AccessUnit &out);
+    // Finishes the unit in progress, for callers that know the frame boundary
+    // (e.g. the jitter buffer) when the marker bit was not set.
+    bool flush(H264AccessUnit &out);
+    void reset();
+
+private:
+    void appendPayload(const RtpPacketView &packet);
+    void appendNal(const std::uint8_t *nal, std::size_t size);
+    void noteNalHeader(std::uint8_t nalHeader);
+    void finish(H264AccessUnit &out);
+
+    H264AccessUnit m_current;
+    bool m_active = false;
+    bool m_hasExpectedSequence = false;
+    std::uint16_t m_expectedSequence = 0;
+    bool m_inFragment = false;
+};
+
+} // namespace controller
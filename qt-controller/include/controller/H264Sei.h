@@ -0,0 +1,27 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace controller {
+
+// Capture timestamps travel in-band as H.264 "user data unregistered" SEI
+// (payload type 5): this 16-byte UUID followed by the host's capture time in
+// microseconds as a big-endian u64. The host clock is the one it stamps
+// LatencyProbeEcho messages with, so the controller can translate it.
+inline constexpr std::array<std::uint8_t, 16> kCaptureTimestampSeiUuid = {
+    'R', 'D', 'E', 'S', 'K', '-', 'C', 'A', 'P', 'T', 'U', 'R', 'E', '-', 'T', 'S',
+};
+
+// Looks for a capture timestamp SEI in an Annex-B access unit. Only NAL units
+// ahead of the first slice are examined, so frames without one cost a few
+// byte compares.
+bool findCaptureTimestamp(const std::uint8_t *data, std::size_t size, std::int64_t &captureUs);
+
+// Host side: appends a start code prefixed SEI NAL unit carrying `captureUs`;
+// put it in front of the frame's slices.
+void appendCaptureTimestampSei(std::int64_t captureUs, std::vector<std::uint8_t> &out);
+
+} // namespace controller
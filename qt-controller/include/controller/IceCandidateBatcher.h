@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <QObject>
+#include <QTimer>
+
+#include "controller/IceServer.h"
+#include "controller/SignalingClient.h"
+
+namespace controller {
+
+struct IceBatcherStats
+{
+    std::uint64_t candidates = 0;
+    std::uint64_t broadcasts = 0; // signals they went out in
+};
+
+// Trickle ICE over the Phoenix channel in batches: local candidates are
+// collected for a short window, or until gathering completes, and go out as
+// one array-valued "ice-batch" signal instead of a broadcast (with its own
+// ref and frame) each.
+//
+//   {"type":"ice-batch","candidates":[{"candidate":"...","sdpMid":"video","sdpMLineIndex":0}, ...]}
+//
+// A lone candidate still goes out as a plain "ice" signal, and a window of 0
+// turns batching off.
+//
+// "ice-batch" is an extension the host has to understand: it advertises it
+// with "iceBatch":true next to the SDP of its description, or an "ice-batch"
+// signal of its own; see peerAdvertised(). Our own descriptions carry the flag
+// through advertise(). Until the first signal from the host shows whether it
+// does, candidates are held back; as the offerer, a pre-warmed peer releases
+// all of them together with the offer, so they then go out as one batch (or
+// one "ice" signal each for a host without the extension) once the answer is
+// in. GUI thread only.
+class IceCandidateBatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int kDefaultWindowMs = 20;
+
+    explicit IceCandidateBatcher(QObject *parent = nullptr);
+
+    void setWindowMs(int windowMs);
+    int windowMs() const { return m_windowMs; }
+
+    // Every signal received from the host: the first one settles whether it
+    // takes "ice-batch" and releases the held candidates.
+    void peerSignalReceived(const SignalEnvelope &signal);
+    // Settles it directly, e.g. from configuration; releases held candidates.
+    void setBatchingEnabled(bool enabled);
+    bool batchingEnabled() const { return m_batching; }
+    // Whether the host's support is known yet.
+    bool peerKnown() const { return m_peerKnown; }
+
+    // Adds the capability flag to the data of an offer/answer signal.
+    static void advertise(QJsonObject &descriptionData);
+    // Whether a received signal shows the sender understands "ice-batch".
+    static bool peerAdvertised(const SignalEnvelope &signal);
+
+    // Connect to WebRtcPeer::localIceCandidate / localIceGatheringComplete.
+    void addCandidate(const QString &candidate, const QString &sdpMid, int sdpMLineIndex);
+    // Sends what is pending now; candidates after this are not held back.
+    void gatheringComplete();
+    void flush();
+    // New transport (reconnect, new session): pending candidates are dropped.
+    void reset();
+
+    IceBatcherStats stats() const { return m_stats; }
+
+    static SignalEnvelope makeSignal(const std::vector<IceCandidate> &candidates);
+    // Candidates carried by a received "ice" or "ice-batch" signal; empty for
+    // anything else. Hand them to WebRtcPeer::addRemoteIceCandidates().
+    static std::vector<IceCandidate> candidatesFromSignal(const SignalEnvelope &signal);
+
+signals:
+    // Pass to SignalingClient::sendSignal().
+    void signalReady(const SignalEnvelope &signal);
+
+private:
+    int m_windowMs = kDefaultWindowMs;
+    bool m_batching = false;
+    bool m_peerKnown = false;
+    bool m_gatheringComplete = false;
+    std::vector<IceCandidate> m_pending;
+    QTimer m_timer;
+    IceBatcherStats m_stats;
+};
+
+} // namespace controller
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+
+namespace controller {
+
+// A STUN/TURN server as handed out by /api/ice.
+struct IceServer
+{
+    QStringList urls;
+    QString username;
+    QString credential;
+};
+
+// One trickled candidate, in either direction.
+struct IceCandidate
+{
+    QString candidate;
+    QString sdpMid;
+    int sdpMLineIndex = -1;
+};
+
+} // namespace controller
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include <QObject>
+#include <QTimer>
+
+#include "common/InputProtocol.h"
+
+namespace controller {
+
+struct InputSchedulerStats
+{
+    std::uint64_t eventsIn = 0;
+    std::uint64_t eventsCoalesced = 0; // moves replaced by a newer one, wheel steps summed
+    std::uint64_t messagesOut = 0;
+    std::uint64_t flushes = 0;
+    std::uint64_t eventsDropped = 0;   // stale moves discarded while throttled
+    std::uint64_t throttledPeriods = 0;
+};
+
+// Sits between input producers and the DataChannel. Pointer motion and wheel
+// steps are merged and sent at most once per flush interval; clicks and keys
+// flush whatever motion is pending and go out immediately, so their order
+// relative to the pointer is kept and they never wait for the timer.
+//
+// While throttled (the transport is backed up) motion is held back and keeps
+// coalescing instead of being sent; discrete events still go out at once.
+class InputScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    // Sends `count` events in order and returns the number of messages it took.
+    using Sink = std::function<std::size_t(const Protocol::InputEvent *events, std::size_t count)>;
+
+    static constexpr int kDefaultFlushIntervalMs = 4;
+
+    explicit InputScheduler(QObject *parent = nullptr);
+
+    void setSink(Sink sink);
+
+    // 0 sends every event as soon as it is submitted.
+    void setFlushInterval(int intervalMs);
+    int flushInterval() const;
+    // Flushes once per display refresh.
+    void setFlushRate(double refreshHz);
+
+    void submit(const Protocol::InputEvent &event);
+    void flush();
+    // Drops pending events, e.g. when the channel goes away.
+    void clear();
+
+    // Lifting the throttle flushes whatever motion accumulated meanwhile.
+    void setThrottled(bool throttled);
+    bool isThrottled() const;
+    std::size_t pendingEvents() const;
+
+    const InputSchedulerStats &stats() const { return m_stats; }
+
+private:
+    static bool isMotion(Protocol::InputEventType type);
+    bool coalesce(const Protocol::InputEvent &event);
+    void shedOldest();
+
+    Sink m_sink;
+    QTimer m_flushTimer;
+    int m_flushIntervalMs = kDefaultFlushIntervalMs;
+    bool m_throttled = false;
+    std::vector<Protocol::InputEvent> m_pending;
+    InputSchedulerStats m_stats;
+};
+
+} // namespace controller
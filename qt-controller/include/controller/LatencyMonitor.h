@@ -0,0 +1,112 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <vector>
+
+#include "common/InputProtocol.h"
+#include "controller/Metrics.h"
+
+namespace controller {
+
+struct LatencyReport
+{
+    HistogramSummary inputRtt;     // probe sent -> echo received
+    HistogramSummary glassToGlass; // host capture -> frame handed to the view
+    std::uint64_t probesSent = 0;
+    std::uint64_t probesAnswered = 0;
+    std::uint64_t framesStamped = 0; // decoded frames that carried a capture timestamp
+    bool clockSynchronized = false;
+    double clockOffsetMs = 0.0;    // host clock minus local clock
+};
+
+// Measurement mode for end-to-end latency. Input round trips come from
+// LatencyProbe/LatencyProbeEcho pairs on the input channel; the echoes also
+// give the host-to-local clock offset (taken from the fastest of the recent
+// round trips, NTP style), which turns the capture timestamps in the video
+// into capture-to-display latency per frame.
+//
+// Every sample is kept (up to a bound) for exact percentiles and CSV export.
+// Times are caller-supplied microseconds on the local monotonic clock.
+// Thread safe: frames are registered on the decode thread, the rest happens
+// on the GUI and network threads.
+class LatencyMonitor
+{
+public:
+    static constexpr std::size_t kDefaultMaxSamples = 100000;
+
+    explicit LatencyMonitor(std::size_t maxSamples = kDefaultMaxSamples);
+
+    void setEnabled(bool enabled);
+    bool isEnabled() const;
+
+    // Next probe to send; its id and send time come back in the echo.
+    Protocol::LatencyProbe nextProbe(std::int64_t nowUs);
+    // Returns the round trip, or nothing for an echo that matches no probe.
+    std::optional<std::int64_t> onProbeEcho(const Protocol::LatencyProbe &echo, std::int64_t nowUs);
+
+    // Decode thread: the frame with `rtpTimestamp` was captured at `hostCaptureUs`.
+    void onFrameCaptured(std::uint32_t rtpTimestamp, std::int64_t hostCaptureUs);
+    // The frame reached the view. Returns its glass-to-glass latency when the
+    // capture time and the clock offset are known.
+    std::optional<std::int64_t> onFramePresented(std::uint32_t rtpTimestamp, std::int64_t nowUs);
+
+    LatencyReport report() const;
+    // One row per sample: kind,time_us,latency_us.
+    void writeCsv(std::ostream &out) const;
+    void reset();
+
+private:
+    enum class SampleKind : std::uint8_t
+    {
+        InputRtt,
+        GlassToGlass,
+    };
+
+    struct Sample
+    {
+        SampleKind kind = SampleKind::InputRtt;
+        std::int64_t timeUs = 0;
+        std::int64_t latencyUs = 0;
+    };
+
+    struct OffsetSample
+    {
+        std::int64_t rttUs = 0;
+        std::int64_t offsetUs = 0;
+    };
+
+    struct CapturedFrame
+    {
+        bool valid = false;
+        std::uint32_t rtpTimestamp = 0;
+        std::int64_t hostCaptureUs = 0;
+    };
+
+    void addSample(SampleKind kind, std::int64_t timeUs, std::int64_t latencyUs);
+    HistogramSummary summarize(SampleKind kind) const;
+
+    mutable std::mutex m_mutex;
+    bool m_enabled = false;
+    std::size_t m_maxSamples;
+    std::vector<Sample> m_samples;
+
+    std::uint32_t m_nextProbeId = 1;
+    std::uint64_t m_probesSent = 0;
+    std::uint64_t m_probesAnswered = 0;
+    std::uint64_t m_framesStamped = 0;
+
+    std::array<OffsetSample, 16> m_offsets{};
+    std::size_t m_offsetCount = 0;
+    std::size_t m_offsetNext = 0;
+    std::optional<std::int64_t> m_clockOffsetUs;
+
+    std::array<CapturedFrame, 32> m_captured{};
+    std::size_t m_capturedNext = 0;
+};
+
+} // namespace controller
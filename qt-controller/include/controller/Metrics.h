@@ -0,0 +1,105 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace controller {
+
+struct HistogramSummary
+{
+    std::uint64_t count = 0;
+    double meanMs = 0.0;
+    double p50Ms = 0.0;
+    double p95Ms = 0.0;
+    double p99Ms = 0.0;
+    double maxMs = 0.0;
+};
+
+// Latency histogram with logarithmic buckets: exact below 8 us, then four
+// buckets per power of two (about 12% resolution) up to ~16 s. record() is
+// a few relaxed atomic adds and never blocks, so it is safe on the decode and
+// network threads; take() summarises and clears what was recorded since the
+// previous call.
+class LatencyHistogram
+{
+public:
+    static constexpr std::size_t kBucketCount = 96;
+
+    void record(std::int64_t us) noexcept;
+    HistogramSummary take() noexcept;
+
+private:
+    static std::size_t bucketFor(std::uint64_t us) noexcept;
+    static double bucketMidpointUs(std::size_t index) noexcept;
+
+    std::array<std::atomic<std::uint64_t>, kBucketCount> m_buckets{};
+    std::atomic<std::uint64_t> m_sumUs{0};
+    std::atomic<std::uint64_t> m_maxUs{0};
+};
+
+enum class MetricTimer
+{
+    Decode,       // H.264 decode of one access unit (decode thread)
+    Convert,      // I420 -> RGB32 of one frame (decode thread)
+    Render,       // VideoSurface paint (GUI thread)
+    Signaling,    // Realtime request -> phx_reply (GUI thread)
+    InputRtt,     // latency probe round trip on the input channel (network thread)
+    GlassToGlass, // host capture -> frame handed to the view (GUI thread)
+    Count,
+};
+
+enum class MetricCounter
+{
+    FramesDecoded,
+    FramesRendered,
+    FramesReplaced, // superseded on the VideoSurface before it was painted
+    DecodeErrors,
+    Count,
+};
+
+// Shared sink for the hot-path measurements. Each timer and counter sits on
+// its own cache line and is written by the one thread that owns that stage,
+// so recording costs an uncontended relaxed atomic and nothing is locked.
+// MetricsCollector reads it once per second.
+class MetricsRegistry
+{
+public:
+    void record(MetricTimer timer, std::int64_t us) noexcept
+    {
+        m_timers[static_cast<std::size_t>(timer)].histogram.record(us);
+    }
+
+    void increment(MetricCounter counter, std::uint64_t amount = 1) noexcept
+    {
+        m_counters[static_cast<std::size_t>(counter)].value.fetch_add(amount, std::memory_order_relaxed);
+    }
+
+    HistogramSummary take(MetricTimer timer) noexcept
+    {
+        return m_timers[static_cast<std::size_t>(timer)].histogram.take();
+    }
+
+    // Monotonic since construction.
+    std::uint64_t counter(MetricCounter counter) const noexcept
+    {
+        return m_counters[static_cast<std::size_t>(counter)].value.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct alignas(64) TimerSlot
+    {
+        LatencyHistogram histogram;
+    };
+
+    struct alignas(64) CounterSlot
+    {
+        std::atomic<std::uint64_t> value{0};
+    };
+
+    std::array<TimerSlot, static_cast<std::size_t>(MetricTimer::Count)> m_timers;
+    std::array<CounterSlot, static_cast<std::size_t>(MetricCounter::Count)> m_counters;
+};
+
+} // namespace controller
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QPointer>
+#include <QString>
+#include <QTimer>
+
+#include "controller/Metrics.h"
+
+class SignalingClient;
+
+namespace controller {
+
+class WebRtcPeer;
+
+// One aggregation interval. Rates, loss and histograms cover the interval;
+// RTT, jitter and queue depths are the values at its end.
+struct MetricsSnapshot
+{
+    qint64 timestampMs = 0; // wall clock, ms since the epoch
+    double intervalSeconds = 0.0;
+
+    double rttMs = 0.0; // 0 until ICE has measured one
+    double videoJitterMs = 0.0;
+    double audioJitterMs = 0.0;
+    double videoLossPercent = 0.0; // packets never recovered
+    double audioLossPercent = 0.0; // frames concealed for loss
+    std::int64_t incomingBps = 0;
+    std::int64_t estimateBps = 0;
+
+    double decodedFps = 0.0;
+    double renderedFps = 0.0;
+    // Lost in the jitter buffer, skipped for lip-sync, or replaced before the
+    // GUI thread or the widget got to them.
+    std::uint64_t framesDropped = 0;
+    std::uint64_t decodeErrors = 0;
+    HistogramSummary decode;
+    HistogramSummary convert;
+    HistogramSummary render;
+
+    std::size_t inputQueueDepth = 0;
+    std::size_t inputBufferedBytes = 0;
+    HistogramSummary signaling;
+    // Only while WebRtcPeer's latency measurement mode is on.
+    HistogramSummary inputRtt;
+    HistogramSummary glassToGlass;
+};
+
+// Aggregates the connection's health once per second. Hot paths write into
+// the shared MetricsRegistry (lock-free); everything else is sampled from
+// the peer's stats accessors here, on the GUI thread. Each round emits a
+// structured snapshot and a one-line summary for the metrics label.
+class MetricsCollector : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int kDefaultIntervalMs = 1000;
+
+    explicit MetricsCollector(QObject *parent = nullptr);
+
+    // Hand this to the peer and the video surface before they start.
+    std::shared_ptr<MetricsRegistry> registry() const { return m_registry; }
+
+    // The session being reported on; either may be switched at any time
+    // (nullptr detaches). A detached peer stops recording into the registry.
+    void setPeer(WebRtcPeer *peer);
+    void setSignalingClient(SignalingClient *client);
+
+    void start(int intervalMs = kDefaultIntervalMs);
+    void stop();
+
+    // The most recent completed interval.
+    const MetricsSnapshot &snapshot() const { return m_snapshot; }
+
+    static QString formatSummary(const MetricsSnapshot &snapshot);
+
+signals:
+    void snapshotReady(const controller::MetricsSnapshot &snapshot);
+    void summaryChanged(const QString &text);
+
+private:
+    // Monotonic totals from the stats accessors; snapshots report their deltas.
+    struct Totals
+    {
+        std::uint64_t videoPackets = 0;
+        std::uint64_t videoPacketsLost = 0;
+        std::uint64_t audioFrames = 0;
+        std::uint64_t audioFramesLost = 0;
+        std::uint64_t framesDecoded = 0;
+        std::uint64_t framesRendered = 0;
+        std::uint64_t framesDropped = 0;
+        std::uint64_t decodeErrors = 0;
+    };
+
+    void collect();
+    Totals readTotals() const;
+
+    std::shared_ptr<MetricsRegistry> m_registry;
+    QPointer<WebRtcPeer> m_peer;
+    QPointer<SignalingClient> m_signaling;
+    QMetaObject::Connection m_signalingConnection;
+    QTimer m_timer;
+    QElapsedTimer m_interval;
+    Totals m_previous;
+    MetricsSnapshot m_snapshot;
+};
+
+} // namespace controller
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+
+namespace controller {
+
+// One direction of a simulated link. All zero means a perfect link.
+struct ImpairmentConfig
+{
+    double lossPercent = 0.0;      // average packet loss
+    double burstLength = 1.0;      // mean packets per loss burst; 1 = independent losses
+    int delayMs = 0;               // one-way propagation delay
+    int jitterMs = 0;              // uniform extra delay in [0, jitterMs]
+    double reorderPercent = 0.0;   // packets held back by reorderDelayMs so later ones overtake them
+    int reorderDelayMs = 10;
+    double duplicatePercent = 0.0;
+    int bandwidthKbps = 0;         // bottleneck rate; 0 = unlimited
+    int queueMs = 300;             // bottleneck queue; packets that would wait longer are dropped
+
+    bool isActive() const
+    {
+        return lossPercent > 0.0 || delayMs > 0 || jitterMs > 0 || reorderPercent > 0.0 || duplicatePercent > 0.0
+               || bandwidthKbps > 0;
+    }
+};
+
+// A profile file: a seed plus one section per impaired path.
+//
+//   seed = 42
+//   [media]            # received RTP/RTCP, video and audio
+//   loss_percent = 2
+//   burst_length = 3
+//   delay_ms = 40
+//   jitter_ms = 15
+//   [input]            # input DataChannel messages we send
+//   delay_ms = 40
+//
+// Keys are the ImpairmentConfig fields in snake_case; '#' starts a comment.
+struct ImpairmentProfile
+{
+    std::uint64_t seed = 1;
+    ImpairmentConfig media;
+    ImpairmentConfig input;
+};
+
+bool parseImpairmentProfile(std::istream &in, ImpairmentProfile &profile, std::string *error = nullptr);
+bool loadImpairmentProfile(const std::string &path, ImpairmentProfile &profile, std::string *error = nullptr);
+
+struct ImpairmentStats
+{
+    std::uint64_t packets = 0;
+    std::uint64_t lost = 0;          // random loss (on a reliable path: retransmitted late instead)
+    std::uint64_t queueDropped = 0;  // tail-dropped at the bandwidth cap or a full link queue
+    std::uint64_t duplicated = 0;
+    std::uint64_t reordered = 0;
+    std::size_t inFlight = 0;        // scheduled, not yet delivered
+    std::size_t queuedBytes = 0;     // of those
+};
+
+struct NetworkImpairmentStats
+{
+    ImpairmentStats video;
+    ImpairmentStats audio;
+    ImpairmentStats input;  // reliable input channel
+    ImpairmentStats motion; // unreliable motion channel
+};
+
+// Decides the fate of each packet on a simulated link: Gilbert-Elliott
+// (bursty) loss, a bandwidth cap with a bounded FIFO queue, propagation
+// delay with jitter, reordering and duplication.
+//
+// Every random draw comes from a generator seeded by the caller, one draw
+// sequence per packet, so a given seed makes the same loss, jitter, reorder
+// and duplicate decisions for the same packets on every machine. Bandwidth
+// cap drops (and ImpairedLink's queue limit) depend on packet arrival times
+// as well, so they only repeat when the traffic's timing does. Reliable
+// paths (SCTP) never lose, duplicate or reorder a message: a loss turns into
+// a late retransmission instead.
+//
+// Times are caller-supplied microseconds. Not thread safe.
+class NetworkImpairment
+{
+public:
+    struct Decision
+    {
+        int copies = 0; // 0 = dropped, 2 = duplicated
+        std::int64_t releaseUs[2] = {0, 0};
+    };
+
+    NetworkImpairment(const ImpairmentConfig &config, std::uint64_t seed, bool reliable = false);
+
+    Decision onPacket(std::size_t bytes, std::int64_t nowUs);
+
+    const ImpairmentStats &stats() const { return m_stats; }
+
+private:
+    double uniform() { return std::uniform_real_distribution<double>(0.0, 1.0)(m_random); }
+    bool nextLoss();
+
+    ImpairmentConfig m_config;
+    bool m_reliable;
+    std::mt19937_64 m_random;
+    double m_enterBurst = 0.0; // good -> lossy state transition probability
+    double m_leaveBurst = 1.0; // lossy -> good
+    bool m_inBurst = false;
+    std::int64_t m_linkFreeUs = 0;    // when the bottleneck finishes sending what it has queued
+    std::int64_t m_lastReleaseUs = 0; // keeps non-reordered packets in FIFO order
+    ImpairmentStats m_stats;
+};
+
+// NetworkImpairment on a thread of its own: push() schedules a delivery
+// action and the link thread runs it at its release time. The actions run on
+// the link thread, in release order.
+//
+// What is scheduled is bounded by maxQueuedBytes: past it, push() refuses the
+// packet (a drop on an unreliable path; on a reliable one the sender should
+// treat it as a full send buffer). Like a DataChannel, the link reports its
+// queue (queuedBytes()) and calls back when it drains below a threshold.
+class ImpairedLink
+{
+public:
+    using Action = std::function<void()>;
+
+    static constexpr std::size_t kDefaultMaxQueuedBytes = 4 * 1024 * 1024;
+
+    ImpairedLink(const ImpairmentConfig &config, std::uint64_t seed, bool reliable = false,
+                 std::size_t maxQueuedBytes = kDefaultMaxQueuedBytes);
+    ~ImpairedLink();
+
+    ImpairedLink(const ImpairedLink &) = delete;
+    ImpairedLink &operator=(const ImpairedLink &) = delete;
+
+    void start();
+    // Pending deliveries are discarded.
+    void stop();
+
+    // `deliver` runs once per delivered copy; it must be copyable. False if
+    // the packet was refused (full queue, or the link is stopped); a packet
+    // the simulated network loses was still sent.
+    bool push(std::size_t bytes, Action deliver);
+
+    std::size_t queuedBytes() const;
+    // Runs on the link thread whenever a delivery takes the queue from above
+    // `threshold` to at or below it. Set before start().
+    void onQueuedBytesLow(std::size_t threshold, Action callback);
+
+    ImpairmentStats stats() const;
+
+private:
+    void run();
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_cv;
+    NetworkImpairment m_impairment;
+    struct Pending
+    {
+        std::size_t bytes = 0;
+        Action deliver;
+    };
+    // Keyed by release time, then arrival order, so equal release times keep FIFO order.
+    std::map<std::pair<std::int64_t, std::uint64_t>, Pending> m_pending;
+    std::uint64_t m_sequence = 0;
+    std::size_t m_maxQueuedBytes;
+    std::size_t m_queuedBytes = 0;
+    std::size_t m_lowThreshold = 0;
+    Action m_onLow;
+    ImpairmentStats m_stats; // refusals; the rest is m_impairment's
+    bool m_running = false;
+    std::thread m_thread;
+};
+
+} // namespace controller
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+struct OpusDecoder;
+
+namespace controller {
+
+// Thin wrapper around libopus. Always decodes to 48 kHz interleaved stereo
+// s16, whatever the sender encoded. Not thread safe: create, use and destroy
+// it on the decode thread.
+class OpusAudioDecoder
+{
+public:
+    static constexpr int kSampleRate = 48000;
+    static constexpr int kChannels = 2;
+    static constexpr int kMaxFrameSamples = 5760; // 120 ms, the longest Opus packet
+
+    OpusAudioDecoder();
+    ~OpusAudioDecoder();
+
+    OpusAudioDecoder(const OpusAudioDecoder &) = delete;
+    OpusAudioDecoder &operator=(const OpusAudioDecoder &) = delete;
+
+    bool isValid() const { return m_decoder != nullptr; }
+
+    // All calls return samples per channel written to `pcm` (which must hold
+    // kMaxFrameSamples * kChannels values), or -1 on error.
+    int decode(const std::uint8_t *data, std::size_t size, std::int16_t *pcm);
+    // Rebuilds the frame before `nextData` from the FEC data in it.
+    int decodeFec(const std::uint8_t *nextData, std::size_t nextSize, int frameSamples, std::int16_t *pcm);
+    // Packet-loss concealment for one missing frame.
+    int conceal(int frameSamples, std::int16_t *pcm);
+    void reset();
+
+    // Duration of the last decoded frame, used to size concealment.
+    int lastFrameSamples() const { return m_lastFrameSamples; }
+
+private:
+    OpusDecoder *m_decoder = nullptr;
+    int m_lastFrameSamples = kSampleRate / 50;
+};
+
+} // namespace controller
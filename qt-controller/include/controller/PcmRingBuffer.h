@@ -0,0 +1,86 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace controller {
+
+// Lock-free single-producer/single-consumer ring of interleaved s16 samples
+// between the audio decode thread and the audio device. Neither side ever
+// blocks: the producer writes what fits, the consumer reads what is there.
+class PcmRingBuffer
+{
+public:
+    explicit PcmRingBuffer(std::size_t capacitySamples)
+    {
+        std::size_t capacity = 1;
+        while (capacity < capacitySamples) {
+            capacity <<= 1;
+        }
+        m_samples.resize(capacity);
+        m_mask = capacity - 1;
+    }
+
+    PcmRingBuffer(const PcmRingBuffer &) = delete;
+    PcmRingBuffer &operator=(const PcmRingBuffer &) = delete;
+
+    std::size_t capacity() const { return m_samples.size(); }
+
+    std::size_t available() const
+    {
+        return m_writeIndex.load(std::memory_order_acquire) - m_readIndex.load(std::memory_order_acquire);
+    }
+
+    // Producer side. Returns the number of samples written.
+    std::size_t write(const std::int16_t *samples, std::size_t count)
+    {
+        const std::size_t write = m_writeIndex.load(std::memory_order_relaxed);
+        const std::size_t read = m_readIndex.load(std::memory_order_acquire);
+        count = std::min(count, capacity() - (write - read));
+        copyIn(write, samples, count);
+        m_writeIndex.store(write + count, std::memory_order_release);
+        return count;
+    }
+
+    // Consumer side. Returns the number of samples read.
+    std::size_t read(std::int16_t *samples, std::size_t count)
+    {
+        const std::size_t read = m_readIndex.load(std::memory_order_relaxed);
+        const std::size_t write = m_writeIndex.load(std::memory_order_acquire);
+        count = std::min(count, write - read);
+        copyOut(read, samples, count);
+        m_readIndex.store(read + count, std::memory_order_release);
+        return count;
+    }
+
+    // Consumer side: discards everything queued.
+    void clear() { m_readIndex.store(m_writeIndex.load(std::memory_order_acquire), std::memory_order_release); }
+
+private:
+    void copyIn(std::size_t index, const std::int16_t *samples, std::size_t count)
+    {
+        const std::size_t offset = index & m_mask;
+        const std::size_t first = std::min(count, capacity() - offset);
+        std::memcpy(m_samples.data() + offset, samples, first * sizeof(std::int16_t));
+        std::memcpy(m_samples.data(), samples + first, (count - first) * sizeof(std::int16_t));
+    }
+
+    void copyOut(std::size_t index, std::int16_t *samples, std::size_t count) const
+    {
+        const std::size_t offset = index & m_mask;
+        const std::size_t first = std::min(count, capacity() - offset);
+        std::memcpy(samples, m_samples.data() + offset, first * sizeof(std::int16_t));
+        std::memcpy(samples + first, m_samples.data(), (count - first) * sizeof(std::int16_t));
+    }
+
+    std::vector<std::int16_t> m_samples;
+    std::size_t m_mask = 0;
+    alignas(64) std::atomic<std::size_t> m_writeIndex{0};
+    alignas(64) std::atomic<std::size_t> m_readIndex{0};
+};
+
+} // namespace controller
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace controller {
+
+// Single-pass codec for Phoenix channel frames (Supabase Realtime):
+//
+//   {"topic":"realtime:x","event":"broadcast","payload":{...},"ref":"7"}
+//
+// Parsing only finds where the top-level members are. Every value comes back
+// as a raw JSON token, a view into the caller's text (strings keep their
+// quotes and escapes), so a payload nobody looks at is never decoded and
+// nested objects are walked on demand. Views stay valid as long as the text.
+struct PhoenixFrame
+{
+    std::string_view topic;
+    std::string_view event;
+    std::string_view payload;
+    std::string_view ref;     // "null" or absent for server pushes
+    std::string_view joinRef;
+};
+
+// False if `text` is not a JSON object; missing members stay empty.
+bool parsePhoenixFrame(std::string_view text, PhoenixFrame &frame);
+
+// Raw value of `key` in a JSON object token; empty if absent or not an object.
+std::string_view jsonField(std::string_view object, std::string_view key);
+
+// Walks the members of a JSON object token in order:
+//
+//   JsonObjectReader reader(object);
+//   while (reader.next(key, value)) { ... }
+//
+// Keys and values are raw tokens; ok() tells a clean end from malformed input.
+class JsonObjectReader
+{
+public:
+    explicit JsonObjectReader(std::string_view object);
+
+    bool next(std::string_view &key, std::string_view &value);
+    bool ok() const { return m_ok; }
+
+private:
+    std::string_view m_text;
+    std::size_t m_pos = 0;
+    bool m_first = true;
+    bool m_done = false;
+    bool m_ok = true;
+};
+
+bool isJsonString(std::string_view raw);
+// Compares a raw string token with plain UTF-8 text, unescaping only if needed.
+bool jsonStringEquals(std::string_view raw, std::string_view text);
+// Unescapes a raw string token (\uXXXX and surrogate pairs become UTF-8).
+bool decodeJsonString(std::string_view raw, std::string &out);
+
+// Writers append compact JSON to `out`, so a caller can reuse one buffer.
+void appendJsonString(std::string &out, std::string_view utf8);
+// `payloadJson` must already be valid JSON; the other arguments are plain text.
+// An empty `ref` is written as null.
+void appendPhoenixFrame(std::string &out, std::string_view topic, std::string_view event, std::string_view payloadJson,
+                        std::string_view ref);
+
+} // namespace controller
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <QObject>
+#include <QPointer>
+
+#include "controller/SignalingTransport.h"
+
+namespace controller {
+
+class MultiplexedSignalingTransport;
+
+struct RealtimeMultiplexerStats
+{
+    quint64 connections = 0;         // times the shared transport was opened
+    quint64 framesSent = 0;          // on the shared transport
+    quint64 framesReceived = 0;
+    quint64 heartbeatsCoalesced = 0; // session heartbeats answered by one already in flight
+    quint64 unrouted = 0;            // replies and pushes no session was waiting for
+    quint64 refused = 0;             // sessions whose endpoint, key or app token did not match
+};
+
+// Many SignalingClients over one Realtime connection. Phoenix multiplexes
+// channels by topic on one socket, so each session only needs its own topic,
+// not its own WebSocket: the multiplexer hands out a SignalingTransport per
+// session (createTransport()) and runs them all over one shared transport.
+//
+// Refs are per socket in Phoenix, so outgoing refs are rewritten to the
+// multiplexer's own and replies are routed back with the session's original
+// ref. Pushes (null ref) go to the sessions joined to their topic. Heartbeats
+// belong to the socket rather than a channel: while one is in flight, other
+// sessions' heartbeats wait for its reply instead of sending their own.
+//
+// The shared transport opens with the first session and closes after the
+// last; when it drops, every session sees closed() and reconnects as usual.
+// A session that aborts while the shared heartbeat is unanswered (its
+// heartbeat timeout) takes the shared connection down with it, since that
+// connection is what failed.
+//
+// Only the socket is shared, not authorisation: it opens with the endpoint,
+// API key and app token, which must be the same for every session
+// (sharesConnection(); a session that differs is refused with an error), and
+// without any signed token. Each SignalingClient sends its own signed token
+// in its phx_join. The socket credentials are taken from the sessions
+// attached when it (re)opens, never kept from an earlier one. One session
+// per topic. GUI thread only.
+class RealtimeMultiplexer : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr std::size_t kMaxPendingReplies = 256;
+
+    explicit RealtimeMultiplexer(QObject *parent = nullptr);
+    ~RealtimeMultiplexer() override;
+
+    // While no session is open; RealtimeWebSocketTransport by default.
+    void setTransport(std::unique_ptr<SignalingTransport> transport);
+    SignalingTransport *transport() const { return m_transport.get(); }
+
+    // The multiplexer must outlive the transports it creates.
+    std::unique_ptr<SignalingTransport> createTransport();
+
+    // Whether two sessions can go over one socket.
+    static bool sharesConnection(const RealtimeCredentials &a, const QString &appTokenA,
+                                 const RealtimeCredentials &b, const QString &appTokenB);
+
+    bool isOpen() const { return m_transport->isOpen(); }
+    int sessionCount() const { return static_cast<int>(m_sessions.size()); }
+    RealtimeMultiplexerStats stats() const { return m_stats; }
+
+private:
+    friend class MultiplexedSignalingTransport;
+
+    struct Session
+    {
+        MultiplexedSignalingTransport *transport = nullptr;
+        RealtimeCredentials credentials;
+        QString appToken;
+        std::string topic; // from its phx_join
+    };
+
+    struct Route
+    {
+        MultiplexedSignalingTransport *transport = nullptr;
+        std::string ref; // the session's own
+    };
+
+    // From MultiplexedSignalingTransport.
+    // False if the session cannot share the connection.
+    bool attach(MultiplexedSignalingTransport *transport, const RealtimeCredentials &credentials,
+                const QString &appToken);
+    void detach(MultiplexedSignalingTransport *transport, bool aborted);
+    void sendFrom(MultiplexedSignalingTransport *transport, std::string_view text);
+
+    void connectTransport();
+    void onTransportOpened();
+    void onTransportText(const QByteArray &utf8);
+    void onTransportClosed();
+    Session *findSession(MultiplexedSignalingTransport *transport);
+    Session *findSession(std::string_view topic);
+    std::string nextRef();
+    void send(std::string_view topic, std::string_view event, std::string_view payloadJson, std::string_view ref);
+    void deliver(MultiplexedSignalingTransport *transport, std::string_view topic, std::string_view event,
+                 std::string_view payloadJson, std::string_view ref);
+
+    std::unique_ptr<SignalingTransport> m_transport;
+    bool m_active = false;  // between opening the shared transport and its closed()
+    bool m_closing = false; // closed by us after the last session left
+    std::vector<Session> m_sessions;
+    std::map<std::uint64_t, Route> m_routes; // by our ref; oldest first
+    std::uint64_t m_refCounter = 1;
+    std::uint64_t m_heartbeatRef = 0; // in flight, 0 = none
+    std::vector<Route> m_heartbeatWaiters;
+    std::string m_frame;
+    std::string m_topic;
+    std::string m_event;
+    std::string m_ref;
+    RealtimeMultiplexerStats m_stats;
+};
+
+// One session's view of a RealtimeMultiplexer; see createTransport().
+class MultiplexedSignalingTransport : public SignalingTransport
+{
+    Q_OBJECT
+
+public:
+    explicit MultiplexedSignalingTransport(RealtimeMultiplexer *multiplexer, QObject *parent = nullptr);
+    ~MultiplexedSignalingTransport() override;
+
+    void open(const RealtimeCredentials &credentials, const QString &appToken) override;
+    void close() override;
+    void abort() override;
+    bool isOpen() const override { return m_open; }
+    void sendText(std::string_view utf8) override;
+
+private:
+    friend class RealtimeMultiplexer;
+
+    // Multiplexer side: the shared connection is up, a frame for this
+    // session, or the shared connection is gone.
+    void connected();
+    void deliver(const QByteArray &utf8);
+    void dropped();
+    void finish();
+    // Runs `fn` from the event loop unless the session changed meanwhile.
+    void post(std::function<void()> fn);
+
+    QPointer<RealtimeMultiplexer> m_multiplexer;
+    std::uint64_t m_generation = 0; // bumped per open()/close(); stale posts are dropped
+    bool m_active = false;          // between open() and closed()
+    bool m_attached = false;
+    bool m_open = false;
+};
+
+} // namespace controller
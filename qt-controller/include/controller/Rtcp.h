@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace controller {
+
+struct RtcpSenderReport
+{
+    std::uint32_t ssrc = 0;
+    std::uint64_t ntpTimestamp = 0; // 32.32 fixed point seconds since 1900
+    std::uint32_t rtpTimestamp = 0; // same instant on the stream's RTP clock
+    std::uint32_t packetCount = 0;
+    std::uint32_t octetCount = 0;
+};
+
+// Walks a (compound) RTCP packet and fills `out` from its sender report.
+// Returns false when there is none.
+bool findRtcpSenderReport(const std::uint8_t *data, std::size_t size, RtcpSenderReport &out);
+
+// RFC 4585 transport-layer generic NACK for the given (ascending) sequence
+// numbers, appended to `out`. Sequences are packed into PID/BLP pairs.
+void appendRtcpNack(std::uint32_t senderSsrc, std::uint32_t mediaSsrc, const std::uint16_t *sequences,
+                    std::size_t count, std::vector<std::uint8_t> &out);
+
+// RFC 4585 picture loss indication, appended to `out`.
+void appendRtcpPli(std::uint32_t senderSsrc, std::uint32_t mediaSsrc, std::vector<std::uint8_t> &out);
+
+// Receiver estimated maximum bitrate (draft-alvestrand-rmcat-remb) for the
+// given media SSRCs, appended to `out`.
+void appendRtcpRemb(std::uint32_t senderSsrc, std::uint64_t bitrateBps, const std::uint32_t *mediaSsrcs,
+                    std::size_t count, std::vector<std::uint8_t> &out);
+
+inline std::int64_t ntpToMicroseconds(std::uint64_t ntp)
+{
+    const auto seconds = static_cast<std::int64_t>(ntp >> 32);
+    const auto fraction = static_cast<std::int64_t>(((ntp & 0xFFFFFFFFu) * 1000000) >> 32);
+    return seconds * 1000000 + fraction;
+}
+
+} // namespace controller
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace controller {
+
+struct RtcpFeedbackConfig
+{
+    int defaultRttMs = 50;      // until a measurement is available
+    int maxNackRetries = 3;     // per missing packet
+    int nackMaxAgeMs = 250;     // matches the jitter buffer's maximum delay
+    int minNackIntervalMs = 5;  // batches NACKs for bursts of loss
+    int minPliIntervalMs = 300; // lower bound; one RTT when that is longer
+    std::size_t maxTrackedMissing = 256; // more loss than this asks for a keyframe instead
+    int rembIntervalMs = 1000;  // a falling estimate is sent at once
+};
+
+struct RtcpFeedbackStats
+{
+    std::uint64_t nackPackets = 0;
+    std::uint64_t nackedSequences = 0;  // including retries
+    std::uint64_t packetsRecovered = 0; // missing packets that arrived after all
+    std::uint64_t packetsAbandoned = 0; // given up after retries or age
+    std::uint64_t pliSent = 0;
+    std::uint64_t pliSuppressed = 0;    // requests absorbed by the rate limit
+    double lastRecoveryMs = 0.0;        // loss detected -> packet arrived
+    double avgRecoveryMs = 0.0;
+    double lastKeyframeRecoveryMs = 0.0; // first PLI -> keyframe decoded
+    double rttMs = 0.0;
+    std::uint64_t rembSent = 0;
+    std::int64_t lastRembBps = 0;
+};
+
+// Receiver-side RTCP feedback for one video stream (RFC 4585): NACKs missing
+// sequence numbers, repeating once per round trip for a few times, and sends
+// PLIs when a picture cannot be recovered. Both are rate limited. The
+// receive-side bandwidth estimate goes back to the sender as REMB.
+//
+// Times are caller-supplied microseconds from a monotonic clock. Not thread
+// safe; the send function is called synchronously.
+class RtcpFeedback
+{
+public:
+    using SendFunction = std::function<void(const std::uint8_t *data, std::size_t size)>;
+
+    explicit RtcpFeedback(const RtcpFeedbackConfig &config = RtcpFeedbackConfig());
+
+    void setSendFunction(SendFunction send);
+    void setRttUs(std::int64_t rttUs);
+    std::int64_t rttUs() const { return m_rttUs; }
+
+    // Every received RTP packet of the stream, in arrival order.
+    void onPacket(std::uint32_t ssrc, std::uint16_t sequence, std::int64_t nowUs);
+    // The decoder needs a keyframe (loss it could not recover, or a decode error).
+    void requestKeyframe(std::int64_t nowUs);
+    void onKeyframe(std::int64_t nowUs);
+    // Latest bandwidth estimate; sent when it drops or the interval is up.
+    void onBandwidthEstimate(std::int64_t bitrateBps, std::int64_t nowUs);
+
+    // Sends the NACKs that are due.
+    void process(std::int64_t nowUs);
+    // When process() next has something to do; -1 if nothing is pending.
+    std::int64_t nextProcessUs() const;
+
+    void reset();
+    const RtcpFeedbackStats &stats() const { return m_stats; }
+
+private:
+    struct Missing
+    {
+        std::int64_t sequence = 0;
+        std::int64_t detectedUs = 0;
+        std::int64_t lastNackUs = -1;
+        int retries = 0;
+    };
+
+    std::int64_t unwrapSequence(std::uint16_t sequence);
+    void send();
+
+    RtcpFeedbackConfig m_config;
+    SendFunction m_send;
+    std::uint32_t m_localSsrc = 0;
+    std::int64_t m_rttUs = 0;
+
+    bool m_started = false;
+    std::uint32_t m_mediaSsrc = 0;
+    std::int64_t m_highest = 0;
+    std::vector<Missing> m_missing; // ascending sequence order
+    std::int64_t m_lastNackUs = -1;
+
+    std::int64_t m_lastPliUs = -1;
+    std::int64_t m_keyframeRequestedUs = -1; // first unanswered request
+    std::int64_t m_lastRembUs = -1;
+
+    std::vector<std::uint16_t> m_nackScratch;
+    std::vector<std::uint8_t> m_packet;
+    RtcpFeedbackStats m_stats;
+};
+
+} // namespace controller
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace controller {
+
+struct RtpDumpPacket
+{
+    std::uint32_t offsetMs = 0; // since the start of the recording
+    bool rtcp = false;
+    std::vector<std::uint8_t> data;
+};
+
+// Reads captures in the rtpdump format written by rtptools' rtpdump and by
+// Wireshark ("RTP > RTP Streams > Export"), so recorded streams can be
+// replayed through the receive pipelines without a network or devices.
+class RtpDumpReader
+{
+public:
+    bool open(const std::string &path);
+    bool isOpen() const { return m_file.is_open(); }
+    void close();
+
+    // Returns false at the end of the file or on a truncated record.
+    bool readPacket(RtpDumpPacket &packet);
+
+private:
+    std::ifstream m_file;
+};
+
+} // namespace controller
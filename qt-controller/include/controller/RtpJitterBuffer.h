@@ -0,0 +1,156 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "controller/RtpPacket.h"
+
+namespace controller {
+
+struct JitterBufferConfig
+{
+    std::size_t capacity = 1024;      // packets, rounded up to a power of two
+    std::size_t maxPacketSize = 1500; // bytes per ring slot
+    int clockRate = 90000;
+    int minDelayMs = 0;
+    int maxDelayMs = 250;
+    double jitterMultiplier = 3.0;    // target delay = multiplier * inter-arrival jitter
+    int minReorderWaitMs = 5;         // how long a gap may stay open once later packets arrived
+};
+
+struct JitterBufferStats
+{
+    std::uint64_t packetsInserted = 0;
+    std::uint64_t packetsDuplicate = 0;
+    std::uint64_t packetsLate = 0;
+    std::uint64_t packetsDiscarded = 0; // dropped with an unrecoverable frame or on overflow
+    std::uint64_t framesReleased = 0;
+    std::uint64_t framesLost = 0;
+    double jitterMs = 0.0;
+    double targetDelayMs = 0.0;
+};
+
+struct JitterFrame
+{
+    std::uint32_t timestamp = 0;
+    bool discontinuity = false; // data before this frame was lost or skipped
+    std::vector<RtpPacketView> packets; // sequence order, marker packet last
+};
+
+// Reorders RTP packets by sequence number in a preallocated ring and releases
+// whole frames (contiguous sequence numbers ending in a marker bit) once they
+// are due for playout. The playout delay tracks measured inter-arrival jitter,
+// so a clean network runs at (near) zero added latency.
+//
+// All times are caller-supplied microseconds from a monotonic clock, which
+// keeps the buffer deterministic for offline replay. Not thread safe.
+class RtpJitterBuffer
+{
+public:
+    enum class InsertResult
+    {
+        Inserted,
+        Duplicate,
+        Late,     // its frame was already released or given up on
+        Invalid,
+    };
+
+    explicit RtpJitterBuffer(const JitterBufferConfig &config = JitterBufferConfig());
+
+    InsertResult insert(const std::uint8_t *data, std::size_t size, std::int64_t arrivalUs);
+
+    // Fills `out` with the next frame that is due at `nowUs`. Packet views
+    // point into the ring and stay valid until the next insert() or popFrame().
+    bool popFrame(std::int64_t nowUs, JitterFrame &out);
+
+    // Earliest time at which popFrame() may produce a frame or give up on a
+    // broken one; -1 when the buffer is empty.
+    std::int64_t nextEventUs() const;
+
+    void reset();
+    // The same stream resumes over a new transport: buffered packets are
+    // dropped and the next packet starts a new sequence run, but the timing
+    // model (jitter estimate, playout delay) carries over.
+    void resync();
+
+    // With NACK, a gap is worth waiting on for about one round trip before
+    // the frame is given up. 0 disables (only reordering is waited for).
+    void setRetransmissionWaitUs(std::int64_t waitUs);
+
+    const JitterBufferStats &stats() const { return m_stats; }
+    std::int64_t targetDelayUs() const;
+
+private:
+    struct Slot
+    {
+        bool used = false;
+        std::int64_t sequence = 0;
+        std::int64_t timestamp = 0;
+        bool marker = false;
+        std::size_t size = 0;
+        std::int64_t arrivalUs = 0;
+    };
+
+    enum class HeadState
+    {
+        Empty,      // nothing to release yet
+        Complete,   // [m_head, endSequence) is a whole frame
+        Incomplete, // a gap blocks the head frame until `deadlineUs`
+    };
+
+    struct HeadScan
+    {
+        HeadState state = HeadState::Empty;
+        std::int64_t timestamp = 0;
+        std::int64_t endSequence = 0;
+        std::int64_t firstPresent = 0;
+        std::int64_t deadlineUs = 0;
+    };
+
+    std::int64_t unwrapSequence(std::uint16_t sequence);
+    std::int64_t unwrapTimestamp(std::uint32_t timestamp);
+    std::int64_t timestampToUs(std::int64_t timestamp) const;
+    std::int64_t releaseTimeUs(std::int64_t timestamp) const;
+    void updateTiming(std::int64_t timestamp, std::int64_t arrivalUs);
+
+    Slot &slotFor(std::int64_t sequence) { return m_slots[static_cast<std::size_t>(sequence) & m_mask]; }
+    const Slot *findSlot(std::int64_t sequence) const;
+    const std::uint8_t *slotData(std::int64_t sequence) const;
+
+    HeadScan scanHead() const;
+    void releaseRange(std::int64_t begin, std::int64_t end, bool discarded);
+    void giveUpHead(const HeadScan &scan);
+    std::int64_t reorderWaitUs() const;
+
+    JitterBufferConfig m_config;
+    std::size_t m_mask = 0;
+    std::vector<Slot> m_slots;
+    std::vector<std::uint8_t> m_storage;
+
+    bool m_started = false;
+    bool m_resyncPending = false;
+    std::uint32_t m_ssrc = 0;
+    std::int64_t m_head = 0;    // next sequence number to release
+    std::int64_t m_highest = 0; // highest sequence number seen
+    std::int64_t m_lastSequence = 0;
+    std::int64_t m_lastTimestamp = 0;
+    bool m_discontinuity = true;
+    bool m_hasDroppedTimestamp = false;
+    std::int64_t m_droppedTimestamp = 0; // remaining packets of an abandoned frame
+
+    // Timing model: transit = arrival - media time. The base tracks the
+    // fastest recent transit; jitter is the RFC 3550 estimator over frames.
+    bool m_hasTiming = false;
+    std::int64_t m_baseTransitUs = 0;
+    std::int64_t m_lastBaseUpdateUs = 0;
+    std::int64_t m_lastFrameTransitUs = 0;
+    std::int64_t m_newestFrameTimestamp = 0;
+    double m_jitterUs = 0.0;
+    double m_latenessPeakUs = 0.0;
+    std::int64_t m_retransmissionWaitUs = 0;
+
+    JitterBufferStats m_stats;
+};
+
+} // namespace controller
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace controller {
+
+// Non-owning view over a single RTP packet (RFC 3550). Pointers refer to the
+// buffer passed to parseRtpPacket() and are only valid while it is alive.
+struct RtpPacketView
+{
+    std::uint8_t payloadType = 0;
+    bool marker = false;
+    std::uint16_t sequenceNumber = 0;
+    std::uint32_t timestamp = 0;
+    std::uint32_t ssrc = 0;
+    const std::uint8_t *payload = nullptr;
+    std::size_t payloadSize = 0;
+};
+
+bool parseRtpPacket(const std::uint8_t *data, std::size_t size, RtpPacketView &out);
+
+// RTP and RTCP share the transport when rtcp-mux is used; RTCP packet types
+// occupy 200..207 in the second byte, which never collides with dynamic RTP payload types.
+bool isRtcpPacket(const std::uint8_t *data, std::size_t size);
+
+inline std::uint16_t readBigEndian16(const std::uint8_t *p)
+{
+    return static_cast<std::uint16_t>((p[0] << 8) | p[1]);
+}
+
+inline std::uint32_t readBigEndian32(const std::uint8_t *p)
+{
+    return (static_cast<std::uint32_t>(p[0]) << 24) | (static_cast<std::uint32_t>(p[1]) << 16)
+           | (static_cast<std::uint32_t>(p[2]) << 8) | static_cast<std::uint32_t>(p[3]);
+}
+
+} // namespace controller
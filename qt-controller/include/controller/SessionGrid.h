@@ -0,0 +1,53 @@
+#pragma once
+
+#include <map>
+#include <memory>
+
+#include <QImage>
+#include <QString>
+#include <QWidget>
+
+class QGridLayout;
+
+namespace controller {
+
+class MetricsRegistry;
+class SessionTile;
+
+// Tiled view of several sessions: one VideoSurface per session with a title
+// line, laid out in a near-square grid (ceil(sqrt(n)) columns). Clicking a
+// tile asks for it to be focused; the focused tile is outlined. Pair it with
+// SessionManager: sessionAdded/Removed -> addTile/removeTile, frameReady ->
+// presentFrame, tileActivated -> setFocusedSession.
+class SessionGrid : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit SessionGrid(QWidget *parent = nullptr);
+    ~SessionGrid() override;
+
+    void addTile(int id, const QString &title);
+    void removeTile(int id);
+    void setTileStatus(int id, const QString &status);
+    void setFocusedTile(int id);
+    // Render timings of the focused tile go here.
+    void setMetricsRegistry(std::shared_ptr<MetricsRegistry> metrics);
+    int tileCount() const { return static_cast<int>(m_tiles.size()); }
+
+public slots:
+    void presentFrame(int id, const QImage &frame);
+
+signals:
+    void tileActivated(int id);
+
+private:
+    void relayout();
+
+    QGridLayout *m_layout = nullptr;
+    std::map<int, SessionTile *> m_tiles;
+    int m_focused = -1;
+    std::shared_ptr<MetricsRegistry> m_metrics;
+};
+
+} // namespace controller
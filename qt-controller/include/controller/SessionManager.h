@@ -0,0 +1,114 @@
+#pragma once
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <QImage>
+#include <QObject>
+#include <QString>
+
+#include "controller/IceServer.h"
+#include "controller/SignalingTransport.h"
+
+class SignalingClient;
+
+namespace controller {
+
+class AuthClient;
+class DecodeWorkerPool;
+class IceCandidateBatcher;
+class MetricsCollector;
+class RealtimeMultiplexer;
+class WebRtcPeer;
+
+// Runs several remote sessions side by side, each an independent WebRtcPeer
+// with its own SignalingClient, sharing what does not need to be per session:
+// the signalling clients go over one Realtime connection (a
+// RealtimeMultiplexer, one topic each) per endpoint, API key and app token,
+// each joining with its own signed token, and video decodes on one
+// DecodeWorkerPool sized to the machine's cores instead of a thread per
+// session.
+//
+// One session at a time is focused and heard; the others are muted and
+// decode in thumbnail mode, at reduced resolution and frame rate. A session
+// offers as soon as its channel is joined (the peer is pre-warmed while
+// joining). GUI thread only.
+class SessionManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    using SessionId = int;
+    static constexpr SessionId kNoSession = -1;
+
+    explicit SessionManager(QObject *parent = nullptr);
+    ~SessionManager() override;
+
+    // Apply to sessions added afterwards.
+    void setIceServers(const std::vector<IceServer> &servers);
+    void setAppToken(const QString &appToken);
+    // Fetches fresh ICE servers (/api/ice) whenever sessions are added; they
+    // pre-warm once the list is in, keeping the current servers if the fetch
+    // fails or returns none.
+    // Without one, sessions use what setIceServers() gave right away.
+    void setAuthClient(AuthClient *auth);
+    // Reports on the focused session; follows focus and is detached when
+    // the last session goes.
+    void setMetricsCollector(MetricsCollector *collector);
+
+    // Transport for each shared signalling connection, e.g. a loopback one to
+    // run without the hosted service; a RealtimeWebSocketTransport if unset.
+    // Applies to connections opened afterwards.
+    using TransportFactory = std::function<std::unique_ptr<SignalingTransport>()>;
+    void setTransportFactory(TransportFactory factory);
+    int connectionCount() const { return static_cast<int>(m_multiplexers.size()); }
+    std::shared_ptr<DecodeWorkerPool> decodePool() const { return m_decodePool; }
+
+    // Joins `credentials.topic` and connects. The first session is focused.
+    SessionId addSession(const QString &label, const RealtimeCredentials &credentials);
+    void removeSession(SessionId id);
+    void removeAllSessions();
+
+    // kNoSession puts every session in thumbnail mode.
+    void setFocusedSession(SessionId id);
+    SessionId focusedSession() const { return m_focused; }
+
+    int sessionCount() const { return static_cast<int>(m_sessions.size()); }
+    std::vector<SessionId> sessionIds() const;
+    QString label(SessionId id) const;
+    WebRtcPeer *peer(SessionId id) const;
+    SignalingClient *signalingClient(SessionId id) const;
+
+signals:
+    void sessionAdded(int id, const QString &label);
+    void sessionRemoved(int id);
+    void sessionStateChanged(int id, const QString &state);
+    void focusedSessionChanged(int id);
+    void frameReady(int id, const QImage &frame);
+
+private:
+    struct Session;
+
+    void wireSession(SessionId id, Session &session);
+    void attachMetrics();
+    void onIceServers(const std::vector<IceServer> &servers);
+    void startPeer(Session &session);
+    RealtimeMultiplexer *multiplexerFor(const RealtimeCredentials &credentials);
+
+    // Keyed by endpoint, API key and app token (sharesConnection()).
+    std::map<QString, std::unique_ptr<RealtimeMultiplexer>> m_multiplexers;
+    TransportFactory m_transportFactory;
+    std::shared_ptr<DecodeWorkerPool> m_decodePool;
+    std::vector<IceServer> m_iceServers;
+    AuthClient *m_auth = nullptr;
+    bool m_fetchingIceServers = false;
+    QString m_appToken;
+    MetricsCollector *m_metricsCollector = nullptr;
+    std::map<SessionId, std::unique_ptr<Session>> m_sessions;
+    SessionId m_nextId = 1;
+    SessionId m_focused = kNoSession;
+};
+
+} // namespace controller
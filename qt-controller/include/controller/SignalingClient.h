@@ -1,61 +1,127 @@
 #pragma once
 #include <QObject>
-#include <QUrl>
-#include <QWebSocket>
 #include <QTimer>
 #include <QJsonObject>
+#include <QElapsedTimer>
+#include <QHash>
 
-struct RealtimeCredentials {
-    QUrl     endpoint;     // e.g. https://xxx.supabase.co
-    QString  apiKey;       // anon key
-    QString  topic;        // "remote:<sessionId>"
-    QString  signedToken;  // optional (MVP 可为空)
-};
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "controller/SignalingTransport.h"
 
 struct SignalEnvelope {
     QString   type;   // "offer" | "answer" | "ice"
     QJsonObject data; // sdp/candidate
 };
 
+struct SignalingStats {
+    quint64 reconnects = 0;       // 断线后重新 join 成功的次数
+    quint64 missedHeartbeats = 0; // 心跳在超时内没收到 phx_reply
+    quint64 joinFailures = 0;     // phx_join 被拒绝或超时未回复
+    quint64 queuedSignals = 0;    // 未 join 期间进入队列的信令
+    quint64 droppedSignals = 0;   // 队列满时丢弃的最旧信令
+    qint64  heartbeatRttUs = -1;  // 最近一次心跳往返
+    qint64  smoothedRttUs = -1;   // 心跳往返 EWMA (1/8)
+};
+
+// 断线自动重连：退避从 initial 起按 2 倍增长到 max，每次取 [base/2, base] 的随机值，
+// 避免大量客户端同时重连；重连后自动 phx_join。
+// 未 join 时 sendSignal 的信令按顺序排队，join 成功后先发完队列再 emit joined()。
+// 心跳按 ref 追踪回复，超时未回复即断开重连，不等 TCP 超时；心跳往返即信令 RTT。
+// phx_join 同样按 ref 等回复：被拒绝（status 不是 ok）或超时都断开，按退避重连。
+// 连接本身交给 SignalingTransport：默认是 Supabase Realtime WebSocket，
+// 也可以换成进程内回环（LoopbackSignalingTransport），不需要网络。
 class SignalingClient : public QObject {
     Q_OBJECT
 public:
     explicit SignalingClient(QObject* parent = nullptr);
+    ~SignalingClient() override;
+
+    // 断开状态下调用；替换掉当前的传输
+    void setTransport(std::unique_ptr<controller::SignalingTransport> transport);
+    controller::SignalingTransport* transport() const { return m_transport.get(); }
 
     void setCredentials(const RealtimeCredentials& cred);
     void setAppToken(const QString& appToken); // 可选：加到 WS Header
     void connectToRealtime();
     void disconnectFromRealtime();
 
-    // 发送信令（内部包一层 Phoenix broadcast）
+    static constexpr int kDefaultReconnectInitialMs = 500;
+    static constexpr int kDefaultReconnectMaxMs = 15000;
+    static constexpr int kDefaultHeartbeatIntervalMs = 5000;
+    static constexpr int kDefaultHeartbeatTimeoutMs = 3000;
+    static constexpr int kDefaultJoinTimeoutMs = 10000;
+    static constexpr int kMaxQueuedSignals = 256;
+
+    void setReconnectBackoff(int initialMs, int maxMs);
+    void setHeartbeat(int intervalMs, int ackTimeoutMs);
+    void setJoinTimeout(int timeoutMs);
+    bool isJoined() const { return m_joined; }
+    int queuedSignals() const { return static_cast<int>(m_outbound.size()); }
+    SignalingStats stats() const { return m_stats; }
+
+    // 发送信令（内部包一层 Phoenix broadcast）；未 join 时先排队
     void sendSignal(const SignalEnvelope& env);
 
+    // 信令载荷 <-> SignalEnvelope，直接读写 JSON 文本，不经过 QJsonDocument；
+    // 基准测试也调用这两个函数
+    static bool decodeSignalPayload(std::string_view payloadJson, SignalEnvelope& env);
+    static void appendSignalPayload(std::string& out, const SignalEnvelope& env);
+
 signals:
     void connected();
     void joined();                    // phx_join 成功
     void signalReceived(const SignalEnvelope& env);
     void errorOccurred(const QString& message);
     void closed();
+    void reconnecting(int attempt, int delayMs); // 已安排第 attempt 次重连
+    void replyLatency(qint64 latencyUs); // 请求 -> phx_reply 往返耗时
+    void heartbeatRtt(qint64 rttUs);     // 心跳往返，即信令 RTT
 
 private slots:
-    void onSocketConnected();
-    void onSocketTextMessage(const QString& msg);
-    void onSocketClosed();
-    void onSocketError(QAbstractSocket::SocketError e);
+    void onTransportOpened();
+    void onTransportText(const QByteArray& utf8);
+    void onTransportClosed();
     void onHeartbeat();
+    void onHeartbeatTimeout();
+    void onJoinTimeout();
 
 private:
+    void openSocket();
+    void scheduleReconnect();
+    void flushOutbound();
     void sendJoin();
-    void sendBroadcast(const QString& event, const QJsonObject& payload);
-    void sendRaw(const QJsonObject& obj);
-
-    QUrl buildRealtimeWsUrl(const QUrl& endpoint, const QString& apikey, const QString& token) const;
+    // join 失败：断开后按退避重连
+    void failJoin(const QString& reason);
+    void sendBroadcast(std::string_view event, std::string_view payloadJson);
+    // 编码一帧并发送；每帧分配一个 ref 并记录发送时间，返回该 ref
+    QString sendFrame(std::string_view topic, std::string_view event, std::string_view payloadJson);
 
 private:
-    QWebSocket   m_socket;
+    std::unique_ptr<controller::SignalingTransport> m_transport;
     QTimer       m_heartbeat;
+    QTimer       m_heartbeatAck;   // 单次：等心跳回复
+    QTimer       m_joinAck;        // 单次：等 phx_join 回复
+    QTimer       m_reconnectTimer; // 单次：退避结束后重连
     RealtimeCredentials m_cred;
+    std::string  m_topicUtf8;
+    std::string  m_outFrame;   // 复用的发送缓冲
+    std::string  m_payload;
     QString      m_appToken;
     quint64      m_refCounter = 1;
     bool         m_joined = false;
+    bool         m_everJoined = false;
+    bool         m_autoReconnect = false; // connectToRealtime 后为 true，主动断开后为 false
+    int          m_reconnectInitialMs = kDefaultReconnectInitialMs;
+    int          m_reconnectMaxMs = kDefaultReconnectMaxMs;
+    int          m_reconnectAttempt = 0;
+    QString      m_heartbeatRef;   // 等待回复的心跳 ref，空表示没有
+    QString      m_joinRef;        // 等待回复的 phx_join ref，空表示没有
+    std::deque<std::string> m_outbound; // 待发送的信令载荷，按 sendSignal 顺序
+    SignalingStats m_stats;
+    QElapsedTimer m_clock;
+    QHash<QString, qint64> m_pendingRefs; // ref -> 发送时间 (us)
 };
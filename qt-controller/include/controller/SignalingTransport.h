@@ -0,0 +1,80 @@
+#pragma once
+
+#include <string_view>
+
+#include <QByteArray>
+#include <QObject>
+#include <QString>
+#include <QUrl>
+#include <QWebSocket>
+
+struct RealtimeCredentials {
+    QUrl     endpoint;     // e.g. https://xxx.supabase.co
+    QString  apiKey;       // anon key
+    QString  topic;        // "remote:<sessionId>"
+    QString  signedToken;  // optional (MVP 可为空)
+};
+
+namespace controller {
+
+// How SignalingClient reaches the Phoenix channel: something that carries
+// whole text frames (UTF-8 JSON) in both directions. SignalingClient owns the
+// protocol (join, heartbeats, refs, reconnect); a transport only connects and
+// moves frames.
+//
+// Every open() ends in exactly one closed(): after a refused or failed
+// connect, a drop, close() or abort(). closed() may be emitted from inside
+// abort(). Frames sent while not open are dropped. GUI thread only.
+class SignalingTransport : public QObject
+{
+    Q_OBJECT
+
+public:
+    using QObject::QObject;
+    ~SignalingTransport() override = default;
+
+    virtual void open(const RealtimeCredentials &credentials, const QString &appToken) = 0;
+    virtual void close() = 0;
+    virtual void abort() = 0;
+    virtual bool isOpen() const = 0;
+    virtual void sendText(std::string_view utf8) = 0;
+
+signals:
+    void opened();
+    void textReceived(const QByteArray &utf8);
+    void closed();
+    void errorOccurred(const QString &message);
+};
+
+// Supabase Realtime over QWebSocket: the endpoint's /realtime/v1/websocket
+// with the API key (and the signed token, if any) in the query, and the app
+// token as a Bearer header.
+class RealtimeWebSocketTransport : public SignalingTransport
+{
+    Q_OBJECT
+
+public:
+    explicit RealtimeWebSocketTransport(QObject *parent = nullptr);
+
+    void open(const RealtimeCredentials &credentials, const QString &appToken) override;
+    void close() override;
+    void abort() override;
+    bool isOpen() const override { return m_open; }
+    void sendText(std::string_view utf8) override;
+
+    static QUrl buildUrl(const QUrl &endpoint, const QString &apiKey, const QString &token);
+
+private slots:
+    void onConnected();
+    void onDisconnected();
+    void onError(QAbstractSocket::SocketError error);
+
+private:
+    void finish();
+
+    QWebSocket m_socket;
+    bool m_active = false; // between open() and closed()
+    bool m_open = false;
+};
+
+} // namespace controller
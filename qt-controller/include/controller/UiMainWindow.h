@@ -8,11 +8,16 @@
 #include <QLineEdit>
 #include <QMainWindow>
 #include <QPushButton>
+#include <QStackedWidget>
 #include <QStatusBar>
 #include <QVBoxLayout>
 
 namespace controller {
 
+class MetricsRegistry;
+class SessionGrid;
+class VideoSurface;
+
 class UiMainWindow : public QMainWindow
 {
     Q_OBJECT
@@ -26,7 +31,12 @@ public:
     void setSessionCode(const QString &code6);
     void setConnectionStatus(const QString &statusText);
     void setMetricsText(const QString &metrics);
+    // Render timings of the video surface go here.
+    void setMetricsRegistry(std::shared_ptr<MetricsRegistry> metrics);
     void showVideoFrame(const QImage &frame);
+    // Several sessions at once: the grid replaces the single video view.
+    SessionGrid *sessionGrid() const { return m_sessionGrid; }
+    void setGridVisible(bool visible);
 
 signals:
     void requestLogin();
@@ -50,7 +60,9 @@ private:
     QPushButton *m_connectButton = nullptr;
     QPushButton *m_disconnectButton = nullptr;
     QLineEdit *m_joinCodeEdit = nullptr;
-    QLabel *m_videoLabel = nullptr;
+    QStackedWidget *m_videoStack = nullptr;
+    VideoSurface *m_videoSurface = nullptr;
+    SessionGrid *m_sessionGrid = nullptr;
     QLabel *m_metricsLabel = nullptr;
 };
 
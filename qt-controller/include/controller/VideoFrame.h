@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+
+namespace controller {
+
+// Planar 4:2:0 picture as handed out by the decoder. The planes are owned by
+// the decoder and stay valid only until the next decode call.
+struct I420FrameView
+{
+    const std::uint8_t *y = nullptr;
+    const std::uint8_t *u = nullptr;
+    const std::uint8_t *v = nullptr;
+    int strideY = 0;
+    int strideUV = 0;
+    int width = 0;
+    int height = 0;
+    std::uint32_t rtpTimestamp = 0;
+
+    bool isValid() const { return y && u && v && width > 0 && height > 0; }
+};
+
+} // namespace controller
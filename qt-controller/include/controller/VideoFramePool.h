@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include <QImage>
+
+namespace controller {
+
+struct FramePoolStats
+{
+    std::uint64_t hits = 0;   // acquire() served from a recycled buffer
+    std::uint64_t misses = 0; // acquire() had to allocate
+    std::size_t outstanding = 0;
+    std::size_t capacity = 0;
+};
+
+// Fixed-size pool of RGB32 frame buffers. acquire() hands out a QImage that
+// wraps pooled memory; QImage's own reference counting keeps the buffer alive
+// across queued signals and copies, and the cleanup hook returns it to the
+// pool when the last copy is destroyed, on whichever thread that happens.
+//
+// The pool may be destroyed while images are still out; those buffers are
+// freed instead of recycled.
+class VideoFramePool
+{
+public:
+    explicit VideoFramePool(std::size_t capacity = 4);
+    ~VideoFramePool();
+
+    VideoFramePool(const VideoFramePool &) = delete;
+    VideoFramePool &operator=(const VideoFramePool &) = delete;
+
+    QImage acquire(int width, int height);
+    FramePoolStats stats() const;
+
+private:
+    struct Shared;
+    struct Buffer;
+
+    static void releaseBuffer(void *info);
+
+    std::shared_ptr<Shared> m_shared;
+};
+
+} // namespace controller
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <QImage>
+
+#include "controller/AvSync.h"
+#include "controller/BandwidthEstimator.h"
+#include "controller/DecodeWorkerPool.h"
+#include "controller/H264Depacketizer.h"
+#include "controller/LatencyMonitor.h"
+#include "controller/Metrics.h"
+#include "controller/RtcpFeedback.h"
+#include "controller/RtpJitterBuffer.h"
+#include "controller/VideoFrame.h"
+#include "controller/VideoFramePool.h"
+
+namespace controller {
+
+class H264Decoder;
+
+// H.264 receive path: RTP packets from the network callback thread go into a
+// jitter buffer; the decode side pulls complete frames when they are due,
+// depacketizes, decodes, converts to RGB and reports finished frames through
+// the callback (on the decode thread). With an AvSync attached, frames are
+// held or skipped so that they line up with the audio.
+//
+// The decode side is a dedicated thread, or, with a DecodeWorkerPool, a job
+// on the pool that many receivers share; either way it runs one access unit
+// at a time and never on two threads at once.
+//
+// Loss is repaired with RTCP feedback sent through the feedback sender:
+// NACKs for missing packets (the jitter buffer waits about one round trip for
+// them) and a PLI when a picture is beyond repair. Packet arrival times also
+// feed a delay-based bandwidth estimate that is reported to the sender as REMB.
+class VideoReceiver : private DecodeJob
+{
+public:
+    using FrameCallback = std::function<void(const QImage &frame, std::uint32_t rtpTimestamp)>;
+
+    // Frames can be held by the decoder, a three-slot handoff to the GUI and
+    // the widget showing them, so the pool is sized to cover all of those.
+    static constexpr std::size_t kFramePoolCapacity = 6;
+
+    // Thumbnail mode: at most this many frames per second are converted and
+    // reported, at 1/kThumbnailDownscale of the size. Every reference picture
+    // is still decoded; disposable ones (nal_ref_idc 0) that would not be
+    // shown are skipped.
+    static constexpr int kThumbnailMaxFps = 5;
+    static constexpr int kThumbnailDownscale = 2;
+
+    explicit VideoReceiver(FrameCallback onFrame, const JitterBufferConfig &jitterConfig = JitterBufferConfig());
+    ~VideoReceiver() override;
+
+    VideoReceiver(const VideoReceiver &) = delete;
+    VideoReceiver &operator=(const VideoReceiver &) = delete;
+
+    // Set before start().
+    void setAvSync(std::shared_ptr<AvSync> avSync);
+    // Decode and conversion times, decoded frames and errors; may be switched
+    // while running (picked up with the next frame).
+    void setMetrics(std::shared_ptr<MetricsRegistry> metrics);
+    // Capture timestamps found in the stream are reported here while it is
+    // enabled; set before start().
+    void setLatencyMonitor(std::shared_ptr<LatencyMonitor> monitor);
+    // Decode on the pool instead of a thread of our own; set before start().
+    void setDecodePool(std::shared_ptr<DecodeWorkerPool> pool);
+    // May change at any time; takes effect from the next frame.
+    void setThumbnail(bool thumbnail);
+    bool thumbnail() const;
+
+    // Where RTCP feedback goes; may be (re)bound once the track exists.
+    void setFeedbackSender(RtcpFeedback::SendFunction send);
+    void setRoundTripTimeUs(std::int64_t rttUs);
+
+    void start();
+    void stop();
+
+    // Called from the libdatachannel track callback for every incoming packet.
+    void handleRtpPacket(const std::byte *data, std::size_t size);
+
+    // The transport under the track was rebuilt. Decoder, frame pool and
+    // jitter timing stay; whatever was in flight is given up, no NACKs go out
+    // for the outage, and a keyframe is requested with the first packet that
+    // arrives over the new transport.
+    void onTransportRestarted();
+
+    JitterBufferStats jitterStats() const;
+    FramePoolStats framePoolStats() const;
+    RtcpFeedbackStats feedbackStats() const;
+    BandwidthEstimatorStats bandwidthStats() const;
+
+private:
+    // One step of decode work: a held frame that is now due, or the next
+    // access unit. Returns when to run again (see DecodeJob).
+    std::int64_t runDue(std::int64_t nowUs) override;
+    // Thread mode: runDue() whenever it asks to, or when a packet arrives.
+    void decodeLoop();
+    // With the lock held: pops a due frame and depacketizes it into m_unit.
+    bool takeAccessUnit(std::int64_t nowUs, bool &discontinuity);
+    void decodeAccessUnit(bool discontinuity);
+    QImage convertFrame(const I420FrameView &frame, bool thumbnail);
+    void present(const QImage &image, std::uint32_t rtpTimestamp);
+    // Thumbnails are rate limited by RTP time.
+    bool presentationDue(std::uint32_t rtpTimestamp, bool thumbnail) const;
+    void requestKeyframe();
+
+    FrameCallback m_onFrame;
+    VideoFramePool m_framePool;
+    std::shared_ptr<AvSync> m_avSync;
+    std::shared_ptr<MetricsRegistry> m_metrics;
+    std::shared_ptr<LatencyMonitor> m_latency;
+    std::shared_ptr<DecodeWorkerPool> m_pool;
+    DecodeWorkerPool::JobId m_poolJob = 0;
+    std::atomic<bool> m_thumbnail{false};
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wakeup;
+    RtpJitterBuffer m_jitterBuffer;
+    RtcpFeedback m_feedback;
+    BandwidthEstimator m_bandwidth;
+    JitterFrame m_frame;
+    H264Depacketizer m_depacketizer;
+    bool m_running = false;
+    bool m_keyframeOnResume = false;
+    bool m_wakePending = false; // a packet arrived since the last runDue()
+    // A converted frame waiting for its lip-sync time; nothing newer is
+    // decoded meanwhile.
+    QImage m_heldFrame;
+    std::int64_t m_heldUntilUs = 0;
+    std::thread m_thread;
+
+    // Decode side only.
+    std::unique_ptr<H264Decoder> m_decoder;
+    std::shared_ptr<MetricsRegistry> m_decodeMetrics; // m_metrics as of this run
+    H264AccessUnit m_unit;
+    I420FrameView m_decoded;
+    bool m_waitingForKeyframe = true;
+    std::uint32_t m_heldTimestamp = 0;
+    bool m_presented = false;
+    std::uint32_t m_lastPresentedTimestamp = 0;
+    std::vector<std::uint8_t> m_thumbnailPlanes;
+};
+
+} // namespace controller
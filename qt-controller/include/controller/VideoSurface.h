@@ -0,0 +1,67 @@
+#pragma once
+
+#include <memory>
+
+#include <QImage>
+#include <QRect>
+#include <QString>
+#include <QWidget>
+
+#include "controller/Metrics.h"
+
+namespace controller {
+
+// Presents decoded frames. Only the most recent frame is kept: a frame that
+// is replaced before it was painted is dropped (and counted) instead of queued.
+// The target rectangle is computed once per window or frame size change, and
+// painting draws the frame straight from the (pooled) QImage.
+class VideoSurface : public QWidget
+{
+    Q_OBJECT
+
+public:
+    enum class ScaleMode
+    {
+        Native,    // 1:1, centred and cropped; no scaling at all
+        FitFast,   // keep aspect ratio, nearest-neighbour
+        FitSmooth, // keep aspect ratio, bilinear
+    };
+
+    explicit VideoSurface(QWidget *parent = nullptr);
+    ~VideoSurface() override;
+
+    void setScaleMode(ScaleMode mode);
+    ScaleMode scaleMode() const;
+
+    void setPlaceholderText(const QString &text);
+    void clear();
+
+    quint64 framesPresented() const;
+    quint64 framesDropped() const;
+
+    // Paint times and presented/replaced frames are recorded here as well.
+    void setMetrics(std::shared_ptr<MetricsRegistry> metrics);
+
+public slots:
+    void presentFrame(const QImage &frame);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+
+private:
+    void updateTargetRect();
+
+    QImage m_frame;
+    QSize m_frameSize;
+    QRect m_targetRect;
+    bool m_smooth = false; // resolved per geometry: integer scales never need filtering
+    bool m_framePending = false;
+    ScaleMode m_scaleMode = ScaleMode::FitFast;
+    QString m_placeholderText;
+    quint64 m_framesPresented = 0;
+    quint64 m_framesDropped = 0;
+    std::shared_ptr<MetricsRegistry> m_metrics;
+};
+
+} // namespace controller
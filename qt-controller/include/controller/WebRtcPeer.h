@@ -1,7 +1,12 @@
 #pragma once
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <optional>
+#include <string>
+#include <utility>
 #include <vector>
 
 #include <QByteArray>
@@ -9,16 +14,44 @@
 #include <QObject>
 #include <QString>
 #include <QStringList>
+#include <QTimer>
 
 #include <rtc/rtc.hpp>
 
+#include "common/InputProtocol.h"
+#include "controller/AudioReceiver.h"
+#include "controller/BandwidthEstimator.h"
+#include "controller/FrameMailbox.h"
+#include "controller/IceServer.h"
+#include "controller/InputScheduler.h"
+#include "controller/LatencyMonitor.h"
+#include "controller/Metrics.h"
+#include "controller/NetworkImpairment.h"
+#include "controller/RtcpFeedback.h"
+#include "controller/RtpJitterBuffer.h"
+#include "controller/VideoFramePool.h"
+
 namespace controller {
 
-struct IceServer
+class AudioOutput;
+class DecodeWorkerPool;
+class VideoReceiver;
+
+struct InputQueueStats
+{
+    std::size_t pendingEvents = 0;       // held back by the scheduler
+    std::size_t bufferedBytes = 0;       // queued on the reliable channel: SCTP plus any simulated link
+    std::size_t motionBufferedBytes = 0; // same for the motion channel
+    std::uint64_t motionDropped = 0;     // moves skipped because the motion channel was backed up
+    bool throttled = false;
+};
+
+struct ReconnectStats
 {
-    QStringList urls;
-    QString username;
-    QString credential;
+    std::uint64_t attempts = 0;   // transports rebuilt
+    std::uint64_t reconnects = 0; // outages recovered from
+    double lastOutageMs = 0.0;    // from losing the transport to connected again
+    bool reconnecting = false;
 };
 
 class WebRtcPeer : public QObject
@@ -30,27 +63,221 @@ public:
     ~WebRtcPeer() override;
 
     void setIceServers(const std::vector<IceServer> &servers);
+    // Where the decode path records its timings; takes effect on the running
+    // video receiver too, so a collector can move between sessions.
+    void setMetrics(std::shared_ptr<MetricsRegistry> metrics);
+    // Decode on a pool shared with other sessions instead of a thread of our
+    // own; applied on the next createPeer().
+    void setDecodePool(std::shared_ptr<DecodeWorkerPool> pool);
+    // Thumbnail mode: video is converted at reduced resolution and frame
+    // rate (see VideoReceiver::setThumbnail). Takes effect immediately.
+    void setVideoThumbnail(bool thumbnail);
+    bool videoThumbnail() const { return m_videoThumbnail; }
+    // Simulated loss, delay, jitter, reordering and bandwidth caps for
+    // reproducible tests: the profile's media section applies to received
+    // RTP/RTCP, its input section to the input messages we send. Applied on
+    // the next createPeer(); nullopt switches it off.
+    void setNetworkImpairment(const std::optional<ImpairmentProfile> &profile);
+    NetworkImpairmentStats networkImpairmentStats() const;
     void createPeer();
     void closePeer();
 
+    // Fast reconnect: when ICE reports the transport disconnected for longer
+    // than a short grace period, or failed, only the PeerConnection, its
+    // channels and tracks are rebuilt and a new offer goes out through
+    // localDescriptionReady. Decoder, jitter buffers, frame pool and audio
+    // keep running, and a keyframe is requested with the first video packet
+    // over the new transport. On by default.
+    static constexpr int kDisconnectGraceMs = 300;
+    static constexpr int kReconnectTimeoutMs = 2000;
+    static constexpr int kMaxReconnectAttempts = 5;
+    void setAutoReconnect(bool enabled);
+    bool autoReconnect() const;
+    // Rebuilds the transport now, e.g. after the network interface changed.
+    void restartTransport();
+    ReconnectStats reconnectStats() const;
+
     void createOffer();
     void setRemoteDescription(const QString &type, const QString &sdp);
+    // Candidates that arrive ahead of the answer are held and applied in one
+    // batch right after it.
     void addRemoteIceCandidate(const QString &candidate, const QString &sdpMid, int sdpMLineIndex);
+    // A batch from one signal (see IceCandidateBatcher), applied in one go.
+    void addRemoteIceCandidates(const std::vector<IceCandidate> &candidates);
+
+    // Pre-warm: createPeer() and createOffer() right away, so ICE gathering
+    // runs while the session is still being joined, but hold the offer and
+    // local candidates back until sendOffer(). Call it as soon as the ICE
+    // servers are known.
+    void prewarm();
+    // The signalling channel has joined: emits the held offer and candidates
+    // (or the offer as soon as it is ready). Without prewarm() it does the
+    // whole createPeer()/createOffer() sequence.
+    void sendOffer();
+    bool offerReady() const;
+    // From sendOffer() (or createOffer() without pre-warm) to the first
+    // decoded frame reaching the GUI thread; 0 until then.
+    double timeToFirstFrameMs() const;
     void sendInputEvent(const QByteArray &payload);
 
+    // Typed input; encoded with the binary format once the host acknowledged
+    // it, JSON otherwise. Coordinates are normalised to the remote screen.
+    // Moves and wheel steps are coalesced and flushed by an InputScheduler;
+    // with binary input, moves travel on the unreliable motion channel.
+    void sendInput(const Protocol::InputEvent &event);
+    void sendMouseMove(double x, double y);
+    void sendMouseClick(double x, double y, int button);
+    void sendMouseWheel(double deltaY);
+    void sendKey(const QString &code, bool down);
+    bool binaryInputActive() const;
+
+    // Input flush cadence: a fixed interval (0 = unbatched) or the display refresh rate.
+    void setInputFlushInterval(int intervalMs);
+    void setInputFlushRate(double refreshHz);
+    InputSchedulerStats inputStats() const;
+    // Send-side backlog; non-zero drops or `throttled` mean input is being
+    // thinned out because the link cannot keep up.
+    InputQueueStats inputQueueStats() const;
+
+    // Audio latency knobs: decoded audio queued ahead of the device, and the
+    // device buffer itself (applied on the next createPeer()).
+    void setAudioBufferMs(int playoutMs, int deviceMs);
+    // Muted sessions drop their audio and keep the device closed; unmuting
+    // opens it again once the transport is up. Takes effect immediately.
+    void setAudioMuted(bool muted);
+    bool audioMuted() const { return m_audioMuted; }
+    AudioReceiverStats audioStats() const;
+    // Lip-sync state; offsetMs is the A/V offset at presentation (> 0 = video early).
+    AvSyncStats avSyncStats() const;
+
+    // NACK/PLI counts and loss recovery latency on the video track.
+    RtcpFeedbackStats videoFeedbackStats() const;
+    JitterBufferStats videoJitterStats() const;
+    // Latest ICE round-trip time; 0 until one has been measured.
+    double roundTripTimeMs() const;
+
+    // Latency measurement mode: a LatencyProbe goes out on the input channel
+    // every `probeIntervalMs` for the input round trip, and capture
+    // timestamps the host embeds in the video give capture-to-display latency
+    // per frame. Needs a host that speaks the binary input format.
+    static constexpr int kDefaultProbeIntervalMs = 200;
+    void setLatencyMeasurementEnabled(bool enabled, int probeIntervalMs = kDefaultProbeIntervalMs);
+    bool latencyMeasurementEnabled() const;
+    LatencyReport latencyReport() const;
+    void resetLatencyMeasurement();
+    // Every sample of the run; false if the file cannot be written.
+    bool exportLatencyCsv(const QString &path) const;
+    // Receive-side bandwidth estimate for the video track (also sent as REMB).
+    BandwidthEstimatorStats videoBandwidthStats() const;
+
+    FramePoolStats framePoolStats() const;
+    // Decoded frames replaced by a newer one before the GUI thread picked them up.
+    quint64 framesOverwritten() const;
+
 signals:
     void localDescriptionReady(const QString &type, const QString &sdp);
     void localIceCandidate(const QString &candidate, const QString &sdpMid, int sdpMLineIndex);
+    // After the last localIceCandidate of the current transport.
+    void localIceGatheringComplete();
     void stateChanged(const QString &newState);
+    void reconnecting(int attempt);
+    void reconnected(double outageMs);
+    // Every attempt timed out; the session needs a full closePeer()/createPeer().
+    void reconnectFailed();
     void videoFrameReady(const QImage &frame);
 
 private:
+    // The PeerConnection with its channels and tracks, without the media pipeline.
+    void openTransport();
+    void closeTransport();
+    void onTransportStateChanged(rtc::PeerConnection::State state, std::uint64_t generation);
+    void onLocalDescription(const QString &type, const QString &sdp, std::uint64_t generation);
+    void onLocalCandidate(const QString &candidate, const QString &sdpMid, int sdpMLineIndex,
+                          std::uint64_t generation);
+    void onLocalGatheringComplete(std::uint64_t generation);
+    void reconnectTransport();
     void attachMediaHandlers();
+    void bindVideoTrack(const std::shared_ptr<rtc::Track> &track);
+    void bindAudioTrack(const std::shared_ptr<rtc::Track> &track);
+    void pollRoundTripTime();
+    void bindInputChannel();
+    std::size_t transmitInput(const Protocol::InputEvent *events, std::size_t count);
+    bool sendMotion(const Protocol::InputEvent &move);
+    void updateInputThrottle();
+    // SCTP's buffer plus what an impaired link still holds.
+    std::size_t inputBufferedBytes() const;
+    std::size_t motionBufferedBytes() const;
+    void releaseInputThrottle();
+    // Input channel sends; they take the impairment link when one is configured.
+    bool sendChannelMessage(const std::shared_ptr<rtc::DataChannel> &channel, const std::shared_ptr<ImpairedLink> &link,
+                            const std::uint8_t *data, std::size_t size);
+    void sendChannelText(const std::shared_ptr<rtc::DataChannel> &channel, const std::shared_ptr<ImpairedLink> &link,
+                         std::string text);
+    void startImpairment();
+    void stopImpairment();
+    void postDecodedFrame(const QImage &frame, std::uint32_t rtpTimestamp);
+    void deliverLatestFrame();
+    void sendLatencyProbe();
+
+    struct DecodedFrame
+    {
+        QImage image;
+        std::uint32_t rtpTimestamp = 0;
+    };
 
     std::vector<IceServer> m_iceServers;
     std::shared_ptr<rtc::PeerConnection> m_peerConnection;
     std::shared_ptr<rtc::DataChannel> m_inputChannel;
+    std::atomic<bool> m_binaryInput{false};
+    std::shared_ptr<rtc::DataChannel> m_motionChannel;
+    std::uint16_t m_motionSequence = 0;
+    std::uint64_t m_motionDropped = 0;
+    InputScheduler *m_inputScheduler = nullptr;
     std::vector<std::shared_ptr<rtc::Track>> m_tracks;
+    std::shared_ptr<rtc::Track> m_videoTrack;
+    std::shared_ptr<VideoReceiver> m_videoReceiver;
+    std::shared_ptr<rtc::Track> m_audioTrack;
+    std::shared_ptr<AudioReceiver> m_audioReceiver;
+    std::shared_ptr<PcmRingBuffer> m_audioRing;
+    AudioOutput *m_audioOutput = nullptr;
+    int m_audioPlayoutBufferMs = AudioReceiver::kDefaultPlayoutBufferMs;
+    bool m_audioMuted = false;
+    bool m_transportConnected = false;
+    std::shared_ptr<AvSync> m_avSync;
+    std::shared_ptr<MetricsRegistry> m_metrics;
+    std::shared_ptr<DecodeWorkerPool> m_decodePool;
+    bool m_videoThumbnail = false;
+    QTimer *m_rttTimer = nullptr;
+    std::int64_t m_rttUs = 0;
+    std::shared_ptr<LatencyMonitor> m_latency;
+    QTimer *m_probeTimer = nullptr;
+    std::optional<ImpairmentProfile> m_impairment;
+    std::shared_ptr<ImpairedLink> m_videoLink;
+    std::shared_ptr<ImpairedLink> m_audioLink;
+    std::shared_ptr<ImpairedLink> m_inputLink;
+    std::shared_ptr<ImpairedLink> m_motionLink;
+    // Bumped whenever the transport is rebuilt; callbacks from an older
+    // PeerConnection compare against it and bail out.
+    std::atomic<std::uint64_t> m_transportGeneration{0};
+    bool m_autoReconnect = true;
+    QTimer *m_reconnectTimer = nullptr;
+    int m_reconnectAttempt = 0;
+    std::int64_t m_outageStartUs = -1;
+    ReconnectStats m_reconnectStats;
+    // Offer and local candidates held back while pre-warming (GUI thread).
+    bool m_holdSignalling = false;
+    std::optional<std::pair<QString, QString>> m_heldOffer;
+    std::vector<IceCandidate> m_heldCandidates;
+    bool m_heldGatheringComplete = false;
+    bool m_remoteDescriptionSet = false;
+    std::vector<IceCandidate> m_pendingRemoteCandidates;
+    std::int64_t m_connectStartUs = -1;
+    std::int64_t m_firstFrameUs = -1;
+
+    // Decode thread -> GUI thread handoff. At most one delivery is queued in
+    // the event loop at any time; it always presents the newest frame.
+    FrameMailbox<DecodedFrame> m_frameMailbox;
+    std::atomic<bool> m_frameDeliveryQueued{false};
 };
 
 } // namespace controller
@@ -1,6 +1,10 @@
 #include "controller/App.h"
 
 #include "common/Protocol.h"
+#include "controller/AuthClient.h"
+#include "controller/MetricsCollector.h"
+#include "controller/SessionGrid.h"
+#include "controller/SessionManager.h"
 #include "controller/UiMainWindow.h"
 
 #include <QSettings>
@@ -21,11 +25,47 @@ int App::run()
 {
     m_mainWindow = std::make_unique<UiMainWindow>();
     m_mainWindow->setApiBase(QString::fromUtf8(Protocol::kApiBase));
+    m_auth = std::make_unique<AuthClient>();
+    m_auth->setApiBase(QUrl(QString::fromUtf8(Protocol::kApiBase)));
+
+    // SessionManager attaches the focused session's peer and signalling
+    // client; until there is one only the widget's render times show up.
+    m_metrics = std::make_unique<MetricsCollector>();
+    m_mainWindow->setMetricsRegistry(m_metrics->registry());
+    connect(m_metrics.get(), &MetricsCollector::summaryChanged, m_mainWindow.get(), &UiMainWindow::setMetricsText);
+    m_metrics->start();
+    bindSessions();
     m_mainWindow->show();
 
     return m_app.exec();
 }
 
+void App::bindSessions()
+{
+    // Sessions are added through SessionManager::addSession() once their
+    // Realtime credentials are known; the grid replaces the single view
+    // while any are running.
+    m_sessions = std::make_unique<SessionManager>();
+    m_sessions->setMetricsCollector(m_metrics.get());
+    // STUN/TURN servers from /api/ice, fetched as sessions are added.
+    m_sessions->setAuthClient(m_auth.get());
+    SessionGrid *grid = m_mainWindow->sessionGrid();
+    grid->setMetricsRegistry(m_metrics->registry());
+    UiMainWindow *window = m_mainWindow.get();
+    connect(m_sessions.get(), &SessionManager::sessionAdded, grid, [grid, window](int id, const QString &label) {
+        grid->addTile(id, label);
+        window->setGridVisible(true);
+    });
+    connect(m_sessions.get(), &SessionManager::sessionRemoved, grid, [grid, window](int id) {
+        grid->removeTile(id);
+        window->setGridVisible(grid->tileCount() > 0);
+    });
+    connect(m_sessions.get(), &SessionManager::sessionStateChanged, grid, &SessionGrid::setTileStatus);
+    connect(m_sessions.get(), &SessionManager::focusedSessionChanged, grid, &SessionGrid::setFocusedTile);
+    connect(m_sessions.get(), &SessionManager::frameReady, grid, &SessionGrid::presentFrame);
+    connect(grid, &SessionGrid::tileActivated, m_sessions.get(), &SessionManager::setFocusedSession);
+}
+
 } // namespace controller
 
 int main(int argc, char **argv)
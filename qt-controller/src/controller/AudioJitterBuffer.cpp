@@ -0,0 +1,249 @@
+#include "controller/AudioJitterBuffer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace controller {
+
+namespace {
+constexpr int kDefaultFrameMs = 20;
+// Frames above the target that are tolerated before one is dropped; keeps
+// the buffer from dropping on every small burst.
+constexpr int kDropHysteresisFrames = 2;
+// Spread drops out so that catching up after a burst stays inaudible.
+constexpr int kMinFramesBetweenDrops = 4;
+// Each underrun raises the delay floor by a frame; it relaxes over a few seconds.
+constexpr double kUnderrunFloorDecayPerFrame = 0.995;
+
+std::size_t roundUpToPowerOfTwo(std::size_t value)
+{
+    std::size_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+} // namespace
+
+AudioJitterBuffer::AudioJitterBuffer(const AudioJitterBufferConfig &config)
+    : m_config(config)
+{
+    const std::size_t capacity = roundUpToPowerOfTwo(std::max<std::size_t>(config.capacity, 8));
+    m_config.capacity = capacity;
+    m_mask = capacity - 1;
+    m_slots.resize(capacity);
+    m_storage.resize(capacity * m_config.maxPacketSize);
+    m_frameDuration = static_cast<std::uint32_t>(m_config.clockRate / 1000 * kDefaultFrameMs);
+}
+
+void AudioJitterBuffer::reset()
+{
+    for (auto &slot : m_slots) {
+        slot.used = false;
+    }
+    m_started = false;
+    m_playing = false;
+    m_hasTransit = false;
+    m_jitterUs = 0.0;
+    m_underrunFloorUs = 0.0;
+    m_stats.bufferedMs = 0.0;
+}
+
+std::int64_t AudioJitterBuffer::unwrapSequence(std::uint16_t sequence)
+{
+    const auto delta = static_cast<std::int16_t>(sequence - static_cast<std::uint16_t>(m_lastSequence));
+    const std::int64_t extended = m_lastSequence + delta;
+    m_lastSequence = std::max(m_lastSequence, extended);
+    return extended;
+}
+
+std::int64_t AudioJitterBuffer::targetDelayUs() const
+{
+    const double wanted = std::max(m_config.jitterMultiplier * m_jitterUs, m_underrunFloorUs);
+    return static_cast<std::int64_t>(std::clamp(wanted, m_config.minDelayMs * 1000.0, m_config.maxDelayMs * 1000.0));
+}
+
+std::int64_t AudioJitterBuffer::frameDurationUs() const
+{
+    return static_cast<std::int64_t>(m_frameDuration) * 1000000 / m_config.clockRate;
+}
+
+std::int64_t AudioJitterBuffer::bufferedUs() const
+{
+    if (!m_started || m_highest < m_head) {
+        return 0;
+    }
+    return (m_highest - m_head + 1) * frameDurationUs();
+}
+
+void AudioJitterBuffer::updateJitter(const RtpPacketView &packet, std::int64_t arrivalUs)
+{
+    // RFC 3550 interarrival jitter, in microseconds.
+    const std::int64_t mediaUs = static_cast<std::int64_t>(packet.timestamp) * 1000000 / m_config.clockRate;
+    const std::int64_t transit = arrivalUs - mediaUs;
+    if (m_hasTransit) {
+        const auto timestampDelta = static_cast<std::int32_t>(packet.timestamp - m_lastTimestamp);
+        if (timestampDelta > 0) {
+            const double d = static_cast<double>(transit - m_lastTransitUs);
+            m_jitterUs += (std::abs(d) - m_jitterUs) / 16.0;
+            m_stats.jitterMs = m_jitterUs / 1000.0;
+            m_stats.targetDelayMs = targetDelayUs() / 1000.0;
+        }
+    }
+    m_hasTransit = true;
+    m_lastTransitUs = transit;
+    m_lastTimestamp = packet.timestamp;
+}
+
+AudioJitterBuffer::InsertResult AudioJitterBuffer::insert(const std::uint8_t *data, std::size_t size, std::int64_t arrivalUs)
+{
+    RtpPacketView packet;
+    if (size > m_config.maxPacketSize || !parseRtpPacket(data, size, packet)) {
+        return InsertResult::Invalid;
+    }
+
+    if (m_started && packet.ssrc != m_ssrc) {
+        reset();
+    }
+    if (!m_started) {
+        m_started = true;
+        m_playing = false;
+        m_ssrc = packet.ssrc;
+        m_lastSequence = packet.sequenceNumber;
+        m_head = packet.sequenceNumber;
+        m_highest = m_head - 1;
+    }
+
+    const std::int64_t sequence = unwrapSequence(packet.sequenceNumber);
+    if (sequence < m_head) {
+        ++m_stats.packetsLate;
+        return InsertResult::Late;
+    }
+    if (sequence >= m_head + static_cast<std::int64_t>(m_config.capacity)) {
+        // Too far ahead to fit: start over from this packet.
+        for (auto &slot : m_slots) {
+            slot.used = false;
+        }
+        m_head = sequence;
+        m_highest = sequence - 1;
+        m_playing = false;
+    }
+
+    Slot &slot = m_slots[static_cast<std::size_t>(sequence) & m_mask];
+    if (slot.used && slot.sequence == sequence) {
+        ++m_stats.packetsDuplicate;
+        return InsertResult::Duplicate;
+    }
+
+    // Learn the frame duration from neighbouring packets.
+    if (const Slot *previous = findSlot(sequence - 1)) {
+        const std::uint32_t delta = packet.timestamp - previous->timestamp;
+        if (delta > 0 && delta <= static_cast<std::uint32_t>(m_config.clockRate / 8)) {
+            m_frameDuration = delta;
+        }
+    }
+
+    slot.used = true;
+    slot.sequence = sequence;
+    slot.timestamp = packet.timestamp;
+    slot.size = packet.payloadSize;
+    std::memcpy(m_storage.data() + (static_cast<std::size_t>(sequence) & m_mask) * m_config.maxPacketSize,
+                packet.payload, packet.payloadSize);
+
+    m_highest = std::max(m_highest, sequence);
+    updateJitter(packet, arrivalUs);
+    updateBufferedStats();
+    ++m_stats.packetsInserted;
+    return InsertResult::Inserted;
+}
+
+AudioJitterBuffer::Slot *AudioJitterBuffer::findSlot(std::int64_t sequence)
+{
+    Slot &slot = m_slots[static_cast<std::size_t>(sequence) & m_mask];
+    return (slot.used && slot.sequence == sequence) ? &slot : nullptr;
+}
+
+const std::uint8_t *AudioJitterBuffer::slotData(std::int64_t sequence) const
+{
+    return m_storage.data() + (static_cast<std::size_t>(sequence) & m_mask) * m_config.maxPacketSize;
+}
+
+void AudioJitterBuffer::releaseHead()
+{
+    if (Slot *slot = findSlot(m_head)) {
+        slot->used = false;
+    }
+    ++m_head;
+}
+
+void AudioJitterBuffer::updateBufferedStats()
+{
+    m_stats.bufferedMs = bufferedUs() / 1000.0;
+}
+
+AudioJitterBuffer::PopResult AudioJitterBuffer::pop(AudioPacket &out)
+{
+    out = AudioPacket();
+    if (!m_started || m_highest < m_head) {
+        if (m_playing) {
+            // Ran dry mid-stream: the caller conceals while the buffer refills
+            // to the target, so the delay grows by what the network needed.
+            m_playing = false;
+            ++m_stats.underruns;
+            m_underrunFloorUs = std::min(m_underrunFloorUs + frameDurationUs(), m_config.maxDelayMs * 1000.0);
+            m_stats.targetDelayMs = targetDelayUs() / 1000.0;
+        }
+        return PopResult::Empty;
+    }
+
+    const std::int64_t target = targetDelayUs();
+    if (!m_playing) {
+        if (bufferedUs() < target) {
+            return PopResult::Empty;
+        }
+        m_playing = true;
+    }
+
+    const std::int64_t frameUs = frameDurationUs();
+    ++m_framesSinceDrop;
+    if (bufferedUs() > target + kDropHysteresisFrames * frameUs && m_framesSinceDrop >= kMinFramesBetweenDrops
+        && findSlot(m_head)) {
+        // More queued than the network needs: skip a frame to cut latency.
+        releaseHead();
+        m_framesSinceDrop = 0;
+        ++m_stats.framesDropped;
+    }
+
+    const Slot *slot = findSlot(m_head);
+    if (const Slot *next = findSlot(m_head + 1)) {
+        out.nextPayload = slotData(m_head + 1);
+        out.nextPayloadSize = next->size;
+    }
+
+    PopResult result = PopResult::Lost;
+    if (slot) {
+        out.timestamp = slot->timestamp;
+        out.payload = slotData(m_head);
+        out.payloadSize = slot->size;
+        ++m_stats.framesPlayed;
+        result = PopResult::Frame;
+        m_underrunFloorUs *= kUnderrunFloorDecayPerFrame;
+    } else {
+        // Later packets are here, so this one is lost rather than late.
+        for (std::int64_t sequence = m_head + 1; sequence <= m_highest; ++sequence) {
+            if (const Slot *later = findSlot(sequence)) {
+                out.timestamp = later->timestamp - static_cast<std::uint32_t>(sequence - m_head) * m_frameDuration;
+                break;
+            }
+        }
+        ++m_stats.framesLost;
+    }
+
+    // The slot is only marked free; its bytes stay intact until the next insert().
+    releaseHead();
+    updateBufferedStats();
+    return result;
+}
+
+} // namespace controller
@@ -0,0 +1,119 @@
+#include "controller/AudioOutput.h"
+
+#include "controller/OpusAudioDecoder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <utility>
+
+#include <QAudioDevice>
+#include <QAudioFormat>
+#include <QAudioSink>
+#include <QIODevice>
+#include <QMediaDevices>
+
+namespace controller {
+
+// Read-only QIODevice over the ring. readData() may run on the audio
+// backend's thread; it never blocks and always returns a full buffer.
+class PcmRingDevice : public QIODevice
+{
+public:
+    PcmRingDevice(std::shared_ptr<PcmRingBuffer> ring, QObject *parent)
+        : QIODevice(parent)
+        , m_ring(std::move(ring))
+    {
+    }
+
+    bool isSequential() const override { return true; }
+    qint64 bytesAvailable() const override
+    {
+        return static_cast<qint64>(m_ring->available() * sizeof(std::int16_t)) + QIODevice::bytesAvailable();
+    }
+
+    quint64 underrunSamples() const { return m_underrunSamples.load(std::memory_order_relaxed); }
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override
+    {
+        const auto wanted = static_cast<std::size_t>(maxSize) / sizeof(std::int16_t);
+        auto *samples = reinterpret_cast<std::int16_t *>(data);
+        const std::size_t got = m_ring->read(samples, wanted);
+        if (got < wanted) {
+            std::memset(samples + got, 0, (wanted - got) * sizeof(std::int16_t));
+            m_underrunSamples.fetch_add(wanted - got, std::memory_order_relaxed);
+        }
+        return static_cast<qint64>(wanted * sizeof(std::int16_t));
+    }
+
+    qint64 writeData(const char *, qint64) override { return -1; }
+
+private:
+    std::shared_ptr<PcmRingBuffer> m_ring;
+    std::atomic<quint64> m_underrunSamples{0};
+};
+
+AudioOutput::AudioOutput(std::shared_ptr<PcmRingBuffer> ring, QObject *parent)
+    : QObject(parent)
+    , m_ring(std::move(ring))
+    , m_device(new PcmRingDevice(m_ring, this))
+{
+}
+
+AudioOutput::~AudioOutput()
+{
+    stop();
+}
+
+void AudioOutput::setBufferDurationMs(int ms)
+{
+    m_bufferMs = std::max(ms, 5);
+}
+
+int AudioOutput::bufferDurationMs() const
+{
+    return m_bufferMs;
+}
+
+void AudioOutput::start()
+{
+    if (m_sink) {
+        return;
+    }
+
+    QAudioFormat format;
+    format.setSampleRate(OpusAudioDecoder::kSampleRate);
+    format.setChannelCount(OpusAudioDecoder::kChannels);
+    format.setSampleFormat(QAudioFormat::Int16);
+
+    const QAudioDevice device = QMediaDevices::defaultAudioOutput();
+    if (device.isNull() || !device.isFormatSupported(format)) {
+        return;
+    }
+
+    m_sink = new QAudioSink(device, format, this);
+    m_sink->setBufferSize(format.bytesForDuration(static_cast<qint64>(m_bufferMs) * 1000));
+    // Whatever is left from a previous session is stale by now.
+    m_ring->clear();
+    m_device->open(QIODevice::ReadOnly);
+    m_sink->start(m_device);
+}
+
+void AudioOutput::stop()
+{
+    if (!m_sink) {
+        return;
+    }
+    m_sink->stop();
+    delete m_sink;
+    m_sink = nullptr;
+    m_device->close();
+}
+
+quint64 AudioOutput::underrunSamples() const
+{
+    return m_device->underrunSamples();
+}
+
+} // namespace controller
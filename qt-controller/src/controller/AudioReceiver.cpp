@@ -0,0 +1,188 @@
+#include "controller/AudioReceiver.h"
+
+#include "controller/OpusAudioDecoder.h"
+#include "controller/Rtcp.h"
+
+#include <algorithm>
+#include <chrono>
+#include <utility>
+#include <vector>
+
+namespace controller {
+
+namespace {
+// How often the decode thread checks the playout level. A quarter of a
+// typical 20 ms frame keeps the level within one frame of the target.
+constexpr auto kPollInterval = std::chrono::milliseconds(5);
+// Consecutive frames concealed on underrun before going quiet; Opus PLC
+// fades out over about this long.
+constexpr int kMaxConcealedFrames = 5;
+
+std::int64_t steadyNowUs()
+{
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+} // namespace
+
+AudioReceiver::AudioReceiver(std::shared_ptr<PcmRingBuffer> output, const AudioJitterBufferConfig &jitterConfig)
+    : m_output(std::move(output))
+    , m_jitterBuffer(jitterConfig)
+{
+}
+
+AudioReceiver::~AudioReceiver()
+{
+    stop();
+}
+
+void AudioReceiver::setAvSync(std::shared_ptr<AvSync> avSync)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_avSync = std::move(avSync);
+}
+
+void AudioReceiver::start()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_running) {
+        return;
+    }
+    m_running = true;
+    m_thread = std::thread(&AudioReceiver::decodeLoop, this);
+}
+
+void AudioReceiver::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_running) {
+            return;
+        }
+        m_running = false;
+    }
+    m_wakeup.notify_all();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_jitterBuffer.reset();
+}
+
+void AudioReceiver::setPlayoutBufferMs(int ms)
+{
+    m_playoutBufferMs.store(std::max(ms, 5), std::memory_order_relaxed);
+}
+
+void AudioReceiver::setOutputLatencyMs(int ms)
+{
+    m_outputLatencyMs.store(std::max(ms, 0), std::memory_order_relaxed);
+}
+
+void AudioReceiver::setMuted(bool muted)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_muted = muted;
+    if (muted) {
+        m_jitterBuffer.reset();
+    }
+}
+
+std::size_t AudioReceiver::playoutTargetSamples() const
+{
+    const int ms = m_playoutBufferMs.load(std::memory_order_relaxed);
+    const auto samples = static_cast<std::size_t>(OpusAudioDecoder::kSampleRate / 1000 * ms * OpusAudioDecoder::kChannels);
+    return std::min(samples, m_output->capacity());
+}
+
+AudioReceiverStats AudioReceiver::stats() const
+{
+    AudioReceiverStats stats;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        stats.jitter = m_jitterBuffer.stats();
+    }
+    stats.framesConcealed = m_framesConcealed.load(std::memory_order_relaxed);
+    stats.framesRecovered = m_framesRecovered.load(std::memory_order_relaxed);
+    stats.playoutBufferedMs = static_cast<double>(m_output->available())
+        / (OpusAudioDecoder::kSampleRate / 1000 * OpusAudioDecoder::kChannels);
+    return stats;
+}
+
+void AudioReceiver::handleRtpPacket(const std::byte *data, std::size_t size)
+{
+    const auto *bytes = reinterpret_cast<const std::uint8_t *>(data);
+    if (isRtcpPacket(bytes, size)) {
+        RtcpSenderReport report;
+        if (m_avSync && findRtcpSenderReport(bytes, size, report)) {
+            m_avSync->onSenderReport(AvSync::Stream::Audio, report);
+        }
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_running && !m_muted) {
+        m_jitterBuffer.insert(bytes, size, steadyNowUs());
+    }
+}
+
+void AudioReceiver::decodeLoop()
+{
+    OpusAudioDecoder decoder;
+    std::vector<std::int16_t> pcm(OpusAudioDecoder::kMaxFrameSamples * OpusAudioDecoder::kChannels);
+    std::vector<std::uint8_t> payload;
+    std::vector<std::uint8_t> nextPayload;
+    // Nothing to conceal before the first frame has played.
+    int concealedRun = kMaxConcealedFrames;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (m_running) {
+        while (m_running && m_output->available() < playoutTargetSamples()) {
+            AudioPacket packet;
+            const auto result = m_jitterBuffer.pop(packet);
+            // Copy out so the network thread is not held up while decoding.
+            payload.assign(packet.payload, packet.payload + packet.payloadSize);
+            nextPayload.assign(packet.nextPayload, packet.nextPayload + packet.nextPayloadSize);
+            lock.unlock();
+
+            int samples = -1;
+            if (result == AudioJitterBuffer::PopResult::Frame) {
+                samples = decoder.decode(payload.data(), payload.size(), pcm.data());
+                concealedRun = 0;
+            } else if (result == AudioJitterBuffer::PopResult::Lost) {
+                samples = decoder.decodeFec(nextPayload.data(), nextPayload.size(), decoder.lastFrameSamples(), pcm.data());
+                if (samples > 0) {
+                    m_framesRecovered.fetch_add(1, std::memory_order_relaxed);
+                }
+                concealedRun = 0;
+            } else if (concealedRun < kMaxConcealedFrames) {
+                ++concealedRun;
+            } else {
+                lock.lock();
+                break; // underrun outlasted concealment: let the device play silence
+            }
+
+            if (samples < 0) {
+                samples = decoder.conceal(decoder.lastFrameSamples(), pcm.data());
+                if (samples > 0) {
+                    m_framesConcealed.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+            if (samples > 0) {
+                if (m_avSync && result != AudioJitterBuffer::PopResult::Empty) {
+                    // Heard once everything queued ahead of it has played.
+                    const std::int64_t queuedUs = static_cast<std::int64_t>(m_output->available())
+                        * 1000000 / (OpusAudioDecoder::kSampleRate * OpusAudioDecoder::kChannels);
+                    const std::int64_t latencyUs = m_outputLatencyMs.load(std::memory_order_relaxed) * 1000;
+                    m_avSync->onAudioScheduled(packet.timestamp, steadyNowUs() + queuedUs + latencyUs);
+                }
+                m_output->write(pcm.data(), static_cast<std::size_t>(samples) * OpusAudioDecoder::kChannels);
+            }
+            lock.lock();
+        }
+        m_wakeup.wait_for(lock, kPollInterval);
+    }
+}
+
+} // namespace controller
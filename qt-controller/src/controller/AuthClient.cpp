@@ -1,5 +1,6 @@
 #include "controller/AuthClient.h"
 
+#include <QJsonArray>
 #include <QJsonDocument>
 #include <QNetworkReply>
 #include <QNetworkRequest>
@@ -14,6 +15,35 @@ QNetworkRequest makeJsonRequest(const QUrl &url)
     return request;
 }
 
+// Accepts both {"iceServers": [...]} and a bare array of RTCIceServer-style
+// entries, where "urls" may be a single string.
+std::vector<IceServer> parseIceServers(const QJsonDocument &document)
+{
+    const QJsonArray entries = document.isArray()
+        ? document.array()
+        : document.object().value(QStringLiteral("iceServers")).toArray();
+
+    std::vector<IceServer> servers;
+    for (const auto &entry : entries) {
+        const auto json = entry.toObject();
+        IceServer server;
+        const auto urls = json.value(QStringLiteral("urls"));
+        if (urls.isArray()) {
+            for (const auto &url : urls.toArray()) {
+                server.urls << url.toString();
+            }
+        } else if (urls.isString()) {
+            server.urls << urls.toString();
+        }
+        server.username = json.value(QStringLiteral("username")).toString();
+        server.credential = json.value(QStringLiteral("credential")).toString();
+        if (!server.urls.isEmpty()) {
+            servers.push_back(server);
+        }
+    }
+    return servers;
+}
+
 } // namespace
 
 AuthClient::AuthClient(QObject *parent)
@@ -102,6 +132,29 @@ void AuthClient::pollDeviceCode(const QString &deviceCode)
     });
 }
 
+void AuthClient::fetchIceServers()
+{
+    if (!m_apiBase.isValid()) {
+        emit requestFailed(QStringLiteral("ice"), QStringLiteral("API base URL is not set"));
+        return;
+    }
+
+    const QUrl url = m_apiBase.resolved(QUrl(QStringLiteral("/api/ice")));
+    QNetworkRequest request(url);
+    if (!m_appToken.isEmpty()) {
+        request.setRawHeader("Authorization", "Bearer " + m_appToken.toUtf8());
+    }
+    auto reply = m_network.get(request);
+    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
+        reply->deleteLater();
+        if (reply->error() != QNetworkReply::NoError) {
+            handleNetworkError(QStringLiteral("ice"), reply);
+            return;
+        }
+        emit iceServersReady(parseIceServers(QJsonDocument::fromJson(reply->readAll())));
+    });
+}
+
 void AuthClient::handleNetworkError(const QString &context, QNetworkReply *reply)
 {
     const auto message = reply->errorString();
@@ -0,0 +1,110 @@
+#include "controller/AvSync.h"
+
+namespace controller {
+
+namespace {
+// Audio that has not been scheduled for this long has stopped (muted host,
+// lost stream); video must not be held against a clock that no longer runs.
+constexpr std::int64_t kAudioAnchorTimeoutUs = 500000;
+constexpr double kOffsetSmoothing = 1.0 / 16.0;
+} // namespace
+
+void AvSync::onSenderReport(Stream stream, const RtcpSenderReport &report)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ClockMapping &mapping = stream == Stream::Audio ? m_audioMapping : m_videoMapping;
+    mapping.valid = true;
+    mapping.senderUs = ntpToMicroseconds(report.ntpTimestamp);
+    mapping.rtpTimestamp = report.rtpTimestamp;
+}
+
+std::optional<std::int64_t> AvSync::toSenderUs(const ClockMapping &mapping, std::uint32_t rtpTimestamp, int clockRate)
+{
+    if (!mapping.valid) {
+        return std::nullopt;
+    }
+    // Signed difference: frames shortly before the report map correctly too.
+    const auto delta = static_cast<std::int32_t>(rtpTimestamp - mapping.rtpTimestamp);
+    return mapping.senderUs + static_cast<std::int64_t>(delta) * 1000000 / clockRate;
+}
+
+void AvSync::onAudioScheduled(std::uint32_t rtpTimestamp, std::int64_t playoutUs)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const auto senderUs = toSenderUs(m_audioMapping, rtpTimestamp, kAudioClockRate);
+    if (!senderUs) {
+        return;
+    }
+    m_audioAnchor.valid = true;
+    m_audioAnchor.senderUs = *senderUs;
+    m_audioAnchor.localUs = playoutUs;
+}
+
+std::optional<std::int64_t> AvSync::audioClockUs(std::int64_t nowUs) const
+{
+    if (!m_audioAnchor.valid || nowUs - m_audioAnchor.localUs > kAudioAnchorTimeoutUs) {
+        return std::nullopt;
+    }
+    return m_audioAnchor.senderUs + (nowUs - m_audioAnchor.localUs);
+}
+
+std::optional<std::int64_t> AvSync::leadLocked(std::uint32_t rtpTimestamp, std::int64_t nowUs) const
+{
+    const auto videoUs = toSenderUs(m_videoMapping, rtpTimestamp, kVideoClockRate);
+    const auto audioUs = audioClockUs(nowUs);
+    if (!videoUs || !audioUs) {
+        return std::nullopt;
+    }
+    return *videoUs - *audioUs;
+}
+
+std::optional<std::int64_t> AvSync::videoLeadUs(std::uint32_t rtpTimestamp, std::int64_t nowUs) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return leadLocked(rtpTimestamp, nowUs);
+}
+
+void AvSync::onVideoPresented(std::uint32_t rtpTimestamp, std::int64_t nowUs)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const auto lead = leadLocked(rtpTimestamp, nowUs);
+    m_stats.synchronized = lead.has_value();
+    if (!lead) {
+        return;
+    }
+
+    const double offsetMs = *lead / 1000.0;
+    m_stats.lastOffsetMs = offsetMs;
+    m_stats.offsetMs = m_hasOffset ? m_stats.offsetMs + (offsetMs - m_stats.offsetMs) * kOffsetSmoothing : offsetMs;
+    m_hasOffset = true;
+}
+
+void AvSync::onVideoHeld()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_stats.framesHeld;
+}
+
+void AvSync::onVideoDropped()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_stats.framesDropped;
+}
+
+void AvSync::reset()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_audioMapping = ClockMapping();
+    m_videoMapping = ClockMapping();
+    m_audioAnchor = AudioAnchor();
+    m_stats = AvSyncStats();
+    m_hasOffset = false;
+}
+
+AvSyncStats AvSync::stats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+} // namespace controller
@@ -0,0 +1,335 @@
+#include "controller/BandwidthEstimator.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace controller {
+
+namespace {
+// Packets arriving this close together with a shrinking delay were queued
+// behind each other; they belong to the group before them.
+constexpr std::int64_t kBurstDeltaUs = 5000;
+constexpr std::int64_t kMaxBurstDurationUs = 100000;
+// A delay jump this large is a host restart or clock reset, not congestion.
+constexpr double kMaxDelayVariationMs = 3000.0;
+constexpr std::size_t kMaxTrendGroups = 60;
+
+constexpr double kOveruseTimeThresholdMs = 10.0;
+constexpr double kThresholdGainUp = 0.0087;
+constexpr double kThresholdGainDown = 0.039;
+constexpr double kMinThresholdMs = 6.0;
+constexpr double kMaxThresholdMs = 600.0;
+constexpr double kMaxThresholdStepMs = 15.0;
+constexpr std::int64_t kMaxThresholdDtUs = 100000;
+
+constexpr double kDecreaseFactor = 0.85;
+constexpr double kMultiplicativeIncreasePerSecond = 1.08;
+constexpr double kMinAdditiveIncreaseBps = 4000.0;
+constexpr double kNearMaxResetFactor = 1.25; // incoming beyond this leaves the additive regime
+constexpr double kAssumedFrameRate = 30.0;
+constexpr double kMaxPacketBits = 1200.0 * 8.0;
+constexpr std::int64_t kResponseExtraUs = 100000;
+constexpr std::int64_t kMaxRateUpdateUs = 1000000;
+} // namespace
+
+BandwidthEstimator::BandwidthEstimator(const BandwidthEstimatorConfig &config)
+    : m_config(config)
+{
+    m_config.trendlineWindow = std::clamp<std::size_t>(m_config.trendlineWindow, 2, m_trend.size());
+    reset();
+}
+
+void BandwidthEstimator::reset()
+{
+    m_hasTimestamp = false;
+    m_current = PacketGroup();
+    m_previous = PacketGroup();
+    m_trendCount = 0;
+    m_trendNext = 0;
+    m_groupCount = 0;
+    m_firstArrivalMs = -1.0;
+    m_accumulatedDelayMs = 0.0;
+    m_smoothedDelayMs = 0.0;
+    m_slope = 0.0;
+
+    m_threshold = 12.5;
+    m_lastThresholdUpdateUs = -1;
+    m_overuseTimeMs = -1.0;
+    m_overuseCount = 0;
+    m_previousTrend = 0.0;
+    m_usage = BandwidthUsage::Normal;
+
+    m_estimateBps = std::clamp(m_config.startBitrateBps, m_config.minBitrateBps, m_config.maxBitrateBps);
+    m_lastEstimateUpdateUs = -1;
+    m_lastDecreaseUs = -1;
+    m_nearMax = false;
+    m_congestedIncomingBps = 0;
+
+    m_rateBytes.fill(0);
+    m_rateFirstBucket = -1;
+    m_rateNewestBucket = -1;
+    m_rateSum = 0;
+
+    m_stats = BandwidthEstimatorStats();
+    m_stats.estimateBps = m_estimateBps;
+    m_stats.thresholdMs = m_threshold;
+}
+
+void BandwidthEstimator::setRttUs(std::int64_t rttUs)
+{
+    if (rttUs > 0) {
+        m_rttUs = rttUs;
+    }
+}
+
+std::int64_t BandwidthEstimator::unwrapTimestamp(std::uint32_t timestamp)
+{
+    if (!m_hasTimestamp) {
+        m_hasTimestamp = true;
+        m_lastTimestamp = timestamp;
+        return timestamp;
+    }
+    const auto delta = static_cast<std::int32_t>(timestamp - static_cast<std::uint32_t>(m_lastTimestamp));
+    const std::int64_t extended = m_lastTimestamp + delta;
+    m_lastTimestamp = std::max(m_lastTimestamp, extended);
+    return extended;
+}
+
+void BandwidthEstimator::updateIncomingRate(std::int64_t arrivalUs, std::size_t bytes)
+{
+    const std::int64_t bucket = arrivalUs / kRateBucketUs;
+    const auto buckets = static_cast<std::int64_t>(kRateBuckets);
+    if (m_rateNewestBucket < 0) {
+        m_rateFirstBucket = bucket;
+        m_rateNewestBucket = bucket;
+    }
+    if (bucket <= m_rateNewestBucket - buckets) {
+        return; // older than the window
+    }
+    if (bucket > m_rateNewestBucket) {
+        const std::int64_t expired = std::min(bucket - m_rateNewestBucket, buckets);
+        for (std::int64_t i = 1; i <= expired; ++i) {
+            std::int64_t &slot = m_rateBytes[static_cast<std::size_t>((m_rateNewestBucket + i) % buckets)];
+            m_rateSum -= slot;
+            slot = 0;
+        }
+        m_rateNewestBucket = bucket;
+    }
+    m_rateBytes[static_cast<std::size_t>(bucket % buckets)] += static_cast<std::int64_t>(bytes);
+    m_rateSum += static_cast<std::int64_t>(bytes);
+
+    // Until the window has filled, average over the time actually covered.
+    const std::int64_t span = std::min(m_rateNewestBucket - m_rateFirstBucket + 1, buckets);
+    m_stats.incomingBps = m_rateSum * 8 * 1000000 / (span * kRateBucketUs);
+}
+
+void BandwidthEstimator::onPacket(std::int64_t arrivalUs, std::uint32_t rtpTimestamp, std::size_t bytes)
+{
+    updateIncomingRate(arrivalUs, bytes);
+    const std::int64_t sendUs = unwrapTimestamp(rtpTimestamp) * 1000000 / m_config.clockRate;
+
+    if (!m_current.valid) {
+        m_current.valid = true;
+        m_current.sendUs = sendUs;
+        m_current.firstArrivalUs = arrivalUs;
+        m_current.lastArrivalUs = arrivalUs;
+        return;
+    }
+    if (sendUs == m_current.sendUs) {
+        m_current.lastArrivalUs = std::max(m_current.lastArrivalUs, arrivalUs);
+        return;
+    }
+    if (sendUs < m_current.sendUs) {
+        return; // a reordered packet of an older frame: counts for the rate only
+    }
+
+    const std::int64_t arrivalDeltaUs = arrivalUs - m_current.lastArrivalUs;
+    const std::int64_t propagationDeltaUs = arrivalDeltaUs - (sendUs - m_current.sendUs);
+    if (propagationDeltaUs < 0 && arrivalDeltaUs <= kBurstDeltaUs
+        && arrivalUs - m_current.firstArrivalUs < kMaxBurstDurationUs) {
+        m_current.sendUs = sendUs;
+        m_current.lastArrivalUs = arrivalUs;
+        return;
+    }
+
+    if (m_previous.valid) {
+        onGroupComplete(m_previous, m_current);
+    }
+    m_previous = m_current;
+    m_current.sendUs = sendUs;
+    m_current.firstArrivalUs = arrivalUs;
+    m_current.lastArrivalUs = arrivalUs;
+}
+
+void BandwidthEstimator::onGroupComplete(const PacketGroup &previous, const PacketGroup &current)
+{
+    const double sendDeltaMs = (current.sendUs - previous.sendUs) / 1000.0;
+    const double arrivalDeltaMs = (current.lastArrivalUs - previous.lastArrivalUs) / 1000.0;
+    if (arrivalDeltaMs < 0.0) {
+        return;
+    }
+
+    const double delayVariationMs = arrivalDeltaMs - sendDeltaMs;
+    if (std::abs(delayVariationMs) > kMaxDelayVariationMs) {
+        // Keep the rate estimate, forget the delay history.
+        m_trendCount = 0;
+        m_trendNext = 0;
+        m_groupCount = 0;
+        m_firstArrivalMs = -1.0;
+        m_accumulatedDelayMs = 0.0;
+        m_smoothedDelayMs = 0.0;
+        m_slope = 0.0;
+        return;
+    }
+
+    updateTrendline(delayVariationMs, current.lastArrivalUs / 1000.0);
+    detect(sendDeltaMs, current.lastArrivalUs);
+    updateEstimate(current.lastArrivalUs);
+}
+
+void BandwidthEstimator::updateTrendline(double delayVariationMs, double arrivalMs)
+{
+    m_groupCount = std::min(m_groupCount + 1, kMaxTrendGroups);
+    m_accumulatedDelayMs += delayVariationMs;
+    m_smoothedDelayMs = m_config.trendlineSmoothing * m_smoothedDelayMs
+        + (1.0 - m_config.trendlineSmoothing) * m_accumulatedDelayMs;
+    if (m_firstArrivalMs < 0.0) {
+        m_firstArrivalMs = arrivalMs;
+    }
+
+    const std::size_t window = m_config.trendlineWindow;
+    m_trend[m_trendNext] = TrendPoint{arrivalMs - m_firstArrivalMs, m_smoothedDelayMs};
+    m_trendNext = (m_trendNext + 1) % window;
+    m_trendCount = std::min(m_trendCount + 1, window);
+    if (m_trendCount < window) {
+        return;
+    }
+
+    // Least-squares slope of smoothed delay over arrival time: how fast the
+    // queue on the path is growing (ms of delay per ms).
+    double meanX = 0.0;
+    double meanY = 0.0;
+    for (std::size_t i = 0; i < window; ++i) {
+        meanX += m_trend[i].arrivalMs;
+        meanY += m_trend[i].smoothedDelayMs;
+    }
+    meanX /= static_cast<double>(window);
+    meanY /= static_cast<double>(window);
+    double numerator = 0.0;
+    double denominator = 0.0;
+    for (std::size_t i = 0; i < window; ++i) {
+        const double dx = m_trend[i].arrivalMs - meanX;
+        numerator += dx * (m_trend[i].smoothedDelayMs - meanY);
+        denominator += dx * dx;
+    }
+    if (denominator != 0.0) {
+        m_slope = numerator / denominator;
+    }
+}
+
+void BandwidthEstimator::detect(double deltaMs, std::int64_t nowUs)
+{
+    if (m_groupCount < 2) {
+        m_usage = BandwidthUsage::Normal;
+        return;
+    }
+
+    const double trend = static_cast<double>(m_groupCount) * m_slope * m_config.trendlineGain;
+    m_stats.trend = trend;
+    if (trend > m_threshold) {
+        m_overuseTimeMs = m_overuseTimeMs < 0.0 ? deltaMs / 2.0 : m_overuseTimeMs + deltaMs;
+        ++m_overuseCount;
+        // Only a sustained and still growing trend counts as overuse.
+        if (m_overuseTimeMs > kOveruseTimeThresholdMs && m_overuseCount > 1 && trend >= m_previousTrend) {
+            m_overuseTimeMs = 0.0;
+            m_overuseCount = 0;
+            m_usage = BandwidthUsage::Overusing;
+        }
+    } else if (trend < -m_threshold) {
+        m_overuseTimeMs = -1.0;
+        m_overuseCount = 0;
+        m_usage = BandwidthUsage::Underusing;
+    } else {
+        m_overuseTimeMs = -1.0;
+        m_overuseCount = 0;
+        m_usage = BandwidthUsage::Normal;
+    }
+    m_previousTrend = trend;
+    m_stats.usage = m_usage;
+    updateThreshold(trend, nowUs);
+}
+
+void BandwidthEstimator::updateThreshold(double trend, std::int64_t nowUs)
+{
+    if (m_lastThresholdUpdateUs < 0) {
+        m_lastThresholdUpdateUs = nowUs;
+    }
+    const double magnitude = std::abs(trend);
+    if (magnitude > m_threshold + kMaxThresholdStepMs) {
+        // A spike (e.g. a route change) should not drag the threshold along.
+        m_lastThresholdUpdateUs = nowUs;
+        return;
+    }
+
+    // Rises slowly under steady high delay, so competing TCP flows do not
+    // starve the stream, and falls back quickly once the queue drains.
+    const double gain = magnitude < m_threshold ? kThresholdGainDown : kThresholdGainUp;
+    const double dtMs = std::min(nowUs - m_lastThresholdUpdateUs, kMaxThresholdDtUs) / 1000.0;
+    m_threshold = std::clamp(m_threshold + gain * (magnitude - m_threshold) * dtMs, kMinThresholdMs, kMaxThresholdMs);
+    m_lastThresholdUpdateUs = nowUs;
+    m_stats.thresholdMs = m_threshold;
+}
+
+void BandwidthEstimator::updateEstimate(std::int64_t nowUs)
+{
+    if (m_lastEstimateUpdateUs < 0) {
+        m_lastEstimateUpdateUs = nowUs;
+    }
+    const double dtSeconds = std::clamp<std::int64_t>(nowUs - m_lastEstimateUpdateUs, 0, kMaxRateUpdateUs) / 1e6;
+    m_lastEstimateUpdateUs = nowUs;
+    const std::int64_t incoming = m_stats.incomingBps;
+
+    if (m_nearMax && incoming > m_congestedIncomingBps * kNearMaxResetFactor) {
+        m_nearMax = false; // the path got faster: probe multiplicatively again
+    }
+
+    double estimate = static_cast<double>(m_estimateBps);
+    switch (m_usage) {
+    case BandwidthUsage::Overusing:
+        // One decrease per response time; the queue needs a round trip to drain.
+        if (m_lastDecreaseUs < 0 || nowUs - m_lastDecreaseUs >= m_rttUs + kResponseExtraUs) {
+            const double target = kDecreaseFactor * static_cast<double>(incoming > 0 ? incoming : m_estimateBps);
+            estimate = std::min(estimate, target);
+            m_lastDecreaseUs = nowUs;
+            m_nearMax = true;
+            m_congestedIncomingBps = incoming;
+            ++m_stats.overuseEvents;
+        }
+        break;
+    case BandwidthUsage::Underusing:
+        // The queue is draining; let it before probing again.
+        break;
+    case BandwidthUsage::Normal: {
+        double increase = 0.0;
+        if (m_nearMax) {
+            // About one packet per response time.
+            const double frameBits = estimate / kAssumedFrameRate;
+            const double packetsPerFrame = std::ceil(frameBits / kMaxPacketBits);
+            const double packetBits = frameBits / std::max(packetsPerFrame, 1.0);
+            const double responseSeconds = (m_rttUs + kResponseExtraUs) / 1e6;
+            increase = std::max(kMinAdditiveIncreaseBps, packetBits / responseSeconds) * dtSeconds;
+        } else {
+            increase = std::max(estimate * (std::pow(kMultiplicativeIncreasePerSecond, dtSeconds) - 1.0), 1000.0 * dtSeconds);
+        }
+        // Never run far ahead of what actually arrives.
+        const double ceiling = incoming > 0 ? 1.5 * static_cast<double>(incoming) + 10000.0 : estimate + increase;
+        estimate = std::max(estimate, std::min(estimate + increase, ceiling));
+        break;
+    }
+    }
+
+    m_estimateBps = std::clamp(static_cast<std::int64_t>(estimate), m_config.minBitrateBps, m_config.maxBitrateBps);
+    m_stats.estimateBps = m_estimateBps;
+}
+
+} // namespace controller
@@ -0,0 +1,354 @@
+#include "controller/ColorConverter.h"
+
+#include <cstdint>
+#include <initializer_list>
+
+#ifdef CONTROLLER_HAVE_LIBYUV
+#include <libyuv/convert_argb.h>
+#include <libyuv/scale.h>
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64) || (defined(__SSE2__) && (defined(__i386__) || defined(_M_IX86)))
+#define CONTROLLER_HAS_X86_SIMD 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// AVX2 code is compiled per function so the rest of the binary keeps the
+// baseline instruction set and still runs on CPUs without AVX2.
+#if defined(CONTROLLER_HAS_X86_SIMD) && (defined(__GNUC__) || defined(__clang__))
+#define CONTROLLER_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define CONTROLLER_TARGET_AVX2
+#endif
+
+namespace controller {
+
+namespace {
+
+// BT.601 limited range, 8.8 fixed point.
+inline std::uint32_t packRgb32(int y, int u, int v)
+{
+    const int c = y - 16;
+    const int d = u - 128;
+    const int e = v - 128;
+    auto clamp = [](int x) { return x < 0 ? 0 : (x > 255 ? 255 : x); };
+    const int r = clamp((298 * c + 409 * e + 128) >> 8);
+    const int g = clamp((298 * c - 100 * d - 208 * e + 128) >> 8);
+    const int b = clamp((298 * c + 516 * d + 128) >> 8);
+    return 0xFF000000u | (static_cast<std::uint32_t>(r) << 16) | (static_cast<std::uint32_t>(g) << 8) | static_cast<std::uint32_t>(b);
+}
+
+void convertRowScalar(const std::uint8_t *y, const std::uint8_t *u, const std::uint8_t *v, std::uint32_t *out, int begin, int end)
+{
+    for (int col = begin; col < end; ++col) {
+        out[col] = packRgb32(y[col], u[col / 2], v[col / 2]);
+    }
+}
+
+void convertScalar(const I420FrameView &frame, std::uint8_t *dst, qsizetype dstStride)
+{
+    for (int row = 0; row < frame.height; ++row) {
+        const std::uint8_t *yRow = frame.y + row * frame.strideY;
+        const std::uint8_t *uRow = frame.u + (row / 2) * frame.strideUV;
+        const std::uint8_t *vRow = frame.v + (row / 2) * frame.strideUV;
+        auto *out = reinterpret_cast<std::uint32_t *>(dst + row * dstStride);
+        convertRowScalar(yRow, uRow, vRow, out, 0, frame.width);
+    }
+}
+
+#ifdef CONTROLLER_HAS_X86_SIMD
+
+// The SIMD paths work on 16-bit lanes with 6 fractional bits. Chroma
+// multipliers are applied with mulhi on operands pre-shifted by 8, i.e. the
+// constants are coefficient * 2^14:
+//   R = 1.164 Y' + 1.596 V'
+//   G = 1.164 Y' - 0.391 U' - 0.813 V'
+//   B = 1.164 Y' + 2.018 U'   (2.018 = 2 via shift + 0.018 via mulhi)
+// 1.164 * 64 = 74.5 is split into a shift (64) and mulhi on Y' << 7 (10.5 * 2^9).
+constexpr short kYFraction = 5376;
+constexpr short kRFromV = 26149;
+constexpr short kGFromU = 6406;
+constexpr short kGFromV = 13320;
+constexpr short kBFromUFraction = 295;
+
+inline void storeEightSse2(std::uint32_t *out, __m128i y16, __m128i u16, __m128i v16)
+{
+    const __m128i yy = _mm_sub_epi16(y16, _mm_set1_epi16(16));
+    const __m128i yc = _mm_add_epi16(_mm_slli_epi16(yy, 6), _mm_mulhi_epi16(_mm_slli_epi16(yy, 7), _mm_set1_epi16(kYFraction)));
+    const __m128i d = _mm_sub_epi16(u16, _mm_set1_epi16(128));
+    const __m128i e = _mm_sub_epi16(v16, _mm_set1_epi16(128));
+    const __m128i d8 = _mm_slli_epi16(d, 8);
+    const __m128i e8 = _mm_slli_epi16(e, 8);
+    const __m128i rounding = _mm_set1_epi16(32);
+
+    __m128i r = _mm_adds_epi16(yc, _mm_mulhi_epi16(e8, _mm_set1_epi16(kRFromV)));
+    __m128i g = _mm_subs_epi16(_mm_subs_epi16(yc, _mm_mulhi_epi16(d8, _mm_set1_epi16(kGFromU))), _mm_mulhi_epi16(e8, _mm_set1_epi16(kGFromV)));
+    __m128i b = _mm_adds_epi16(_mm_adds_epi16(yc, _mm_slli_epi16(d, 7)), _mm_mulhi_epi16(d8, _mm_set1_epi16(kBFromUFraction)));
+    r = _mm_srai_epi16(_mm_adds_epi16(r, rounding), 6);
+    g = _mm_srai_epi16(_mm_adds_epi16(g, rounding), 6);
+    b = _mm_srai_epi16(_mm_adds_epi16(b, rounding), 6);
+
+    const __m128i b8 = _mm_packus_epi16(b, b);
+    const __m128i g8 = _mm_packus_epi16(g, g);
+    const __m128i r8 = _mm_packus_epi16(r, r);
+    const __m128i bg = _mm_unpacklo_epi8(b8, g8);
+    const __m128i ra = _mm_unpacklo_epi8(r8, _mm_set1_epi8(static_cast<char>(0xFF)));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out), _mm_unpacklo_epi16(bg, ra));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 4), _mm_unpackhi_epi16(bg, ra));
+}
+
+void convertSse2(const I420FrameView &frame, std::uint8_t *dst, qsizetype dstStride)
+{
+    const __m128i zero = _mm_setzero_si128();
+    for (int row = 0; row < frame.height; ++row) {
+        const std::uint8_t *yRow = frame.y + row * frame.strideY;
+        const std::uint8_t *uRow = frame.u + (row / 2) * frame.strideUV;
+        const std::uint8_t *vRow = frame.v + (row / 2) * frame.strideUV;
+        auto *out = reinterpret_cast<std::uint32_t *>(dst + row * dstStride);
+
+        int col = 0;
+        for (; col + 16 <= frame.width; col += 16) {
+            const __m128i y8 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(yRow + col));
+            const __m128i u8 = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(uRow + col / 2));
+            const __m128i v8 = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(vRow + col / 2));
+            const __m128i uu = _mm_unpacklo_epi8(u8, u8);
+            const __m128i vv = _mm_unpacklo_epi8(v8, v8);
+            storeEightSse2(out + col, _mm_unpacklo_epi8(y8, zero), _mm_unpacklo_epi8(uu, zero), _mm_unpacklo_epi8(vv, zero));
+            storeEightSse2(out + col + 8, _mm_unpackhi_epi8(y8, zero), _mm_unpackhi_epi8(uu, zero), _mm_unpackhi_epi8(vv, zero));
+        }
+        convertRowScalar(yRow, uRow, vRow, out, col, frame.width);
+    }
+}
+
+CONTROLLER_TARGET_AVX2 inline void storeSixteenAvx2(std::uint32_t *out, __m256i y16, __m256i u16, __m256i v16)
+{
+    const __m256i yy = _mm256_sub_epi16(y16, _mm256_set1_epi16(16));
+    const __m256i yc = _mm256_add_epi16(_mm256_slli_epi16(yy, 6), _mm256_mulhi_epi16(_mm256_slli_epi16(yy, 7), _mm256_set1_epi16(kYFraction)));
+    const __m256i d = _mm256_sub_epi16(u16, _mm256_set1_epi16(128));
+    const __m256i e = _mm256_sub_epi16(v16, _mm256_set1_epi16(128));
+    const __m256i d8 = _mm256_slli_epi16(d, 8);
+    const __m256i e8 = _mm256_slli_epi16(e, 8);
+    const __m256i rounding = _mm256_set1_epi16(32);
+
+    __m256i r = _mm256_adds_epi16(yc, _mm256_mulhi_epi16(e8, _mm256_set1_epi16(kRFromV)));
+    __m256i g = _mm256_subs_epi16(_mm256_subs_epi16(yc, _mm256_mulhi_epi16(d8, _mm256_set1_epi16(kGFromU))), _mm256_mulhi_epi16(e8, _mm256_set1_epi16(kGFromV)));
+    __m256i b = _mm256_adds_epi16(_mm256_adds_epi16(yc, _mm256_slli_epi16(d, 7)), _mm256_mulhi_epi16(d8, _mm256_set1_epi16(kBFromUFraction)));
+    r = _mm256_srai_epi16(_mm256_adds_epi16(r, rounding), 6);
+    g = _mm256_srai_epi16(_mm256_adds_epi16(g, rounding), 6);
+    b = _mm256_srai_epi16(_mm256_adds_epi16(b, rounding), 6);
+
+    // Pack/unpack work per 128-bit lane: lane 0 ends up with pixels 0-3 and
+    // 4-7, lane 1 with 8-11 and 12-15; the final permutes restore the order.
+    const __m256i b8 = _mm256_packus_epi16(b, b);
+    const __m256i g8 = _mm256_packus_epi16(g, g);
+    const __m256i r8 = _mm256_packus_epi16(r, r);
+    const __m256i bg = _mm256_unpacklo_epi8(b8, g8);
+    const __m256i ra = _mm256_unpacklo_epi8(r8, _mm256_set1_epi8(static_cast<char>(0xFF)));
+    const __m256i lo = _mm256_unpacklo_epi16(bg, ra);
+    const __m256i hi = _mm256_unpackhi_epi16(bg, ra);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out), _mm256_permute2x128_si256(lo, hi, 0x20));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + 8), _mm256_permute2x128_si256(lo, hi, 0x31));
+}
+
+CONTROLLER_TARGET_AVX2 void convertAvx2(const I420FrameView &frame, std::uint8_t *dst, qsizetype dstStride)
+{
+    for (int row = 0; row < frame.height; ++row) {
+        const std::uint8_t *yRow = frame.y + row * frame.strideY;
+        const std::uint8_t *uRow = frame.u + (row / 2) * frame.strideUV;
+        const std::uint8_t *vRow = frame.v + (row / 2) * frame.strideUV;
+        auto *out = reinterpret_cast<std::uint32_t *>(dst + row * dstStride);
+
+        int col = 0;
+        for (; col + 16 <= frame.width; col += 16) {
+            const __m128i y8 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(yRow + col));
+            const __m128i u8 = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(uRow + col / 2));
+            const __m128i v8 = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(vRow + col / 2));
+            storeSixteenAvx2(out + col,
+                             _mm256_cvtepu8_epi16(y8),
+                             _mm256_cvtepu8_epi16(_mm_unpacklo_epi8(u8, u8)),
+                             _mm256_cvtepu8_epi16(_mm_unpacklo_epi8(v8, v8)));
+        }
+        convertRowScalar(yRow, uRow, vRow, out, col, frame.width);
+    }
+}
+
+bool cpuSupportsAvx2()
+{
+#ifdef _MSC_VER
+    int info[4] = {};
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return false;
+    }
+    __cpuid(info, 1);
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif // CONTROLLER_HAS_X86_SIMD
+
+} // namespace
+
+bool isColorConversionBackendAvailable(ColorConversionBackend backend)
+{
+    switch (backend) {
+    case ColorConversionBackend::Auto:
+    case ColorConversionBackend::Scalar:
+        return true;
+    case ColorConversionBackend::LibYuv:
+#ifdef CONTROLLER_HAVE_LIBYUV
+        return true;
+#else
+        return false;
+#endif
+    case ColorConversionBackend::Avx2:
+#ifdef CONTROLLER_HAS_X86_SIMD
+    {
+        static const bool supported = cpuSupportsAvx2();
+        return supported;
+    }
+#else
+        return false;
+#endif
+    case ColorConversionBackend::Sse2:
+#ifdef CONTROLLER_HAS_X86_SIMD
+        return true;
+#else
+        return false;
+#endif
+    }
+    return false;
+}
+
+ColorConversionBackend resolveColorConversionBackend(ColorConversionBackend backend)
+{
+    if (backend != ColorConversionBackend::Auto) {
+        return isColorConversionBackendAvailable(backend) ? backend : ColorConversionBackend::Scalar;
+    }
+    for (auto candidate : {ColorConversionBackend::LibYuv, ColorConversionBackend::Avx2, ColorConversionBackend::Sse2}) {
+        if (isColorConversionBackendAvailable(candidate)) {
+            return candidate;
+        }
+    }
+    return ColorConversionBackend::Scalar;
+}
+
+const char *colorConversionBackendName(ColorConversionBackend backend)
+{
+    switch (backend) {
+    case ColorConversionBackend::Auto:
+        return "auto";
+    case ColorConversionBackend::LibYuv:
+        return "libyuv";
+    case ColorConversionBackend::Avx2:
+        return "avx2";
+    case ColorConversionBackend::Sse2:
+        return "sse2";
+    case ColorConversionBackend::Scalar:
+        return "scalar";
+    }
+    return "unknown";
+}
+
+void convertI420ToRgb32(const I420FrameView &frame, QImage &target, ColorConversionBackend backend)
+{
+    if (!frame.isValid()) {
+        return;
+    }
+
+    if (target.width() != frame.width || target.height() != frame.height || target.format() != QImage::Format_RGB32) {
+        target = QImage(frame.width, frame.height, QImage::Format_RGB32);
+    }
+
+    // bits() detaches a shared image; callers that keep handing frames out
+    // should give us an image nobody else references.
+    std::uint8_t *dst = target.bits();
+    const qsizetype dstStride = target.bytesPerLine();
+
+    static const ColorConversionBackend automatic = resolveColorConversionBackend(ColorConversionBackend::Auto);
+    const ColorConversionBackend resolved = backend == ColorConversionBackend::Auto ? automatic : resolveColorConversionBackend(backend);
+
+    switch (resolved) {
+#ifdef CONTROLLER_HAVE_LIBYUV
+    case ColorConversionBackend::LibYuv:
+        // libyuv "ARGB" is B,G,R,A in memory, i.e. QImage::Format_RGB32 on little-endian hosts.
+        libyuv::I420ToARGB(frame.y, frame.strideY, frame.u, frame.strideUV, frame.v, frame.strideUV,
+                           dst, static_cast<int>(dstStride), frame.width, frame.height);
+        return;
+#endif
+#ifdef CONTROLLER_HAS_X86_SIMD
+    case ColorConversionBackend::Avx2:
+        convertAvx2(frame, dst, dstStride);
+        return;
+    case ColorConversionBackend::Sse2:
+        convertSse2(frame, dst, dstStride);
+        return;
+#endif
+    default:
+        convertScalar(frame, dst, dstStride);
+        return;
+    }
+}
+
+I420FrameView downscaleI420(const I420FrameView &frame, int factor, std::vector<std::uint8_t> &storage)
+{
+    if (factor < 2 || !frame.isValid() || frame.width < 2 * factor || frame.height < 2 * factor) {
+        return frame;
+    }
+    I420FrameView out;
+    out.width = frame.width / factor;
+    out.height = frame.height / factor;
+    out.strideY = out.width;
+    out.strideUV = (out.width + 1) / 2;
+    out.rtpTimestamp = frame.rtpTimestamp;
+    const int chromaHeight = (out.height + 1) / 2;
+    const std::size_t ySize = static_cast<std::size_t>(out.strideY) * out.height;
+    const std::size_t uvSize = static_cast<std::size_t>(out.strideUV) * chromaHeight;
+    storage.resize(ySize + 2 * uvSize);
+    auto *y = storage.data();
+    auto *u = y + ySize;
+    auto *v = u + uvSize;
+
+#ifdef CONTROLLER_HAVE_LIBYUV
+    libyuv::I420Scale(frame.y, frame.strideY, frame.u, frame.strideUV, frame.v, frame.strideUV, frame.width,
+                      frame.height, y, out.strideY, u, out.strideUV, v, out.strideUV, out.width, out.height,
+                      libyuv::kFilterBox);
+#else
+    for (int row = 0; row < out.height; ++row) {
+        const std::uint8_t *src = frame.y + row * factor * frame.strideY;
+        std::uint8_t *dst = y + row * out.strideY;
+        for (int col = 0; col < out.width; ++col) {
+            dst[col] = src[col * factor];
+        }
+    }
+    for (int row = 0; row < chromaHeight; ++row) {
+        const std::uint8_t *srcU = frame.u + row * factor * frame.strideUV;
+        const std::uint8_t *srcV = frame.v + row * factor * frame.strideUV;
+        std::uint8_t *dstU = u + row * out.strideUV;
+        std::uint8_t *dstV = v + row * out.strideUV;
+        for (int col = 0; col < out.strideUV; ++col) {
+            dstU[col] = srcU[col * factor];
+            dstV[col] = srcV[col * factor];
+        }
+    }
+#endif
+
+    out.y = y;
+    out.u = u;
+    out.v = v;
+    return out;
+}
+
+} // namespace controller
@@ -0,0 +1,140 @@
+#include "controller/DecodeWorkerPool.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace controller {
+
+namespace {
+std::int64_t steadyNowUs()
+{
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+std::chrono::steady_clock::time_point toTimePoint(std::int64_t us)
+{
+    return std::chrono::steady_clock::time_point(std::chrono::microseconds(us));
+}
+} // namespace
+
+DecodeWorkerPool::DecodeWorkerPool(std::size_t threads)
+{
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    m_threads.reserve(threads);
+    for (std::size_t i = 0; i < threads; ++i) {
+        m_threads.emplace_back(&DecodeWorkerPool::workerLoop, this);
+    }
+}
+
+DecodeWorkerPool::~DecodeWorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wakeup.notify_all();
+    for (auto &thread : m_threads) {
+        thread.join();
+    }
+}
+
+DecodeWorkerPool::JobId DecodeWorkerPool::add(DecodeJob *job)
+{
+    JobId id;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        id = m_nextId++;
+        m_jobs[id] = Entry{job, steadyNowUs(), false, false};
+    }
+    m_wakeup.notify_one();
+    return id;
+}
+
+void DecodeWorkerPool::remove(JobId id)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_finished.wait(lock, [this, id]() {
+        const auto it = m_jobs.find(id);
+        return it == m_jobs.end() || !it->second.running;
+    });
+    m_jobs.erase(id);
+}
+
+void DecodeWorkerPool::wake(JobId id)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const auto it = m_jobs.find(id);
+        if (it == m_jobs.end()) {
+            return;
+        }
+        if (it->second.running) {
+            it->second.rerun = true;
+            return;
+        }
+        it->second.dueUs = steadyNowUs();
+    }
+    m_wakeup.notify_one();
+}
+
+DecodeWorkerPoolStats DecodeWorkerPool::stats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    DecodeWorkerPoolStats stats;
+    stats.threads = m_threads.size();
+    stats.jobs = m_jobs.size();
+    stats.runs = m_runs;
+    stats.busyUs = m_busyUs;
+    return stats;
+}
+
+void DecodeWorkerPool::workerLoop()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_stopping) {
+        // A handful of jobs per pool, so a scan beats keeping a heap in sync.
+        std::unordered_map<JobId, Entry>::iterator next = m_jobs.end();
+        for (auto it = m_jobs.begin(); it != m_jobs.end(); ++it) {
+            const Entry &entry = it->second;
+            if (!entry.running && entry.dueUs >= 0 && (next == m_jobs.end() || entry.dueUs < next->second.dueUs)) {
+                next = it;
+            }
+        }
+        if (next == m_jobs.end()) {
+            m_wakeup.wait(lock);
+            continue;
+        }
+        const std::int64_t nowUs = steadyNowUs();
+        if (next->second.dueUs > nowUs) {
+            m_wakeup.wait_until(lock, toTimePoint(next->second.dueUs));
+            continue;
+        }
+
+        const JobId id = next->first;
+        DecodeJob *job = next->second.job;
+        next->second.running = true;
+        next->second.rerun = false;
+        lock.unlock();
+        const std::int64_t dueUs = job->runDue(nowUs);
+        const std::int64_t endUs = steadyNowUs();
+        lock.lock();
+
+        ++m_runs;
+        m_busyUs += static_cast<std::uint64_t>(endUs - nowUs);
+        // The iterator may be stale: other jobs can have come and gone.
+        const auto it = m_jobs.find(id);
+        if (it != m_jobs.end()) {
+            it->second.running = false;
+            it->second.dueUs = it->second.rerun ? endUs : dueUs;
+            it->second.rerun = false;
+        }
+        // Back to the scan: that covers this job's new due time as well as
+        // wake()s that found every thread busy.
+        m_finished.notify_all();
+    }
+}
+
+} // namespace controller
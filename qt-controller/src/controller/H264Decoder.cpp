@@ -0,0 +1,64 @@
+#include "controller/H264Decoder.h"
+
+#include <climits>
+
+#include <wels/codec_api.h>
+
+namespace controller {
+
+H264Decoder::H264Decoder()
+{
+    if (WelsCreateDecoder(&m_decoder) != 0 || !m_decoder) {
+        m_decoder = nullptr;
+        return;
+    }
+
+    SDecodingParam param{};
+    param.uiTargetDqLayer = UCHAR_MAX;
+    // Corrupted pictures are dropped and recovered with a keyframe instead of concealed.
+    param.eEcActiveIdc = ERROR_CON_DISABLE;
+    param.sVideoProperty.eVideoBsType = VIDEO_BITSTREAM_AVC;
+
+    if (m_decoder->Initialize(&param) != cmResultSuccess) {
+        WelsDestroyDecoder(m_decoder);
+        m_decoder = nullptr;
+    }
+}
+
+H264Decoder::~H264Decoder()
+{
+    if (m_decoder) {
+        m_decoder->Uninitialize();
+        WelsDestroyDecoder(m_decoder);
+    }
+}
+
+H264Decoder::Result H264Decoder::decode(const std::uint8_t *data, std::size_t size, std::uint32_t rtpTimestamp, I420FrameView &frame)
+{
+    if (!m_decoder || !data || size == 0) {
+        return Result::Error;
+    }
+
+    unsigned char *planes[3] = {nullptr, nullptr, nullptr};
+    SBufferInfo info{};
+    const DECODING_STATE state = m_decoder->DecodeFrameNoDelay(data, static_cast<int>(size), planes, &info);
+    if (state != dsErrorFree) {
+        return Result::Error;
+    }
+    if (info.iBufferStatus != 1) {
+        return Result::NoOutput;
+    }
+
+    const auto &buffer = info.UsrData.sSystemBuffer;
+    frame.y = planes[0];
+    frame.u = planes[1];
+    frame.v = planes[2];
+    frame.strideY = buffer.iStride[0];
+    frame.strideUV = buffer.iStride[1];
+    frame.width = buffer.iWidth;
+    frame.height = buffer.iHeight;
+    frame.rtpTimestamp = rtpTimestamp;
+    return frame.isValid() ? Result::Frame : Result::NoOutput;
+}
+
+} // namespace controller
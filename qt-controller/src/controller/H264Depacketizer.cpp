@@ -0,0 +1,185 @@
+#include "controller/H264Depacketizer.h"
+
+#include <iterator>
+#include <utility>
+
+namespace controller {
+
+namespace {
+constexpr std::uint8_t kStartCode[] = {0x00, 0x00, 0x00, 0x01};
+constexpr std::uint8_t kNalTypeMask = 0x1F;
+constexpr std::uint8_t kNalRefIdcMask = 0x60;
+constexpr std::uint8_t kNalTypeIdr = 5;
+constexpr std::uint8_t kNalTypeSps = 7;
+constexpr std::uint8_t kNalTypeStapA = 24;
+constexpr std::uint8_t kNalTypeFuA = 28;
+constexpr std::size_t kInitialReserve = 256 * 1024;
+
+bool isKeyframeNal(std::uint8_t nalHeader)
+{
+    const auto type = nalHeader & kNalTypeMask;
+    return type == kNalTypeIdr || type == kNalTypeSps;
+}
+} // namespace
+
+H264Depacketizer::H264Depacketizer()
+{
+    m_current.data.reserve(kInitialReserve);
+}
+
+void H264Depacketizer::reset()
+{
+    m_current.clear();
+    m_active = false;
+    m_hasExpectedSequence = false;
+    m_inFragment = false;
+}
+
+bool H264Depacketizer::push(const RtpPacketView &packet, H264AccessUnit &out)
+{
+    bool finished = false;
+
+    if (m_active && packet.timestamp != m_current.rtpTimestamp) {
+        // The marker packet of the previous unit never arrived.
+        m_current.complete = false;
+        finish(out);
+        finished = true;
+    }
+
+    // Any gap means data of the unit in progress, or of the one about to
+    // start, is missing (packets after a marker belong to the next unit).
+    const bool gap = m_hasExpectedSequence && packet.sequenceNumber != m_expectedSequence;
+    m_expectedSequence = static_cast<std::uint16_t>(packet.sequenceNumber + 1);
+    m_hasExpectedSequence = true;
+    if (gap) {
+        m_inFragment = false;
+    }
+
+    if (!m_active) {
+        m_active = true;
+        m_current.rtpTimestamp = packet.timestamp;
+    }
+    if (gap) {
+        m_current.complete = false;
+    }
+
+    appendPayload(packet);
+
+    if (packet.marker) {
+        if (finished) {
+            // Two units completed by one packet; the caller only gets the
+            // earlier (broken) one, so drop it in favour of the intact one.
+            out.clear();
+        }
+        finish(out);
+        return true;
+    }
+
+    return finished;
+}
+
+bool H264Depacketizer::flush(H264AccessUnit &out)
+{
+    if (!m_active) {
+        return false;
+    }
+    finish(out);
+    return true;
+}
+
+void H264Depacketizer::appendPayload(const RtpPacketView &packet)
+{
+    if (packet.payloadSize < 1) {
+        m_current.complete = false;
+        return;
+    }
+
+    const std::uint8_t *payload = packet.payload;
+    const std::size_t size = packet.payloadSize;
+    const std::uint8_t type = payload[0] & kNalTypeMask;
+
+    if (type >= 1 && type <= 23) {
+        m_inFragment = false;
+        appendNal(payload, size);
+        return;
+    }
+
+    if (type == kNalTypeStapA) {
+        m_inFragment = false;
+        std::size_t offset = 1;
+        while (offset + 2 <= size) {
+            const std::size_t nalSize = readBigEndian16(payload + offset);
+            offset += 2;
+            if (nalSize == 0 || offset + nalSize > size) {
+                m_current.complete = false;
+                return;
+            }
+            appendNal(payload + offset, nalSize);
+            offset += nalSize;
+        }
+        return;
+    }
+
+    if (type == kNalTypeFuA) {
+        if (size < 2) {
+            m_current.complete = false;
+            return;
+        }
+        const std::uint8_t indicator = payload[0];
+        const std::uint8_t header = payload[1];
+        const bool start = (header & 0x80) != 0;
+        const bool end = (header & 0x40) != 0;
+
+        if (start) {
+            const std::uint8_t nalHeader = static_cast<std::uint8_t>((indicator & 0xE0) | (header & kNalTypeMask));
+            m_current.data.insert(m_current.data.end(), std::begin(kStartCode), std::end(kStartCode));
+            m_current.data.push_back(nalHeader);
+            noteNalHeader(nalHeader);
+            m_inFragment = true;
+        } else if (!m_inFragment) {
+            // Continuation without a start fragment: the head of this NAL was lost.
+            m_current.complete = false;
+            return;
+        }
+
+        m_current.data.insert(m_current.data.end(), payload + 2, payload + size);
+        if (end) {
+            m_inFragment = false;
+        }
+        return;
+    }
+
+    // STAP-B, MTAP and FU-B are not negotiated by our SDP.
+    m_inFragment = false;
+    m_current.complete = false;
+}
+
+void H264Depacketizer::appendNal(const std::uint8_t *nal, std::size_t size)
+{
+    m_current.data.insert(m_current.data.end(), std::begin(kStartCode), std::end(kStartCode));
+    m_current.data.insert(m_current.data.end(), nal, nal + size);
+    noteNalHeader(nal[0]);
+}
+
+void H264Depacketizer::noteNalHeader(std::uint8_t nalHeader)
+{
+    m_current.keyframe = m_current.keyframe || isKeyframeNal(nalHeader);
+    m_current.referenced = m_current.referenced || (nalHeader & kNalRefIdcMask) != 0;
+}
+
+void H264Depacketizer::finish(H264AccessUnit &out)
+{
+    if (m_inFragment) {
+        m_current.complete = false;
+        m_inFragment = false;
+    }
+    if (m_current.data.empty()) {
+        m_current.complete = false;
+    }
+
+    std::swap(out, m_current);
+    m_current.clear();
+    m_active = false;
+}
+
+} // namespace controller
@@ -0,0 +1,142 @@
+#include "controller/H264Sei.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+namespace controller {
+
+namespace {
+constexpr std::uint8_t kStartCode[] = {0x00, 0x00, 0x00, 0x01};
+constexpr std::uint8_t kNalTypeMask = 0x1F;
+constexpr std::uint8_t kNalTypeSlice = 1;
+constexpr std::uint8_t kNalTypeIdr = 5;
+constexpr std::uint8_t kNalTypeSei = 6;
+constexpr std::uint8_t kSeiUserDataUnregistered = 5;
+constexpr std::size_t kTimestampPayloadSize = 16 + 8; // UUID + u64
+constexpr std::uint8_t kRbspStopBit = 0x80;
+// Enough for our SEI plus the usual encoder SEIs in front of it.
+constexpr std::size_t kMaxSeiSize = 512;
+
+// Position just past the next 00 00 01 start code at or after `from`, or `size`.
+std::size_t nextNalStart(const std::uint8_t *data, std::size_t size, std::size_t from)
+{
+    for (std::size_t i = from; i + 3 <= size; ++i) {
+        if (data[i] == 0 && data[i + 1] == 0 && data[i + 2] == 1) {
+            return i + 3;
+        }
+    }
+    return size;
+}
+
+// Removes emulation prevention bytes (00 00 03 -> 00 00).
+std::size_t unescapeRbsp(const std::uint8_t *in, std::size_t size, std::uint8_t *out, std::size_t capacity)
+{
+    std::size_t written = 0;
+    int zeros = 0;
+    for (std::size_t i = 0; i < size && written < capacity; ++i) {
+        if (zeros >= 2 && in[i] == 0x03) {
+            zeros = 0;
+            continue;
+        }
+        zeros = in[i] == 0 ? zeros + 1 : 0;
+        out[written++] = in[i];
+    }
+    return written;
+}
+
+bool parseSeiMessages(const std::uint8_t *rbsp, std::size_t size, std::int64_t &captureUs)
+{
+    std::size_t offset = 0;
+    while (offset < size && rbsp[offset] != kRbspStopBit) {
+        std::size_t payloadType = 0;
+        while (offset < size && rbsp[offset] == 0xFF) {
+            payloadType += 0xFF;
+            ++offset;
+        }
+        if (offset >= size) {
+            return false;
+        }
+        payloadType += rbsp[offset++];
+
+        std::size_t payloadSize = 0;
+        while (offset < size && rbsp[offset] == 0xFF) {
+            payloadSize += 0xFF;
+            ++offset;
+        }
+        if (offset >= size) {
+            return false;
+        }
+        payloadSize += rbsp[offset++];
+        if (payloadSize > size - offset) {
+            return false;
+        }
+
+        const std::uint8_t *payload = rbsp + offset;
+        if (payloadType == kSeiUserDataUnregistered && payloadSize >= kTimestampPayloadSize
+            && std::equal(kCaptureTimestampSeiUuid.begin(), kCaptureTimestampSeiUuid.end(), payload)) {
+            std::uint64_t value = 0;
+            for (std::size_t i = 0; i < 8; ++i) {
+                value = (value << 8) | payload[16 + i];
+            }
+            captureUs = static_cast<std::int64_t>(value);
+            return true;
+        }
+        offset += payloadSize;
+    }
+    return false;
+}
+} // namespace
+
+bool findCaptureTimestamp(const std::uint8_t *data, std::size_t size, std::int64_t &captureUs)
+{
+    std::uint8_t rbsp[kMaxSeiSize];
+    std::size_t start = nextNalStart(data, size, 0);
+    while (start < size) {
+        const std::uint8_t type = data[start] & kNalTypeMask;
+        if (type == kNalTypeSlice || type == kNalTypeIdr) {
+            return false; // SEI precedes the slices of its access unit
+        }
+        const std::size_t next = nextNalStart(data, size, start + 1);
+        if (type == kNalTypeSei) {
+            // Trailing zeros of the next start code belong to neither unit.
+            std::size_t end = next < size ? next - 3 : size;
+            while (end > start + 1 && data[end - 1] == 0) {
+                --end;
+            }
+            const std::size_t length = unescapeRbsp(data + start + 1, end - start - 1, rbsp, sizeof(rbsp));
+            if (parseSeiMessages(rbsp, length, captureUs)) {
+                return true;
+            }
+        }
+        start = next;
+    }
+    return false;
+}
+
+void appendCaptureTimestampSei(std::int64_t captureUs, std::vector<std::uint8_t> &out)
+{
+    std::uint8_t rbsp[2 + kTimestampPayloadSize + 1];
+    rbsp[0] = kSeiUserDataUnregistered;
+    rbsp[1] = static_cast<std::uint8_t>(kTimestampPayloadSize);
+    std::memcpy(rbsp + 2, kCaptureTimestampSeiUuid.data(), kCaptureTimestampSeiUuid.size());
+    const auto value = static_cast<std::uint64_t>(captureUs);
+    for (std::size_t i = 0; i < 8; ++i) {
+        rbsp[2 + 16 + i] = static_cast<std::uint8_t>(value >> (56 - 8 * i));
+    }
+    rbsp[sizeof(rbsp) - 1] = kRbspStopBit;
+
+    out.insert(out.end(), std::begin(kStartCode), std::end(kStartCode));
+    out.push_back(kNalTypeSei);
+    int zeros = 0;
+    for (const std::uint8_t byte : rbsp) {
+        if (zeros >= 2 && byte <= 0x03) {
+            out.push_back(0x03);
+            zeros = 0;
+        }
+        out.push_back(byte);
+        zeros = byte == 0 ? zeros + 1 : 0;
+    }
+}
+
+} // namespace controller
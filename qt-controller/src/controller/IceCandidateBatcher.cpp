@@ -0,0 +1,158 @@
+#include "controller/IceCandidateBatcher.h"
+
+#include <QJsonArray>
+#include <QJsonObject>
+
+namespace controller {
+
+namespace {
+const QString kIceType = QStringLiteral("ice");
+const QString kIceBatchType = QStringLiteral("ice-batch");
+const QString kCandidatesKey = QStringLiteral("candidates");
+const QString kCapabilityKey = QStringLiteral("iceBatch");
+const QString kCandidateKey = QStringLiteral("candidate");
+const QString kSdpMidKey = QStringLiteral("sdpMid");
+const QString kSdpMLineIndexKey = QStringLiteral("sdpMLineIndex");
+
+QJsonObject candidateToJson(const IceCandidate &candidate)
+{
+    return QJsonObject{
+        {kCandidateKey, candidate.candidate},
+        {kSdpMidKey, candidate.sdpMid},
+        {kSdpMLineIndexKey, candidate.sdpMLineIndex},
+    };
+}
+
+IceCandidate candidateFromJson(const QJsonObject &json)
+{
+    IceCandidate candidate;
+    candidate.candidate = json.value(kCandidateKey).toString();
+    candidate.sdpMid = json.value(kSdpMidKey).toString();
+    candidate.sdpMLineIndex = json.value(kSdpMLineIndexKey).toInt(-1);
+    return candidate;
+}
+} // namespace
+
+IceCandidateBatcher::IceCandidateBatcher(QObject *parent)
+    : QObject(parent)
+{
+    m_timer.setSingleShot(true);
+    connect(&m_timer, &QTimer::timeout, this, &IceCandidateBatcher::flush);
+}
+
+void IceCandidateBatcher::setWindowMs(int windowMs)
+{
+    m_windowMs = windowMs > 0 ? windowMs : 0;
+}
+
+void IceCandidateBatcher::setBatchingEnabled(bool enabled)
+{
+    const bool held = !m_peerKnown;
+    m_batching = enabled;
+    m_peerKnown = true;
+    if (held) {
+        flush();
+    }
+}
+
+void IceCandidateBatcher::peerSignalReceived(const SignalEnvelope &signal)
+{
+    if (peerAdvertised(signal)) {
+        if (!m_batching) {
+            setBatchingEnabled(true);
+        }
+    } else if (!m_peerKnown) {
+        // A host with the extension says so in its first signal, the answer.
+        setBatchingEnabled(false);
+    }
+}
+
+void IceCandidateBatcher::advertise(QJsonObject &descriptionData)
+{
+    descriptionData.insert(kCapabilityKey, true);
+}
+
+bool IceCandidateBatcher::peerAdvertised(const SignalEnvelope &signal)
+{
+    return signal.type == kIceBatchType || signal.data.value(kCapabilityKey).toBool(false);
+}
+
+void IceCandidateBatcher::addCandidate(const QString &candidate, const QString &sdpMid, int sdpMLineIndex)
+{
+    m_pending.push_back(IceCandidate{candidate, sdpMid, sdpMLineIndex});
+    if (!m_peerKnown) {
+        return; // released by setBatchingEnabled()
+    }
+    if (m_windowMs == 0 || !m_batching) {
+        flush();
+    } else if (!m_timer.isActive()) {
+        // Once gathering is over, only collect what arrives in the same event
+        // loop pass (a pre-warmed peer releases its candidates in one burst).
+        m_timer.start(m_gatheringComplete ? 0 : m_windowMs);
+    }
+}
+
+void IceCandidateBatcher::gatheringComplete()
+{
+    m_gatheringComplete = true;
+    flush();
+}
+
+void IceCandidateBatcher::flush()
+{
+    m_timer.stop();
+    if (m_pending.empty() || !m_peerKnown) {
+        return;
+    }
+    m_stats.candidates += m_pending.size();
+    if (!m_batching || m_windowMs == 0) {
+        // The host may only know "ice".
+        const std::vector<IceCandidate> pending = std::move(m_pending);
+        m_pending.clear();
+        for (const IceCandidate &candidate : pending) {
+            ++m_stats.broadcasts;
+            emit signalReady(makeSignal({candidate}));
+        }
+        return;
+    }
+    const SignalEnvelope signal = makeSignal(m_pending);
+    ++m_stats.broadcasts;
+    m_pending.clear();
+    emit signalReady(signal);
+}
+
+void IceCandidateBatcher::reset()
+{
+    m_timer.stop();
+    m_pending.clear();
+    m_gatheringComplete = false;
+}
+
+SignalEnvelope IceCandidateBatcher::makeSignal(const std::vector<IceCandidate> &candidates)
+{
+    if (candidates.size() == 1) {
+        return SignalEnvelope{kIceType, candidateToJson(candidates.front())};
+    }
+    QJsonArray array;
+    for (const IceCandidate &candidate : candidates) {
+        array.append(candidateToJson(candidate));
+    }
+    return SignalEnvelope{kIceBatchType, QJsonObject{{kCandidatesKey, array}}};
+}
+
+std::vector<IceCandidate> IceCandidateBatcher::candidatesFromSignal(const SignalEnvelope &signal)
+{
+    std::vector<IceCandidate> candidates;
+    if (signal.type == kIceType) {
+        candidates.push_back(candidateFromJson(signal.data));
+    } else if (signal.type == kIceBatchType) {
+        const QJsonArray array = signal.data.value(kCandidatesKey).toArray();
+        candidates.reserve(static_cast<std::size_t>(array.size()));
+        for (const auto &entry : array) {
+            candidates.push_back(candidateFromJson(entry.toObject()));
+        }
+    }
+    return candidates;
+}
+
+} // namespace controller
@@ -0,0 +1,179 @@
+#include "controller/InputScheduler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <utility>
+
+namespace controller {
+
+InputScheduler::InputScheduler(QObject *parent)
+    : QObject(parent)
+{
+    m_pending.reserve(Protocol::kMaxInputBatchEvents);
+    m_flushTimer.setSingleShot(true);
+    m_flushTimer.setTimerType(Qt::PreciseTimer);
+    connect(&m_flushTimer, &QTimer::timeout, this, &InputScheduler::flush);
+}
+
+void InputScheduler::setSink(Sink sink)
+{
+    m_sink = std::move(sink);
+}
+
+void InputScheduler::setFlushInterval(int intervalMs)
+{
+    m_flushIntervalMs = std::max(intervalMs, 0);
+    if (m_flushIntervalMs == 0 && !m_throttled) {
+        flush();
+    }
+}
+
+int InputScheduler::flushInterval() const
+{
+    return m_flushIntervalMs;
+}
+
+void InputScheduler::setFlushRate(double refreshHz)
+{
+    if (refreshHz <= 0.0) {
+        setFlushInterval(kDefaultFlushIntervalMs);
+        return;
+    }
+    setFlushInterval(std::max(1, static_cast<int>(std::lround(1000.0 / refreshHz))));
+}
+
+bool InputScheduler::isMotion(Protocol::InputEventType type)
+{
+    return type == Protocol::InputEventType::MouseMove || type == Protocol::InputEventType::MouseWheel;
+}
+
+bool InputScheduler::coalesce(const Protocol::InputEvent &event)
+{
+    // Only the newest pending event is a candidate: merging across a
+    // different event type would reorder motion against the wheel.
+    if (m_pending.empty() || m_pending.back().type != event.type) {
+        return false;
+    }
+
+    Protocol::InputEvent &last = m_pending.back();
+    if (event.type == Protocol::InputEventType::MouseMove) {
+        last.x = event.x;
+        last.y = event.y;
+        return true;
+    }
+    if (event.type == Protocol::InputEventType::MouseWheel) {
+        last.deltaY += event.deltaY;
+        return true;
+    }
+    return false;
+}
+
+void InputScheduler::submit(const Protocol::InputEvent &event)
+{
+    ++m_stats.eventsIn;
+
+    if (!isMotion(event.type)) {
+        m_pending.push_back(event);
+        flush();
+        return;
+    }
+
+    if (coalesce(event)) {
+        ++m_stats.eventsCoalesced;
+    } else {
+        if (m_throttled && m_pending.size() >= Protocol::kMaxInputBatchEvents) {
+            shedOldest();
+        }
+        m_pending.push_back(event);
+    }
+
+    if (m_throttled) {
+        return;
+    }
+    if (m_flushIntervalMs == 0 || m_pending.size() >= Protocol::kMaxInputBatchEvents) {
+        flush();
+    } else if (!m_flushTimer.isActive()) {
+        // Armed by the first pending event only, so an idle pointer costs no wakeups.
+        m_flushTimer.start(m_flushIntervalMs);
+    }
+}
+
+void InputScheduler::shedOldest()
+{
+    // A move is superseded by any later one, but the newest position must
+    // survive. Wheel steps are relative, so they are never dropped, and only
+    // neighbours are summed: folding across a move would turn the wheel at a
+    // different pointer position.
+    const auto isMove = [](const Protocol::InputEvent &event) {
+        return event.type == Protocol::InputEventType::MouseMove;
+    };
+    const auto bothWheel = [](const Protocol::InputEvent &a, const Protocol::InputEvent &b) {
+        return a.type == Protocol::InputEventType::MouseWheel && b.type == Protocol::InputEventType::MouseWheel;
+    };
+
+    auto merge = m_pending.end();
+    if (std::count_if(m_pending.begin(), m_pending.end(), isMove) >= 2) {
+        const auto at = m_pending.erase(std::find_if(m_pending.begin(), m_pending.end(), isMove));
+        ++m_stats.eventsDropped;
+        // The wheel steps either side of the dropped move are neighbours now.
+        if (at != m_pending.begin() && at != m_pending.end() && bothWheel(*std::prev(at), *at)) {
+            merge = std::prev(at);
+        }
+    } else {
+        merge = std::adjacent_find(m_pending.begin(), m_pending.end(), bothWheel);
+    }
+
+    if (merge != m_pending.end()) {
+        merge->deltaY += std::next(merge)->deltaY;
+        m_pending.erase(std::next(merge));
+        ++m_stats.eventsCoalesced;
+    }
+}
+
+void InputScheduler::flush()
+{
+    m_flushTimer.stop();
+    if (m_pending.empty()) {
+        return;
+    }
+
+    if (m_sink) {
+        m_stats.messagesOut += m_sink(m_pending.data(), m_pending.size());
+    }
+    ++m_stats.flushes;
+    m_pending.clear();
+}
+
+void InputScheduler::clear()
+{
+    m_flushTimer.stop();
+    m_pending.clear();
+    m_throttled = false;
+}
+
+void InputScheduler::setThrottled(bool throttled)
+{
+    if (throttled == m_throttled) {
+        return;
+    }
+    m_throttled = throttled;
+    if (throttled) {
+        ++m_stats.throttledPeriods;
+        m_flushTimer.stop();
+    } else {
+        flush();
+    }
+}
+
+bool InputScheduler::isThrottled() const
+{
+    return m_throttled;
+}
+
+std::size_t InputScheduler::pendingEvents() const
+{
+    return m_pending.size();
+}
+
+} // namespace controller
@@ -0,0 +1,174 @@
+#include "controller/LatencyMonitor.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace controller {
+
+namespace {
+// Probes older than this are not matched any more; the host restarted or the
+// echo is a duplicate from a previous run.
+constexpr std::int64_t kMaxProbeAgeUs = 10 * 1000 * 1000;
+} // namespace
+
+LatencyMonitor::LatencyMonitor(std::size_t maxSamples)
+    : m_maxSamples(std::max<std::size_t>(maxSamples, 1))
+{
+}
+
+void LatencyMonitor::setEnabled(bool enabled)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_enabled = enabled;
+}
+
+bool LatencyMonitor::isEnabled() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_enabled;
+}
+
+void LatencyMonitor::reset()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_samples.clear();
+    m_probesSent = 0;
+    m_probesAnswered = 0;
+    m_framesStamped = 0;
+    m_offsetCount = 0;
+    m_offsetNext = 0;
+    m_clockOffsetUs.reset();
+    m_captured.fill(CapturedFrame());
+}
+
+Protocol::LatencyProbe LatencyMonitor::nextProbe(std::int64_t nowUs)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Protocol::LatencyProbe probe;
+    probe.id = m_nextProbeId++;
+    probe.sentUs = static_cast<std::uint64_t>(nowUs);
+    ++m_probesSent;
+    return probe;
+}
+
+std::optional<std::int64_t> LatencyMonitor::onProbeEcho(const Protocol::LatencyProbe &echo, std::int64_t nowUs)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const auto sentUs = static_cast<std::int64_t>(echo.sentUs);
+    const std::int64_t rttUs = nowUs - sentUs;
+    if (echo.id == 0 || echo.id >= m_nextProbeId || rttUs < 0 || rttUs > kMaxProbeAgeUs) {
+        return std::nullopt;
+    }
+    ++m_probesAnswered;
+    addSample(SampleKind::InputRtt, nowUs, rttUs);
+
+    // Assume the host stamped the echo halfway through the round trip; the
+    // fastest recent round trip has the least room for asymmetry.
+    OffsetSample sample;
+    sample.rttUs = rttUs;
+    sample.offsetUs = static_cast<std::int64_t>(echo.hostUs) - (sentUs + nowUs) / 2;
+    m_offsets[m_offsetNext] = sample;
+    m_offsetNext = (m_offsetNext + 1) % m_offsets.size();
+    m_offsetCount = std::min(m_offsetCount + 1, m_offsets.size());
+    const auto best = std::min_element(m_offsets.begin(), m_offsets.begin() + static_cast<std::ptrdiff_t>(m_offsetCount),
+                                       [](const OffsetSample &a, const OffsetSample &b) { return a.rttUs < b.rttUs; });
+    m_clockOffsetUs = best->offsetUs;
+    return rttUs;
+}
+
+void LatencyMonitor::onFrameCaptured(std::uint32_t rtpTimestamp, std::int64_t hostCaptureUs)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    CapturedFrame &slot = m_captured[m_capturedNext];
+    slot.valid = true;
+    slot.rtpTimestamp = rtpTimestamp;
+    slot.hostCaptureUs = hostCaptureUs;
+    m_capturedNext = (m_capturedNext + 1) % m_captured.size();
+    ++m_framesStamped;
+}
+
+std::optional<std::int64_t> LatencyMonitor::onFramePresented(std::uint32_t rtpTimestamp, std::int64_t nowUs)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_clockOffsetUs) {
+        return std::nullopt;
+    }
+    for (CapturedFrame &slot : m_captured) {
+        if (slot.valid && slot.rtpTimestamp == rtpTimestamp) {
+            slot.valid = false;
+            const std::int64_t latencyUs = nowUs - (slot.hostCaptureUs - *m_clockOffsetUs);
+            addSample(SampleKind::GlassToGlass, nowUs, latencyUs);
+            return latencyUs;
+        }
+    }
+    return std::nullopt;
+}
+
+void LatencyMonitor::addSample(SampleKind kind, std::int64_t timeUs, std::int64_t latencyUs)
+{
+    if (!m_enabled || m_samples.size() >= m_maxSamples) {
+        return;
+    }
+    Sample sample;
+    sample.kind = kind;
+    sample.timeUs = timeUs;
+    sample.latencyUs = latencyUs;
+    m_samples.push_back(sample);
+}
+
+HistogramSummary LatencyMonitor::summarize(SampleKind kind) const
+{
+    std::vector<std::int64_t> values;
+    for (const Sample &sample : m_samples) {
+        if (sample.kind == kind) {
+            values.push_back(sample.latencyUs);
+        }
+    }
+
+    HistogramSummary summary;
+    summary.count = values.size();
+    if (values.empty()) {
+        return summary;
+    }
+    std::sort(values.begin(), values.end());
+    double sum = 0.0;
+    for (const std::int64_t value : values) {
+        sum += static_cast<double>(value);
+    }
+    const auto percentile = [&values](double fraction) {
+        const auto rank = static_cast<std::size_t>(std::ceil(fraction * static_cast<double>(values.size())));
+        return values[std::min(std::max<std::size_t>(rank, 1), values.size()) - 1] / 1000.0;
+    };
+    summary.meanMs = sum / static_cast<double>(values.size()) / 1000.0;
+    summary.p50Ms = percentile(0.50);
+    summary.p95Ms = percentile(0.95);
+    summary.p99Ms = percentile(0.99);
+    summary.maxMs = values.back() / 1000.0;
+    return summary;
+}
+
+LatencyReport LatencyMonitor::report() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    LatencyReport report;
+    report.inputRtt = summarize(SampleKind::InputRtt);
+    report.glassToGlass = summarize(SampleKind::GlassToGlass);
+    report.probesSent = m_probesSent;
+    report.probesAnswered = m_probesAnswered;
+    report.framesStamped = m_framesStamped;
+    report.clockSynchronized = m_clockOffsetUs.has_value();
+    report.clockOffsetMs = m_clockOffsetUs.value_or(0) / 1000.0;
+    return report;
+}
+
+void LatencyMonitor::writeCsv(std::ostream &out) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    out << "kind,time_us,latency_us\n";
+    for (const Sample &sample : m_samples) {
+        out << (sample.kind == SampleKind::InputRtt ? "input_rtt" : "glass_to_glass") << ',' << sample.timeUs << ','
+            << sample.latencyUs << '\n';
+    }
+}
+
+} // namespace controller
@@ -0,0 +1,88 @@
+#include "controller/Metrics.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace controller {
+
+namespace {
+constexpr std::size_t kLinearBuckets = 8;
+constexpr std::size_t kSubBuckets = 4;
+constexpr unsigned kFirstLogExponent = 3; // 8 us, the first value past the linear range
+} // namespace
+
+std::size_t LatencyHistogram::bucketFor(std::uint64_t us) noexcept
+{
+    if (us < kLinearBuckets) {
+        return static_cast<std::size_t>(us);
+    }
+    unsigned exponent = kFirstLogExponent;
+    while (exponent < 63 && (us >> (exponent + 1)) != 0) {
+        ++exponent;
+    }
+    const auto sub = static_cast<std::size_t>((us >> (exponent - 2)) & (kSubBuckets - 1));
+    const std::size_t index = kLinearBuckets + (exponent - kFirstLogExponent) * kSubBuckets + sub;
+    return std::min(index, kBucketCount - 1);
+}
+
+double LatencyHistogram::bucketMidpointUs(std::size_t index) noexcept
+{
+    if (index < kLinearBuckets) {
+        return static_cast<double>(index);
+    }
+    const std::size_t exponent = (index - kLinearBuckets) / kSubBuckets + kFirstLogExponent;
+    const std::size_t sub = (index - kLinearBuckets) % kSubBuckets;
+    const double width = std::ldexp(1.0, static_cast<int>(exponent) - 2);
+    return (kSubBuckets + sub) * width + width / 2.0;
+}
+
+void LatencyHistogram::record(std::int64_t us) noexcept
+{
+    const auto value = static_cast<std::uint64_t>(std::max<std::int64_t>(us, 0));
+    m_buckets[bucketFor(value)].fetch_add(1, std::memory_order_relaxed);
+    m_sumUs.fetch_add(value, std::memory_order_relaxed);
+    std::uint64_t max = m_maxUs.load(std::memory_order_relaxed);
+    while (value > max && !m_maxUs.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+    }
+}
+
+HistogramSummary LatencyHistogram::take() noexcept
+{
+    // A sample recorded while this runs lands in this summary or the next;
+    // either is fine for a once-per-second readout.
+    std::array<std::uint64_t, kBucketCount> counts{};
+    std::uint64_t total = 0;
+    for (std::size_t i = 0; i < kBucketCount; ++i) {
+        counts[i] = m_buckets[i].exchange(0, std::memory_order_relaxed);
+        total += counts[i];
+    }
+    const std::uint64_t sum = m_sumUs.exchange(0, std::memory_order_relaxed);
+    const std::uint64_t max = m_maxUs.exchange(0, std::memory_order_relaxed);
+
+    HistogramSummary summary;
+    summary.count = total;
+    if (total == 0) {
+        return summary;
+    }
+    summary.meanMs = static_cast<double>(sum) / static_cast<double>(total) / 1000.0;
+    summary.maxMs = static_cast<double>(max) / 1000.0;
+
+    const auto percentile = [&](double fraction) {
+        const auto rank = static_cast<std::uint64_t>(std::ceil(fraction * static_cast<double>(total)));
+        std::uint64_t seen = 0;
+        for (std::size_t i = 0; i < kBucketCount; ++i) {
+            seen += counts[i];
+            if (seen >= rank) {
+                // The bucket midpoint can overshoot the largest sample.
+                return std::min(bucketMidpointUs(i), static_cast<double>(max)) / 1000.0;
+            }
+        }
+        return summary.maxMs;
+    };
+    summary.p50Ms = percentile(0.50);
+    summary.p95Ms = percentile(0.95);
+    summary.p99Ms = percentile(0.99);
+    return summary;
+}
+
+} // namespace controller
@@ -0,0 +1,176 @@
+#include "controller/MetricsCollector.h"
+
+#include "controller/SignalingClient.h"
+#include "controller/WebRtcPeer.h"
+
+#include <QDateTime>
+#include <QStringList>
+
+namespace controller {
+
+namespace {
+// Totals restart with a new peer connection; count from zero then.
+std::uint64_t delta(std::uint64_t current, std::uint64_t previous)
+{
+    return current >= previous ? current - previous : current;
+}
+
+double percent(std::uint64_t part, std::uint64_t whole)
+{
+    return whole == 0 ? 0.0 : 100.0 * static_cast<double>(part) / static_cast<double>(whole);
+}
+} // namespace
+
+MetricsCollector::MetricsCollector(QObject *parent)
+    : QObject(parent)
+    , m_registry(std::make_shared<MetricsRegistry>())
+{
+    m_timer.setInterval(kDefaultIntervalMs);
+    connect(&m_timer, &QTimer::timeout, this, &MetricsCollector::collect);
+}
+
+void MetricsCollector::setPeer(WebRtcPeer *peer)
+{
+    if (m_peer == peer) {
+        return;
+    }
+    if (m_peer) {
+        m_peer->setMetrics(nullptr);
+    }
+    m_peer = peer;
+    if (peer) {
+        peer->setMetrics(m_registry);
+    }
+    m_previous = readTotals();
+}
+
+void MetricsCollector::setSignalingClient(SignalingClient *client)
+{
+    if (m_signaling == client) {
+        return;
+    }
+    QObject::disconnect(m_signalingConnection);
+    m_signaling = client;
+    if (!client) {
+        return;
+    }
+    const std::weak_ptr<MetricsRegistry> registry = m_registry;
+    m_signalingConnection = connect(client, &SignalingClient::replyLatency, this, [registry](qint64 latencyUs) {
+        if (const auto metrics = registry.lock()) {
+            metrics->record(MetricTimer::Signaling, latencyUs);
+        }
+    });
+}
+
+void MetricsCollector::start(int intervalMs)
+{
+    m_timer.setInterval(intervalMs > 0 ? intervalMs : kDefaultIntervalMs);
+    m_previous = readTotals();
+    m_interval.start();
+    m_timer.start();
+}
+
+void MetricsCollector::stop()
+{
+    m_timer.stop();
+}
+
+MetricsCollector::Totals MetricsCollector::readTotals() const
+{
+    Totals totals;
+    totals.framesDecoded = m_registry->counter(MetricCounter::FramesDecoded);
+    totals.framesRendered = m_registry->counter(MetricCounter::FramesRendered);
+    totals.framesDropped = m_registry->counter(MetricCounter::FramesReplaced);
+    totals.decodeErrors = m_registry->counter(MetricCounter::DecodeErrors);
+    if (!m_peer) {
+        return totals;
+    }
+
+    const JitterBufferStats jitter = m_peer->videoJitterStats();
+    const RtcpFeedbackStats feedback = m_peer->videoFeedbackStats();
+    totals.videoPackets = jitter.packetsInserted + feedback.packetsAbandoned;
+    totals.videoPacketsLost = feedback.packetsAbandoned;
+    totals.framesDropped += jitter.framesLost + m_peer->avSyncStats().framesDropped + m_peer->framesOverwritten();
+
+    const AudioJitterStats audio = m_peer->audioStats().jitter;
+    totals.audioFrames = audio.framesPlayed + audio.framesLost;
+    totals.audioFramesLost = audio.framesLost;
+    return totals;
+}
+
+void MetricsCollector::collect()
+{
+    const double seconds = m_interval.isValid() ? m_interval.restart() / 1000.0 : 0.0;
+    const Totals totals = readTotals();
+
+    MetricsSnapshot snapshot;
+    snapshot.timestampMs = QDateTime::currentMSecsSinceEpoch();
+    snapshot.intervalSeconds = seconds;
+
+    if (m_peer) {
+        snapshot.rttMs = m_peer->roundTripTimeMs();
+        snapshot.videoJitterMs = m_peer->videoJitterStats().jitterMs;
+        snapshot.audioJitterMs = m_peer->audioStats().jitter.jitterMs;
+        const BandwidthEstimatorStats bandwidth = m_peer->videoBandwidthStats();
+        snapshot.incomingBps = bandwidth.incomingBps;
+        snapshot.estimateBps = bandwidth.estimateBps;
+        const InputQueueStats input = m_peer->inputQueueStats();
+        snapshot.inputQueueDepth = input.pendingEvents;
+        snapshot.inputBufferedBytes = input.bufferedBytes + input.motionBufferedBytes;
+    }
+
+    snapshot.videoLossPercent = percent(delta(totals.videoPacketsLost, m_previous.videoPacketsLost),
+                                        delta(totals.videoPackets, m_previous.videoPackets));
+    snapshot.audioLossPercent = percent(delta(totals.audioFramesLost, m_previous.audioFramesLost),
+                                        delta(totals.audioFrames, m_previous.audioFrames));
+    if (seconds > 0.0) {
+        snapshot.decodedFps = delta(totals.framesDecoded, m_previous.framesDecoded) / seconds;
+        snapshot.renderedFps = delta(totals.framesRendered, m_previous.framesRendered) / seconds;
+    }
+    snapshot.framesDropped = delta(totals.framesDropped, m_previous.framesDropped);
+    snapshot.decodeErrors = delta(totals.decodeErrors, m_previous.decodeErrors);
+    m_previous = totals;
+
+    snapshot.decode = m_registry->take(MetricTimer::Decode);
+    snapshot.convert = m_registry->take(MetricTimer::Convert);
+    snapshot.render = m_registry->take(MetricTimer::Render);
+    snapshot.signaling = m_registry->take(MetricTimer::Signaling);
+    snapshot.inputRtt = m_registry->take(MetricTimer::InputRtt);
+    snapshot.glassToGlass = m_registry->take(MetricTimer::GlassToGlass);
+
+    m_snapshot = snapshot;
+    emit snapshotReady(m_snapshot);
+    emit summaryChanged(formatSummary(m_snapshot));
+}
+
+QString MetricsCollector::formatSummary(const MetricsSnapshot &snapshot)
+{
+    const auto ms = [](double value) { return QString::number(value, 'f', 1); };
+
+    QStringList parts;
+    parts << QStringLiteral("RTT %1 ms").arg(ms(snapshot.rttMs))
+          << QStringLiteral("loss %1%").arg(ms(snapshot.videoLossPercent))
+          << QStringLiteral("jitter %1 ms").arg(ms(snapshot.videoJitterMs))
+          << QStringLiteral("%1 Mbps (est %2)")
+                 .arg(QString::number(snapshot.incomingBps / 1e6, 'f', 2),
+                      QString::number(snapshot.estimateBps / 1e6, 'f', 2))
+          << QStringLiteral("%1 fps, %2 dropped")
+                 .arg(QString::number(snapshot.renderedFps, 'f', 0), QString::number(snapshot.framesDropped))
+          << QStringLiteral("decode %1/%2 ms").arg(ms(snapshot.decode.p50Ms), ms(snapshot.decode.p95Ms))
+          << QStringLiteral("convert %1 ms").arg(ms(snapshot.convert.p50Ms))
+          << QStringLiteral("render %1 ms").arg(ms(snapshot.render.p50Ms))
+          << QStringLiteral("input queue %1").arg(snapshot.inputQueueDepth);
+    if (snapshot.signaling.count > 0) {
+        parts << QStringLiteral("signalling %1 ms").arg(ms(snapshot.signaling.p50Ms));
+    }
+    if (snapshot.inputRtt.count > 0) {
+        parts << QStringLiteral("input RTT %1 ms").arg(ms(snapshot.inputRtt.p50Ms));
+    }
+    if (snapshot.glassToGlass.count > 0) {
+        parts << QStringLiteral("glass-to-glass %1/%2 ms")
+                     .arg(ms(snapshot.glassToGlass.p50Ms), ms(snapshot.glassToGlass.p95Ms));
+    }
+    return parts.join(QStringLiteral(" | "));
+}
+
+} // namespace controller
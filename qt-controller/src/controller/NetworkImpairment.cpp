@@ -0,0 +1,310 @@
+#include "controller/NetworkImpairment.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+
+namespace controller {
+
+namespace {
+// A message lost on a reliable path shows up one round trip later, plus
+// the time it takes the sender to notice, as a retransmission would.
+constexpr std::int64_t kRetransmitTimerUs = 50000;
+constexpr double kMaxLossFraction = 0.99;
+
+std::int64_t steadyNowUs()
+{
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+std::string trim(const std::string &text)
+{
+    const auto begin = text.find_first_not_of(" \t\r");
+    if (begin == std::string::npos) {
+        return std::string();
+    }
+    const auto end = text.find_last_not_of(" \t\r");
+    return text.substr(begin, end - begin + 1);
+}
+
+bool parseNumber(const std::string &text, double &value)
+{
+    std::istringstream in(text);
+    in >> value;
+    return in && in.peek() == std::char_traits<char>::eof() && value >= 0.0;
+}
+
+// Sets `key` in `config`; false for an unknown key.
+bool setConfigValue(ImpairmentConfig &config, const std::string &key, double value)
+{
+    if (key == "loss_percent") {
+        config.lossPercent = value;
+    } else if (key == "burst_length") {
+        config.burstLength = value;
+    } else if (key == "delay_ms") {
+        config.delayMs = static_cast<int>(value);
+    } else if (key == "jitter_ms") {
+        config.jitterMs = static_cast<int>(value);
+    } else if (key == "reorder_percent") {
+        config.reorderPercent = value;
+    } else if (key == "reorder_delay_ms") {
+        config.reorderDelayMs = static_cast<int>(value);
+    } else if (key == "duplicate_percent") {
+        config.duplicatePercent = value;
+    } else if (key == "bandwidth_kbps") {
+        config.bandwidthKbps = static_cast<int>(value);
+    } else if (key == "queue_ms") {
+        config.queueMs = static_cast<int>(value);
+    } else {
+        return false;
+    }
+    return true;
+}
+} // namespace
+
+bool parseImpairmentProfile(std::istream &in, ImpairmentProfile &profile, std::string *error)
+{
+    const auto fail = [error](int line, const std::string &message) {
+        if (error) {
+            *error = "line " + std::to_string(line) + ": " + message;
+        }
+        return false;
+    };
+
+    ImpairmentProfile parsed;
+    ImpairmentConfig *section = nullptr;
+    std::string text;
+    for (int line = 1; std::getline(in, text); ++line) {
+        text = trim(text.substr(0, text.find('#')));
+        if (text.empty()) {
+            continue;
+        }
+        if (text.front() == '[') {
+            if (text == "[media]") {
+                section = &parsed.media;
+            } else if (text == "[input]") {
+                section = &parsed.input;
+            } else {
+                return fail(line, "unknown section " + text);
+            }
+            continue;
+        }
+
+        const auto equals = text.find('=');
+        if (equals == std::string::npos) {
+            return fail(line, "expected key = value");
+        }
+        const std::string key = trim(text.substr(0, equals));
+        double value = 0.0;
+        if (!parseNumber(trim(text.substr(equals + 1)), value)) {
+            return fail(line, "invalid value for " + key);
+        }
+        if (!section && key == "seed") {
+            parsed.seed = static_cast<std::uint64_t>(value);
+        } else if (!section || !setConfigValue(*section, key, value)) {
+            return fail(line, "unknown key " + key);
+        }
+    }
+
+    profile = parsed;
+    return true;
+}
+
+bool loadImpairmentProfile(const std::string &path, ImpairmentProfile &profile, std::string *error)
+{
+    std::ifstream file(path);
+    if (!file) {
+        if (error) {
+            *error = "cannot open " + path;
+        }
+        return false;
+    }
+    return parseImpairmentProfile(file, profile, error);
+}
+
+NetworkImpairment::NetworkImpairment(const ImpairmentConfig &config, std::uint64_t seed, bool reliable)
+    : m_config(config)
+    , m_reliable(reliable)
+    , m_random(seed)
+{
+    // Two-state Markov chain whose stationary loss is lossPercent and whose
+    // lossy state lasts burstLength packets on average.
+    const double loss = std::clamp(config.lossPercent / 100.0, 0.0, kMaxLossFraction);
+    m_leaveBurst = 1.0 / std::max(config.burstLength, 1.0);
+    m_enterBurst = std::min(loss * m_leaveBurst / (1.0 - loss), 1.0);
+}
+
+bool NetworkImpairment::nextLoss()
+{
+    const double draw = uniform();
+    m_inBurst = m_inBurst ? draw >= m_leaveBurst : draw < m_enterBurst;
+    return m_inBurst;
+}
+
+NetworkImpairment::Decision NetworkImpairment::onPacket(std::size_t bytes, std::int64_t nowUs)
+{
+    ++m_stats.packets;
+    // Always the same draws per packet, whatever happens to it, so the fate
+    // of packet n depends only on the seed.
+    const bool lost = nextLoss();
+    const auto jitterUs = static_cast<std::int64_t>(uniform() * m_config.jitterMs * 1000.0);
+    const bool reorder = !m_reliable && uniform() * 100.0 < m_config.reorderPercent;
+    const bool duplicate = !m_reliable && uniform() * 100.0 < m_config.duplicatePercent;
+
+    Decision decision;
+    std::int64_t departUs = nowUs;
+    if (m_config.bandwidthKbps > 0) {
+        const std::int64_t startUs = std::max(nowUs, m_linkFreeUs);
+        if (!m_reliable && startUs - nowUs > static_cast<std::int64_t>(m_config.queueMs) * 1000) {
+            ++m_stats.queueDropped;
+            return decision;
+        }
+        m_linkFreeUs = startUs + static_cast<std::int64_t>(bytes) * 8 * 1000 / m_config.bandwidthKbps;
+        departUs = m_linkFreeUs;
+    }
+
+    const std::int64_t delayUs = static_cast<std::int64_t>(m_config.delayMs) * 1000;
+    if (lost) {
+        ++m_stats.lost;
+        if (!m_reliable) {
+            return decision;
+        }
+        departUs += 2 * delayUs + kRetransmitTimerUs;
+    }
+
+    std::int64_t releaseUs = departUs + delayUs + jitterUs;
+    if (reorder) {
+        releaseUs += static_cast<std::int64_t>(m_config.reorderDelayMs) * 1000;
+        ++m_stats.reordered;
+    } else {
+        // Jitter alone does not reorder, as on a single path.
+        releaseUs = std::max(releaseUs, m_lastReleaseUs);
+        m_lastReleaseUs = releaseUs;
+    }
+
+    decision.copies = 1;
+    decision.releaseUs[0] = releaseUs;
+    if (duplicate) {
+        decision.copies = 2;
+        decision.releaseUs[1] = releaseUs;
+        ++m_stats.duplicated;
+    }
+    return decision;
+}
+
+ImpairedLink::ImpairedLink(const ImpairmentConfig &config, std::uint64_t seed, bool reliable,
+                           std::size_t maxQueuedBytes)
+    : m_impairment(config, seed, reliable)
+    , m_maxQueuedBytes(maxQueuedBytes)
+{
+}
+
+ImpairedLink::~ImpairedLink()
+{
+    stop();
+}
+
+void ImpairedLink::start()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_running) {
+        return;
+    }
+    m_running = true;
+    m_thread = std::thread([this]() { run(); });
+}
+
+void ImpairedLink::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_running) {
+            return;
+        }
+        m_running = false;
+        m_pending.clear();
+        m_queuedBytes = 0;
+    }
+    m_cv.notify_all();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+bool ImpairedLink::push(std::size_t bytes, Action deliver)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_running) {
+            return false;
+        }
+        if (m_queuedBytes + bytes > m_maxQueuedBytes) {
+            // Not offered to the impairment: the packet never left, so it
+            // must not use up a packet's worth of random draws.
+            ++m_stats.queueDropped;
+            return false;
+        }
+        const NetworkImpairment::Decision decision = m_impairment.onPacket(bytes, steadyNowUs());
+        for (int i = 0; i < decision.copies; ++i) {
+            m_pending.emplace(std::make_pair(decision.releaseUs[i], m_sequence++), Pending{bytes, deliver});
+            m_queuedBytes += bytes;
+        }
+    }
+    m_cv.notify_one();
+    return true;
+}
+
+std::size_t ImpairedLink::queuedBytes() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_queuedBytes;
+}
+
+void ImpairedLink::onQueuedBytesLow(std::size_t threshold, Action callback)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_lowThreshold = threshold;
+    m_onLow = std::move(callback);
+}
+
+ImpairmentStats ImpairedLink::stats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ImpairmentStats stats = m_impairment.stats();
+    stats.queueDropped += m_stats.queueDropped;
+    stats.inFlight = m_pending.size();
+    stats.queuedBytes = m_queuedBytes;
+    return stats;
+}
+
+void ImpairedLink::run()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (m_running) {
+        if (m_pending.empty()) {
+            m_cv.wait(lock);
+            continue;
+        }
+        const auto next = m_pending.begin();
+        const std::int64_t waitUs = next->first.first - steadyNowUs();
+        if (waitUs > 0) {
+            m_cv.wait_for(lock, std::chrono::microseconds(waitUs));
+            continue;
+        }
+        Action deliver = std::move(next->second.deliver);
+        const std::size_t before = m_queuedBytes;
+        m_queuedBytes -= next->second.bytes;
+        m_pending.erase(next);
+        const bool low = m_onLow && before > m_lowThreshold && m_queuedBytes <= m_lowThreshold;
+        lock.unlock();
+        deliver();
+        if (low) {
+            m_onLow();
+        }
+        lock.lock();
+    }
+}
+
+} // namespace controller
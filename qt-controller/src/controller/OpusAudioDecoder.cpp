@@ -0,0 +1,65 @@
+#include "controller/OpusAudioDecoder.h"
+
+#include <algorithm>
+
+#include <opus/opus.h>
+
+namespace controller {
+
+OpusAudioDecoder::OpusAudioDecoder()
+{
+    int error = OPUS_OK;
+    m_decoder = opus_decoder_create(kSampleRate, kChannels, &error);
+    if (error != OPUS_OK) {
+        m_decoder = nullptr;
+    }
+}
+
+OpusAudioDecoder::~OpusAudioDecoder()
+{
+    if (m_decoder) {
+        opus_decoder_destroy(m_decoder);
+    }
+}
+
+int OpusAudioDecoder::decode(const std::uint8_t *data, std::size_t size, std::int16_t *pcm)
+{
+    if (!m_decoder || !data || size == 0) {
+        return -1;
+    }
+    const int samples = opus_decode(m_decoder, data, static_cast<opus_int32>(size), pcm, kMaxFrameSamples, 0);
+    if (samples > 0) {
+        m_lastFrameSamples = samples;
+    }
+    return samples < 0 ? -1 : samples;
+}
+
+int OpusAudioDecoder::decodeFec(const std::uint8_t *nextData, std::size_t nextSize, int frameSamples, std::int16_t *pcm)
+{
+    if (!m_decoder || !nextData || nextSize == 0) {
+        return -1;
+    }
+    // With decode_fec set, frame_size must be exactly the duration of the lost frame.
+    frameSamples = std::clamp(frameSamples, 1, kMaxFrameSamples);
+    const int samples = opus_decode(m_decoder, nextData, static_cast<opus_int32>(nextSize), pcm, frameSamples, 1);
+    return samples < 0 ? -1 : samples;
+}
+
+int OpusAudioDecoder::conceal(int frameSamples, std::int16_t *pcm)
+{
+    if (!m_decoder) {
+        return -1;
+    }
+    frameSamples = std::clamp(frameSamples, 1, kMaxFrameSamples);
+    const int samples = opus_decode(m_decoder, nullptr, 0, pcm, frameSamples, 0);
+    return samples < 0 ? -1 : samples;
+}
+
+void OpusAudioDecoder::reset()
+{
+    if (m_decoder) {
+        opus_decoder_ctl(m_decoder, OPUS_RESET_STATE);
+    }
+}
+
+} // namespace controller
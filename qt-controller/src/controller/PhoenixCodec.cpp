@@ -0,0 +1,378 @@
+#include "controller/PhoenixCodec.h"
+
+#include <cstdint>
+
+namespace controller {
+
+namespace {
+// Guards against stack exhaustion on hostile input; Phoenix frames nest 3 or 4 deep.
+constexpr int kMaxDepth = 64;
+
+void skipWhitespace(std::string_view text, std::size_t &pos)
+{
+    while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\n' || text[pos] == '\r')) {
+        ++pos;
+    }
+}
+
+// Moves `pos` past the string token starting at it (on the opening quote).
+bool skipString(std::string_view text, std::size_t &pos)
+{
+    for (++pos; pos < text.size(); ++pos) {
+        if (text[pos] == '\\') {
+            ++pos;
+        } else if (text[pos] == '"') {
+            ++pos;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Moves `pos` past one JSON value. Containers are skipped by bracket
+// matching; scalars are not validated beyond finding where they end.
+bool skipValue(std::string_view text, std::size_t &pos, int depth = 0)
+{
+    skipWhitespace(text, pos);
+    if (pos >= text.size()) {
+        return false;
+    }
+    const char first = text[pos];
+    if (first == '"') {
+        return skipString(text, pos);
+    }
+    if (first == '{' || first == '[') {
+        if (depth >= kMaxDepth) {
+            return false;
+        }
+        const char close = first == '{' ? '}' : ']';
+        ++pos;
+        skipWhitespace(text, pos);
+        if (pos < text.size() && text[pos] == close) {
+            ++pos;
+            return true;
+        }
+        while (pos < text.size()) {
+            if (first == '{') {
+                skipWhitespace(text, pos);
+                if (pos >= text.size() || text[pos] != '"' || !skipString(text, pos)) {
+                    return false;
+                }
+                skipWhitespace(text, pos);
+                if (pos >= text.size() || text[pos] != ':') {
+                    return false;
+                }
+                ++pos;
+            }
+            if (!skipValue(text, pos, depth + 1)) {
+                return false;
+            }
+            skipWhitespace(text, pos);
+            if (pos >= text.size()) {
+                return false;
+            }
+            if (text[pos] == close) {
+                ++pos;
+                return true;
+            }
+            if (text[pos] != ',') {
+                return false;
+            }
+            ++pos;
+        }
+        return false;
+    }
+
+    const std::size_t begin = pos;
+    while (pos < text.size() && text[pos] != ',' && text[pos] != '}' && text[pos] != ']' && text[pos] != ' '
+           && text[pos] != '\t' && text[pos] != '\n' && text[pos] != '\r') {
+        ++pos;
+    }
+    return pos > begin;
+}
+
+int hexDigit(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+bool readHex4(std::string_view text, std::size_t pos, std::uint32_t &value)
+{
+    if (pos + 4 > text.size()) {
+        return false;
+    }
+    value = 0;
+    for (std::size_t i = 0; i < 4; ++i) {
+        const int digit = hexDigit(text[pos + i]);
+        if (digit < 0) {
+            return false;
+        }
+        value = value << 4 | static_cast<std::uint32_t>(digit);
+    }
+    return true;
+}
+
+void appendUtf8(std::string &out, std::uint32_t codePoint)
+{
+    if (codePoint < 0x80) {
+        out.push_back(static_cast<char>(codePoint));
+    } else if (codePoint < 0x800) {
+        out.push_back(static_cast<char>(0xC0 | codePoint >> 6));
+        out.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+    } else if (codePoint < 0x10000) {
+        out.push_back(static_cast<char>(0xE0 | codePoint >> 12));
+        out.push_back(static_cast<char>(0x80 | (codePoint >> 6 & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+    } else {
+        out.push_back(static_cast<char>(0xF0 | codePoint >> 18));
+        out.push_back(static_cast<char>(0x80 | (codePoint >> 12 & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (codePoint >> 6 & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+    }
+}
+} // namespace
+
+JsonObjectReader::JsonObjectReader(std::string_view object)
+    : m_text(object)
+{
+    skipWhitespace(m_text, m_pos);
+    if (m_pos >= m_text.size() || m_text[m_pos] != '{') {
+        m_ok = false;
+        return;
+    }
+    ++m_pos;
+}
+
+bool JsonObjectReader::next(std::string_view &key, std::string_view &value)
+{
+    if (!m_ok || m_done) {
+        return false;
+    }
+    skipWhitespace(m_text, m_pos);
+    if (m_pos >= m_text.size()) {
+        m_ok = false;
+        return false;
+    }
+    if (m_text[m_pos] == '}') {
+        m_done = true;
+        return false;
+    }
+    if (!m_first) {
+        if (m_pos >= m_text.size() || m_text[m_pos] != ',') {
+            m_ok = false;
+            return false;
+        }
+        ++m_pos;
+        skipWhitespace(m_text, m_pos);
+    }
+    m_first = false;
+
+    const std::size_t keyBegin = m_pos;
+    if (m_pos >= m_text.size() || m_text[m_pos] != '"' || !skipString(m_text, m_pos)) {
+        m_ok = false;
+        return false;
+    }
+    key = m_text.substr(keyBegin, m_pos - keyBegin);
+    skipWhitespace(m_text, m_pos);
+    if (m_pos >= m_text.size() || m_text[m_pos] != ':') {
+        m_ok = false;
+        return false;
+    }
+    ++m_pos;
+    skipWhitespace(m_text, m_pos);
+    const std::size_t valueBegin = m_pos;
+    if (!skipValue(m_text, m_pos)) {
+        m_ok = false;
+        return false;
+    }
+    value = m_text.substr(valueBegin, m_pos - valueBegin);
+    return true;
+}
+
+bool parsePhoenixFrame(std::string_view text, PhoenixFrame &frame)
+{
+    frame = PhoenixFrame();
+    JsonObjectReader reader(text);
+    std::string_view key;
+    std::string_view value;
+    while (reader.next(key, value)) {
+        if (jsonStringEquals(key, "event")) {
+            frame.event = value;
+        } else if (jsonStringEquals(key, "topic")) {
+            frame.topic = value;
+        } else if (jsonStringEquals(key, "payload")) {
+            frame.payload = value;
+        } else if (jsonStringEquals(key, "ref")) {
+            frame.ref = value;
+        } else if (jsonStringEquals(key, "join_ref")) {
+            frame.joinRef = value;
+        }
+    }
+    return reader.ok();
+}
+
+std::string_view jsonField(std::string_view object, std::string_view key)
+{
+    JsonObjectReader reader(object);
+    std::string_view name;
+    std::string_view value;
+    while (reader.next(name, value)) {
+        if (jsonStringEquals(name, key)) {
+            return value;
+        }
+    }
+    return std::string_view();
+}
+
+bool isJsonString(std::string_view raw)
+{
+    return raw.size() >= 2 && raw.front() == '"' && raw.back() == '"';
+}
+
+bool jsonStringEquals(std::string_view raw, std::string_view text)
+{
+    if (!isJsonString(raw)) {
+        return false;
+    }
+    const std::string_view body = raw.substr(1, raw.size() - 2);
+    if (body.find('\\') == std::string_view::npos) {
+        return body == text;
+    }
+    std::string decoded;
+    return decodeJsonString(raw, decoded) && decoded == text;
+}
+
+bool decodeJsonString(std::string_view raw, std::string &out)
+{
+    out.clear();
+    if (!isJsonString(raw)) {
+        return false;
+    }
+    const std::string_view body = raw.substr(1, raw.size() - 2);
+    out.reserve(body.size());
+    for (std::size_t pos = 0; pos < body.size(); ++pos) {
+        const char c = body[pos];
+        if (c != '\\') {
+            out.push_back(c);
+            continue;
+        }
+        if (++pos >= body.size()) {
+            return false;
+        }
+        switch (body[pos]) {
+        case '"':
+        case '\\':
+        case '/':
+            out.push_back(body[pos]);
+            break;
+        case 'b':
+            out.push_back('\b');
+            break;
+        case 'f':
+            out.push_back('\f');
+            break;
+        case 'n':
+            out.push_back('\n');
+            break;
+        case 'r':
+            out.push_back('\r');
+            break;
+        case 't':
+            out.push_back('\t');
+            break;
+        case 'u': {
+            std::uint32_t codePoint = 0;
+            if (!readHex4(body, pos + 1, codePoint)) {
+                return false;
+            }
+            pos += 4;
+            if (codePoint >= 0xD800 && codePoint < 0xDC00) {
+                std::uint32_t low = 0;
+                if (pos + 2 < body.size() && body[pos + 1] == '\\' && body[pos + 2] == 'u'
+                    && readHex4(body, pos + 3, low) && low >= 0xDC00 && low < 0xE000) {
+                    codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+                    pos += 6;
+                } else {
+                    codePoint = 0xFFFD; // unpaired surrogate
+                }
+            } else if (codePoint >= 0xDC00 && codePoint < 0xE000) {
+                codePoint = 0xFFFD;
+            }
+            appendUtf8(out, codePoint);
+            break;
+        }
+        default:
+            return false;
+        }
+    }
+    return true;
+}
+
+void appendJsonString(std::string &out, std::string_view utf8)
+{
+    static constexpr char kHex[] = "0123456789abcdef";
+    out.push_back('"');
+    std::size_t runBegin = 0;
+    for (std::size_t pos = 0; pos < utf8.size(); ++pos) {
+        const auto c = static_cast<unsigned char>(utf8[pos]);
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+        // Copy the clean run in one go; SDP is long and mostly plain text.
+        out.append(utf8.data() + runBegin, pos - runBegin);
+        runBegin = pos + 1;
+        switch (c) {
+        case '"':
+            out.append("\\\"");
+            break;
+        case '\\':
+            out.append("\\\\");
+            break;
+        case '\n':
+            out.append("\\n");
+            break;
+        case '\r':
+            out.append("\\r");
+            break;
+        case '\t':
+            out.append("\\t");
+            break;
+        default: {
+            const char escape[] = {'\\', 'u', '0', '0', kHex[c >> 4], kHex[c & 0xF]};
+            out.append(escape, sizeof(escape));
+            break;
+        }
+        }
+    }
+    out.append(utf8.data() + runBegin, utf8.size() - runBegin);
+    out.push_back('"');
+}
+
+void appendPhoenixFrame(std::string &out, std::string_view topic, std::string_view event, std::string_view payloadJson,
+                        std::string_view ref)
+{
+    out.append("{\"topic\":");
+    appendJsonString(out, topic);
+    out.append(",\"event\":");
+    appendJsonString(out, event);
+    out.append(",\"payload\":");
+    out.append(payloadJson.empty() ? std::string_view("{}") : payloadJson);
+    out.append(",\"ref\":");
+    if (ref.empty()) {
+        out.append("null");
+    } else {
+        appendJsonString(out, ref);
+    }
+    out.push_back('}');
+}
+
+} // namespace controller
@@ -0,0 +1,404 @@
+#include "controller/RealtimeMultiplexer.h"
+#include "controller/PhoenixCodec.h"
+
+#include <QMetaObject>
+
+#include <algorithm>
+#include <charconv>
+
+namespace controller {
+
+namespace {
+std::string_view utf8View(const QByteArray &bytes)
+{
+    return std::string_view(bytes.constData(), static_cast<std::size_t>(bytes.size()));
+}
+
+// Our refs are plain counters; anything else cannot be one of them.
+std::uint64_t parseRef(std::string_view ref)
+{
+    std::uint64_t value = 0;
+    const auto result = std::from_chars(ref.data(), ref.data() + ref.size(), value);
+    return result.ec == std::errc() && result.ptr == ref.data() + ref.size() ? value : 0;
+}
+} // namespace
+
+RealtimeMultiplexer::RealtimeMultiplexer(QObject *parent)
+    : QObject(parent)
+{
+    setTransport(std::make_unique<RealtimeWebSocketTransport>());
+}
+
+RealtimeMultiplexer::~RealtimeMultiplexer()
+{
+    // Tearing the transport down may still emit closed().
+    if (m_transport) {
+        QObject::disconnect(m_transport.get(), nullptr, this, nullptr);
+    }
+    const std::vector<Session> sessions = std::move(m_sessions);
+    m_sessions.clear();
+    for (const Session &session : sessions) {
+        session.transport->dropped();
+    }
+}
+
+void RealtimeMultiplexer::setTransport(std::unique_ptr<SignalingTransport> transport)
+{
+    if (m_transport) {
+        QObject::disconnect(m_transport.get(), nullptr, this, nullptr);
+    }
+    m_transport = std::move(transport);
+    m_active = false;
+    m_closing = false;
+    connect(m_transport.get(), &SignalingTransport::opened, this, &RealtimeMultiplexer::onTransportOpened);
+    connect(m_transport.get(), &SignalingTransport::textReceived, this, &RealtimeMultiplexer::onTransportText);
+    connect(m_transport.get(), &SignalingTransport::closed, this, &RealtimeMultiplexer::onTransportClosed);
+}
+
+std::unique_ptr<SignalingTransport> RealtimeMultiplexer::createTransport()
+{
+    return std::make_unique<MultiplexedSignalingTransport>(this);
+}
+
+bool RealtimeMultiplexer::sharesConnection(const RealtimeCredentials &a, const QString &appTokenA,
+                                           const RealtimeCredentials &b, const QString &appTokenB)
+{
+    return a.endpoint == b.endpoint && a.apiKey == b.apiKey && appTokenA == appTokenB;
+}
+
+bool RealtimeMultiplexer::attach(MultiplexedSignalingTransport *transport, const RealtimeCredentials &credentials,
+                                 const QString &appToken)
+{
+    // While a close is in progress the old sessions are gone but the socket
+    // is not; whoever is attached now decides how it reopens.
+    if (!m_sessions.empty()
+        && !sharesConnection(m_sessions.front().credentials, m_sessions.front().appToken, credentials, appToken)) {
+        ++m_stats.refused;
+        return false;
+    }
+    m_sessions.push_back(Session{transport, credentials, appToken, {}});
+    if (!m_active) {
+        connectTransport();
+    } else if (!m_closing && m_transport->isOpen()) {
+        transport->connected();
+    }
+    // Otherwise it is connected along with the others by onTransportOpened(),
+    // or once a close in progress has finished.
+    return true;
+}
+
+void RealtimeMultiplexer::detach(MultiplexedSignalingTransport *transport, bool aborted)
+{
+    const auto it = std::find_if(m_sessions.begin(), m_sessions.end(),
+                                 [transport](const Session &session) { return session.transport == transport; });
+    if (it == m_sessions.end()) {
+        return;
+    }
+    const std::string topic = std::move(it->topic);
+    m_sessions.erase(it);
+
+    const auto isTransport = [transport](const Route &route) { return route.transport == transport; };
+    const bool waitedForHeartbeat =
+        std::any_of(m_heartbeatWaiters.begin(), m_heartbeatWaiters.end(), isTransport);
+    m_heartbeatWaiters.erase(std::remove_if(m_heartbeatWaiters.begin(), m_heartbeatWaiters.end(), isTransport),
+                             m_heartbeatWaiters.end());
+    for (auto route = m_routes.begin(); route != m_routes.end();) {
+        route = isTransport(route->second) ? m_routes.erase(route) : std::next(route);
+    }
+
+    if (aborted && waitedForHeartbeat) {
+        // Its heartbeat timed out, and that heartbeat was the shared one.
+        m_transport->abort();
+        return;
+    }
+    if (!topic.empty() && m_transport->isOpen() && !findSession(topic)) {
+        send(topic, "phx_leave", "{}", {});
+    }
+    if (m_sessions.empty() && m_active && !m_closing) {
+        m_closing = true;
+        m_transport->close();
+    }
+}
+
+void RealtimeMultiplexer::sendFrom(MultiplexedSignalingTransport *transport, std::string_view text)
+{
+    PhoenixFrame frame;
+    if (!parsePhoenixFrame(text, frame) || !decodeJsonString(frame.topic, m_topic)
+        || !decodeJsonString(frame.event, m_event)) {
+        return;
+    }
+    m_ref.clear();
+    decodeJsonString(frame.ref, m_ref); // null stays empty
+    const std::string_view payload = frame.payload.empty() ? std::string_view("{}") : frame.payload;
+
+    if (m_event == "heartbeat") {
+        m_heartbeatWaiters.push_back(Route{transport, m_ref});
+        if (m_heartbeatRef != 0) {
+            ++m_stats.heartbeatsCoalesced;
+            return;
+        }
+        m_heartbeatRef = m_refCounter;
+        send(m_topic, m_event, payload, nextRef());
+        return;
+    }
+
+    if (m_event == "phx_join") {
+        if (Session *session = findSession(transport)) {
+            session->topic = m_topic;
+        }
+    }
+    if (m_ref.empty()) {
+        send(m_topic, m_event, payload, {});
+        return;
+    }
+    m_routes.emplace(m_refCounter, Route{transport, m_ref});
+    if (m_routes.size() > kMaxPendingReplies) {
+        // Never answered; the session has long stopped waiting for it.
+        m_routes.erase(m_routes.begin());
+    }
+    send(m_topic, m_event, payload, nextRef());
+}
+
+void RealtimeMultiplexer::connectTransport()
+{
+    m_active = true;
+    m_closing = false;
+    ++m_stats.connections;
+    // Socket-level only: signed tokens go in each session's phx_join, and
+    // the socket must not carry one session's.
+    const Session &first = m_sessions.front();
+    RealtimeCredentials credentials;
+    credentials.endpoint = first.credentials.endpoint;
+    credentials.apiKey = first.credentials.apiKey;
+    m_transport->open(credentials, first.appToken);
+}
+
+void RealtimeMultiplexer::onTransportOpened()
+{
+    if (m_closing) {
+        return;
+    }
+    for (const Session &session : m_sessions) {
+        session.transport->connected();
+    }
+}
+
+void RealtimeMultiplexer::onTransportText(const QByteArray &utf8)
+{
+    ++m_stats.framesReceived;
+    const std::string_view text = utf8View(utf8);
+    PhoenixFrame frame;
+    if (!parsePhoenixFrame(text, frame) || !decodeJsonString(frame.topic, m_topic)) {
+        return;
+    }
+    m_ref.clear();
+    decodeJsonString(frame.ref, m_ref);
+
+    if (m_ref.empty()) {
+        // A push: everyone on the topic gets it as is.
+        for (const Session &session : m_sessions) {
+            if (session.topic == m_topic) {
+                session.transport->deliver(utf8);
+            }
+        }
+        return;
+    }
+
+    decodeJsonString(frame.event, m_event);
+    const std::uint64_t ref = parseRef(m_ref);
+    if (ref != 0 && ref == m_heartbeatRef) {
+        m_heartbeatRef = 0;
+        const std::vector<Route> waiters = std::move(m_heartbeatWaiters);
+        m_heartbeatWaiters.clear();
+        for (const Route &waiter : waiters) {
+            deliver(waiter.transport, m_topic, m_event, frame.payload, waiter.ref);
+        }
+        return;
+    }
+    const auto route = m_routes.find(ref);
+    if (route == m_routes.end()) {
+        ++m_stats.unrouted;
+        return;
+    }
+    deliver(route->second.transport, m_topic, m_event, frame.payload, route->second.ref);
+    m_routes.erase(route);
+}
+
+void RealtimeMultiplexer::onTransportClosed()
+{
+    m_active = false;
+    m_routes.clear();
+    m_heartbeatRef = 0;
+    m_heartbeatWaiters.clear();
+    if (m_closing) {
+        m_closing = false;
+        // Sessions that opened while it was closing.
+        if (!m_sessions.empty()) {
+            connectTransport();
+        }
+        return;
+    }
+    const std::vector<Session> sessions = std::move(m_sessions);
+    m_sessions.clear();
+    for (const Session &session : sessions) {
+        session.transport->dropped();
+    }
+}
+
+RealtimeMultiplexer::Session *RealtimeMultiplexer::findSession(MultiplexedSignalingTransport *transport)
+{
+    for (Session &session : m_sessions) {
+        if (session.transport == transport) {
+            return &session;
+        }
+    }
+    return nullptr;
+}
+
+RealtimeMultiplexer::Session *RealtimeMultiplexer::findSession(std::string_view topic)
+{
+    for (Session &session : m_sessions) {
+        if (session.topic == topic) {
+            return &session;
+        }
+    }
+    return nullptr;
+}
+
+std::string RealtimeMultiplexer::nextRef()
+{
+    return std::to_string(m_refCounter++);
+}
+
+void RealtimeMultiplexer::send(std::string_view topic, std::string_view event, std::string_view payloadJson,
+                               std::string_view ref)
+{
+    ++m_stats.framesSent;
+    m_frame.clear();
+    appendPhoenixFrame(m_frame, topic, event, payloadJson, ref);
+    m_transport->sendText(m_frame);
+}
+
+void RealtimeMultiplexer::deliver(MultiplexedSignalingTransport *transport, std::string_view topic,
+                                  std::string_view event, std::string_view payloadJson, std::string_view ref)
+{
+    m_frame.clear();
+    appendPhoenixFrame(m_frame, topic, event, payloadJson.empty() ? std::string_view("{}") : payloadJson, ref);
+    transport->deliver(QByteArray(m_frame.data(), static_cast<int>(m_frame.size())));
+}
+
+MultiplexedSignalingTransport::MultiplexedSignalingTransport(RealtimeMultiplexer *multiplexer, QObject *parent)
+    : SignalingTransport(parent)
+    , m_multiplexer(multiplexer)
+{
+}
+
+MultiplexedSignalingTransport::~MultiplexedSignalingTransport()
+{
+    if (m_attached && m_multiplexer) {
+        m_multiplexer->detach(this, false);
+    }
+}
+
+void MultiplexedSignalingTransport::open(const RealtimeCredentials &credentials, const QString &appToken)
+{
+    if (m_attached && m_multiplexer) {
+        m_multiplexer->detach(this, false);
+    }
+    ++m_generation;
+    m_attached = false;
+    m_open = false;
+    m_active = true;
+    if (!m_multiplexer) {
+        post([this] {
+            emit errorOccurred(QStringLiteral("Realtime multiplexer is gone"));
+            finish();
+        });
+        return;
+    }
+    // Before attach(): opening the shared transport may drop us right away.
+    m_attached = true;
+    if (!m_multiplexer->attach(this, credentials, appToken)) {
+        m_attached = false;
+        post([this] {
+            emit errorOccurred(QStringLiteral("Realtime session does not match the shared connection's credentials"));
+            finish();
+        });
+        return;
+    }
+}
+
+void MultiplexedSignalingTransport::close()
+{
+    if (m_attached && m_multiplexer) {
+        m_multiplexer->detach(this, false);
+    }
+    ++m_generation;
+    m_attached = false;
+    m_open = false;
+    post([this] { finish(); });
+}
+
+void MultiplexedSignalingTransport::abort()
+{
+    if (m_attached && m_multiplexer) {
+        m_attached = false;
+        m_multiplexer->detach(this, true);
+    }
+    ++m_generation;
+    m_attached = false;
+    finish();
+}
+
+void MultiplexedSignalingTransport::sendText(std::string_view utf8)
+{
+    if (m_open && m_attached && m_multiplexer) {
+        m_multiplexer->sendFrom(this, utf8);
+    }
+}
+
+void MultiplexedSignalingTransport::connected()
+{
+    post([this] {
+        m_open = true;
+        emit opened();
+    });
+}
+
+void MultiplexedSignalingTransport::deliver(const QByteArray &utf8)
+{
+    post([this, utf8] { emit textReceived(utf8); });
+}
+
+void MultiplexedSignalingTransport::dropped()
+{
+    // The multiplexer has already forgotten this session.
+    ++m_generation;
+    m_attached = false;
+    m_open = false;
+    post([this] { finish(); });
+}
+
+void MultiplexedSignalingTransport::finish()
+{
+    m_open = false;
+    if (m_active) {
+        m_active = false;
+        emit closed();
+    }
+}
+
+void MultiplexedSignalingTransport::post(std::function<void()> fn)
+{
+    const std::uint64_t generation = m_generation;
+    QMetaObject::invokeMethod(
+        this,
+        [this, generation, fn = std::move(fn)] {
+            if (m_generation == generation) {
+                fn();
+            }
+        },
+        Qt::QueuedConnection);
+}
+
+} // namespace controller
@@ -0,0 +1,137 @@
+#include "controller/Rtcp.h"
+
+#include "controller/RtpPacket.h"
+
+#include <algorithm>
+
+namespace controller {
+
+namespace {
+constexpr std::size_t kRtcpHeaderSize = 4;
+constexpr std::uint8_t kRtcpSenderReport = 200;
+constexpr std::size_t kSenderInfoSize = 24; // SSRC + NTP + RTP + counts
+constexpr std::uint8_t kRtcpTransportFeedback = 205;
+constexpr std::uint8_t kRtcpPayloadFeedback = 206;
+constexpr std::uint8_t kFmtGenericNack = 1;
+constexpr std::uint8_t kFmtPli = 1;
+constexpr std::uint8_t kFmtApplicationLayer = 15;
+constexpr std::uint32_t kRembMaxMantissa = 0x3FFFF; // 18 bits
+
+void appendBigEndian16(std::vector<std::uint8_t> &out, std::uint16_t value)
+{
+    out.push_back(static_cast<std::uint8_t>(value >> 8));
+    out.push_back(static_cast<std::uint8_t>(value));
+}
+
+void appendBigEndian32(std::vector<std::uint8_t> &out, std::uint32_t value)
+{
+    appendBigEndian16(out, static_cast<std::uint16_t>(value >> 16));
+    appendBigEndian16(out, static_cast<std::uint16_t>(value));
+}
+
+// Common feedback header; the length is patched in by finishFeedback().
+std::size_t beginFeedback(std::uint8_t fmt, std::uint8_t packetType, std::uint32_t senderSsrc, std::uint32_t mediaSsrc,
+                          std::vector<std::uint8_t> &out)
+{
+    const std::size_t start = out.size();
+    out.push_back(static_cast<std::uint8_t>(0x80 | fmt));
+    out.push_back(packetType);
+    appendBigEndian16(out, 0);
+    appendBigEndian32(out, senderSsrc);
+    appendBigEndian32(out, mediaSsrc);
+    return start;
+}
+
+void finishFeedback(std::size_t start, std::vector<std::uint8_t> &out)
+{
+    const auto words = static_cast<std::uint16_t>((out.size() - start) / 4 - 1);
+    out[start + 2] = static_cast<std::uint8_t>(words >> 8);
+    out[start + 3] = static_cast<std::uint8_t>(words);
+}
+} // namespace
+
+bool findRtcpSenderReport(const std::uint8_t *data, std::size_t size, RtcpSenderReport &out)
+{
+    std::size_t offset = 0;
+    while (data && offset + kRtcpHeaderSize <= size) {
+        const std::uint8_t *packet = data + offset;
+        if ((packet[0] >> 6) != 2) {
+            return false;
+        }
+        const std::size_t length = (static_cast<std::size_t>(readBigEndian16(packet + 2)) + 1) * 4;
+        if (offset + length > size) {
+            return false;
+        }
+
+        if (packet[1] == kRtcpSenderReport && length >= kRtcpHeaderSize + kSenderInfoSize) {
+            const std::uint8_t *info = packet + kRtcpHeaderSize;
+            out.ssrc = readBigEndian32(info);
+            out.ntpTimestamp = (static_cast<std::uint64_t>(readBigEndian32(info + 4)) << 32) | readBigEndian32(info + 8);
+            out.rtpTimestamp = readBigEndian32(info + 12);
+            out.packetCount = readBigEndian32(info + 16);
+            out.octetCount = readBigEndian32(info + 20);
+            return true;
+        }
+        offset += length;
+    }
+    return false;
+}
+
+void appendRtcpNack(std::uint32_t senderSsrc, std::uint32_t mediaSsrc, const std::uint16_t *sequences,
+                    std::size_t count, std::vector<std::uint8_t> &out)
+{
+    if (count == 0) {
+        return;
+    }
+
+    const std::size_t start = beginFeedback(kFmtGenericNack, kRtcpTransportFeedback, senderSsrc, mediaSsrc, out);
+    std::size_t i = 0;
+    while (i < count) {
+        const std::uint16_t pid = sequences[i++];
+        std::uint16_t bitmask = 0;
+        while (i < count) {
+            const auto distance = static_cast<std::uint16_t>(sequences[i] - pid);
+            if (distance == 0 || distance > 16) {
+                break;
+            }
+            bitmask |= static_cast<std::uint16_t>(1u << (distance - 1));
+            ++i;
+        }
+        appendBigEndian16(out, pid);
+        appendBigEndian16(out, bitmask);
+    }
+    finishFeedback(start, out);
+}
+
+void appendRtcpPli(std::uint32_t senderSsrc, std::uint32_t mediaSsrc, std::vector<std::uint8_t> &out)
+{
+    const std::size_t start = beginFeedback(kFmtPli, kRtcpPayloadFeedback, senderSsrc, mediaSsrc, out);
+    finishFeedback(start, out);
+}
+
+void appendRtcpRemb(std::uint32_t senderSsrc, std::uint64_t bitrateBps, const std::uint32_t *mediaSsrcs,
+                    std::size_t count, std::vector<std::uint8_t> &out)
+{
+    count = std::min<std::size_t>(count, 0xFF);
+    std::uint8_t exponent = 0;
+    while ((bitrateBps >> exponent) > kRembMaxMantissa && exponent < 63) {
+        ++exponent;
+    }
+    const auto mantissa = static_cast<std::uint32_t>(bitrateBps >> exponent);
+
+    // The media SSRC of the common header is unused; the streams follow the bitrate.
+    const std::size_t start = beginFeedback(kFmtApplicationLayer, kRtcpPayloadFeedback, senderSsrc, 0, out);
+    out.push_back('R');
+    out.push_back('E');
+    out.push_back('M');
+    out.push_back('B');
+    out.push_back(static_cast<std::uint8_t>(count));
+    out.push_back(static_cast<std::uint8_t>((exponent << 2) | (mantissa >> 16)));
+    appendBigEndian16(out, static_cast<std::uint16_t>(mantissa));
+    for (std::size_t i = 0; i < count; ++i) {
+        appendBigEndian32(out, mediaSsrcs[i]);
+    }
+    finishFeedback(start, out);
+}
+
+} // namespace controller
@@ -0,0 +1,220 @@
+#include "controller/RtcpFeedback.h"
+
+#include "controller/Rtcp.h"
+
+#include <algorithm>
+#include <random>
+#include <utility>
+
+namespace controller {
+
+namespace {
+constexpr double kRecoverySmoothing = 1.0 / 8.0;
+// Smaller drops wait for the next periodic REMB.
+constexpr double kRembDecreaseRatio = 0.97;
+
+std::uint32_t randomSsrc()
+{
+    std::random_device device;
+    std::uint32_t ssrc = 0;
+    while (ssrc == 0) {
+        ssrc = device();
+    }
+    return ssrc;
+}
+} // namespace
+
+RtcpFeedback::RtcpFeedback(const RtcpFeedbackConfig &config)
+    : m_config(config)
+    , m_localSsrc(randomSsrc())
+    , m_rttUs(static_cast<std::int64_t>(config.defaultRttMs) * 1000)
+{
+    m_missing.reserve(m_config.maxTrackedMissing);
+    m_nackScratch.reserve(m_config.maxTrackedMissing);
+    m_stats.rttMs = m_rttUs / 1000.0;
+}
+
+void RtcpFeedback::setSendFunction(SendFunction send)
+{
+    m_send = std::move(send);
+}
+
+void RtcpFeedback::setRttUs(std::int64_t rttUs)
+{
+    if (rttUs > 0) {
+        m_rttUs = rttUs;
+        m_stats.rttMs = rttUs / 1000.0;
+    }
+}
+
+void RtcpFeedback::reset()
+{
+    m_started = false;
+    m_missing.clear();
+    m_lastNackUs = -1;
+    m_lastPliUs = -1;
+    m_keyframeRequestedUs = -1;
+    m_lastRembUs = -1;
+}
+
+std::int64_t RtcpFeedback::unwrapSequence(std::uint16_t sequence)
+{
+    const auto delta = static_cast<std::int16_t>(sequence - static_cast<std::uint16_t>(m_highest));
+    return m_highest + delta;
+}
+
+void RtcpFeedback::onPacket(std::uint32_t ssrc, std::uint16_t sequence, std::int64_t nowUs)
+{
+    if (!m_started || ssrc != m_mediaSsrc) {
+        m_started = true;
+        m_mediaSsrc = ssrc;
+        m_highest = sequence;
+        m_missing.clear();
+        return;
+    }
+
+    const std::int64_t extended = unwrapSequence(sequence);
+    if (extended <= m_highest) {
+        // Reordered or retransmitted: if we were missing it, it is recovered.
+        const auto it = std::lower_bound(m_missing.begin(), m_missing.end(), extended,
+                                         [](const Missing &entry, std::int64_t value) { return entry.sequence < value; });
+        if (it != m_missing.end() && it->sequence == extended) {
+            const double recoveryMs = (nowUs - it->detectedUs) / 1000.0;
+            m_stats.lastRecoveryMs = recoveryMs;
+            m_stats.avgRecoveryMs = m_stats.packetsRecovered == 0
+                ? recoveryMs
+                : m_stats.avgRecoveryMs + (recoveryMs - m_stats.avgRecoveryMs) * kRecoverySmoothing;
+            ++m_stats.packetsRecovered;
+            m_missing.erase(it);
+        }
+        return;
+    }
+
+    const std::int64_t gap = extended - m_highest - 1;
+    m_highest = extended;
+    if (gap <= 0) {
+        return;
+    }
+    if (m_missing.size() + static_cast<std::size_t>(gap) > m_config.maxTrackedMissing) {
+        // Too much is gone to retransmit in time; start over from a keyframe.
+        m_stats.packetsAbandoned += m_missing.size() + static_cast<std::size_t>(gap);
+        m_missing.clear();
+        requestKeyframe(nowUs);
+        return;
+    }
+    for (std::int64_t missing = extended - gap; missing < extended; ++missing) {
+        Missing entry;
+        entry.sequence = missing;
+        entry.detectedUs = nowUs;
+        m_missing.push_back(entry);
+    }
+    process(nowUs);
+}
+
+std::int64_t RtcpFeedback::nextProcessUs() const
+{
+    std::int64_t next = -1;
+    for (const Missing &entry : m_missing) {
+        const std::int64_t due = entry.lastNackUs < 0 ? entry.detectedUs : entry.lastNackUs + m_rttUs;
+        if (next < 0 || due < next) {
+            next = due;
+        }
+    }
+    if (next >= 0 && m_lastNackUs >= 0) {
+        next = std::max(next, m_lastNackUs + m_config.minNackIntervalMs * 1000);
+    }
+    return next;
+}
+
+void RtcpFeedback::process(std::int64_t nowUs)
+{
+    if (m_missing.empty() || (m_lastNackUs >= 0 && nowUs - m_lastNackUs < m_config.minNackIntervalMs * 1000)) {
+        return;
+    }
+
+    const std::int64_t maxAgeUs = static_cast<std::int64_t>(m_config.nackMaxAgeMs) * 1000;
+    m_nackScratch.clear();
+    auto keep = m_missing.begin();
+    for (auto it = m_missing.begin(); it != m_missing.end(); ++it) {
+        if (it->retries >= m_config.maxNackRetries || nowUs - it->detectedUs > maxAgeUs) {
+            // The jitter buffer has given up on it by now.
+            ++m_stats.packetsAbandoned;
+            continue;
+        }
+        // A retry only makes sense once the previous request had a round trip to work.
+        if (it->lastNackUs < 0 || nowUs - it->lastNackUs >= m_rttUs) {
+            it->lastNackUs = nowUs;
+            ++it->retries;
+            m_nackScratch.push_back(static_cast<std::uint16_t>(it->sequence));
+        }
+        *keep++ = *it;
+    }
+    m_missing.erase(keep, m_missing.end());
+
+    if (m_nackScratch.empty()) {
+        return;
+    }
+    m_packet.clear();
+    appendRtcpNack(m_localSsrc, m_mediaSsrc, m_nackScratch.data(), m_nackScratch.size(), m_packet);
+    send();
+    m_lastNackUs = nowUs;
+    ++m_stats.nackPackets;
+    m_stats.nackedSequences += m_nackScratch.size();
+}
+
+void RtcpFeedback::requestKeyframe(std::int64_t nowUs)
+{
+    if (!m_started) {
+        return;
+    }
+    if (m_keyframeRequestedUs < 0) {
+        m_keyframeRequestedUs = nowUs;
+    }
+
+    const std::int64_t intervalUs = std::max<std::int64_t>(m_config.minPliIntervalMs * 1000, m_rttUs);
+    if (m_lastPliUs >= 0 && nowUs - m_lastPliUs < intervalUs) {
+        ++m_stats.pliSuppressed;
+        return;
+    }
+
+    m_packet.clear();
+    appendRtcpPli(m_localSsrc, m_mediaSsrc, m_packet);
+    send();
+    m_lastPliUs = nowUs;
+    ++m_stats.pliSent;
+}
+
+void RtcpFeedback::onKeyframe(std::int64_t nowUs)
+{
+    if (m_keyframeRequestedUs >= 0) {
+        m_stats.lastKeyframeRecoveryMs = (nowUs - m_keyframeRequestedUs) / 1000.0;
+        m_keyframeRequestedUs = -1;
+    }
+}
+
+void RtcpFeedback::onBandwidthEstimate(std::int64_t bitrateBps, std::int64_t nowUs)
+{
+    if (!m_started || bitrateBps <= 0) {
+        return;
+    }
+    const bool dropped = bitrateBps < m_stats.lastRembBps * kRembDecreaseRatio;
+    if (m_lastRembUs >= 0 && !dropped && nowUs - m_lastRembUs < m_config.rembIntervalMs * 1000) {
+        return;
+    }
+
+    m_packet.clear();
+    appendRtcpRemb(m_localSsrc, static_cast<std::uint64_t>(bitrateBps), &m_mediaSsrc, 1, m_packet);
+    send();
+    m_lastRembUs = nowUs;
+    m_stats.lastRembBps = bitrateBps;
+    ++m_stats.rembSent;
+}
+
+void RtcpFeedback::send()
+{
+    if (m_send && !m_packet.empty()) {
+        m_send(m_packet.data(), m_packet.size());
+    }
+}
+
+} // namespace controller
@@ -0,0 +1,60 @@
+#include "controller/RtpDump.h"
+
+#include "controller/RtpPacket.h"
+
+namespace controller {
+
+namespace {
+constexpr char kMagic[] = "#!rtpplay1.0 ";
+constexpr std::size_t kFileHeaderSize = 16;   // start sec/usec, source, port, padding
+constexpr std::size_t kPacketHeaderSize = 8;  // length, packet length, offset
+} // namespace
+
+bool RtpDumpReader::open(const std::string &path)
+{
+    close();
+    m_file.open(path, std::ios::binary);
+    if (!m_file) {
+        return false;
+    }
+
+    std::string line;
+    std::uint8_t header[kFileHeaderSize];
+    if (!std::getline(m_file, line) || line.compare(0, sizeof(kMagic) - 1, kMagic) != 0
+        || !m_file.read(reinterpret_cast<char *>(header), sizeof(header))) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void RtpDumpReader::close()
+{
+    if (m_file.is_open()) {
+        m_file.close();
+    }
+    m_file.clear();
+}
+
+bool RtpDumpReader::readPacket(RtpDumpPacket &packet)
+{
+    std::uint8_t header[kPacketHeaderSize];
+    if (!m_file.is_open() || !m_file.read(reinterpret_cast<char *>(header), sizeof(header))) {
+        return false;
+    }
+
+    const std::size_t length = readBigEndian16(header);
+    const std::size_t packetLength = readBigEndian16(header + 2);
+    if (length < kPacketHeaderSize) {
+        return false;
+    }
+
+    packet.offsetMs = readBigEndian32(header + 4);
+    // The packet length field is zero for RTCP records.
+    packet.rtcp = packetLength == 0;
+    packet.data.resize(length - kPacketHeaderSize);
+    return static_cast<bool>(m_file.read(reinterpret_cast<char *>(packet.data.data()),
+                                         static_cast<std::streamsize>(packet.data.size())));
+}
+
+} // namespace controller
@@ -0,0 +1,373 @@
+#include "controller/RtpJitterBuffer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace controller {
+
+namespace {
+// The transit base may creep upwards by this much per microsecond so that a
+// permanent path change (or clock drift) is absorbed within a few seconds.
+constexpr double kBaseDriftPerUs = 0.005;
+constexpr double kLatenessDecayPerFrame = 0.99;
+
+std::size_t roundUpToPowerOfTwo(std::size_t value)
+{
+    std::size_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+} // namespace
+
+RtpJitterBuffer::RtpJitterBuffer(const JitterBufferConfig &config)
+    : m_config(config)
+{
+    const std::size_t capacity = roundUpToPowerOfTwo(std::max<std::size_t>(config.capacity, 16));
+    m_config.capacity = capacity;
+    m_mask = capacity - 1;
+    m_slots.resize(capacity);
+    m_storage.resize(capacity * m_config.maxPacketSize);
+}
+
+void RtpJitterBuffer::reset()
+{
+    for (auto &slot : m_slots) {
+        slot.used = false;
+    }
+    m_started = false;
+    m_resyncPending = false;
+    m_discontinuity = true;
+    m_hasDroppedTimestamp = false;
+    m_hasTiming = false;
+    m_jitterUs = 0.0;
+    m_latenessPeakUs = 0.0;
+}
+
+void RtpJitterBuffer::resync()
+{
+    if (m_started) {
+        releaseRange(m_head, m_highest + 1, true);
+        m_head = m_highest + 1;
+        m_resyncPending = true;
+    }
+}
+
+std::int64_t RtpJitterBuffer::unwrapSequence(std::uint16_t sequence)
+{
+    const auto delta = static_cast<std::int16_t>(sequence - static_cast<std::uint16_t>(m_lastSequence));
+    const std::int64_t extended = m_lastSequence + delta;
+    m_lastSequence = std::max(m_lastSequence, extended);
+    return extended;
+}
+
+std::int64_t RtpJitterBuffer::unwrapTimestamp(std::uint32_t timestamp)
+{
+    const auto delta = static_cast<std::int32_t>(timestamp - static_cast<std::uint32_t>(m_lastTimestamp));
+    const std::int64_t extended = m_lastTimestamp + delta;
+    m_lastTimestamp = std::max(m_lastTimestamp, extended);
+    return extended;
+}
+
+std::int64_t RtpJitterBuffer::timestampToUs(std::int64_t timestamp) const
+{
+    return timestamp * 1000000 / m_config.clockRate;
+}
+
+std::int64_t RtpJitterBuffer::targetDelayUs() const
+{
+    const double wanted = std::max(m_config.jitterMultiplier * m_jitterUs, m_latenessPeakUs);
+    const double clamped = std::clamp(wanted, m_config.minDelayMs * 1000.0, m_config.maxDelayMs * 1000.0);
+    return static_cast<std::int64_t>(clamped);
+}
+
+void RtpJitterBuffer::setRetransmissionWaitUs(std::int64_t waitUs)
+{
+    m_retransmissionWaitUs = std::clamp<std::int64_t>(waitUs, 0, static_cast<std::int64_t>(m_config.maxDelayMs) * 1000);
+}
+
+std::int64_t RtpJitterBuffer::reorderWaitUs() const
+{
+    return std::max({targetDelayUs(), static_cast<std::int64_t>(m_config.minReorderWaitMs) * 1000, m_retransmissionWaitUs});
+}
+
+std::int64_t RtpJitterBuffer::releaseTimeUs(std::int64_t timestamp) const
+{
+    return timestampToUs(timestamp) + m_baseTransitUs + targetDelayUs();
+}
+
+void RtpJitterBuffer::updateTiming(std::int64_t timestamp, std::int64_t arrivalUs)
+{
+    const std::int64_t transit = arrivalUs - timestampToUs(timestamp);
+    if (!m_hasTiming) {
+        m_hasTiming = true;
+        m_baseTransitUs = transit;
+        m_lastBaseUpdateUs = arrivalUs;
+        m_lastFrameTransitUs = transit;
+        m_newestFrameTimestamp = timestamp;
+        return;
+    }
+
+    const auto drift = static_cast<std::int64_t>((arrivalUs - m_lastBaseUpdateUs) * kBaseDriftPerUs);
+    m_baseTransitUs = std::min(transit, m_baseTransitUs + std::max<std::int64_t>(drift, 0));
+    m_lastBaseUpdateUs = arrivalUs;
+
+    // Jitter is measured between the first packets of consecutive frames;
+    // packets within one frame share a timestamp but are paced out by the sender.
+    if (timestamp > m_newestFrameTimestamp) {
+        const double d = static_cast<double>(transit - m_lastFrameTransitUs);
+        m_jitterUs += (std::abs(d) - m_jitterUs) / 16.0;
+        m_lastFrameTransitUs = transit;
+        m_newestFrameTimestamp = timestamp;
+        m_stats.jitterMs = m_jitterUs / 1000.0;
+        m_stats.targetDelayMs = targetDelayUs() / 1000.0;
+    }
+}
+
+RtpJitterBuffer::InsertResult RtpJitterBuffer::insert(const std::uint8_t *data, std::size_t size, std::int64_t arrivalUs)
+{
+    RtpPacketView packet;
+    if (size > m_config.maxPacketSize || !parseRtpPacket(data, size, packet)) {
+        return InsertResult::Invalid;
+    }
+
+    if (m_started && packet.ssrc != m_ssrc) {
+        // The sender restarted its stream; nothing buffered relates to it any more.
+        releaseRange(m_head, m_highest + 1, true);
+        m_started = false;
+        m_resyncPending = false;
+        m_hasTiming = false;
+    }
+
+    if (m_resyncPending) {
+        // Packets sent while the transport was down are gone; rebase the
+        // sequence space on this one. Timestamps keep unwrapping as before.
+        m_resyncPending = false;
+        m_lastSequence = packet.sequenceNumber;
+        m_head = packet.sequenceNumber;
+        m_highest = m_head - 1;
+        m_discontinuity = true;
+        m_hasDroppedTimestamp = false;
+    }
+
+    if (!m_started) {
+        m_started = true;
+        m_ssrc = packet.ssrc;
+        m_lastSequence = packet.sequenceNumber;
+        m_lastTimestamp = packet.timestamp;
+        m_head = packet.sequenceNumber;
+        m_highest = m_head - 1;
+        m_discontinuity = true;
+        m_hasDroppedTimestamp = false;
+    }
+
+    const std::int64_t sequence = unwrapSequence(packet.sequenceNumber);
+    const std::int64_t timestamp = unwrapTimestamp(packet.timestamp);
+
+    if (sequence < m_head || (m_hasDroppedTimestamp && timestamp == m_droppedTimestamp)) {
+        ++m_stats.packetsLate;
+        if (m_hasTiming) {
+            // Remember how late data turned up so the target delay covers it next time.
+            const double lateness = static_cast<double>(arrivalUs - (timestampToUs(timestamp) + m_baseTransitUs));
+            m_latenessPeakUs = std::max(m_latenessPeakUs, lateness);
+        }
+        return InsertResult::Late;
+    }
+
+    if (sequence >= m_head + static_cast<std::int64_t>(m_config.capacity)) {
+        // Too far ahead to fit the ring: everything buffered is stale.
+        releaseRange(m_head, m_highest + 1, true);
+        m_head = sequence;
+        m_highest = sequence - 1;
+        m_discontinuity = true;
+    }
+
+    Slot &slot = slotFor(sequence);
+    if (slot.used && slot.sequence == sequence) {
+        ++m_stats.packetsDuplicate;
+        return InsertResult::Duplicate;
+    }
+
+    slot.used = true;
+    slot.sequence = sequence;
+    slot.timestamp = timestamp;
+    slot.marker = packet.marker;
+    slot.size = size;
+    slot.arrivalUs = arrivalUs;
+    std::memcpy(m_storage.data() + (static_cast<std::size_t>(sequence) & m_mask) * m_config.maxPacketSize, data, size);
+
+    m_highest = std::max(m_highest, sequence);
+    updateTiming(timestamp, arrivalUs);
+    ++m_stats.packetsInserted;
+    return InsertResult::Inserted;
+}
+
+const RtpJitterBuffer::Slot *RtpJitterBuffer::findSlot(std::int64_t sequence) const
+{
+    const Slot &slot = m_slots[static_cast<std::size_t>(sequence) & m_mask];
+    return (slot.used && slot.sequence == sequence) ? &slot : nullptr;
+}
+
+const std::uint8_t *RtpJitterBuffer::slotData(std::int64_t sequence) const
+{
+    return m_storage.data() + (static_cast<std::size_t>(sequence) & m_mask) * m_config.maxPacketSize;
+}
+
+RtpJitterBuffer::HeadScan RtpJitterBuffer::scanHead() const
+{
+    HeadScan scan;
+    if (!m_started || m_highest < m_head) {
+        return scan;
+    }
+
+    std::int64_t gap = -1;
+    if (const Slot *first = findSlot(m_head)) {
+        scan.firstPresent = m_head;
+        scan.timestamp = first->timestamp;
+        for (std::int64_t sequence = m_head; sequence <= m_highest; ++sequence) {
+            const Slot *slot = findSlot(sequence);
+            if (!slot) {
+                gap = sequence;
+                break;
+            }
+            if (slot->timestamp != scan.timestamp) {
+                // Contiguous data with a new timestamp: the marker was simply not set.
+                scan.state = HeadState::Complete;
+                scan.endSequence = sequence;
+                return scan;
+            }
+            if (slot->marker) {
+                scan.state = HeadState::Complete;
+                scan.endSequence = sequence + 1;
+                return scan;
+            }
+        }
+        if (gap < 0) {
+            return scan; // frame still arriving in order
+        }
+    } else {
+        gap = m_head;
+    }
+
+    // Anything received after the gap is evidence that the missing packets
+    // were lost or reordered; give them a bounded time to turn up.
+    for (std::int64_t sequence = gap + 1; sequence <= m_highest; ++sequence) {
+        if (const Slot *slot = findSlot(sequence)) {
+            if (gap == m_head) {
+                scan.firstPresent = sequence;
+                scan.timestamp = slot->timestamp;
+            }
+            scan.state = HeadState::Incomplete;
+            scan.deadlineUs = slot->arrivalUs + reorderWaitUs();
+            return scan;
+        }
+    }
+    return scan;
+}
+
+std::int64_t RtpJitterBuffer::nextEventUs() const
+{
+    const HeadScan scan = scanHead();
+    switch (scan.state) {
+    case HeadState::Complete:
+        return releaseTimeUs(scan.timestamp);
+    case HeadState::Incomplete:
+        return scan.deadlineUs;
+    case HeadState::Empty:
+        break;
+    }
+    return -1;
+}
+
+void RtpJitterBuffer::releaseRange(std::int64_t begin, std::int64_t end, bool discarded)
+{
+    for (std::int64_t sequence = begin; sequence < end; ++sequence) {
+        Slot &slot = slotFor(sequence);
+        if (slot.used && slot.sequence == sequence) {
+            slot.used = false;
+            if (discarded) {
+                ++m_stats.packetsDiscarded;
+            }
+        }
+    }
+}
+
+void RtpJitterBuffer::giveUpHead(const HeadScan &scan)
+{
+    ++m_stats.framesLost;
+    m_discontinuity = true;
+
+    if (scan.firstPresent != m_head) {
+        // Only the head packets are missing; the first packet we do have may
+        // well start the next frame, so keep it and let the decoder judge.
+        m_head = scan.firstPresent;
+        return;
+    }
+
+    // The gap is inside the head frame: drop the whole frame.
+    std::int64_t next = m_highest + 1;
+    for (std::int64_t sequence = m_head + 1; sequence <= m_highest; ++sequence) {
+        const Slot *slot = findSlot(sequence);
+        if (slot && slot->timestamp != scan.timestamp) {
+            next = sequence;
+            break;
+        }
+    }
+    releaseRange(m_head, next, true);
+    m_head = next;
+    if (next > m_highest) {
+        // Its tail may still be in flight; make sure it is not mistaken for a new frame.
+        m_hasDroppedTimestamp = true;
+        m_droppedTimestamp = scan.timestamp;
+    }
+}
+
+bool RtpJitterBuffer::popFrame(std::int64_t nowUs, JitterFrame &out)
+{
+    for (;;) {
+        const HeadScan scan = scanHead();
+        if (scan.state == HeadState::Empty) {
+            return false;
+        }
+
+        if (scan.state == HeadState::Incomplete) {
+            if (nowUs < scan.deadlineUs) {
+                return false;
+            }
+            giveUpHead(scan);
+            continue;
+        }
+
+        if (nowUs < releaseTimeUs(scan.timestamp)) {
+            return false;
+        }
+
+        out.packets.clear();
+        out.timestamp = static_cast<std::uint32_t>(scan.timestamp);
+        out.discontinuity = m_discontinuity;
+        for (std::int64_t sequence = m_head; sequence < scan.endSequence; ++sequence) {
+            const Slot *slot = findSlot(sequence);
+            RtpPacketView view;
+            if (parseRtpPacket(slotData(sequence), slot->size, view)) {
+                out.packets.push_back(view);
+            }
+        }
+
+        // Slots are only marked free; their bytes stay intact until a newer
+        // packet lands in them, which cannot happen before the next call.
+        releaseRange(m_head, scan.endSequence, false);
+        m_head = scan.endSequence;
+        m_discontinuity = false;
+        if (m_hasDroppedTimestamp && scan.timestamp > m_droppedTimestamp) {
+            m_hasDroppedTimestamp = false;
+        }
+        m_latenessPeakUs *= kLatenessDecayPerFrame;
+        ++m_stats.framesReleased;
+        m_stats.targetDelayMs = targetDelayUs() / 1000.0;
+        return true;
+    }
+}
+
+} // namespace controller
@@ -0,0 +1,69 @@
+#include "controller/RtpPacket.h"
+
+namespace controller {
+
+namespace {
+constexpr std::size_t kRtpFixedHeaderSize = 12;
+constexpr std::uint8_t kRtpVersion = 2;
+} // namespace
+
+bool parseRtpPacket(const std::uint8_t *data, std::size_t size, RtpPacketView &out)
+{
+    if (!data || size < kRtpFixedHeaderSize) {
+        return false;
+    }
+
+    const std::uint8_t version = data[0] >> 6;
+    if (version != kRtpVersion) {
+        return false;
+    }
+
+    const bool padding = (data[0] & 0x20) != 0;
+    const bool extension = (data[0] & 0x10) != 0;
+    const std::size_t csrcCount = data[0] & 0x0F;
+
+    std::size_t offset = kRtpFixedHeaderSize + csrcCount * 4;
+    if (size < offset) {
+        return false;
+    }
+
+    if (extension) {
+        if (size < offset + 4) {
+            return false;
+        }
+        const std::size_t extensionWords = readBigEndian16(data + offset + 2);
+        offset += 4 + extensionWords * 4;
+        if (size < offset) {
+            return false;
+        }
+    }
+
+    std::size_t end = size;
+    if (padding) {
+        const std::size_t paddingSize = data[size - 1];
+        if (paddingSize == 0 || end < offset + paddingSize) {
+            return false;
+        }
+        end -= paddingSize;
+    }
+
+    out.marker = (data[1] & 0x80) != 0;
+    out.payloadType = data[1] & 0x7F;
+    out.sequenceNumber = readBigEndian16(data + 2);
+    out.timestamp = readBigEndian32(data + 4);
+    out.ssrc = readBigEndian32(data + 8);
+    out.payload = data + offset;
+    out.payloadSize = end - offset;
+    return true;
+}
+
+bool isRtcpPacket(const std::uint8_t *data, std::size_t size)
+{
+    if (!data || size < 8) {
+        return false;
+    }
+    const std::uint8_t packetType = data[1];
+    return packetType >= 200 && packetType <= 207;
+}
+
+} // namespace controller
@@ -0,0 +1,152 @@
+#include "controller/SessionGrid.h"
+
+#include "controller/VideoSurface.h"
+
+#include <QFrame>
+#include <QGridLayout>
+#include <QLabel>
+#include <QMouseEvent>
+#include <QVBoxLayout>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <utility>
+
+namespace controller {
+
+namespace {
+// Tiles get small; the surface's own minimum is sized for a single view.
+constexpr int kTileMinWidth = 192;
+constexpr int kTileMinHeight = 108;
+} // namespace
+
+class SessionTile : public QFrame
+{
+public:
+    SessionTile(const QString &title, std::function<void()> onActivated, QWidget *parent)
+        : QFrame(parent)
+        , m_title(title)
+        , m_onActivated(std::move(onActivated))
+    {
+        setObjectName(QStringLiteral("sessionTile"));
+        auto *layout = new QVBoxLayout(this);
+        layout->setContentsMargins(2, 2, 2, 2);
+        layout->setSpacing(2);
+        m_titleLabel = new QLabel(title, this);
+        surface = new VideoSurface(this);
+        surface->setMinimumSize(kTileMinWidth, kTileMinHeight);
+        surface->setPlaceholderText(tr("Waiting for video"));
+        layout->addWidget(m_titleLabel);
+        layout->addWidget(surface, 1);
+        setFocused(false);
+    }
+
+    void setStatus(const QString &status)
+    {
+        m_titleLabel->setText(status.isEmpty() ? m_title : tr("%1 (%2)").arg(m_title, status));
+    }
+
+    void setFocused(bool focused)
+    {
+        setStyleSheet(focused ? QStringLiteral("#sessionTile { border: 2px solid palette(highlight); }")
+                              : QStringLiteral("#sessionTile { border: 2px solid transparent; }"));
+    }
+
+    VideoSurface *surface = nullptr;
+
+protected:
+    void mousePressEvent(QMouseEvent *event) override
+    {
+        if (event->button() == Qt::LeftButton && m_onActivated) {
+            m_onActivated();
+        }
+        QFrame::mousePressEvent(event);
+    }
+
+private:
+    QString m_title;
+    QLabel *m_titleLabel = nullptr;
+    std::function<void()> m_onActivated;
+};
+
+SessionGrid::SessionGrid(QWidget *parent)
+    : QWidget(parent)
+{
+    m_layout = new QGridLayout(this);
+    m_layout->setContentsMargins(0, 0, 0, 0);
+    m_layout->setSpacing(4);
+}
+
+SessionGrid::~SessionGrid() = default;
+
+void SessionGrid::addTile(int id, const QString &title)
+{
+    if (m_tiles.count(id) != 0) {
+        return;
+    }
+    m_tiles[id] = new SessionTile(title, [this, id] { emit tileActivated(id); }, this);
+    m_tiles[id]->setFocused(id == m_focused);
+    if (id == m_focused) {
+        m_tiles[id]->surface->setMetrics(m_metrics);
+    }
+    relayout();
+}
+
+void SessionGrid::removeTile(int id)
+{
+    const auto it = m_tiles.find(id);
+    if (it == m_tiles.end()) {
+        return;
+    }
+    m_layout->removeWidget(it->second);
+    delete it->second;
+    m_tiles.erase(it);
+    relayout();
+}
+
+void SessionGrid::setTileStatus(int id, const QString &status)
+{
+    const auto it = m_tiles.find(id);
+    if (it != m_tiles.end()) {
+        it->second->setStatus(status);
+    }
+}
+
+void SessionGrid::setFocusedTile(int id)
+{
+    m_focused = id;
+    for (const auto &[tileId, tile] : m_tiles) {
+        tile->setFocused(tileId == id);
+        tile->surface->setMetrics(tileId == id ? m_metrics : nullptr);
+    }
+}
+
+void SessionGrid::setMetricsRegistry(std::shared_ptr<MetricsRegistry> metrics)
+{
+    m_metrics = std::move(metrics);
+    setFocusedTile(m_focused);
+}
+
+void SessionGrid::presentFrame(int id, const QImage &frame)
+{
+    const auto it = m_tiles.find(id);
+    if (it != m_tiles.end()) {
+        it->second->surface->presentFrame(frame);
+    }
+}
+
+void SessionGrid::relayout()
+{
+    for (const auto &entry : m_tiles) {
+        m_layout->removeWidget(entry.second);
+    }
+    const int columns = std::max(1, static_cast<int>(std::ceil(std::sqrt(static_cast<double>(m_tiles.size())))));
+    int index = 0;
+    for (const auto &entry : m_tiles) {
+        m_layout->addWidget(entry.second, index / columns, index % columns);
+        ++index;
+    }
+}
+
+} // namespace controller
@@ -0,0 +1,308 @@
+#include "controller/SessionManager.h"
+
+#include "controller/AuthClient.h"
+#include "controller/DecodeWorkerPool.h"
+#include "controller/IceCandidateBatcher.h"
+#include "controller/MetricsCollector.h"
+#include "controller/RealtimeMultiplexer.h"
+#include "controller/SignalingClient.h"
+#include "controller/WebRtcPeer.h"
+
+#include <QJsonObject>
+
+#include <utility>
+
+namespace controller {
+
+struct SessionManager::Session
+{
+    QString label;
+    QString connectionKey;
+    // Declared so the peer goes first: it stops decoding before the
+    // signalling it reports to disappears.
+    std::unique_ptr<SignalingClient> signaling;
+    std::unique_ptr<IceCandidateBatcher> batcher;
+    std::unique_ptr<WebRtcPeer> peer;
+    bool started = false; // ICE servers applied and pre-warmed
+    bool joined = false;
+    bool offered = false;
+};
+
+SessionManager::SessionManager(QObject *parent)
+    : QObject(parent)
+    , m_decodePool(std::make_shared<DecodeWorkerPool>())
+{
+}
+
+SessionManager::~SessionManager()
+{
+    removeAllSessions();
+}
+
+void SessionManager::setIceServers(const std::vector<IceServer> &servers)
+{
+    m_iceServers = servers;
+}
+
+void SessionManager::setAppToken(const QString &appToken)
+{
+    m_appToken = appToken;
+}
+
+void SessionManager::setTransportFactory(TransportFactory factory)
+{
+    m_transportFactory = std::move(factory);
+}
+
+namespace {
+QString connectionKey(const RealtimeCredentials &credentials, const QString &appToken)
+{
+    // Whatever RealtimeMultiplexer::sharesConnection() compares.
+    return credentials.endpoint.toString() + QLatin1Char('\n') + credentials.apiKey + QLatin1Char('\n') + appToken;
+}
+} // namespace
+
+RealtimeMultiplexer *SessionManager::multiplexerFor(const RealtimeCredentials &credentials)
+{
+    std::unique_ptr<RealtimeMultiplexer> &multiplexer = m_multiplexers[connectionKey(credentials, m_appToken)];
+    if (!multiplexer) {
+        multiplexer = std::make_unique<RealtimeMultiplexer>();
+        if (m_transportFactory) {
+            multiplexer->setTransport(m_transportFactory());
+        }
+    }
+    return multiplexer.get();
+}
+
+void SessionManager::setAuthClient(AuthClient *auth)
+{
+    if (m_auth) {
+        QObject::disconnect(m_auth, nullptr, this, nullptr);
+    }
+    m_auth = auth;
+    m_fetchingIceServers = false;
+    if (!auth) {
+        return;
+    }
+    connect(auth, &AuthClient::iceServersReady, this, &SessionManager::onIceServers);
+    connect(auth, &AuthClient::requestFailed, this, [this](const QString &context, const QString &) {
+        if (context == QLatin1String("ice") && m_fetchingIceServers) {
+            onIceServers(m_iceServers);
+        }
+    });
+}
+
+void SessionManager::onIceServers(const std::vector<IceServer> &servers)
+{
+    m_fetchingIceServers = false;
+    // An answer with nothing usable in it must not leave later peers without
+    // STUN or TURN; keep what we had.
+    if (!servers.empty()) {
+        m_iceServers = servers;
+    }
+    for (const auto &entry : m_sessions) {
+        if (!entry.second->started) {
+            startPeer(*entry.second);
+        }
+    }
+}
+
+void SessionManager::startPeer(Session &session)
+{
+    session.started = true;
+    session.peer->setIceServers(m_iceServers);
+    // ICE gathering runs while the channel is being joined.
+    session.peer->prewarm();
+    if (session.joined && !session.offered) {
+        session.offered = true;
+        session.peer->sendOffer();
+    }
+}
+
+void SessionManager::setMetricsCollector(MetricsCollector *collector)
+{
+    if (m_metricsCollector && m_metricsCollector != collector) {
+        m_metricsCollector->setPeer(nullptr);
+        m_metricsCollector->setSignalingClient(nullptr);
+    }
+    m_metricsCollector = collector;
+    attachMetrics();
+}
+
+void SessionManager::attachMetrics()
+{
+    if (!m_metricsCollector) {
+        return;
+    }
+    m_metricsCollector->setPeer(peer(m_focused));
+    m_metricsCollector->setSignalingClient(signalingClient(m_focused));
+}
+
+SessionManager::SessionId SessionManager::addSession(const QString &label, const RealtimeCredentials &credentials)
+{
+    const SessionId id = m_nextId++;
+    auto session = std::make_unique<Session>();
+    session->label = label;
+    session->connectionKey = connectionKey(credentials, m_appToken);
+    session->signaling = std::make_unique<SignalingClient>();
+    session->signaling->setTransport(multiplexerFor(credentials)->createTransport());
+    session->signaling->setCredentials(credentials);
+    session->signaling->setAppToken(m_appToken);
+    session->batcher = std::make_unique<IceCandidateBatcher>();
+    session->peer = std::make_unique<WebRtcPeer>();
+    session->peer->setDecodePool(m_decodePool);
+    if (m_focused == kNoSession && m_sessions.empty()) {
+        m_focused = id;
+    }
+    session->peer->setVideoThumbnail(id != m_focused);
+    // Only the focused session is heard; a grid of hosts would talk over each other.
+    session->peer->setAudioMuted(id != m_focused);
+
+    Session &added = *session;
+    m_sessions.emplace(id, std::move(session));
+    wireSession(id, added);
+    emit sessionAdded(id, label);
+    if (m_focused == id) {
+        attachMetrics();
+        emit focusedSessionChanged(id);
+    }
+
+    added.signaling->connectToRealtime();
+    if (!m_auth) {
+        startPeer(added);
+    } else if (!m_fetchingIceServers) {
+        // TURN credentials are short-lived: fetch them for every new session
+        // (or batch of sessions added while a fetch is in flight).
+        m_fetchingIceServers = true;
+        m_auth->fetchIceServers();
+    }
+    return id;
+}
+
+void SessionManager::wireSession(SessionId id, Session &session)
+{
+    SignalingClient *signaling = session.signaling.get();
+    IceCandidateBatcher *batcher = session.batcher.get();
+    WebRtcPeer *peer = session.peer.get();
+    Session *state = &session;
+
+    connect(peer, &WebRtcPeer::localDescriptionReady, signaling, [signaling](const QString &type, const QString &sdp) {
+        QJsonObject data{{QStringLiteral("sdp"), sdp}};
+        IceCandidateBatcher::advertise(data);
+        signaling->sendSignal(SignalEnvelope{type, data});
+    });
+    connect(peer, &WebRtcPeer::localIceCandidate, batcher, &IceCandidateBatcher::addCandidate);
+    connect(peer, &WebRtcPeer::localIceGatheringComplete, batcher, &IceCandidateBatcher::gatheringComplete);
+    connect(peer, &WebRtcPeer::reconnecting, batcher, [batcher](int) { batcher->reset(); });
+    connect(batcher, &IceCandidateBatcher::signalReady, signaling, &SignalingClient::sendSignal);
+
+    connect(signaling, &SignalingClient::joined, peer, [peer, state] {
+        state->joined = true;
+        // Rejoins after a signalling drop keep the peer as it is; before the
+        // ICE servers are in, startPeer() offers instead.
+        if (state->started && !state->offered) {
+            state->offered = true;
+            peer->sendOffer();
+        }
+    });
+    connect(signaling, &SignalingClient::signalReceived, peer, [peer, batcher](const SignalEnvelope &env) {
+        batcher->peerSignalReceived(env);
+        if (env.type == QLatin1String("answer")) {
+            peer->setRemoteDescription(env.type, env.data.value(QStringLiteral("sdp")).toString());
+            return;
+        }
+        const std::vector<IceCandidate> candidates = IceCandidateBatcher::candidatesFromSignal(env);
+        if (!candidates.empty()) {
+            peer->addRemoteIceCandidates(candidates);
+        }
+    });
+
+    connect(peer, &WebRtcPeer::stateChanged, this, [this, id](const QString &newState) {
+        emit sessionStateChanged(id, newState);
+    });
+    connect(peer, &WebRtcPeer::videoFrameReady, this, [this, id](const QImage &frame) {
+        emit frameReady(id, frame);
+    });
+}
+
+void SessionManager::removeSession(SessionId id)
+{
+    const auto it = m_sessions.find(id);
+    if (it == m_sessions.end()) {
+        return;
+    }
+    std::unique_ptr<Session> session = std::move(it->second);
+    m_sessions.erase(it);
+    if (m_focused == id && m_metricsCollector) {
+        // Before the peer goes, not after: the collector samples it.
+        m_metricsCollector->setPeer(nullptr);
+        m_metricsCollector->setSignalingClient(nullptr);
+    }
+    session->peer->closePeer();
+    session->signaling->disconnectFromRealtime();
+    const QString key = session->connectionKey;
+    session.reset();
+    const auto multiplexer = m_multiplexers.find(key);
+    if (multiplexer != m_multiplexers.end() && multiplexer->second->sessionCount() == 0) {
+        m_multiplexers.erase(multiplexer);
+    }
+
+    emit sessionRemoved(id);
+    if (m_focused == id) {
+        setFocusedSession(m_sessions.empty() ? kNoSession : m_sessions.begin()->first);
+    }
+}
+
+void SessionManager::removeAllSessions()
+{
+    while (!m_sessions.empty()) {
+        removeSession(m_sessions.begin()->first);
+    }
+}
+
+void SessionManager::setFocusedSession(SessionId id)
+{
+    if (id != kNoSession && m_sessions.find(id) == m_sessions.end()) {
+        return;
+    }
+    if (id == m_focused) {
+        return;
+    }
+    m_focused = id;
+    for (const auto &[sessionId, session] : m_sessions) {
+        session->peer->setVideoThumbnail(sessionId != m_focused);
+        session->peer->setAudioMuted(sessionId != m_focused);
+    }
+    attachMetrics();
+    emit focusedSessionChanged(id);
+}
+
+std::vector<SessionManager::SessionId> SessionManager::sessionIds() const
+{
+    std::vector<SessionId> ids;
+    ids.reserve(m_sessions.size());
+    for (const auto &entry : m_sessions) {
+        ids.push_back(entry.first);
+    }
+    return ids;
+}
+
+QString SessionManager::label(SessionId id) const
+{
+    const auto it = m_sessions.find(id);
+    return it == m_sessions.end() ? QString() : it->second->label;
+}
+
+WebRtcPeer *SessionManager::peer(SessionId id) const
+{
+    const auto it = m_sessions.find(id);
+    return it == m_sessions.end() ? nullptr : it->second->peer.get();
+}
+
+SignalingClient *SessionManager::signalingClient(SessionId id) const
+{
+    const auto it = m_sessions.find(id);
+    return it == m_sessions.end() ? nullptr : it->second->signaling.get();
+}
+
+} // namespace controller
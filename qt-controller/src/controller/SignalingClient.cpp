@@ -1,142 +1,390 @@
 #include "controller/SignalingClient.h"
+#include "controller/PhoenixCodec.h"
+#include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonValue>
-#include <QUrlQuery>
-#include <QDateTime>
-#include <QNetworkRequest>
+#include <QRandomGenerator>
+
+#include <algorithm>
+
+#include <cmath>
+#include <iterator>
+
+namespace {
+constexpr int kMaxPendingRefs = 64;
+constexpr qint64 kPendingRefTimeoutUs = 60 * 1000 * 1000;
+
+std::string_view utf8View(const QByteArray& bytes) {
+    return std::string_view(bytes.constData(), static_cast<std::size_t>(bytes.size()));
+}
+
+// 原始 JSON 值 -> QJsonValue；字符串和数字直接转换，嵌套对象/数组才交给 QJsonDocument
+QJsonValue jsonValueFromRaw(std::string_view raw, std::string& scratch) {
+    if (raw.empty()) return QJsonValue();
+    switch (raw.front()) {
+    case '"':
+        if (!controller::decodeJsonString(raw, scratch)) return QJsonValue();
+        return QString::fromUtf8(scratch.data(), static_cast<int>(scratch.size()));
+    case 't':
+        return true;
+    case 'f':
+        return false;
+    case 'n':
+        return QJsonValue(QJsonValue::Null);
+    case '{':
+    case '[': {
+        const auto doc = QJsonDocument::fromJson(QByteArray::fromRawData(raw.data(), static_cast<int>(raw.size())));
+        return doc.isArray() ? QJsonValue(doc.array()) : QJsonValue(doc.object());
+    }
+    default: {
+        bool ok = false;
+        const double value = QByteArray::fromRawData(raw.data(), static_cast<int>(raw.size())).toDouble(&ok);
+        return ok ? QJsonValue(value) : QJsonValue();
+    }
+    }
+}
+
+void appendJsonValue(std::string& out, const QJsonValue& value) {
+    switch (value.type()) {
+    case QJsonValue::String:
+        controller::appendJsonString(out, utf8View(value.toString().toUtf8()));
+        break;
+    case QJsonValue::Double: {
+        const double number = value.toDouble();
+        // sdpMLineIndex 这类整数按整数写出
+        if (std::abs(number) < 1e15 && std::floor(number) == number) {
+            out.append(std::to_string(static_cast<qint64>(number)));
+        } else {
+            out.append(utf8View(QByteArray::number(number, 'g', 17)));
+        }
+        break;
+    }
+    case QJsonValue::Bool:
+        out.append(value.toBool() ? "true" : "false");
+        break;
+    case QJsonValue::Object: {
+        // 批量 ICE 是对象数组，同样直接写出
+        const QJsonObject object = value.toObject();
+        out.push_back('{');
+        for (auto it = object.begin(); it != object.end(); ++it) {
+            if (it != object.begin()) out.push_back(',');
+            controller::appendJsonString(out, utf8View(it.key().toUtf8()));
+            out.push_back(':');
+            appendJsonValue(out, it.value());
+        }
+        out.push_back('}');
+        break;
+    }
+    case QJsonValue::Array: {
+        const QJsonArray array = value.toArray();
+        out.push_back('[');
+        for (qsizetype i = 0; i < array.size(); ++i) {
+            if (i > 0) out.push_back(',');
+            appendJsonValue(out, array.at(i));
+        }
+        out.push_back(']');
+        break;
+    }
+    default:
+        out.append("null");
+        break;
+    }
+}
+}
 
 SignalingClient::SignalingClient(QObject* parent)
     : QObject(parent)
 {
-    connect(&m_socket, &QWebSocket::connected, this, &SignalingClient::onSocketConnected);
-    connect(&m_socket, &QWebSocket::textMessageReceived, this, &SignalingClient::onSocketTextMessage);
-    connect(&m_socket, &QWebSocket::disconnected, this, &SignalingClient::onSocketClosed);
-#if QT_VERSION >= QT_VERSION_CHECK(6, 5, 0)
-    connect(&m_socket, &QWebSocket::errorOccurred, this, &SignalingClient::onSocketError);
-#else
-    connect(&m_socket, SIGNAL(error(QAbstractSocket::SocketError)), this, SLOT(onSocketError(QAbstractSocket::SocketError)));
-#endif
-
-    m_heartbeat.setInterval(30000); // 30s
+    setTransport(std::make_unique<controller::RealtimeWebSocketTransport>());
+
+    m_heartbeat.setInterval(kDefaultHeartbeatIntervalMs);
+    m_heartbeatAck.setSingleShot(true);
+    m_heartbeatAck.setInterval(kDefaultHeartbeatTimeoutMs);
+    m_joinAck.setSingleShot(true);
+    m_joinAck.setInterval(kDefaultJoinTimeoutMs);
+    m_reconnectTimer.setSingleShot(true);
+    m_clock.start();
     connect(&m_heartbeat, &QTimer::timeout, this, &SignalingClient::onHeartbeat);
+    connect(&m_heartbeatAck, &QTimer::timeout, this, &SignalingClient::onHeartbeatTimeout);
+    connect(&m_joinAck, &QTimer::timeout, this, &SignalingClient::onJoinTimeout);
+    connect(&m_reconnectTimer, &QTimer::timeout, this, &SignalingClient::openSocket);
 }
 
-void SignalingClient::setCredentials(const RealtimeCredentials& cred) { m_cred = cred; }
-void SignalingClient::setAppToken(const QString& appToken) { m_appToken = appToken; }
+SignalingClient::~SignalingClient() {
+    // 传输析构时可能还会发 closed()，此时不应再回调到这里
+    if (m_transport) m_transport->disconnect(this);
+}
+
+void SignalingClient::setTransport(std::unique_ptr<controller::SignalingTransport> transport) {
+    if (m_transport) {
+        m_transport->disconnect(this);
+        m_transport->abort();
+    }
+    m_transport = std::move(transport);
+    if (!m_transport) return;
+    connect(m_transport.get(), &controller::SignalingTransport::opened, this, &SignalingClient::onTransportOpened);
+    connect(m_transport.get(), &controller::SignalingTransport::textReceived, this, &SignalingClient::onTransportText);
+    connect(m_transport.get(), &controller::SignalingTransport::closed, this, &SignalingClient::onTransportClosed);
+    connect(m_transport.get(), &controller::SignalingTransport::errorOccurred, this, &SignalingClient::errorOccurred);
+}
+
+void SignalingClient::setReconnectBackoff(int initialMs, int maxMs) {
+    m_reconnectInitialMs = std::max(1, initialMs);
+    m_reconnectMaxMs = std::max(m_reconnectInitialMs, maxMs);
+}
 
-QUrl SignalingClient::buildRealtimeWsUrl(const QUrl& endpoint, const QString& apikey, const QString& token) const {
-    // endpoint: https://<project>.supabase.co
-    QUrl ws = endpoint;
-    if (ws.scheme() == "https") ws.setScheme("wss");
-    else if (ws.scheme() == "http") ws.setScheme("ws");
-    ws.setPath("/realtime/v1/websocket");
+void SignalingClient::setHeartbeat(int intervalMs, int ackTimeoutMs) {
+    m_heartbeat.setInterval(std::max(1, intervalMs));
+    m_heartbeatAck.setInterval(std::max(1, ackTimeoutMs));
+}
+
+void SignalingClient::setJoinTimeout(int timeoutMs) {
+    m_joinAck.setInterval(std::max(1, timeoutMs));
+}
 
-    QUrlQuery q;
-    q.addQueryItem("apikey", apikey);
-    q.addQueryItem("vsn", "1.0.0");
-    if (!token.isEmpty()) q.addQueryItem("token", token);
-    ws.setQuery(q);
-    return ws;
+void SignalingClient::setCredentials(const RealtimeCredentials& cred) {
+    m_cred = cred;
+    m_topicUtf8 = cred.topic.toStdString();
 }
+void SignalingClient::setAppToken(const QString& appToken) { m_appToken = appToken; }
 
 void SignalingClient::connectToRealtime() {
     if (!m_cred.endpoint.isValid() || m_cred.apiKey.isEmpty() || m_cred.topic.isEmpty()) {
         emit errorOccurred(QStringLiteral("Invalid Realtime credentials"));
         return;
     }
-    const QUrl wsUrl = buildRealtimeWsUrl(m_cred.endpoint, m_cred.apiKey, m_cred.signedToken);
+    m_autoReconnect = true;
+    m_reconnectAttempt = 0;
+    m_reconnectTimer.stop();
+    openSocket();
+}
 
-    QNetworkRequest req(wsUrl);
-    if (!m_appToken.isEmpty()) {
-        req.setRawHeader("Authorization", QByteArray("Bearer ").append(m_appToken.toUtf8()));
-    }
-    m_socket.open(req);
+void SignalingClient::openSocket() {
+    if (m_transport) m_transport->open(m_cred, m_appToken);
 }
 
 void SignalingClient::disconnectFromRealtime() {
+    m_autoReconnect = false;
+    m_reconnectTimer.stop();
     m_heartbeat.stop();
-    m_socket.close();
+    m_heartbeatAck.stop();
+    m_heartbeatRef.clear();
+    m_joinAck.stop();
+    m_joinRef.clear();
+    m_pendingRefs.clear();
+    m_outbound.clear(); // 主动断开：排队的信令不再有意义
+    if (m_transport) m_transport->close();
+}
+
+void SignalingClient::scheduleReconnect() {
+    if (!m_autoReconnect || m_reconnectTimer.isActive()) return;
+    // 指数退避 + 抖动：base = initial * 2^(attempt-1)，封顶 max，实际等待 [base/2, base]
+    const int attempt = ++m_reconnectAttempt;
+    qint64 base = m_reconnectInitialMs;
+    for (int i = 1; i < attempt && base < m_reconnectMaxMs; ++i) base *= 2;
+    base = std::min<qint64>(base, m_reconnectMaxMs);
+    const int delayMs = static_cast<int>(base / 2 + QRandomGenerator::global()->bounded(base / 2 + 1));
+    emit reconnecting(attempt, delayMs);
+    m_reconnectTimer.start(delayMs);
 }
 
-void SignalingClient::onSocketConnected() {
+void SignalingClient::onTransportOpened() {
     emit connected();
     m_joined = false;
+    m_heartbeatRef.clear();
     sendJoin();
     m_heartbeat.start();
 }
 
 void SignalingClient::sendJoin() {
-    // Phoenix: event=phx_join
-    const QJsonObject obj{
-        {"topic",   m_cred.topic},
-        {"event",   "phx_join"},
-        {"payload", QJsonObject{}},
-        {"ref",     QString::number(m_refCounter++)}
-    };
-    sendRaw(obj);
+    // Phoenix: event=phx_join；有签名 token 时放进 join 载荷，频道按它鉴权
+    // （共享连接时 URL 上的 token 只能是一个会话的）
+    if (m_cred.signedToken.isEmpty()) {
+        m_joinRef = sendFrame(m_topicUtf8, "phx_join", "{}");
+    } else {
+        m_payload.assign("{\"access_token\":");
+        controller::appendJsonString(m_payload, m_cred.signedToken.toStdString());
+        m_payload.push_back('}');
+        m_joinRef = sendFrame(m_topicUtf8, "phx_join", m_payload);
+    }
+    m_joinAck.start();
+}
+
+void SignalingClient::onJoinTimeout() {
+    failJoin(QStringLiteral("Realtime join timed out"));
+}
+
+void SignalingClient::failJoin(const QString& reason) {
+    // 连接还在但进不了频道：不能一直挂着排队，断开后走正常的退避重连
+    ++m_stats.joinFailures;
+    m_joinAck.stop();
+    m_joinRef.clear();
+    emit errorOccurred(reason);
+    if (m_transport) m_transport->abort(); // closed() -> 重连
+    scheduleReconnect();                   // 传输若已关闭不会再发 closed()
 }
 
 void SignalingClient::onHeartbeat() {
-    const QJsonObject beat{
-        {"topic",   "phoenix"},
-        {"event",   "heartbeat"},
-        {"payload", QJsonObject{}},
-        {"ref",     QString::number(m_refCounter++)}
-    };
-    sendRaw(beat);
+    if (!m_heartbeatRef.isEmpty()) return; // 上一个还在等回复，由 m_heartbeatAck 判定超时
+    m_heartbeatRef = sendFrame("phoenix", "heartbeat", "{}");
+    m_heartbeatAck.start();
+}
+
+void SignalingClient::onHeartbeatTimeout() {
+    // 连接已经不通（半开的 TCP 可能要几分钟才报错）：直接断开，走重连
+    ++m_stats.missedHeartbeats;
+    m_heartbeatRef.clear();
+    emit errorOccurred(QStringLiteral("Realtime heartbeat timed out"));
+    if (m_transport) m_transport->abort(); // closed() -> 重连
 }
 
-void SignalingClient::sendBroadcast(const QString& event, const QJsonObject& payload) {
+void SignalingClient::sendBroadcast(std::string_view event, std::string_view payloadJson) {
     // 统一使用 broadcast：外层 event="broadcast"，内层 event=你自定义（如 "signal"）
-    const QJsonObject obj{
-        {"topic",   m_cred.topic},
-        {"event",   "broadcast"},
-        {"payload", QJsonObject{
-            {"type",   "broadcast"},
-            {"event",  event},         // e.g. "signal"
-            {"payload", payload}       // 自己的内容（offer/answer/ice）
-        }},
-        {"ref",     QString::number(m_refCounter++)}
-    };
-    sendRaw(obj);
+    m_payload.clear();
+    m_payload.append("{\"type\":\"broadcast\",\"event\":");
+    controller::appendJsonString(m_payload, event);
+    m_payload.append(",\"payload\":");
+    m_payload.append(payloadJson); // 自己的内容（offer/answer/ice）
+    m_payload.push_back('}');
+    sendFrame(m_topicUtf8, "broadcast", m_payload);
 }
 
 void SignalingClient::sendSignal(const SignalEnvelope& env) {
-    QJsonObject inner = env.data;
-    inner.insert("type", env.type); // 例如 "offer" / "answer" / "ice"
-    sendBroadcast(QStringLiteral("signal"), inner);
+    std::string inner;
+    appendSignalPayload(inner, env);
+    if (!m_joined) {
+        // 连接中/断线重连中：排队，join 后按顺序发出；满了丢最旧的
+        if (m_outbound.size() >= kMaxQueuedSignals) {
+            m_outbound.pop_front();
+            ++m_stats.droppedSignals;
+        }
+        m_outbound.push_back(std::move(inner));
+        ++m_stats.queuedSignals;
+        return;
+    }
+    flushOutbound();
+    sendBroadcast("signal", inner);
+}
+
+void SignalingClient::flushOutbound() {
+    while (m_joined && !m_outbound.empty()) {
+        sendBroadcast("signal", m_outbound.front());
+        m_outbound.pop_front();
+    }
+}
+
+void SignalingClient::appendSignalPayload(std::string& out, const SignalEnvelope& env) {
+    // {"type":"offer","sdp":"..."}：SDP/candidate 字符串直接转义写入
+    out.append("{\"type\":");
+    controller::appendJsonString(out, utf8View(env.type.toUtf8()));
+    for (auto it = env.data.begin(); it != env.data.end(); ++it) {
+        if (it.key() == QLatin1String("type")) continue;
+        out.push_back(',');
+        controller::appendJsonString(out, utf8View(it.key().toUtf8()));
+        out.push_back(':');
+        appendJsonValue(out, it.value());
+    }
+    out.push_back('}');
+}
+
+bool SignalingClient::decodeSignalPayload(std::string_view payloadJson, SignalEnvelope& env) {
+    env = SignalEnvelope();
+    controller::JsonObjectReader reader(payloadJson);
+    std::string_view key;
+    std::string_view value;
+    std::string scratch;
+    while (reader.next(key, value)) {
+        if (controller::jsonStringEquals(key, "type")) {
+            if (controller::decodeJsonString(value, scratch)) env.type = QString::fromStdString(scratch);
+            continue;
+        }
+        if (!controller::decodeJsonString(key, scratch)) return false;
+        const QString name = QString::fromStdString(scratch);
+        env.data.insert(name, jsonValueFromRaw(value, scratch));
+    }
+    return reader.ok();
 }
 
-void SignalingClient::sendRaw(const QJsonObject& obj) {
-    const auto str = QString::fromUtf8(QJsonDocument(obj).toJson(QJsonDocument::Compact));
-    m_socket.sendTextMessage(str);
+QString SignalingClient::sendFrame(std::string_view topic, std::string_view event, std::string_view payloadJson) {
+    const QString ref = QString::number(m_refCounter++);
+    // 记录发送时间，收到同 ref 的 phx_reply 时得出信令往返耗时
+    // broadcast 默认没有 ack，不会有回复；条目过多时丢弃最旧的一批
+    if (m_pendingRefs.size() >= kMaxPendingRefs) {
+        const qint64 cutoff = m_clock.nsecsElapsed() / 1000 - kPendingRefTimeoutUs;
+        for (auto it = m_pendingRefs.begin(); it != m_pendingRefs.end();) {
+            it = it.value() < cutoff ? m_pendingRefs.erase(it) : std::next(it);
+        }
+        if (m_pendingRefs.size() >= kMaxPendingRefs) {
+            m_pendingRefs.clear();
+        }
+    }
+    m_pendingRefs.insert(ref, m_clock.nsecsElapsed() / 1000);
+
+    m_outFrame.clear();
+    controller::appendPhoenixFrame(m_outFrame, topic, event, payloadJson, utf8View(ref.toLatin1()));
+    if (m_transport) m_transport->sendText(m_outFrame);
+    return ref;
 }
 
-void SignalingClient::onSocketTextMessage(const QString& msg) {
-    const auto obj = QJsonDocument::fromJson(msg.toUtf8()).object();
-    const QString event = obj.value("event").toString();
+void SignalingClient::onTransportText(const QByteArray& utf8) {
+    // 只扫描一遍外层；payload 按需再看
+    controller::PhoenixFrame frame;
+    if (!controller::parsePhoenixFrame(utf8View(utf8), frame)) return;
 
-    if (event == "phx_reply") {
-        // join ok?
-        const auto payload = obj.value("payload").toObject();
-        const auto status = payload.value("status").toString();
-        if (!m_joined && status == "ok" && obj.value("topic").toString() == m_cred.topic) {
+    if (controller::jsonStringEquals(frame.event, "phx_reply")) {
+        std::string ref;
+        if (controller::decodeJsonString(frame.ref, ref)) {
+            const QString key = QString::fromStdString(ref);
+            const auto sent = m_pendingRefs.find(key);
+            if (sent != m_pendingRefs.end()) {
+                const qint64 latencyUs = m_clock.nsecsElapsed() / 1000 - sent.value();
+                m_pendingRefs.erase(sent);
+                emit replyLatency(latencyUs);
+                if (key == m_heartbeatRef) {
+                    m_heartbeatRef.clear();
+                    m_heartbeatAck.stop();
+                    m_stats.heartbeatRttUs = latencyUs;
+                    m_stats.smoothedRttUs = m_stats.smoothedRttUs < 0
+                        ? latencyUs : m_stats.smoothedRttUs + (latencyUs - m_stats.smoothedRttUs) / 8;
+                    emit heartbeatRtt(latencyUs);
+                }
+            }
+        }
+        // join 的回复：按 ref 认
+        if (!m_joined && !m_joinRef.isEmpty() && controller::jsonStringEquals(frame.ref, m_joinRef.toStdString())) {
+            m_joinAck.stop();
+            m_joinRef.clear();
+            const std::string_view status = controller::jsonField(frame.payload, "status");
+            if (!controller::jsonStringEquals(status, "ok")) {
+                std::string text;
+                controller::decodeJsonString(status, text);
+                failJoin(QStringLiteral("Realtime join rejected: %1")
+                             .arg(text.empty() ? QStringLiteral("no status") : QString::fromStdString(text)));
+                return;
+            }
             m_joined = true;
+            if (m_everJoined) ++m_stats.reconnects;
+            m_everJoined = true;
+            m_reconnectAttempt = 0; // join 成功才算恢复；连上但 join 失败继续退避
+            flushOutbound();
             emit joined();
         }
         return;
     }
 
-    if (event == "broadcast") {
-        const auto p = obj.value("payload").toObject();
-        if (p.value("type").toString() == "broadcast" &&
-            p.value("event").toString() == "signal") {
-            const auto inner = p.value("payload").toObject(); // 真正信令
-            const QString t = inner.value("type").toString();
-            QJsonObject data = inner;
-            data.remove("type");
-            emit signalReceived(SignalEnvelope{t, data});
+    if (controller::jsonStringEquals(frame.event, "broadcast")) {
+        controller::JsonObjectReader reader(frame.payload);
+        std::string_view key, value, type, event, inner;
+        while (reader.next(key, value)) {
+            if (controller::jsonStringEquals(key, "type")) type = value;
+            else if (controller::jsonStringEquals(key, "event")) event = value;
+            else if (controller::jsonStringEquals(key, "payload")) inner = value; // 真正信令
+        }
+        SignalEnvelope env;
+        if (controller::jsonStringEquals(type, "broadcast") && controller::jsonStringEquals(event, "signal") &&
+            decodeSignalPayload(inner, env)) {
+            emit signalReceived(env);
         }
         return;
     }
@@ -144,11 +392,15 @@ void SignalingClient::onSocketTextMessage(const QString& msg) {
     // 其它事件忽略
 }
 
-void SignalingClient::onSocketClosed() {
+void SignalingClient::onTransportClosed() {
     m_heartbeat.stop();
+    m_heartbeatAck.stop();
+    m_heartbeatRef.clear();
+    m_joinAck.stop();
+    m_joinRef.clear();
+    m_pendingRefs.clear();
+    m_joined = false;
     emit closed();
+    scheduleReconnect();
 }
 
-void SignalingClient::onSocketError(QAbstractSocket::SocketError) {
-    emit errorOccurred(m_socket.errorString());
-}
@@ -0,0 +1,105 @@
+#include "controller/SignalingTransport.h"
+
+#include <QNetworkRequest>
+#include <QUrlQuery>
+
+namespace controller {
+
+RealtimeWebSocketTransport::RealtimeWebSocketTransport(QObject *parent)
+    : SignalingTransport(parent)
+{
+    connect(&m_socket, &QWebSocket::connected, this, &RealtimeWebSocketTransport::onConnected);
+    connect(&m_socket, &QWebSocket::disconnected, this, &RealtimeWebSocketTransport::onDisconnected);
+    connect(&m_socket, &QWebSocket::textMessageReceived, this, [this](const QString &message) {
+        emit textReceived(message.toUtf8());
+    });
+#if QT_VERSION >= QT_VERSION_CHECK(6, 5, 0)
+    connect(&m_socket, &QWebSocket::errorOccurred, this, &RealtimeWebSocketTransport::onError);
+#else
+    connect(&m_socket, SIGNAL(error(QAbstractSocket::SocketError)), this, SLOT(onError(QAbstractSocket::SocketError)));
+#endif
+}
+
+QUrl RealtimeWebSocketTransport::buildUrl(const QUrl &endpoint, const QString &apiKey, const QString &token)
+{
+    // endpoint: https://<project>.supabase.co
+    QUrl ws = endpoint;
+    if (ws.scheme() == QLatin1String("https")) {
+        ws.setScheme(QStringLiteral("wss"));
+    } else if (ws.scheme() == QLatin1String("http")) {
+        ws.setScheme(QStringLiteral("ws"));
+    }
+    ws.setPath(QStringLiteral("/realtime/v1/websocket"));
+
+    QUrlQuery query;
+    query.addQueryItem(QStringLiteral("apikey"), apiKey);
+    query.addQueryItem(QStringLiteral("vsn"), QStringLiteral("1.0.0"));
+    if (!token.isEmpty()) {
+        query.addQueryItem(QStringLiteral("token"), token);
+    }
+    ws.setQuery(query);
+    return ws;
+}
+
+void RealtimeWebSocketTransport::open(const RealtimeCredentials &credentials, const QString &appToken)
+{
+    QNetworkRequest request(buildUrl(credentials.endpoint, credentials.apiKey, credentials.signedToken));
+    if (!appToken.isEmpty()) {
+        request.setRawHeader("Authorization", QByteArray("Bearer ").append(appToken.toUtf8()));
+    }
+    m_active = true;
+    m_open = false;
+    m_socket.open(request);
+}
+
+void RealtimeWebSocketTransport::close()
+{
+    m_socket.close();
+}
+
+void RealtimeWebSocketTransport::abort()
+{
+    m_socket.abort();
+    // A socket that never got anywhere may not report disconnected.
+    if (m_socket.state() == QAbstractSocket::UnconnectedState) {
+        finish();
+    }
+}
+
+void RealtimeWebSocketTransport::sendText(std::string_view utf8)
+{
+    if (m_open) {
+        m_socket.sendTextMessage(QString::fromUtf8(utf8.data(), static_cast<int>(utf8.size())));
+    }
+}
+
+void RealtimeWebSocketTransport::onConnected()
+{
+    m_open = true;
+    emit opened();
+}
+
+void RealtimeWebSocketTransport::onDisconnected()
+{
+    finish();
+}
+
+void RealtimeWebSocketTransport::onError(QAbstractSocket::SocketError)
+{
+    emit errorOccurred(m_socket.errorString());
+    // A failed connect is not always followed by disconnected.
+    if (m_socket.state() == QAbstractSocket::UnconnectedState) {
+        finish();
+    }
+}
+
+void RealtimeWebSocketTransport::finish()
+{
+    m_open = false;
+    if (m_active) {
+        m_active = false;
+        emit closed();
+    }
+}
+
+} // namespace controller
@@ -1,13 +1,16 @@
 #include "controller/UiMainWindow.h"
 
+#include "controller/SessionGrid.h"
+#include "controller/VideoSurface.h"
+
 #include <QBoxLayout>
 #include <QGuiApplication>
 #include <QImage>
 #include <QLabel>
-#include <QPainter>
-#include <QPixmap>
 #include <QStatusBar>
 
+#include <utility>
+
 namespace controller {
 
 UiMainWindow::UiMainWindow(QWidget *parent)
@@ -47,10 +50,12 @@ void UiMainWindow::buildUi()
     m_disconnectButton = new QPushButton(tr("Disconnect"), m_centralWidget);
     connect(m_disconnectButton, &QPushButton::clicked, this, &UiMainWindow::requestDisconnect);
 
-    m_videoLabel = new QLabel(m_centralWidget);
-    m_videoLabel->setMinimumSize(640, 360);
-    m_videoLabel->setAlignment(Qt::AlignCenter);
-    m_videoLabel->setText(tr("Waiting for video"));
+    m_videoStack = new QStackedWidget(m_centralWidget);
+    m_videoSurface = new VideoSurface(m_videoStack);
+    m_videoSurface->setPlaceholderText(tr("Waiting for video"));
+    m_sessionGrid = new SessionGrid(m_videoStack);
+    m_videoStack->addWidget(m_videoSurface);
+    m_videoStack->addWidget(m_sessionGrid);
 
     m_metricsLabel = new QLabel(tr("Metrics: --"), m_centralWidget);
 
@@ -61,7 +66,7 @@ void UiMainWindow::buildUi()
     layout->addWidget(m_sessionCodeLabel);
     layout->addWidget(m_connectButton);
     layout->addWidget(m_disconnectButton);
-    layout->addWidget(m_videoLabel, 1);
+    layout->addWidget(m_videoStack, 1);
     layout->addWidget(m_metricsLabel);
 
     setCentralWidget(m_centralWidget);
@@ -96,11 +101,19 @@ void UiMainWindow::setMetricsText(const QString &metrics)
     m_metricsLabel->setText(tr("Metrics: %1").arg(metrics));
 }
 
+void UiMainWindow::setMetricsRegistry(std::shared_ptr<MetricsRegistry> metrics)
+{
+    m_videoSurface->setMetrics(std::move(metrics));
+}
+
 void UiMainWindow::showVideoFrame(const QImage &frame)
 {
-    if (!frame.isNull()) {
-        m_videoLabel->setPixmap(QPixmap::fromImage(frame).scaled(m_videoLabel->size(), Qt::KeepAspectRatio, Qt::SmoothTransformation));
-    }
+    m_videoSurface->presentFrame(frame);
+}
+
+void UiMainWindow::setGridVisible(bool visible)
+{
+    m_videoStack->setCurrentWidget(visible ? static_cast<QWidget *>(m_sessionGrid) : m_videoSurface);
 }
 
 void UiMainWindow::onJoinButtonClicked()
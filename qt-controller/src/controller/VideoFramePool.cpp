@@ -0,0 +1,147 @@
+#include "controller/VideoFramePool.h"
+
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace controller {
+
+namespace {
+constexpr std::size_t kRowAlignment = 64;
+
+qsizetype alignedStride(int width)
+{
+    const std::size_t bytes = static_cast<std::size_t>(width) * 4;
+    return static_cast<qsizetype>((bytes + kRowAlignment - 1) / kRowAlignment * kRowAlignment);
+}
+} // namespace
+
+struct VideoFramePool::Buffer
+{
+    std::shared_ptr<Shared> owner;
+    std::uint64_t generation = 0;
+    uchar *data = nullptr;
+
+    ~Buffer() { ::operator delete(data, std::align_val_t(kRowAlignment)); }
+};
+
+struct VideoFramePool::Shared
+{
+    std::mutex mutex;
+    std::size_t capacity = 0;
+    std::size_t allocated = 0;   // buffers of the current generation, pooled or out
+    std::size_t outstanding = 0;
+    std::uint64_t generation = 0; // bumped on every geometry change
+    int width = 0;
+    int height = 0;
+    qsizetype stride = 0;
+    bool closed = false;
+    std::vector<Buffer *> free;
+    std::uint64_t hits = 0;
+    std::uint64_t misses = 0;
+
+    void clearFree()
+    {
+        for (Buffer *buffer : free) {
+            delete buffer;
+        }
+        allocated -= free.size();
+        free.clear();
+    }
+};
+
+VideoFramePool::VideoFramePool(std::size_t capacity)
+    : m_shared(std::make_shared<Shared>())
+{
+    m_shared->capacity = capacity;
+    m_shared->free.reserve(capacity);
+}
+
+VideoFramePool::~VideoFramePool()
+{
+    std::lock_guard<std::mutex> lock(m_shared->mutex);
+    m_shared->closed = true;
+    m_shared->clearFree();
+}
+
+QImage VideoFramePool::acquire(int width, int height)
+{
+    if (width <= 0 || height <= 0) {
+        return QImage();
+    }
+
+    Buffer *buffer = nullptr;
+    qsizetype stride = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_shared->mutex);
+        Shared &shared = *m_shared;
+        if (shared.width != width || shared.height != height) {
+            shared.clearFree();
+            shared.allocated = 0; // outstanding buffers of the old size are dropped on release
+            shared.width = width;
+            shared.height = height;
+            shared.stride = alignedStride(width);
+            ++shared.generation;
+        }
+        stride = shared.stride;
+
+        if (!shared.free.empty()) {
+            buffer = shared.free.back();
+            shared.free.pop_back();
+            ++shared.hits;
+        } else {
+            ++shared.misses;
+            ++shared.allocated;
+        }
+        ++shared.outstanding;
+
+        if (!buffer) {
+            buffer = new Buffer;
+            buffer->generation = shared.generation;
+        }
+    }
+
+    // Only buffers that are out hold the pool state alive; pooled ones must
+    // not, or pool and free list would keep each other around.
+    buffer->owner = m_shared;
+
+    if (!buffer->data) {
+        const std::size_t bytes = static_cast<std::size_t>(stride) * height;
+        buffer->data = static_cast<uchar *>(::operator new(bytes, std::align_val_t(kRowAlignment)));
+    }
+
+    return QImage(buffer->data, width, height, stride, QImage::Format_RGB32, &VideoFramePool::releaseBuffer, buffer);
+}
+
+void VideoFramePool::releaseBuffer(void *info)
+{
+    auto *buffer = static_cast<Buffer *>(info);
+    const std::shared_ptr<Shared> shared = std::move(buffer->owner);
+
+    std::unique_lock<std::mutex> lock(shared->mutex);
+    --shared->outstanding;
+    const bool current = !shared->closed && buffer->generation == shared->generation;
+    if (current && shared->allocated <= shared->capacity) {
+        shared->free.push_back(buffer);
+        return;
+    }
+    if (current) {
+        // Allocated past capacity while the pool was exhausted; shrink back.
+        --shared->allocated;
+    }
+    lock.unlock();
+    delete buffer;
+}
+
+FramePoolStats VideoFramePool::stats() const
+{
+    std::lock_guard<std::mutex> lock(m_shared->mutex);
+    FramePoolStats stats;
+    stats.hits = m_shared->hits;
+    stats.misses = m_shared->misses;
+    stats.outstanding = m_shared->outstanding;
+    stats.capacity = m_shared->capacity;
+    return stats;
+}
+
+} // namespace controller
@@ -0,0 +1,437 @@
+#include "controller/VideoReceiver.h"
+
+#include "controller/ColorConverter.h"
+#include "controller/H264Decoder.h"
+#include "controller/H264Sei.h"
+#include "controller/Rtcp.h"
+
+#include <algorithm>
+#include <chrono>
+#include <utility>
+
+namespace controller {
+
+namespace {
+// Never hold a frame longer than this for lip-sync: a bad sender report must
+// not freeze the picture.
+constexpr std::int64_t kMaxSyncHoldUs = 150000;
+// Late frames within this window are still shown.
+constexpr std::int64_t kSyncLateToleranceUs = 40000;
+// Slack on top of the RTT for the sender to react to a NACK.
+constexpr std::int64_t kRetransmissionSlackUs = 10000;
+constexpr std::uint32_t kVideoClockRate = 90000;
+
+std::int64_t steadyNowUs()
+{
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+std::chrono::steady_clock::time_point toTimePoint(std::int64_t us)
+{
+    return std::chrono::steady_clock::time_point(std::chrono::microseconds(us));
+}
+
+// -1 means "no deadline".
+std::int64_t earliestUs(std::int64_t a, std::int64_t b)
+{
+    if (a < 0) {
+        return b;
+    }
+    return b < 0 ? a : std::min(a, b);
+}
+} // namespace
+
+VideoReceiver::VideoReceiver(FrameCallback onFrame, const JitterBufferConfig &jitterConfig)
+    : m_onFrame(std::move(onFrame))
+    , m_framePool(kFramePoolCapacity)
+    , m_jitterBuffer(jitterConfig)
+{
+    m_jitterBuffer.setRetransmissionWaitUs(m_feedback.rttUs() + kRetransmissionSlackUs);
+}
+
+VideoReceiver::~VideoReceiver()
+{
+    stop();
+}
+
+void VideoReceiver::setAvSync(std::shared_ptr<AvSync> avSync)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_avSync = std::move(avSync);
+}
+
+void VideoReceiver::setMetrics(std::shared_ptr<MetricsRegistry> metrics)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_metrics = std::move(metrics);
+}
+
+void VideoReceiver::setLatencyMonitor(std::shared_ptr<LatencyMonitor> monitor)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_latency = std::move(monitor);
+}
+
+void VideoReceiver::setDecodePool(std::shared_ptr<DecodeWorkerPool> pool)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pool = std::move(pool);
+}
+
+void VideoReceiver::setThumbnail(bool thumbnail)
+{
+    m_thumbnail.store(thumbnail, std::memory_order_relaxed);
+}
+
+bool VideoReceiver::thumbnail() const
+{
+    return m_thumbnail.load(std::memory_order_relaxed);
+}
+
+void VideoReceiver::setFeedbackSender(RtcpFeedback::SendFunction send)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_feedback.setSendFunction(std::move(send));
+}
+
+void VideoReceiver::setRoundTripTimeUs(std::int64_t rttUs)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_feedback.setRttUs(rttUs);
+    m_bandwidth.setRttUs(rttUs);
+    m_jitterBuffer.setRetransmissionWaitUs(m_feedback.rttUs() + kRetransmissionSlackUs);
+}
+
+RtcpFeedbackStats VideoReceiver::feedbackStats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_feedback.stats();
+}
+
+BandwidthEstimatorStats VideoReceiver::bandwidthStats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_bandwidth.stats();
+}
+
+void VideoReceiver::start()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_running) {
+        return;
+    }
+    m_running = true;
+    if (m_pool) {
+        m_poolJob = m_pool->add(this);
+    } else {
+        m_thread = std::thread(&VideoReceiver::decodeLoop, this);
+    }
+}
+
+void VideoReceiver::stop()
+{
+    DecodeWorkerPool::JobId job = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_running) {
+            return;
+        }
+        m_running = false;
+        job = std::exchange(m_poolJob, 0);
+    }
+    m_wakeup.notify_all();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+    if (job != 0) {
+        // Waits out a run in progress; it sees !m_running and returns.
+        m_pool->remove(job);
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_jitterBuffer.reset();
+    m_depacketizer.reset();
+    m_feedback.reset();
+    m_bandwidth.reset();
+    m_keyframeOnResume = false;
+    m_heldFrame = QImage();
+    // The next start() begins with a fresh decoder, waiting for a keyframe.
+    m_decoder.reset();
+    m_waitingForKeyframe = true;
+    m_presented = false;
+}
+
+JitterBufferStats VideoReceiver::jitterStats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_jitterBuffer.stats();
+}
+
+FramePoolStats VideoReceiver::framePoolStats() const
+{
+    return m_framePool.stats();
+}
+
+void VideoReceiver::handleRtpPacket(const std::byte *data, std::size_t size)
+{
+    DecodeWorkerPool::JobId job = 0;
+    const auto *bytes = reinterpret_cast<const std::uint8_t *>(data);
+    if (isRtcpPacket(bytes, size)) {
+        RtcpSenderReport report;
+        if (m_avSync && findRtcpSenderReport(bytes, size, report)) {
+            m_avSync->onSenderReport(AvSync::Stream::Video, report);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_running) {
+            return;
+        }
+        const std::int64_t nowUs = steadyNowUs();
+        RtpPacketView packet;
+        if (m_jitterBuffer.insert(bytes, size, nowUs) != RtpJitterBuffer::InsertResult::Invalid
+            && parseRtpPacket(bytes, size, packet)) {
+            m_feedback.onPacket(packet.ssrc, packet.sequenceNumber, nowUs);
+            if (m_keyframeOnResume) {
+                m_keyframeOnResume = false;
+                m_feedback.requestKeyframe(nowUs);
+            }
+            m_bandwidth.onPacket(nowUs, packet.timestamp, size);
+            m_feedback.onBandwidthEstimate(m_bandwidth.estimateBps(), nowUs);
+        }
+        m_wakePending = true;
+        job = m_poolJob;
+    }
+    if (job != 0) {
+        m_pool->wake(job);
+    } else {
+        m_wakeup.notify_one();
+    }
+}
+
+void VideoReceiver::onTransportRestarted()
+{
+    DecodeWorkerPool::JobId job = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_running) {
+            return;
+        }
+        m_jitterBuffer.resync();
+        m_feedback.reset();
+        m_keyframeOnResume = true;
+        m_wakePending = true;
+        job = m_poolJob;
+    }
+    if (job != 0) {
+        m_pool->wake(job);
+    } else {
+        m_wakeup.notify_one();
+    }
+}
+
+void VideoReceiver::decodeLoop()
+{
+    for (;;) {
+        const std::int64_t nextUs = runDue(steadyNowUs());
+        std::unique_lock<std::mutex> lock(m_mutex);
+        // Packets that arrived during runDue() set m_wakePending, so they are not slept through.
+        const auto woken = [this]() { return !m_running || m_wakePending; };
+        if (nextUs < 0) {
+            m_wakeup.wait(lock, woken);
+        } else if (nextUs > steadyNowUs()) {
+            m_wakeup.wait_until(lock, toTimePoint(nextUs), woken);
+        }
+        if (!m_running) {
+            return;
+        }
+    }
+}
+
+std::int64_t VideoReceiver::runDue(std::int64_t nowUs)
+{
+    QImage held;
+    bool discontinuity = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_running) {
+            return -1;
+        }
+        m_wakePending = false;
+        m_decodeMetrics = m_metrics; // may be swapped while running
+        m_feedback.process(nowUs);
+        if (!m_heldFrame.isNull()) {
+            if (nowUs < m_heldUntilUs) {
+                return earliestUs(m_heldUntilUs, m_feedback.nextProcessUs());
+            }
+            held = std::move(m_heldFrame);
+            m_heldFrame = QImage();
+        } else if (!takeAccessUnit(nowUs, discontinuity)) {
+            // Wake for whichever comes first: a frame, a give-up, or a NACK retry.
+            return earliestUs(m_jitterBuffer.nextEventUs(), m_feedback.nextProcessUs());
+        }
+    }
+
+    if (!held.isNull()) {
+        present(held, m_heldTimestamp);
+    } else {
+        decodeAccessUnit(discontinuity);
+    }
+    // More may be due already; on a pool this lets other streams go first.
+    return nowUs;
+}
+
+bool VideoReceiver::takeAccessUnit(std::int64_t nowUs, bool &discontinuity)
+{
+    if (!m_jitterBuffer.popFrame(nowUs, m_frame)) {
+        return false;
+    }
+
+    // Depacketize while the lock is held: the packet views point into the ring.
+    discontinuity = m_frame.discontinuity;
+    if (discontinuity) {
+        m_depacketizer.reset();
+    }
+    m_unit.clear();
+    bool finished = false;
+    for (const auto &packet : m_frame.packets) {
+        finished = m_depacketizer.push(packet, m_unit);
+    }
+    if (!finished) {
+        m_depacketizer.flush(m_unit);
+    }
+    return true;
+}
+
+void VideoReceiver::requestKeyframe()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_feedback.requestKeyframe(steadyNowUs());
+}
+
+bool VideoReceiver::presentationDue(std::uint32_t rtpTimestamp, bool thumbnail) const
+{
+    if (!thumbnail || !m_presented) {
+        return true;
+    }
+    const auto elapsed = static_cast<std::int32_t>(rtpTimestamp - m_lastPresentedTimestamp);
+    return elapsed >= static_cast<std::int32_t>(kVideoClockRate / kThumbnailMaxFps) || elapsed < 0;
+}
+
+void VideoReceiver::decodeAccessUnit(bool discontinuity)
+{
+    if (!m_decoder) {
+        m_decoder = std::make_unique<H264Decoder>();
+    }
+    if (!m_decoder->isValid()) {
+        return;
+    }
+
+    if (discontinuity || !m_unit.complete) {
+        // Decoding past lost data would only propagate corruption through the references.
+        m_waitingForKeyframe = true;
+    }
+    if (!m_unit.complete || (m_waitingForKeyframe && !m_unit.keyframe)) {
+        // Rate limited inside, so asking on every unusable frame is fine.
+        requestKeyframe();
+        return;
+    }
+
+    const bool thumbnail = m_thumbnail.load(std::memory_order_relaxed);
+    if (thumbnail && !m_unit.referenced && !presentationDue(m_unit.rtpTimestamp, thumbnail)) {
+        // Nothing refers to it and it would not be shown.
+        return;
+    }
+
+    std::int64_t captureUs = 0;
+    if (m_latency && m_latency->isEnabled()
+        && findCaptureTimestamp(m_unit.data.data(), m_unit.data.size(), captureUs)) {
+        m_latency->onFrameCaptured(m_unit.rtpTimestamp, captureUs);
+    }
+
+    const std::int64_t decodeStartUs = steadyNowUs();
+    const auto result = m_decoder->decode(m_unit.data.data(), m_unit.data.size(), m_unit.rtpTimestamp, m_decoded);
+    if (m_decodeMetrics) {
+        m_decodeMetrics->record(MetricTimer::Decode, steadyNowUs() - decodeStartUs);
+    }
+    if (result == H264Decoder::Result::Error) {
+        if (m_decodeMetrics) {
+            m_decodeMetrics->increment(MetricCounter::DecodeErrors);
+        }
+        m_waitingForKeyframe = true;
+        requestKeyframe();
+        return;
+    }
+    if (m_waitingForKeyframe) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_feedback.onKeyframe(steadyNowUs());
+    }
+    m_waitingForKeyframe = false;
+    if (result != H264Decoder::Result::Frame) {
+        return;
+    }
+    if (m_decodeMetrics) {
+        m_decodeMetrics->increment(MetricCounter::FramesDecoded);
+    }
+    if (!presentationDue(m_decoded.rtpTimestamp, thumbnail)) {
+        // Decoded for the pictures that refer to it; not shown.
+        return;
+    }
+
+    if (m_avSync) {
+        const auto lead = m_avSync->videoLeadUs(m_decoded.rtpTimestamp, steadyNowUs());
+        if (lead && *lead > 0) {
+            // Early against the audio: convert now, present when due.
+            m_avSync->onVideoHeld();
+            QImage image = convertFrame(m_decoded, thumbnail);
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_heldFrame = std::move(image);
+            m_heldTimestamp = m_decoded.rtpTimestamp;
+            m_heldUntilUs = steadyNowUs() + std::min(*lead, kMaxSyncHoldUs);
+            return;
+        }
+        if (lead && *lead < -kSyncLateToleranceUs) {
+            // Only skip when that actually catches up, i.e. a newer frame is
+            // waiting; otherwise a constantly late stream would show nothing.
+            std::lock_guard<std::mutex> lock(m_mutex);
+            const std::int64_t next = m_jitterBuffer.nextEventUs();
+            if (next >= 0 && next <= steadyNowUs()) {
+                m_avSync->onVideoDropped();
+                return;
+            }
+        }
+    }
+
+    present(convertFrame(m_decoded, thumbnail), m_decoded.rtpTimestamp);
+}
+
+QImage VideoReceiver::convertFrame(const I420FrameView &frame, bool thumbnail)
+{
+    // Convert straight into a pooled buffer; it returns to the pool once
+    // the last receiver drops its copy of the image.
+    const std::int64_t convertStartUs = steadyNowUs();
+    const I420FrameView source = thumbnail ? downscaleI420(frame, kThumbnailDownscale, m_thumbnailPlanes) : frame;
+    QImage image = m_framePool.acquire(source.width, source.height);
+    convertI420ToRgb32(source, image);
+    if (m_decodeMetrics) {
+        m_decodeMetrics->record(MetricTimer::Convert, steadyNowUs() - convertStartUs);
+    }
+    return image;
+}
+
+void VideoReceiver::present(const QImage &image, std::uint32_t rtpTimestamp)
+{
+    m_presented = true;
+    m_lastPresentedTimestamp = rtpTimestamp;
+    if (m_onFrame) {
+        m_onFrame(image, rtpTimestamp);
+    }
+    if (m_avSync) {
+        m_avSync->onVideoPresented(rtpTimestamp, steadyNowUs());
+    }
+}
+
+} // namespace controller
@@ -0,0 +1,181 @@
+#include "controller/VideoSurface.h"
+
+#include <QElapsedTimer>
+#include <QPaintEvent>
+#include <QPainter>
+#include <QRegion>
+#include <QResizeEvent>
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace controller {
+
+namespace {
+// Fit factors this close to a whole number are snapped to it so the frame is
+// replicated exactly instead of resampled.
+constexpr double kIntegerScaleTolerance = 0.02;
+} // namespace
+
+VideoSurface::VideoSurface(QWidget *parent)
+    : QWidget(parent)
+{
+    // Every pixel is painted by us (frame or border), so skip background erasing.
+    setAttribute(Qt::WA_OpaquePaintEvent);
+    setAttribute(Qt::WA_NoSystemBackground);
+    setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
+    setMinimumSize(640, 360);
+}
+
+VideoSurface::~VideoSurface() = default;
+
+void VideoSurface::setScaleMode(ScaleMode mode)
+{
+    if (m_scaleMode == mode) {
+        return;
+    }
+    m_scaleMode = mode;
+    updateTargetRect();
+    update();
+}
+
+VideoSurface::ScaleMode VideoSurface::scaleMode() const
+{
+    return m_scaleMode;
+}
+
+void VideoSurface::setPlaceholderText(const QString &text)
+{
+    m_placeholderText = text;
+    if (m_frame.isNull()) {
+        update();
+    }
+}
+
+void VideoSurface::clear()
+{
+    m_frame = QImage();
+    m_frameSize = QSize();
+    m_framePending = false;
+    update();
+}
+
+quint64 VideoSurface::framesPresented() const
+{
+    return m_framesPresented;
+}
+
+quint64 VideoSurface::framesDropped() const
+{
+    return m_framesDropped;
+}
+
+void VideoSurface::setMetrics(std::shared_ptr<MetricsRegistry> metrics)
+{
+    m_metrics = std::move(metrics);
+}
+
+void VideoSurface::presentFrame(const QImage &frame)
+{
+    if (frame.isNull()) {
+        return;
+    }
+
+    if (m_framePending) {
+        ++m_framesDropped;
+        if (m_metrics) {
+            m_metrics->increment(MetricCounter::FramesReplaced);
+        }
+    }
+    // Replacing the image releases the previous frame back to its pool.
+    m_frame = frame;
+    m_framePending = true;
+
+    if (frame.size() != m_frameSize) {
+        m_frameSize = frame.size();
+        updateTargetRect();
+        update();
+    } else {
+        update(m_targetRect);
+    }
+}
+
+void VideoSurface::resizeEvent(QResizeEvent *event)
+{
+    QWidget::resizeEvent(event);
+    updateTargetRect();
+}
+
+void VideoSurface::updateTargetRect()
+{
+    const QRect bounds = rect();
+    if (m_frameSize.isEmpty() || bounds.isEmpty()) {
+        m_targetRect = bounds;
+        m_smooth = false;
+        return;
+    }
+
+    QSize target = m_frameSize;
+    if (m_scaleMode != ScaleMode::Native) {
+        double scale = std::min(static_cast<double>(bounds.width()) / m_frameSize.width(),
+                                static_cast<double>(bounds.height()) / m_frameSize.height());
+        const double whole = std::round(scale);
+        const bool integerScale = whole >= 1.0 && std::abs(scale - whole) <= kIntegerScaleTolerance * whole
+                                  && m_frameSize.width() * whole <= bounds.width()
+                                  && m_frameSize.height() * whole <= bounds.height();
+        if (integerScale) {
+            scale = whole;
+        }
+        target = QSize(static_cast<int>(m_frameSize.width() * scale), static_cast<int>(m_frameSize.height() * scale));
+        m_smooth = m_scaleMode == ScaleMode::FitSmooth && !integerScale;
+    } else {
+        m_smooth = false;
+    }
+
+    m_targetRect = QRect(QPoint(0, 0), target);
+    m_targetRect.moveCenter(bounds.center());
+}
+
+void VideoSurface::paintEvent(QPaintEvent *event)
+{
+    QPainter painter(this);
+
+    if (m_frame.isNull()) {
+        painter.fillRect(rect(), Qt::black);
+        if (!m_placeholderText.isEmpty()) {
+            painter.setPen(Qt::gray);
+            painter.drawText(rect(), Qt::AlignCenter, m_placeholderText);
+        }
+        return;
+    }
+
+    QElapsedTimer paintTimer;
+    paintTimer.start();
+
+    // Letterbox bars only; the frame covers the rest.
+    const QRegion borders = QRegion(event->rect()).subtracted(QRegion(m_targetRect));
+    for (const QRect &border : borders) {
+        painter.fillRect(border, Qt::black);
+    }
+
+    if (m_targetRect.size() == m_frame.size()) {
+        painter.drawImage(m_targetRect.topLeft(), m_frame);
+    } else {
+        painter.setRenderHint(QPainter::SmoothPixmapTransform, m_smooth);
+        painter.drawImage(m_targetRect, m_frame);
+    }
+
+    if (m_metrics) {
+        m_metrics->record(MetricTimer::Render, paintTimer.nsecsElapsed() / 1000);
+    }
+    if (m_framePending) {
+        m_framePending = false;
+        ++m_framesPresented;
+        if (m_metrics) {
+            m_metrics->increment(MetricCounter::FramesRendered);
+        }
+    }
+}
+
+} // namespace controller
@@ -1,8 +1,15 @@
 #include "controller/WebRtcPeer.h"
 
 #include "common/Protocol.h"
+#include "controller/AudioOutput.h"
+#include "controller/AudioReceiver.h"
+#include "controller/VideoReceiver.h"
 
+#include <QFile>
+
+#include <chrono>
 #include <cstdint>
+#include <functional>
 #include <optional>
 #include <ostream>
 #include <sstream>
@@ -13,6 +20,29 @@
 
 namespace {
 
+constexpr auto kVideoMid = "video";
+constexpr int kH264PayloadType = 96;
+constexpr auto kAudioMid = "audio";
+constexpr int kOpusPayloadType = 111;
+// Decoded audio the ring can hold: far more than the playout target, so the
+// decode thread never has to wait for the device.
+constexpr std::size_t kAudioRingSamples = 48000 / 5 * 2; // 200 ms stereo
+// NACK retry spacing and the jitter buffer's retransmission wait follow the RTT.
+constexpr int kRttPollIntervalMs = 1000;
+// Input messages are a few bytes each, so anything beyond this much queued in
+// SCTP means the link is congested and more motion would only add lag.
+constexpr std::size_t kInputBufferHighWater = 8 * 1024;
+constexpr std::size_t kInputBufferLowWater = 1024;
+// A simulated input link holds what SCTP would otherwise have buffered;
+// well above the high water mark, so the throttle acts first.
+constexpr std::size_t kInputLinkMaxQueuedBytes = 64 * 1024;
+
+std::int64_t steadyNowUs()
+{
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
 template <typename> struct AlwaysFalse : std::false_type {};
 
 template <typename T, typename = void>
@@ -243,13 +273,89 @@ CandidateT makeCandidate(const QString &candidate, const QString &sdpMid, int sd
     }
 }
 
+template <typename T, typename = void>
+struct HasMaxRetransmitsField : std::false_type {};
+
+template <typename T>
+struct HasMaxRetransmitsField<T, std::void_t<decltype(std::declval<T &>().maxRetransmits)>> : std::true_type {};
+
+template <typename T, typename = void>
+struct HasRttMethod : std::false_type {};
+
+template <typename T>
+struct HasRttMethod<T, std::void_t<decltype(std::declval<T &>().rtt())>> : std::true_type {};
+
+// Round-trip time as measured by SCTP, when this libdatachannel exposes it.
+template <typename PeerConnectionT>
+std::optional<std::int64_t> peerRttUs(PeerConnectionT &peerConnection)
+{
+    if constexpr (HasRttMethod<PeerConnectionT>::value) {
+        if (const auto rtt = peerConnection.rtt()) {
+            return std::chrono::duration_cast<std::chrono::microseconds>(*rtt).count();
+        }
+    }
+    return std::nullopt;
+}
+
+// Fire-and-forget delivery: unordered, never retransmitted.
+template <typename ReliabilityT>
+void makeUnreliable(ReliabilityT &reliability)
+{
+    reliability.unordered = true;
+    if constexpr (HasMaxRetransmitsField<ReliabilityT>::value) {
+        reliability.maxRetransmits = 0;
+    } else {
+        reliability.type = ReliabilityT::Type::Rexmit;
+        reliability.rexmit = 0;
+    }
+}
+
+// Hands received packets to `receiver`, through `link` when the path is impaired.
+template <typename Receiver>
+std::function<void(rtc::binary)> rtpHandler(std::weak_ptr<Receiver> receiver,
+                                             std::shared_ptr<controller::ImpairedLink> link)
+{
+    return [receiver = std::move(receiver), link = std::move(link)](rtc::binary message) {
+        const auto deliver = [receiver](const rtc::binary &packet) {
+            if (auto target = receiver.lock()) {
+                target->handleRtpPacket(packet.data(), packet.size());
+            }
+        };
+        if (!link) {
+            deliver(message);
+            return;
+        }
+        const std::size_t size = message.size();
+        link->push(size, [deliver, message = std::move(message)]() { deliver(message); });
+    };
+}
+
 } // namespace
 
 namespace controller {
 
 WebRtcPeer::WebRtcPeer(QObject *parent)
     : QObject(parent)
+    , m_inputScheduler(new InputScheduler(this))
+    , m_audioRing(std::make_shared<PcmRingBuffer>(kAudioRingSamples))
+    , m_audioOutput(new AudioOutput(m_audioRing, this))
+    , m_rttTimer(new QTimer(this))
+    , m_latency(std::make_shared<LatencyMonitor>())
+    , m_probeTimer(new QTimer(this))
+    , m_reconnectTimer(new QTimer(this))
 {
+    m_rttTimer->setInterval(kRttPollIntervalMs);
+    connect(m_rttTimer, &QTimer::timeout, this, &WebRtcPeer::pollRoundTripTime);
+    m_probeTimer->setInterval(kDefaultProbeIntervalMs);
+    connect(m_probeTimer, &QTimer::timeout, this, &WebRtcPeer::sendLatencyProbe);
+    // Fires after the disconnect grace period, or when a rebuilt transport
+    // has not connected in time.
+    m_reconnectTimer->setSingleShot(true);
+    connect(m_reconnectTimer, &QTimer::timeout, this, &WebRtcPeer::reconnectTransport);
+
+    m_inputScheduler->setSink([this](const Protocol::InputEvent *events, std::size_t count) {
+        return transmitInput(events, count);
+    });
 }
 
 WebRtcPeer::~WebRtcPeer()
@@ -262,7 +368,103 @@ void WebRtcPeer::setIceServers(const std::vector<IceServer> &servers)
     m_iceServers = servers;
 }
 
+void WebRtcPeer::setMetrics(std::shared_ptr<MetricsRegistry> metrics)
+{
+    m_metrics = std::move(metrics);
+    if (m_videoReceiver) {
+        m_videoReceiver->setMetrics(m_metrics);
+    }
+}
+
+void WebRtcPeer::setDecodePool(std::shared_ptr<DecodeWorkerPool> pool)
+{
+    m_decodePool = std::move(pool);
+}
+
+void WebRtcPeer::setVideoThumbnail(bool thumbnail)
+{
+    m_videoThumbnail = thumbnail;
+    if (m_videoReceiver) {
+        m_videoReceiver->setThumbnail(thumbnail);
+    }
+}
+
+void WebRtcPeer::setNetworkImpairment(const std::optional<ImpairmentProfile> &profile)
+{
+    m_impairment = profile;
+}
+
+NetworkImpairmentStats WebRtcPeer::networkImpairmentStats() const
+{
+    NetworkImpairmentStats stats;
+    stats.video = m_videoLink ? m_videoLink->stats() : ImpairmentStats();
+    stats.audio = m_audioLink ? m_audioLink->stats() : ImpairmentStats();
+    stats.input = m_inputLink ? m_inputLink->stats() : ImpairmentStats();
+    stats.motion = m_motionLink ? m_motionLink->stats() : ImpairmentStats();
+    return stats;
+}
+
+void WebRtcPeer::startImpairment()
+{
+    if (!m_impairment) {
+        return;
+    }
+    // One seed per path, so each stays reproducible whatever the others carry.
+    const std::uint64_t seed = m_impairment->seed;
+    m_videoLink = std::make_shared<ImpairedLink>(m_impairment->media, seed);
+    m_audioLink = std::make_shared<ImpairedLink>(m_impairment->media, seed + 1);
+    m_inputLink = std::make_shared<ImpairedLink>(m_impairment->input, seed + 2, true, kInputLinkMaxQueuedBytes);
+    m_motionLink = std::make_shared<ImpairedLink>(m_impairment->input, seed + 3, false, kInputLinkMaxQueuedBytes);
+    // The link queue stands in front of SCTP, so it lifts the throttle too.
+    m_inputLink->onQueuedBytesLow(kInputBufferLowWater, [this]() {
+        QMetaObject::invokeMethod(this, [this]() { releaseInputThrottle(); }, Qt::QueuedConnection);
+    });
+    for (const auto &link : {m_videoLink, m_audioLink, m_inputLink, m_motionLink}) {
+        link->start();
+    }
+}
+
+void WebRtcPeer::stopImpairment()
+{
+    for (auto *link : {&m_videoLink, &m_audioLink, &m_inputLink, &m_motionLink}) {
+        if (*link) {
+            (*link)->stop();
+            link->reset();
+        }
+    }
+}
+
 void WebRtcPeer::createPeer()
+{
+    m_videoReceiver = std::make_shared<VideoReceiver>([this](const QImage &frame, std::uint32_t rtpTimestamp) {
+        postDecodedFrame(frame, rtpTimestamp);
+    });
+    m_avSync = std::make_shared<AvSync>();
+    m_videoReceiver->setAvSync(m_avSync);
+    m_videoReceiver->setMetrics(m_metrics);
+    m_videoReceiver->setLatencyMonitor(m_latency);
+    m_videoReceiver->setDecodePool(m_decodePool);
+    m_videoReceiver->setThumbnail(m_videoThumbnail);
+    m_videoReceiver->start();
+
+    m_audioReceiver = std::make_shared<AudioReceiver>(m_audioRing);
+    m_audioReceiver->setPlayoutBufferMs(m_audioPlayoutBufferMs);
+    m_audioReceiver->setOutputLatencyMs(m_audioOutput->bufferDurationMs());
+    m_audioReceiver->setAvSync(m_avSync);
+    m_audioReceiver->setMuted(m_audioMuted);
+    m_audioReceiver->start();
+    // The sink opens the audio device; that waits until the transport is up,
+    // so pre-warmed peers stay silent and hold no device.
+    startImpairment();
+
+    m_reconnectAttempt = 0;
+    m_outageStartUs = -1;
+    m_reconnectStats = ReconnectStats();
+    openTransport();
+    m_rttTimer->start();
+}
+
+void WebRtcPeer::openTransport()
 {
     rtc::Configuration config;
     for (const auto &server : m_iceServers) {
@@ -270,24 +472,39 @@ void WebRtcPeer::createPeer()
         config.iceServers.emplace_back(makeIceServer<IceServerType>(server.urls, server.username, server.credential));
     }
 
+    const std::uint64_t generation = ++m_transportGeneration;
     m_peerConnection = std::make_shared<rtc::PeerConnection>(config);
 
-    m_peerConnection->onLocalDescription([this](const rtc::Description &description) {
+    // Both go through the GUI thread, in order, so a held offer and its
+    // candidates can be released together.
+    m_peerConnection->onLocalDescription([this, generation](const rtc::Description &description) {
         const auto type = QString::fromStdString(description.typeString());
         const auto sdp = descriptionSdp(description);
-        emit localDescriptionReady(type, sdp);
+        QMetaObject::invokeMethod(
+            this, [this, type, sdp, generation]() { onLocalDescription(type, sdp, generation); },
+            Qt::QueuedConnection);
     });
 
-    m_peerConnection->onLocalCandidate([this](const rtc::Candidate &candidate) {
+    m_peerConnection->onLocalCandidate([this, generation](const rtc::Candidate &candidate) {
         const auto candidateSdp = QString::fromStdString(candidate.candidate());
         const auto midOpt = candidateMid(candidate);
         const auto mlineOpt = candidateMLineIndex(candidate);
         const QString sdpMid = midOpt ? QString::fromStdString(*midOpt) : QString();
         const int mline = mlineOpt.value_or(-1);
-        emit localIceCandidate(candidateSdp, sdpMid, mline);
+        QMetaObject::invokeMethod(
+            this, [this, candidateSdp, sdpMid, mline, generation]() {
+                onLocalCandidate(candidateSdp, sdpMid, mline, generation);
+            },
+            Qt::QueuedConnection);
     });
 
-    m_peerConnection->onStateChange([this](rtc::PeerConnection::State state) {
+    m_peerConnection->onStateChange([this, generation](rtc::PeerConnection::State state) {
+        if (generation != m_transportGeneration.load()) {
+            return; // a transport we already replaced, closing down
+        }
+        QMetaObject::invokeMethod(
+            this, [this, state, generation]() { onTransportStateChanged(state, generation); }, Qt::QueuedConnection);
+
         QString text;
         switch (state) {
         case rtc::PeerConnection::State::New:
@@ -312,27 +529,83 @@ void WebRtcPeer::createPeer()
         emit stateChanged(text);
     });
 
-    m_peerConnection->onGatheringStateChange([this](rtc::PeerConnection::GatheringState state) {
+    m_peerConnection->onGatheringStateChange([this, generation](rtc::PeerConnection::GatheringState state) {
         if (state == rtc::PeerConnection::GatheringState::Complete) {
             emit stateChanged(QStringLiteral("ice-complete"));
+            QMetaObject::invokeMethod(
+                this, [this, generation]() { onLocalGatheringComplete(generation); }, Qt::QueuedConnection);
         }
     });
 
     m_peerConnection->onTrack([this](std::shared_ptr<rtc::Track> track) {
+        if (track->description().type() == kVideoMid) {
+            bindVideoTrack(track);
+        } else if (track->description().type() == kAudioMid) {
+            bindAudioTrack(track);
+        }
         m_tracks.push_back(std::move(track));
     });
 
-    m_inputChannel = m_peerConnection->createDataChannel(Protocol::kInputChannelName);
+    // Offer the binary input format through the channel protocol; the host
+    // opts in by answering with a HelloAck.
+    m_binaryInput.store(false);
+    rtc::DataChannelInit inputInit;
+    inputInit.protocol = Protocol::kInputBinaryProtocol;
+    m_inputChannel = m_peerConnection->createDataChannel(Protocol::kInputChannelName, inputInit);
+    bindInputChannel();
+
+    // Pointer motion gets its own channel so that a lost (and by then stale)
+    // move is never retransmitted ahead of the clicks and keys behind it.
+    rtc::DataChannelInit motionInit;
+    motionInit.protocol = Protocol::kInputBinaryProtocol;
+    makeUnreliable(motionInit.reliability);
+    m_motionChannel = m_peerConnection->createDataChannel(Protocol::kInputMotionChannelName, motionInit);
+    m_motionSequence = 0;
+    m_motionDropped = 0;
 
     attachMediaHandlers();
 }
 
 void WebRtcPeer::closePeer()
 {
+    m_rttTimer->stop();
+    m_rttUs = 0;
+    m_reconnectTimer->stop();
+    m_reconnectStats.reconnecting = false;
+    m_holdSignalling = false;
+    m_connectStartUs = -1;
+    m_firstFrameUs = -1;
+    closeTransport();
+    stopImpairment();
+
+    if (m_videoReceiver) {
+        m_videoReceiver->stop();
+        m_videoReceiver.reset();
+    }
+    m_audioOutput->stop();
+    if (m_audioReceiver) {
+        m_audioReceiver->stop();
+        m_audioReceiver.reset();
+    }
+    m_avSync.reset();
+    // The decode thread is gone; hand the pooled buffers back.
+    m_frameMailbox.clear();
+}
+
+void WebRtcPeer::closeTransport()
+{
+    // Anything the old PeerConnection still reports is stale from here on.
+    ++m_transportGeneration;
+    m_inputScheduler->clear();
+    m_binaryInput.store(false);
     if (m_inputChannel) {
         m_inputChannel->close();
         m_inputChannel.reset();
     }
+    if (m_motionChannel) {
+        m_motionChannel->close();
+        m_motionChannel.reset();
+    }
 
     if (m_peerConnection) {
         m_peerConnection->close();
@@ -340,6 +613,114 @@ void WebRtcPeer::closePeer()
     }
 
     m_tracks.clear();
+    m_videoTrack.reset();
+    m_audioTrack.reset();
+    m_heldOffer.reset();
+    m_heldCandidates.clear();
+    m_heldGatheringComplete = false;
+    m_remoteDescriptionSet = false;
+    m_pendingRemoteCandidates.clear();
+    m_transportConnected = false;
+}
+
+void WebRtcPeer::setAutoReconnect(bool enabled)
+{
+    m_autoReconnect = enabled;
+    if (!enabled) {
+        m_reconnectTimer->stop();
+    }
+}
+
+bool WebRtcPeer::autoReconnect() const
+{
+    return m_autoReconnect;
+}
+
+void WebRtcPeer::restartTransport()
+{
+    m_reconnectAttempt = 0;
+    reconnectTransport();
+}
+
+ReconnectStats WebRtcPeer::reconnectStats() const
+{
+    return m_reconnectStats;
+}
+
+void WebRtcPeer::onTransportStateChanged(rtc::PeerConnection::State state, std::uint64_t generation)
+{
+    if (generation != m_transportGeneration.load()) {
+        return;
+    }
+
+    switch (state) {
+    case rtc::PeerConnection::State::Connected:
+        m_reconnectTimer->stop();
+        m_transportConnected = true;
+        if (!m_audioMuted) {
+            m_audioOutput->start();
+        }
+        if (m_outageStartUs >= 0) {
+            const double outageMs = (steadyNowUs() - m_outageStartUs) / 1000.0;
+            m_outageStartUs = -1;
+            m_reconnectAttempt = 0;
+            ++m_reconnectStats.reconnects;
+            m_reconnectStats.lastOutageMs = outageMs;
+            m_reconnectStats.reconnecting = false;
+            emit reconnected(outageMs);
+        }
+        break;
+    case rtc::PeerConnection::State::Disconnected:
+        // ICE often recovers on its own from a short outage; give it a moment
+        // before throwing the transport away.
+        if (m_outageStartUs < 0) {
+            m_outageStartUs = steadyNowUs();
+        }
+        if (m_autoReconnect && !m_reconnectTimer->isActive()) {
+            m_reconnectTimer->start(kDisconnectGraceMs);
+        }
+        break;
+    case rtc::PeerConnection::State::Failed:
+        if (m_outageStartUs < 0) {
+            m_outageStartUs = steadyNowUs();
+        }
+        if (m_autoReconnect) {
+            m_reconnectTimer->stop();
+            reconnectTransport();
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+void WebRtcPeer::reconnectTransport()
+{
+    if (!m_videoReceiver) {
+        return; // no session to keep alive
+    }
+    if (m_reconnectAttempt >= kMaxReconnectAttempts) {
+        m_reconnectStats.reconnecting = false;
+        m_outageStartUs = -1;
+        emit reconnectFailed();
+        return;
+    }
+    ++m_reconnectAttempt;
+    ++m_reconnectStats.attempts;
+    m_reconnectStats.reconnecting = true;
+    if (m_outageStartUs < 0) {
+        m_outageStartUs = steadyNowUs();
+    }
+    emit reconnecting(m_reconnectAttempt);
+
+    // libdatachannel cannot restart ICE on a live PeerConnection, so the
+    // transport is rebuilt while the media pipeline keeps its state. Video
+    // drops what was in flight and asks for a keyframe once packets flow.
+    closeTransport();
+    m_videoReceiver->onTransportRestarted();
+    openTransport();
+    createOffer();
+    m_reconnectTimer->start(kReconnectTimeoutMs);
 }
 
 void WebRtcPeer::createOffer()
@@ -347,10 +728,97 @@ void WebRtcPeer::createOffer()
     if (!m_peerConnection) {
         return;
     }
+    if (!m_holdSignalling && m_connectStartUs < 0) {
+        m_connectStartUs = steadyNowUs();
+    }
 
     m_peerConnection->setLocalDescription();
 }
 
+void WebRtcPeer::prewarm()
+{
+    if (m_peerConnection) {
+        return;
+    }
+    m_holdSignalling = true;
+    createPeer();
+    createOffer();
+}
+
+void WebRtcPeer::sendOffer()
+{
+    m_connectStartUs = steadyNowUs();
+    if (!m_peerConnection) {
+        createPeer();
+        createOffer();
+        return;
+    }
+
+    m_holdSignalling = false;
+    if (m_heldOffer) {
+        emit localDescriptionReady(m_heldOffer->first, m_heldOffer->second);
+        m_heldOffer.reset();
+    }
+    for (const IceCandidate &held : m_heldCandidates) {
+        emit localIceCandidate(held.candidate, held.sdpMid, held.sdpMLineIndex);
+    }
+    m_heldCandidates.clear();
+    if (m_heldGatheringComplete) {
+        m_heldGatheringComplete = false;
+        emit localIceGatheringComplete();
+    }
+}
+
+bool WebRtcPeer::offerReady() const
+{
+    return m_heldOffer.has_value();
+}
+
+double WebRtcPeer::timeToFirstFrameMs() const
+{
+    if (m_connectStartUs < 0 || m_firstFrameUs < 0) {
+        return 0.0;
+    }
+    return (m_firstFrameUs - m_connectStartUs) / 1000.0;
+}
+
+void WebRtcPeer::onLocalDescription(const QString &type, const QString &sdp, std::uint64_t generation)
+{
+    if (generation != m_transportGeneration.load()) {
+        return;
+    }
+    if (m_holdSignalling) {
+        m_heldOffer = std::make_pair(type, sdp);
+        return;
+    }
+    emit localDescriptionReady(type, sdp);
+}
+
+void WebRtcPeer::onLocalCandidate(const QString &candidate, const QString &sdpMid, int sdpMLineIndex,
+                                  std::uint64_t generation)
+{
+    if (generation != m_transportGeneration.load()) {
+        return;
+    }
+    if (m_holdSignalling) {
+        m_heldCandidates.push_back(IceCandidate{candidate, sdpMid, sdpMLineIndex});
+        return;
+    }
+    emit localIceCandidate(candidate, sdpMid, sdpMLineIndex);
+}
+
+void WebRtcPeer::onLocalGatheringComplete(std::uint64_t generation)
+{
+    if (generation != m_transportGeneration.load()) {
+        return;
+    }
+    if (m_holdSignalling) {
+        m_heldGatheringComplete = true;
+        return;
+    }
+    emit localIceGatheringComplete();
+}
+
 void WebRtcPeer::setRemoteDescription(const QString &type, const QString &sdp)
 {
     if (!m_peerConnection) {
@@ -359,6 +827,16 @@ void WebRtcPeer::setRemoteDescription(const QString &type, const QString &sdp)
 
     rtc::Description description(sdp.toStdString(), type.toStdString());
     m_peerConnection->setRemoteDescription(description);
+    m_remoteDescriptionSet = true;
+
+    // libdatachannel rejects candidates without a remote description; the
+    // ones that raced ahead of the answer go in now, together.
+    using CandidateType = rtc::Candidate;
+    for (const IceCandidate &pending : m_pendingRemoteCandidates) {
+        m_peerConnection->addRemoteCandidate(
+            makeCandidate<CandidateType>(pending.candidate, pending.sdpMid, pending.sdpMLineIndex));
+    }
+    m_pendingRemoteCandidates.clear();
 }
 
 void WebRtcPeer::addRemoteIceCandidate(const QString &candidate, const QString &sdpMid, int sdpMLineIndex)
@@ -366,22 +844,498 @@ void WebRtcPeer::addRemoteIceCandidate(const QString &candidate, const QString &
     if (!m_peerConnection) {
         return;
     }
+    if (!m_remoteDescriptionSet) {
+        m_pendingRemoteCandidates.push_back(IceCandidate{candidate, sdpMid, sdpMLineIndex});
+        return;
+    }
 
     using CandidateType = rtc::Candidate;
     auto iceCandidate = makeCandidate<CandidateType>(candidate, sdpMid, sdpMLineIndex);
     m_peerConnection->addRemoteCandidate(iceCandidate);
 }
 
+void WebRtcPeer::addRemoteIceCandidates(const std::vector<IceCandidate> &candidates)
+{
+    if (!m_peerConnection) {
+        return;
+    }
+    if (!m_remoteDescriptionSet) {
+        m_pendingRemoteCandidates.insert(m_pendingRemoteCandidates.end(), candidates.begin(), candidates.end());
+        return;
+    }
+
+    using CandidateType = rtc::Candidate;
+    for (const IceCandidate &candidate : candidates) {
+        m_peerConnection->addRemoteCandidate(
+            makeCandidate<CandidateType>(candidate.candidate, candidate.sdpMid, candidate.sdpMLineIndex));
+    }
+}
+
 void WebRtcPeer::sendInputEvent(const QByteArray &payload)
 {
     if (m_inputChannel && m_inputChannel->isOpen()) {
-        m_inputChannel->send(std::string(payload.constData(), static_cast<std::size_t>(payload.size())));
+        sendChannelText(m_inputChannel, m_inputLink,
+                        std::string(payload.constData(), static_cast<std::size_t>(payload.size())));
+    }
+}
+
+void WebRtcPeer::sendInput(const Protocol::InputEvent &event)
+{
+    if (!m_inputChannel || !m_inputChannel->isOpen()) {
+        return;
+    }
+    m_inputScheduler->submit(event);
+}
+
+std::size_t WebRtcPeer::transmitInput(const Protocol::InputEvent *events, std::size_t count)
+{
+    if (!m_inputChannel || !m_inputChannel->isOpen()) {
+        return 0;
+    }
+
+    std::size_t messages = 0;
+    const Protocol::InputEvent *sentMove = nullptr; // already out on the motion channel
+    if (m_binaryInput.load(std::memory_order_relaxed)) {
+        // Moves are absolute, so only the newest one in the batch matters and
+        // it can take the unreliable channel; the rest stays reliable.
+        const bool useMotionChannel = m_motionChannel && m_motionChannel->isOpen();
+        Protocol::InputEvent reliable[Protocol::kMaxInputBatchEvents];
+        std::size_t reliableCount = 0;
+        const Protocol::InputEvent *latestMove = nullptr;
+        for (std::size_t i = 0; i < count; ++i) {
+            if (useMotionChannel && events[i].type == Protocol::InputEventType::MouseMove) {
+                latestMove = &events[i];
+            } else {
+                reliable[reliableCount++] = events[i];
+            }
+        }
+
+        if (latestMove && sendMotion(*latestMove)) {
+            sentMove = latestMove;
+            ++messages;
+        }
+        if (reliableCount == 0) {
+            return messages;
+        }
+
+        std::uint8_t buffer[Protocol::kMaxInputBatchSize];
+        const std::size_t size = reliableCount == 1
+            ? Protocol::encodeInputEvent(reliable[0], buffer, sizeof(buffer))
+            : Protocol::encodeInputBatch(reliable, reliableCount, buffer, sizeof(buffer));
+        if (size > 0) {
+            sendChannelMessage(m_inputChannel, m_inputLink, buffer, size);
+            updateInputThrottle();
+            return messages + 1;
+        }
+    }
+
+    // The JSON format has no batch form; coalescing still applies. A move the
+    // motion channel already carried must not reach the host twice.
+    for (std::size_t i = 0; i < count; ++i) {
+        if (&events[i] == sentMove) {
+            continue;
+        }
+        sendInputEvent(Protocol::toJson(Protocol::makeInputPayload(events[i])));
+        ++messages;
+    }
+    updateInputThrottle();
+    return messages;
+}
+
+void WebRtcPeer::updateInputThrottle()
+{
+    // Hold motion back in the scheduler (where it coalesces) rather than let
+    // it pile up behind the congestion; onBufferedAmountLow lifts this again.
+    if (inputBufferedBytes() > kInputBufferHighWater) {
+        m_inputScheduler->setThrottled(true);
+    }
+}
+
+void WebRtcPeer::releaseInputThrottle()
+{
+    // Both the SCTP buffer and the link queue must have drained.
+    if (inputBufferedBytes() <= kInputBufferLowWater) {
+        m_inputScheduler->setThrottled(false);
+    }
+}
+
+std::size_t WebRtcPeer::inputBufferedBytes() const
+{
+    std::size_t bytes = m_inputChannel ? m_inputChannel->bufferedAmount() : 0;
+    if (m_inputLink) {
+        bytes += m_inputLink->queuedBytes();
+    }
+    return bytes;
+}
+
+std::size_t WebRtcPeer::motionBufferedBytes() const
+{
+    std::size_t bytes = m_motionChannel ? m_motionChannel->bufferedAmount() : 0;
+    if (m_motionLink) {
+        bytes += m_motionLink->queuedBytes();
+    }
+    return bytes;
+}
+
+bool WebRtcPeer::sendMotion(const Protocol::InputEvent &move)
+{
+    Protocol::InputEvent motion = move;
+    motion.type = Protocol::InputEventType::MotionMove;
+    motion.sequence = m_motionSequence++;
+
+    if (motionBufferedBytes() > kInputBufferHighWater) {
+        // A queued move is stale by the time it leaves; the next one replaces it.
+        ++m_motionDropped;
+        return false;
+    }
+
+    std::uint8_t buffer[Protocol::kMaxInputMessageSize];
+    const std::size_t size = Protocol::encodeInputEvent(motion, buffer, sizeof(buffer));
+    return size > 0 && sendChannelMessage(m_motionChannel, m_motionLink, buffer, size);
+}
+
+bool WebRtcPeer::sendChannelMessage(const std::shared_ptr<rtc::DataChannel> &channel,
+                                    const std::shared_ptr<ImpairedLink> &link, const std::uint8_t *data,
+                                    std::size_t size)
+{
+    const auto *bytes = reinterpret_cast<const std::byte *>(data);
+    if (!link) {
+        return channel->send(bytes, size);
+    }
+    // A full link queue refuses the message like a full send buffer would.
+    std::weak_ptr<rtc::DataChannel> weakChannel = channel;
+    return link->push(size, [weakChannel, message = rtc::binary(bytes, bytes + size)]() {
+        if (auto target = weakChannel.lock(); target && target->isOpen()) {
+            target->send(message.data(), message.size());
+        }
+    });
+}
+
+void WebRtcPeer::sendChannelText(const std::shared_ptr<rtc::DataChannel> &channel,
+                                 const std::shared_ptr<ImpairedLink> &link, std::string text)
+{
+    if (!link) {
+        channel->send(std::move(text));
+        return;
+    }
+    std::weak_ptr<rtc::DataChannel> weakChannel = channel;
+    const std::size_t size = text.size();
+    link->push(size, [weakChannel, text = std::move(text)]() {
+        if (auto target = weakChannel.lock(); target && target->isOpen()) {
+            target->send(text);
+        }
+    });
+}
+
+void WebRtcPeer::sendMouseMove(double x, double y)
+{
+    Protocol::InputEvent event;
+    event.type = Protocol::InputEventType::MouseMove;
+    event.x = x;
+    event.y = y;
+    sendInput(event);
+}
+
+void WebRtcPeer::sendMouseClick(double x, double y, int button)
+{
+    Protocol::InputEvent event;
+    event.type = Protocol::InputEventType::MouseClick;
+    event.x = x;
+    event.y = y;
+    event.button = button;
+    sendInput(event);
+}
+
+void WebRtcPeer::sendMouseWheel(double deltaY)
+{
+    Protocol::InputEvent event;
+    event.type = Protocol::InputEventType::MouseWheel;
+    event.deltaY = deltaY;
+    sendInput(event);
+}
+
+void WebRtcPeer::sendKey(const QString &code, bool down)
+{
+    Protocol::InputEvent event;
+    event.type = Protocol::InputEventType::Key;
+    event.keyCode = Protocol::keyCodeFromName(code);
+    event.keyDown = down;
+    if (event.keyCode == 0) {
+        // Not in the key table: only the JSON form can carry it. Send the
+        // pending motion first so the key still lands where the pointer is.
+        m_inputScheduler->flush();
+        sendInputEvent(Protocol::toJson(Protocol::makeKeyPayload(code, down ? QStringLiteral("down") : QStringLiteral("up"))));
+        return;
+    }
+    sendInput(event);
+}
+
+bool WebRtcPeer::binaryInputActive() const
+{
+    return m_binaryInput.load(std::memory_order_relaxed);
+}
+
+void WebRtcPeer::setInputFlushInterval(int intervalMs)
+{
+    m_inputScheduler->setFlushInterval(intervalMs);
+}
+
+void WebRtcPeer::setInputFlushRate(double refreshHz)
+{
+    m_inputScheduler->setFlushRate(refreshHz);
+}
+
+InputSchedulerStats WebRtcPeer::inputStats() const
+{
+    return m_inputScheduler->stats();
+}
+
+InputQueueStats WebRtcPeer::inputQueueStats() const
+{
+    InputQueueStats stats;
+    stats.pendingEvents = m_inputScheduler->pendingEvents();
+    stats.bufferedBytes = inputBufferedBytes();
+    stats.motionBufferedBytes = motionBufferedBytes();
+    stats.motionDropped = m_motionDropped;
+    stats.throttled = m_inputScheduler->isThrottled();
+    return stats;
+}
+
+void WebRtcPeer::bindInputChannel()
+{
+    m_inputChannel->setBufferedAmountLowThreshold(kInputBufferLowWater);
+    m_inputChannel->onBufferedAmountLow([this]() {
+        QMetaObject::invokeMethod(this, [this]() { releaseInputThrottle(); }, Qt::QueuedConnection);
+    });
+
+    m_inputChannel->onMessage(
+        [this, metrics = m_metrics](rtc::binary message) {
+            const auto *data = reinterpret_cast<const std::uint8_t *>(message.data());
+            Protocol::InputEventType probeType;
+            Protocol::LatencyProbe echo;
+            if (Protocol::decodeLatencyProbe(data, message.size(), probeType, echo)) {
+                if (probeType != Protocol::InputEventType::LatencyProbeEcho) {
+                    return;
+                }
+                const auto rttUs = m_latency->onProbeEcho(echo, steadyNowUs());
+                if (rttUs && metrics) {
+                    metrics->record(MetricTimer::InputRtt, *rttUs);
+                }
+                return;
+            }
+
+            Protocol::InputEvent event;
+            if (Protocol::decodeInputEvent(data, message.size(), event) > 0
+                && event.type == Protocol::InputEventType::HelloAck) {
+                m_binaryInput.store(true, std::memory_order_relaxed);
+            }
+        },
+        nullptr);
+}
+
+quint64 WebRtcPeer::framesOverwritten() const
+{
+    return m_frameMailbox.overwritten();
+}
+
+void WebRtcPeer::postDecodedFrame(const QImage &frame, std::uint32_t rtpTimestamp)
+{
+    // Decode thread.
+    DecodedFrame &slot = m_frameMailbox.back();
+    slot.image = frame;
+    slot.rtpTimestamp = rtpTimestamp;
+    m_frameMailbox.publish();
+    if (!m_frameDeliveryQueued.exchange(true, std::memory_order_acq_rel)) {
+        QMetaObject::invokeMethod(this, [this]() { deliverLatestFrame(); }, Qt::QueuedConnection);
     }
 }
 
+void WebRtcPeer::deliverLatestFrame()
+{
+    // GUI thread. Re-arm before taking so a frame published meanwhile queues a new delivery.
+    m_frameDeliveryQueued.store(false, std::memory_order_release);
+    if (!m_frameMailbox.take()) {
+        return;
+    }
+    const DecodedFrame &frame = m_frameMailbox.front();
+    if (m_firstFrameUs < 0) {
+        m_firstFrameUs = steadyNowUs();
+    }
+    if (m_latency->isEnabled()) {
+        const auto latencyUs = m_latency->onFramePresented(frame.rtpTimestamp, steadyNowUs());
+        if (latencyUs && m_metrics) {
+            m_metrics->record(MetricTimer::GlassToGlass, *latencyUs);
+        }
+    }
+    emit videoFrameReady(frame.image);
+}
+
+FramePoolStats WebRtcPeer::framePoolStats() const
+{
+    return m_videoReceiver ? m_videoReceiver->framePoolStats() : FramePoolStats();
+}
+
 void WebRtcPeer::attachMediaHandlers()
 {
-    // Placeholder for future video/audio rendering logic.
+    // We are the offerer, so the receive-only m-line has to come from our side.
+    rtc::Description::Video media(kVideoMid, rtc::Description::Direction::RecvOnly);
+    media.addH264Codec(kH264PayloadType);
+
+    auto track = m_peerConnection->addTrack(media);
+    bindVideoTrack(track);
+    m_tracks.push_back(std::move(track));
+
+    rtc::Description::Audio audio(kAudioMid, rtc::Description::Direction::RecvOnly);
+    audio.addOpusCodec(kOpusPayloadType);
+
+    auto audioTrack = m_peerConnection->addTrack(audio);
+    bindAudioTrack(audioTrack);
+    m_tracks.push_back(std::move(audioTrack));
+}
+
+void WebRtcPeer::bindAudioTrack(const std::shared_ptr<rtc::Track> &track)
+{
+    if (!track || !m_audioReceiver) {
+        return;
+    }
+
+    track->onMessage(rtpHandler(std::weak_ptr<AudioReceiver>(m_audioReceiver), m_audioLink), nullptr);
+    m_audioTrack = track;
+}
+
+void WebRtcPeer::setAudioBufferMs(int playoutMs, int deviceMs)
+{
+    m_audioPlayoutBufferMs = playoutMs;
+    if (m_audioReceiver) {
+        m_audioReceiver->setPlayoutBufferMs(playoutMs);
+    }
+    m_audioOutput->setBufferDurationMs(deviceMs);
+}
+
+void WebRtcPeer::setAudioMuted(bool muted)
+{
+    m_audioMuted = muted;
+    if (m_audioReceiver) {
+        m_audioReceiver->setMuted(muted);
+    }
+    if (muted) {
+        m_audioOutput->stop();
+    } else if (m_transportConnected) {
+        m_audioOutput->start();
+    }
+}
+
+AudioReceiverStats WebRtcPeer::audioStats() const
+{
+    return m_audioReceiver ? m_audioReceiver->stats() : AudioReceiverStats();
+}
+
+void WebRtcPeer::pollRoundTripTime()
+{
+    if (!m_peerConnection || !m_videoReceiver) {
+        return;
+    }
+    if (const auto rttUs = peerRttUs(*m_peerConnection)) {
+        m_rttUs = *rttUs;
+        m_videoReceiver->setRoundTripTimeUs(*rttUs);
+    }
+}
+
+RtcpFeedbackStats WebRtcPeer::videoFeedbackStats() const
+{
+    return m_videoReceiver ? m_videoReceiver->feedbackStats() : RtcpFeedbackStats();
+}
+
+void WebRtcPeer::setLatencyMeasurementEnabled(bool enabled, int probeIntervalMs)
+{
+    m_latency->setEnabled(enabled);
+    if (!enabled) {
+        m_probeTimer->stop();
+        return;
+    }
+    m_probeTimer->start(probeIntervalMs > 0 ? probeIntervalMs : kDefaultProbeIntervalMs);
+}
+
+bool WebRtcPeer::latencyMeasurementEnabled() const
+{
+    return m_latency->isEnabled();
+}
+
+LatencyReport WebRtcPeer::latencyReport() const
+{
+    return m_latency->report();
+}
+
+void WebRtcPeer::resetLatencyMeasurement()
+{
+    m_latency->reset();
+}
+
+bool WebRtcPeer::exportLatencyCsv(const QString &path) const
+{
+    std::ostringstream csv;
+    m_latency->writeCsv(csv);
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        return false;
+    }
+    const std::string text = csv.str();
+    return file.write(text.data(), static_cast<qint64>(text.size())) == static_cast<qint64>(text.size());
+}
+
+void WebRtcPeer::sendLatencyProbe()
+{
+    // Probes share the reliable channel with clicks and keys, so they measure
+    // what input actually experiences, including SCTP queueing.
+    if (!m_inputChannel || !m_inputChannel->isOpen() || !binaryInputActive()) {
+        return;
+    }
+    std::uint8_t buffer[Protocol::kMaxLatencyProbeSize];
+    const Protocol::LatencyProbe probe = m_latency->nextProbe(steadyNowUs());
+    const std::size_t size = Protocol::encodeLatencyProbe(Protocol::InputEventType::LatencyProbe, probe, buffer,
+                                                          sizeof(buffer));
+    if (size > 0) {
+        sendChannelMessage(m_inputChannel, m_inputLink, buffer, size);
+        updateInputThrottle();
+    }
+}
+
+JitterBufferStats WebRtcPeer::videoJitterStats() const
+{
+    return m_videoReceiver ? m_videoReceiver->jitterStats() : JitterBufferStats();
+}
+
+double WebRtcPeer::roundTripTimeMs() const
+{
+    return m_rttUs / 1000.0;
+}
+
+BandwidthEstimatorStats WebRtcPeer::videoBandwidthStats() const
+{
+    return m_videoReceiver ? m_videoReceiver->bandwidthStats() : BandwidthEstimatorStats();
+}
+
+AvSyncStats WebRtcPeer::avSyncStats() const
+{
+    return m_avSync ? m_avSync->stats() : AvSyncStats();
+}
+
+void WebRtcPeer::bindVideoTrack(const std::shared_ptr<rtc::Track> &track)
+{
+    if (!track || !m_videoReceiver) {
+        return;
+    }
+
+    track->onMessage(rtpHandler(std::weak_ptr<VideoReceiver>(m_videoReceiver), m_videoLink), nullptr);
+
+    // NACK/PLI go back as raw RTCP on the same (rtcp-mux) transport.
+    std::weak_ptr<rtc::Track> weakTrack = track;
+    m_videoReceiver->setFeedbackSender([weakTrack](const std::uint8_t *data, std::size_t size) {
+        if (auto videoTrack = weakTrack.lock(); videoTrack && videoTrack->isOpen()) {
+            videoTrack->send(reinterpret_cast<const std::byte *>(data), size);
+        }
+    });
+    m_videoTrack = track;
 }
 
 } // namespace controller
@@ -0,0 +1,351 @@
+// The audio receive path offline: an Opus stream is encoded, recorded to an
+// rtpdump file, read back with RtpDumpReader and played out through
+// AudioJitterBuffer and OpusAudioDecoder at a simulated device pace. No sound
+// device, no network.
+
+#include "controller/AudioJitterBuffer.h"
+#include "controller/OpusAudioDecoder.h"
+#include "controller/RtpDump.h"
+
+#include <QtTest>
+
+#include <opus/opus.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+using controller::AudioJitterBuffer;
+using controller::AudioJitterStats;
+using controller::AudioPacket;
+using controller::OpusAudioDecoder;
+using controller::RtpDumpPacket;
+using controller::RtpDumpReader;
+
+namespace {
+
+constexpr int kSampleRate = 48000;
+constexpr int kFrameSamples = 960; // 20 ms
+constexpr std::int64_t kFrameUs = 20000;
+constexpr std::uint32_t kSsrc = 0x51a7e011;
+
+void putBigEndian16(std::vector<std::uint8_t> &out, std::uint16_t value)
+{
+    out.push_back(static_cast<std::uint8_t>(value >> 8));
+    out.push_back(static_cast<std::uint8_t>(value));
+}
+
+void putBigEndian32(std::vector<std::uint8_t> &out, std::uint32_t value)
+{
+    putBigEndian16(out, static_cast<std::uint16_t>(value >> 16));
+    putBigEndian16(out, static_cast<std::uint16_t>(value));
+}
+
+std::vector<std::uint8_t> makeRtp(std::uint16_t sequence, std::uint32_t timestamp, const std::vector<std::uint8_t> &payload)
+{
+    std::vector<std::uint8_t> packet = {0x80, 111};
+    putBigEndian16(packet, sequence);
+    putBigEndian32(packet, timestamp);
+    putBigEndian32(packet, kSsrc);
+    packet.insert(packet.end(), payload.begin(), payload.end());
+    return packet;
+}
+
+// rtpdump as rtptools writes it: text line, 16-byte file header, then per
+// packet an 8-byte record header (length incl. header, packet length or 0
+// for RTCP, offset in ms).
+void writeRtpDump(const std::string &path, const std::vector<RtpDumpPacket> &packets)
+{
+    std::vector<std::uint8_t> out;
+    const std::string line = "#!rtpplay1.0 127.0.0.1/5004\n";
+    out.insert(out.end(), line.begin(), line.end());
+    out.resize(out.size() + 16, 0);
+    for (const RtpDumpPacket &packet : packets) {
+        putBigEndian16(out, static_cast<std::uint16_t>(packet.data.size() + 8));
+        putBigEndian16(out, packet.rtcp ? 0 : static_cast<std::uint16_t>(packet.data.size()));
+        putBigEndian32(out, packet.offsetMs);
+        out.insert(out.end(), packet.data.begin(), packet.data.end());
+    }
+    std::ofstream file(path, std::ios::binary);
+    file.write(reinterpret_cast<const char *>(out.data()), static_cast<std::streamsize>(out.size()));
+}
+
+std::string tempPath(const char *name)
+{
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+std::vector<RtpDumpPacket> readAll(const std::string &path)
+{
+    std::vector<RtpDumpPacket> packets;
+    RtpDumpReader reader;
+    if (!reader.open(path)) {
+        return packets;
+    }
+    RtpDumpPacket packet;
+    while (reader.readPacket(packet)) {
+        packets.push_back(packet);
+    }
+    return packets;
+}
+
+// A recording of `count` 20 ms packets whose payload is just its index,
+// arriving with up to `jitterMs` of jitter (in arrival order, as a capture
+// would have them) and without the packets in `lost`.
+std::vector<RtpDumpPacket> recordStream(int count, int jitterMs, const std::set<int> &lost)
+{
+    std::mt19937 random(11);
+    std::vector<RtpDumpPacket> packets;
+    for (int i = 0; i < count; ++i) {
+        if (lost.count(i) != 0) {
+            continue;
+        }
+        RtpDumpPacket packet;
+        packet.offsetMs = static_cast<std::uint32_t>(i * 20 + std::uniform_int_distribution<int>(0, jitterMs)(random));
+        packet.data = makeRtp(static_cast<std::uint16_t>(40000 + i), static_cast<std::uint32_t>(i * kFrameSamples),
+                              {static_cast<std::uint8_t>(i), static_cast<std::uint8_t>(i >> 8)});
+        packets.push_back(packet);
+    }
+    std::stable_sort(packets.begin(), packets.end(),
+                     [](const RtpDumpPacket &a, const RtpDumpPacket &b) { return a.offsetMs < b.offsetMs; });
+    return packets;
+}
+
+int payloadIndex(const std::uint8_t *payload)
+{
+    return payload[0] | (payload[1] << 8);
+}
+
+} // namespace
+
+class AudioReceiveTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void rtpDumpRoundTrip();
+    void rtpDumpRejectsBadFiles();
+    void jitterBufferPlaysRecordingAndReportsLoss();
+    void jitterBufferRecoversFromUnderrun();
+    void decodesRecordedOpusWithFecAndConcealment();
+};
+
+void AudioReceiveTest::rtpDumpRoundTrip()
+{
+    std::vector<RtpDumpPacket> written = recordStream(20, 0, {});
+    RtpDumpPacket rtcp;
+    rtcp.rtcp = true;
+    rtcp.offsetMs = 500;
+    rtcp.data = {0x80, 200, 0x00, 0x06, 0, 0, 0, 1};
+    written.push_back(rtcp);
+    const std::string path = tempPath("controller_audio_roundtrip.rtpdump");
+    writeRtpDump(path, written);
+
+    const std::vector<RtpDumpPacket> read = readAll(path);
+    std::filesystem::remove(path);
+    QCOMPARE(read.size(), written.size());
+    for (std::size_t i = 0; i < read.size(); ++i) {
+        QCOMPARE(read[i].offsetMs, written[i].offsetMs);
+        QCOMPARE(read[i].rtcp, written[i].rtcp);
+        QVERIFY(read[i].data == written[i].data);
+    }
+}
+
+void AudioReceiveTest::rtpDumpRejectsBadFiles()
+{
+    const std::string path = tempPath("controller_audio_bad.rtpdump");
+    {
+        std::ofstream file(path, std::ios::binary);
+        file << "not an rtpdump file\n";
+    }
+    RtpDumpReader reader;
+    QVERIFY(!reader.open(path));
+
+    // A record cut short ends the stream instead of yielding garbage.
+    writeRtpDump(path, recordStream(3, 0, {}));
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 4);
+    QCOMPARE(readAll(path).size(), std::size_t(2));
+    std::filesystem::remove(path);
+    QVERIFY(!reader.open(path));
+}
+
+void AudioReceiveTest::jitterBufferPlaysRecordingAndReportsLoss()
+{
+    constexpr int kPackets = 150;
+    const std::set<int> lost = {50, 100};
+    const std::string path = tempPath("controller_audio_jitter.rtpdump");
+    writeRtpDump(path, recordStream(kPackets, 8, lost));
+    const std::vector<RtpDumpPacket> recording = readAll(path);
+    std::filesystem::remove(path);
+    QCOMPARE(recording.size(), std::size_t(kPackets - 2));
+
+    // The device pulls a frame every 20 ms; packets arrive at their offsets.
+    AudioJitterBuffer buffer;
+    std::size_t next = 0;
+    std::vector<int> played;
+    std::vector<int> concealedBefore; // index of the packet after each lost frame
+    std::uint32_t lastTimestamp = 0;
+    bool ordered = true;
+    AudioPacket packet;
+    for (std::int64_t nowUs = 0; nowUs < (kPackets + 20) * kFrameUs; nowUs += kFrameUs) {
+        while (next < recording.size() && recording[next].offsetMs * 1000LL <= nowUs) {
+            const RtpDumpPacket &record = recording[next++];
+            buffer.insert(record.data.data(), record.data.size(), record.offsetMs * 1000LL);
+        }
+        switch (buffer.pop(packet)) {
+        case AudioJitterBuffer::PopResult::Frame:
+            played.push_back(payloadIndex(packet.payload));
+            break;
+        case AudioJitterBuffer::PopResult::Lost:
+            // The next packet is offered for FEC.
+            QVERIFY(packet.nextPayload != nullptr);
+            concealedBefore.push_back(payloadIndex(packet.nextPayload));
+            break;
+        case AudioJitterBuffer::PopResult::Empty:
+            continue;
+        }
+        ordered &= lastTimestamp == 0 || packet.timestamp == lastTimestamp + kFrameSamples
+                   || buffer.stats().framesDropped > 0;
+        lastTimestamp = packet.timestamp;
+    }
+
+    QVERIFY(ordered);
+    QVERIFY(std::is_sorted(played.begin(), played.end()));
+    QVERIFY(std::adjacent_find(played.begin(), played.end()) == played.end());
+    QCOMPARE(concealedBefore, (std::vector<int>{51, 101}));
+    const AudioJitterStats &stats = buffer.stats();
+    QCOMPARE(stats.framesLost, std::uint64_t(2));
+    QCOMPARE(stats.framesPlayed + stats.framesDropped, std::uint64_t(kPackets - 2));
+    QCOMPARE(played.size(), std::size_t(stats.framesPlayed));
+    // 8 ms of jitter is absorbed within the bounds, well under the ~60 ms budget.
+    QVERIFY(stats.targetDelayMs >= 10.0);
+    QVERIFY(stats.targetDelayMs <= 40.0);
+    QCOMPARE(stats.packetsLate, std::uint64_t(0));
+}
+
+void AudioReceiveTest::jitterBufferRecoversFromUnderrun()
+{
+    AudioJitterBuffer buffer;
+    AudioPacket packet;
+    std::int64_t nowUs = 0;
+    int sequence = 0;
+    const auto feed = [&](int count) {
+        for (int i = 0; i < count; ++i, ++sequence) {
+            const auto rtp = makeRtp(static_cast<std::uint16_t>(sequence),
+                                     static_cast<std::uint32_t>(sequence * kFrameSamples),
+                                     {static_cast<std::uint8_t>(sequence), 0});
+            buffer.insert(rtp.data(), rtp.size(), nowUs);
+        }
+    };
+
+    feed(5);
+    const double targetBefore = buffer.stats().targetDelayMs;
+    int frames = 0;
+    while (buffer.pop(packet) == AudioJitterBuffer::PopResult::Frame) {
+        ++frames;
+        nowUs += kFrameUs;
+    }
+    QCOMPARE(frames, 5);
+    // Ran dry mid-stream: one underrun, and the delay floor rises by a frame.
+    QCOMPARE(buffer.stats().underruns, std::uint64_t(1));
+    QVERIFY(buffer.stats().targetDelayMs >= std::max(targetBefore, 20.0));
+
+    // Playout resumes, where it left off, once the raised target is buffered.
+    feed(1);
+    QCOMPARE(buffer.pop(packet), AudioJitterBuffer::PopResult::Frame);
+    QCOMPARE(payloadIndex(packet.payload), 5);
+}
+
+void AudioReceiveTest::decodesRecordedOpusWithFecAndConcealment()
+{
+    constexpr int kPackets = 50;
+    constexpr int kLost = 25;
+    int error = OPUS_OK;
+    OpusEncoder *encoder = opus_encoder_create(kSampleRate, OpusAudioDecoder::kChannels, OPUS_APPLICATION_VOIP, &error);
+    QVERIFY(encoder != nullptr && error == OPUS_OK);
+    opus_encoder_ctl(encoder, OPUS_SET_INBAND_FEC(1));
+    opus_encoder_ctl(encoder, OPUS_SET_PACKET_LOSS_PERC(20));
+
+    // 440 Hz tone, recorded with one packet missing.
+    std::vector<RtpDumpPacket> recording;
+    std::vector<std::int16_t> pcm(kFrameSamples * OpusAudioDecoder::kChannels);
+    std::vector<std::uint8_t> encoded(1500);
+    for (int i = 0; i < kPackets; ++i) {
+        for (int s = 0; s < kFrameSamples; ++s) {
+            const double t = static_cast<double>(i * kFrameSamples + s) / kSampleRate;
+            const auto value = static_cast<std::int16_t>(8000.0 * std::sin(2.0 * 3.14159265358979 * 440.0 * t));
+            pcm[static_cast<std::size_t>(2 * s)] = value;
+            pcm[static_cast<std::size_t>(2 * s + 1)] = value;
+        }
+        const int bytes = opus_encode(encoder, pcm.data(), kFrameSamples, encoded.data(),
+                                      static_cast<opus_int32>(encoded.size()));
+        QVERIFY(bytes > 0);
+        if (i == kLost) {
+            continue;
+        }
+        RtpDumpPacket packet;
+        packet.offsetMs = static_cast<std::uint32_t>(i * 20);
+        packet.data = makeRtp(static_cast<std::uint16_t>(i), static_cast<std::uint32_t>(i * kFrameSamples),
+                              std::vector<std::uint8_t>(encoded.begin(), encoded.begin() + bytes));
+        recording.push_back(packet);
+    }
+    opus_encoder_destroy(encoder);
+
+    const std::string path = tempPath("controller_audio_opus.rtpdump");
+    writeRtpDump(path, recording);
+    const std::vector<RtpDumpPacket> replay = readAll(path);
+    std::filesystem::remove(path);
+    QCOMPARE(replay.size(), std::size_t(kPackets - 1));
+
+    // Everything is buffered up front, so the lost frame's successor is there
+    // for FEC; pops then run without further arrivals.
+    AudioJitterBuffer buffer;
+    for (const RtpDumpPacket &record : replay) {
+        QCOMPARE(buffer.insert(record.data.data(), record.data.size(), record.offsetMs * 1000LL),
+                 AudioJitterBuffer::InsertResult::Inserted);
+    }
+    OpusAudioDecoder decoder;
+    QVERIFY(decoder.isValid());
+    std::vector<std::int16_t> out(OpusAudioDecoder::kMaxFrameSamples * OpusAudioDecoder::kChannels);
+    int decoded = 0;
+    int recovered = 0;
+    double energy = 0.0;
+    AudioPacket packet;
+    for (;;) {
+        const AudioJitterBuffer::PopResult result = buffer.pop(packet);
+        if (result == AudioJitterBuffer::PopResult::Empty) {
+            break;
+        }
+        int samples = 0;
+        if (result == AudioJitterBuffer::PopResult::Frame) {
+            samples = decoder.decode(packet.payload, packet.payloadSize, out.data());
+            ++decoded;
+        } else if (packet.nextPayload) {
+            samples = decoder.decodeFec(packet.nextPayload, packet.nextPayloadSize, decoder.lastFrameSamples(), out.data());
+            ++recovered;
+        } else {
+            samples = decoder.conceal(decoder.lastFrameSamples(), out.data());
+        }
+        QCOMPARE(samples, kFrameSamples);
+        for (int s = 0; s < samples * OpusAudioDecoder::kChannels; ++s) {
+            energy += std::abs(out[static_cast<std::size_t>(s)]);
+        }
+    }
+    QCOMPARE(recovered, 1);
+    QCOMPARE(decoded + static_cast<int>(buffer.stats().framesDropped), kPackets - 1);
+    // The tone came through, not silence.
+    QVERIFY(energy / (decoded * kFrameSamples * OpusAudioDecoder::kChannels) > 1000.0);
+
+    // Plain concealment, as when nothing follows the gap.
+    QCOMPARE(decoder.conceal(kFrameSamples, out.data()), kFrameSamples);
+}
+
+QTEST_APPLESS_MAIN(AudioReceiveTest)
+#include "AudioReceiveTest.moc"
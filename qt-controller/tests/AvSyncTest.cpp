@@ -0,0 +1,225 @@
+// Lip-sync from RTCP sender reports: a synthetic sender captures audio and
+// video on one wallclock, describes both RTP clocks in SRs, and the receiver
+// plays them with a known offset between the two paths. AvSync has to
+// measure exactly that offset.
+
+#include "controller/AvSync.h"
+#include "controller/Rtcp.h"
+
+#include <QtTest>
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <optional>
+#include <vector>
+
+using controller::AvSync;
+using controller::RtcpSenderReport;
+
+namespace {
+
+constexpr std::uint32_t kAudioSsrc = 0xa0d10012;
+constexpr std::uint32_t kVideoSsrc = 0x51de0012;
+// Sender wallclock at capture instant 0, an arbitrary NTP time.
+constexpr std::int64_t kSenderBaseUs = 3900000000LL * 1000000;
+// Local monotonic clock at capture instant 0.
+constexpr std::int64_t kLocalBaseUs = 7000000;
+constexpr std::uint32_t kAudioRtpBase = 123456;
+// Video wraps its 32-bit timestamp a few seconds in.
+constexpr std::uint32_t kVideoRtpBase = 0xFFFF0000u;
+constexpr std::int64_t kAudioFrameUs = 20000;
+constexpr std::int64_t kVideoFrameUs = 33333;
+// Audio is heard this long after capture; it is decoded 60 ms before that.
+constexpr std::int64_t kAudioLatencyUs = 120000;
+constexpr std::int64_t kAudioQueueUs = 60000;
+constexpr std::int64_t kDurationUs = 4000000;
+
+std::uint32_t audioRtp(std::int64_t captureUs)
+{
+    return kAudioRtpBase + static_cast<std::uint32_t>(captureUs * AvSync::kAudioClockRate / 1000000);
+}
+
+std::uint32_t videoRtp(std::int64_t captureUs)
+{
+    return kVideoRtpBase + static_cast<std::uint32_t>(captureUs * AvSync::kVideoClockRate / 1000000);
+}
+
+// 32.32 NTP, rounded up so that ntpToMicroseconds() gives `us` back exactly.
+std::uint64_t ntpFromMicroseconds(std::int64_t us)
+{
+    const auto seconds = static_cast<std::uint64_t>(us / 1000000);
+    const auto micros = static_cast<std::uint64_t>(us % 1000000);
+    return (seconds << 32) | (((micros << 32) + 999999) / 1000000);
+}
+
+void appendBigEndian32(std::vector<std::uint8_t> &out, std::uint32_t value)
+{
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        out.push_back(static_cast<std::uint8_t>(value >> shift));
+    }
+}
+
+// A compound RTCP packet as a sender puts it on the wire: an empty receiver
+// report, then the sender report for the capture instant `captureUs`.
+std::vector<std::uint8_t> makeCompound(std::uint32_t ssrc, std::int64_t captureUs, std::uint32_t rtpTimestamp)
+{
+    std::vector<std::uint8_t> out = {0x80, 201, 0x00, 0x01};
+    appendBigEndian32(out, ssrc);
+    out.insert(out.end(), {0x80, 200, 0x00, 0x06});
+    appendBigEndian32(out, ssrc);
+    const std::uint64_t ntp = ntpFromMicroseconds(kSenderBaseUs + captureUs);
+    appendBigEndian32(out, static_cast<std::uint32_t>(ntp >> 32));
+    appendBigEndian32(out, static_cast<std::uint32_t>(ntp));
+    appendBigEndian32(out, rtpTimestamp);
+    appendBigEndian32(out, 1000);
+    appendBigEndian32(out, 100000);
+    return out;
+}
+
+RtcpSenderReport parseReport(const std::vector<std::uint8_t> &packet)
+{
+    RtcpSenderReport report;
+    if (!controller::findRtcpSenderReport(packet.data(), packet.size(), report)) {
+        qFatal("no sender report in the synthetic RTCP packet");
+    }
+    return report;
+}
+
+void sendReports(AvSync &sync, std::int64_t audioCaptureUs, std::int64_t videoCaptureUs)
+{
+    sync.onSenderReport(AvSync::Stream::Audio,
+                        parseReport(makeCompound(kAudioSsrc, audioCaptureUs, audioRtp(audioCaptureUs))));
+    sync.onSenderReport(AvSync::Stream::Video,
+                        parseReport(makeCompound(kVideoSsrc, videoCaptureUs, videoRtp(videoCaptureUs))));
+}
+
+// Plays the synthetic session: audio heard kAudioLatencyUs after capture,
+// video presented `videoLatencyUs` after capture. Returns the lead AvSync
+// reports for every video frame, in microseconds.
+std::vector<std::optional<std::int64_t>> play(AvSync &sync, std::int64_t videoLatencyUs)
+{
+    std::vector<std::optional<std::int64_t>> leads;
+    std::int64_t audioCaptureUs = 0;
+    for (std::int64_t videoCaptureUs = 0; videoCaptureUs < kDurationUs; videoCaptureUs += kVideoFrameUs) {
+        const std::int64_t nowUs = kLocalBaseUs + videoCaptureUs + videoLatencyUs;
+        // The audio decode thread has scheduled everything decoded by now.
+        while (kLocalBaseUs + audioCaptureUs + kAudioLatencyUs - kAudioQueueUs <= nowUs) {
+            sync.onAudioScheduled(audioRtp(audioCaptureUs), kLocalBaseUs + audioCaptureUs + kAudioLatencyUs);
+            audioCaptureUs += kAudioFrameUs;
+        }
+        leads.push_back(sync.videoLeadUs(videoRtp(videoCaptureUs), nowUs));
+        sync.onVideoPresented(videoRtp(videoCaptureUs), nowUs);
+    }
+    return leads;
+}
+
+// Every lead equals `expectedUs` to within the RTP clock rounding.
+bool allLeadsAre(const std::vector<std::optional<std::int64_t>> &leads, std::int64_t expectedUs)
+{
+    for (const auto &lead : leads) {
+        if (!lead || std::llabs(*lead - expectedUs) > 30) {
+            return false;
+        }
+    }
+    return !leads.empty();
+}
+
+} // namespace
+
+class AvSyncTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void parsesSenderReportFromCompoundPacket();
+    void measuresKnownOffsetVideoEarly();
+    void measuresKnownOffsetVideoLate();
+    void reportsAtDifferentInstantsAgree();
+    void leavesVideoAloneWithoutBothReports();
+    void leavesVideoAloneWhenAudioStops();
+};
+
+void AvSyncTest::parsesSenderReportFromCompoundPacket()
+{
+    const std::vector<std::uint8_t> packet = makeCompound(kVideoSsrc, 1500000, 0xDEADBEEF);
+    const RtcpSenderReport report = parseReport(packet);
+    QCOMPARE(report.ssrc, kVideoSsrc);
+    QCOMPARE(report.rtpTimestamp, 0xDEADBEEFu);
+    QCOMPARE(report.packetCount, 1000u);
+    QCOMPARE(controller::ntpToMicroseconds(report.ntpTimestamp), kSenderBaseUs + 1500000);
+
+    // A sender report cut short is not read past the end.
+    RtcpSenderReport truncated;
+    QVERIFY(!controller::findRtcpSenderReport(packet.data(), packet.size() - 4, truncated));
+    // Receiver report only.
+    QVERIFY(!controller::findRtcpSenderReport(packet.data(), 8, truncated));
+}
+
+void AvSyncTest::measuresKnownOffsetVideoEarly()
+{
+    AvSync sync;
+    sendReports(sync, 0, 0);
+    // Video reaches the screen 50 ms sooner after capture than audio the speaker.
+    const auto leads = play(sync, kAudioLatencyUs - 50000);
+    QVERIFY(allLeadsAre(leads, 50000));
+    const auto stats = sync.stats();
+    QVERIFY(stats.synchronized);
+    QVERIFY(std::abs(stats.offsetMs - 50.0) < 0.1);
+    QVERIFY(std::abs(stats.lastOffsetMs - 50.0) < 0.1);
+}
+
+void AvSyncTest::measuresKnownOffsetVideoLate()
+{
+    AvSync sync;
+    sendReports(sync, 0, 0);
+    const auto leads = play(sync, kAudioLatencyUs + 80000);
+    QVERIFY(allLeadsAre(leads, -80000));
+    QVERIFY(std::abs(sync.stats().offsetMs + 80.0) < 0.1);
+}
+
+void AvSyncTest::reportsAtDifferentInstantsAgree()
+{
+    // The streams' SRs describe different instants, both before and after
+    // the video timestamp wraps; the mapping must not depend on which.
+    AvSync sync;
+    sendReports(sync, 2500000, 700000);
+    QVERIFY(allLeadsAre(play(sync, kAudioLatencyUs - 50000), 50000));
+
+    sync.reset();
+    QVERIFY(!sync.stats().synchronized);
+    sendReports(sync, 300000, 3900000);
+    QVERIFY(allLeadsAre(play(sync, kAudioLatencyUs - 50000), 50000));
+}
+
+void AvSyncTest::leavesVideoAloneWithoutBothReports()
+{
+    AvSync sync;
+    sync.onSenderReport(AvSync::Stream::Audio, parseReport(makeCompound(kAudioSsrc, 0, audioRtp(0))));
+    for (const auto &lead : play(sync, kAudioLatencyUs)) {
+        QVERIFY(!lead);
+    }
+    QVERIFY(!sync.stats().synchronized);
+
+    // The video SR arrives late; from then on the streams are related.
+    sync.onSenderReport(AvSync::Stream::Video, parseReport(makeCompound(kVideoSsrc, 0, videoRtp(0))));
+    QVERIFY(allLeadsAre(play(sync, kAudioLatencyUs), 0));
+    QVERIFY(sync.stats().synchronized);
+}
+
+void AvSyncTest::leavesVideoAloneWhenAudioStops()
+{
+    AvSync sync;
+    sendReports(sync, 0, 0);
+    sync.onAudioScheduled(audioRtp(0), kLocalBaseUs + kAudioLatencyUs);
+    const std::int64_t nowUs = kLocalBaseUs + kAudioLatencyUs;
+    QVERIFY(sync.videoLeadUs(videoRtp(0), nowUs).has_value());
+    // Nothing scheduled for longer than the anchor timeout: the clock has stopped.
+    QVERIFY(sync.videoLeadUs(videoRtp(400000), nowUs + 400000).has_value());
+    QVERIFY(!sync.videoLeadUs(videoRtp(600000), nowUs + 600000).has_value());
+    sync.onVideoPresented(videoRtp(600000), nowUs + 600000);
+    QVERIFY(!sync.stats().synchronized);
+}
+
+QTEST_APPLESS_MAIN(AvSyncTest)
+#include "AvSyncTest.moc"
@@ -0,0 +1,213 @@
+// BandwidthEstimator on simulated arrival traces: a 30 fps sender pushes its
+// frames through a FIFO bottleneck of known capacity, and the estimator sees
+// only the arrival times, RTP timestamps and sizes, as on the receiver.
+
+#include "controller/BandwidthEstimator.h"
+
+#include <QtTest>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <random>
+
+using controller::BandwidthEstimator;
+using controller::BandwidthUsage;
+
+namespace {
+
+constexpr std::int64_t kFrameUs = 1000000 / 30;
+constexpr std::size_t kPacketBytes = 1200;
+constexpr std::int64_t kPropagationUs = 20000;
+
+// A bottleneck with a FIFO queue: a packet leaves once the ones before it
+// have, after its own serialisation time, plus propagation and optional
+// jitter downstream of the queue.
+struct Link
+{
+    std::function<std::int64_t(std::int64_t)> capacityBps; // by send time
+    std::int64_t jitterUs = 0;
+    std::int64_t freeUs = 0;
+    std::int64_t queueUs = 0; // waited by the last packet
+    std::mt19937 random{14};
+
+    std::int64_t send(std::int64_t sendUs, std::size_t bytes)
+    {
+        const std::int64_t start = std::max(sendUs, freeUs);
+        queueUs = start - sendUs;
+        freeUs = start + static_cast<std::int64_t>(bytes) * 8 * 1000000 / capacityBps(sendUs);
+        const std::int64_t jitter =
+            jitterUs > 0 ? std::uniform_int_distribution<std::int64_t>(0, jitterUs)(random) : 0;
+        return freeUs + kPropagationUs + jitter;
+    }
+};
+
+struct Trace
+{
+    std::int64_t minEstimateBps = 0;
+    double meanEstimateBps = 0.0; // over the second half
+    std::int64_t maxQueueUs = 0;  // over the second half
+    std::int64_t firstOveruseUs = -1;
+    bool everOverusing = false;
+};
+
+// Runs `durationUs` of video through `link`. The sender's rate is
+// `rateBps(nowUs, estimate)`: a fixed rate, or one following the estimate as
+// the host does on REMB.
+Trace run(BandwidthEstimator &estimator, Link &link, std::int64_t durationUs,
+          const std::function<std::int64_t(std::int64_t, std::int64_t)> &rateBps)
+{
+    Trace trace;
+    trace.minEstimateBps = estimator.estimateBps();
+    double secondHalfSum = 0.0;
+    int secondHalfFrames = 0;
+    for (std::int64_t sendUs = 0; sendUs < durationUs; sendUs += kFrameUs) {
+        const auto timestamp = static_cast<std::uint32_t>(sendUs * 90 / 1000);
+        std::int64_t remaining = rateBps(sendUs, estimator.estimateBps()) * kFrameUs / 8 / 1000000;
+        while (remaining > 0) {
+            const std::size_t bytes = static_cast<std::size_t>(std::min<std::int64_t>(remaining, kPacketBytes));
+            remaining -= static_cast<std::int64_t>(bytes);
+            estimator.onPacket(link.send(sendUs, bytes), timestamp, bytes);
+        }
+        if (estimator.stats().usage == BandwidthUsage::Overusing) {
+            trace.everOverusing = true;
+        }
+        if (trace.firstOveruseUs < 0 && estimator.stats().overuseEvents > 0) {
+            trace.firstOveruseUs = sendUs;
+        }
+        trace.minEstimateBps = std::min(trace.minEstimateBps, estimator.estimateBps());
+        if (sendUs >= durationUs / 2) {
+            secondHalfSum += static_cast<double>(estimator.estimateBps());
+            trace.maxQueueUs = std::max(trace.maxQueueUs, link.queueUs);
+            ++secondHalfFrames;
+        }
+    }
+    trace.meanEstimateBps = secondHalfFrames > 0 ? secondHalfSum / secondHalfFrames : 0.0;
+    return trace;
+}
+
+std::function<std::int64_t(std::int64_t)> constantCapacity(std::int64_t bps)
+{
+    return [bps](std::int64_t) { return bps; };
+}
+
+std::function<std::int64_t(std::int64_t, std::int64_t)> fixedRate(std::int64_t bps)
+{
+    return [bps](std::int64_t, std::int64_t) { return bps; };
+}
+
+std::int64_t followEstimate(std::int64_t, std::int64_t estimateBps)
+{
+    return estimateBps;
+}
+
+} // namespace
+
+class BandwidthEstimatorTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void uncongestedLinkIsNotOverused();
+    void jitterAloneIsNotOverused();
+    void overloadedLinkIsDetectedQuickly();
+    void followsBottleneckInClosedLoop();
+    void followsCapacityDrop();
+    void replayIsDeterministic();
+};
+
+void BandwidthEstimatorTest::uncongestedLinkIsNotOverused()
+{
+    BandwidthEstimator estimator;
+    Link link{constantCapacity(20000000)};
+    const Trace trace = run(estimator, link, 10000000, fixedRate(4000000));
+    QVERIFY(!trace.everOverusing);
+    QCOMPARE(estimator.stats().overuseEvents, std::uint64_t(0));
+    QVERIFY(trace.minEstimateBps >= 5000000);
+    // The incoming rate is measured, and the estimate is not allowed to run
+    // far ahead of it.
+    QVERIFY(std::abs(estimator.stats().incomingBps - 4000000) < 200000);
+    QVERIFY(estimator.estimateBps() <= 1.5 * estimator.stats().incomingBps + 10000);
+}
+
+void BandwidthEstimatorTest::jitterAloneIsNotOverused()
+{
+    // Up to 10 ms of random delay on every packet, but no standing queue.
+    BandwidthEstimator estimator;
+    Link link{constantCapacity(20000000), 10000};
+    const Trace trace = run(estimator, link, 20000000, fixedRate(4000000));
+    QCOMPARE(estimator.stats().overuseEvents, std::uint64_t(0));
+    QVERIFY(trace.minEstimateBps >= 5000000);
+}
+
+void BandwidthEstimatorTest::overloadedLinkIsDetectedQuickly()
+{
+    constexpr std::int64_t kCapacityBps = 5000000;
+    BandwidthEstimator estimator;
+    Link link{constantCapacity(kCapacityBps)};
+    const Trace trace = run(estimator, link, 3000000, fixedRate(8000000));
+    // A saturated link delivers frames back to back, so they merge into
+    // ~100 ms burst groups and the trendline needs its window of those.
+    QVERIFY(trace.firstOveruseUs >= 0);
+    QVERIFY2(trace.firstOveruseUs < 2000000,
+             qPrintable(QStringLiteral("overuse after %1 ms").arg(trace.firstOveruseUs / 1000)));
+    // Backed off below what the link carries.
+    QVERIFY(estimator.estimateBps() < kCapacityBps);
+    QVERIFY(estimator.estimateBps() >= kCapacityBps / 2);
+}
+
+void BandwidthEstimatorTest::followsBottleneckInClosedLoop()
+{
+    constexpr std::int64_t kCapacityBps = 3000000;
+    BandwidthEstimator estimator;
+    Link link{constantCapacity(kCapacityBps)};
+    const Trace trace = run(estimator, link, 30000000, followEstimate);
+    QVERIFY(estimator.stats().overuseEvents >= 1);
+    QVERIFY2(trace.meanEstimateBps > 0.6 * kCapacityBps && trace.meanEstimateBps < 1.1 * kCapacityBps,
+             qPrintable(QStringLiteral("mean estimate %1 bps").arg(trace.meanEstimateBps)));
+    // Once settled, the queue the estimator lets build up stays bounded.
+    QVERIFY2(trace.maxQueueUs < 300000, qPrintable(QStringLiteral("queue %1 ms").arg(trace.maxQueueUs / 1000)));
+}
+
+void BandwidthEstimatorTest::followsCapacityDrop()
+{
+    constexpr std::int64_t kDropUs = 10000000;
+    BandwidthEstimator estimator;
+    Link link{[](std::int64_t sendUs) { return sendUs < kDropUs ? 10000000 : 2000000; }};
+    std::int64_t estimateBeforeDrop = 0;
+    std::int64_t recoveredUs = -1;
+    run(estimator, link, 20000000, [&](std::int64_t sendUs, std::int64_t estimateBps) {
+        if (sendUs < kDropUs) {
+            estimateBeforeDrop = estimateBps;
+        } else if (recoveredUs < 0 && estimateBps < 2000000) {
+            recoveredUs = sendUs - kDropUs;
+        }
+        return estimateBps;
+    });
+    QVERIFY(estimateBeforeDrop > 2000000);
+    QVERIFY(recoveredUs >= 0);
+    QVERIFY2(recoveredUs < 2000000, qPrintable(QStringLiteral("followed after %1 ms").arg(recoveredUs / 1000)));
+    QVERIFY(estimator.estimateBps() < 2400000);
+}
+
+void BandwidthEstimatorTest::replayIsDeterministic()
+{
+    BandwidthEstimator first;
+    BandwidthEstimator second;
+    Link firstLink{constantCapacity(3000000), 5000};
+    Link secondLink{constantCapacity(3000000), 5000};
+    run(first, firstLink, 10000000, followEstimate);
+    run(second, secondLink, 10000000, followEstimate);
+    QCOMPARE(first.estimateBps(), second.estimateBps());
+    QCOMPARE(first.stats().overuseEvents, second.stats().overuseEvents);
+
+    // reset() forgets everything, so the same trace gives the same result.
+    first.reset();
+    Link replayLink{constantCapacity(3000000), 5000};
+    run(first, replayLink, 10000000, followEstimate);
+    QCOMPARE(first.estimateBps(), second.estimateBps());
+}
+
+QTEST_APPLESS_MAIN(BandwidthEstimatorTest)
+#include "BandwidthEstimatorTest.moc"
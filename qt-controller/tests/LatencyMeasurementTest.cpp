@@ -0,0 +1,236 @@
+// The latency measurement mode against LatencyLoopbackHost: probes and echoes
+// go through the binary input protocol over links with known delays, frames
+// carry the host's capture timestamp SEI, and LatencyMonitor has to recover
+// the round trip, the host clock offset and glass-to-glass latency.
+
+#include "common/InputProtocol.h"
+#include "controller/H264Sei.h"
+#include "controller/LatencyLoopbackHost.h"
+#include "controller/LatencyMonitor.h"
+
+#include <QtTest>
+
+#include <cmath>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using controller::LatencyLoopbackConfig;
+using controller::LatencyLoopbackHost;
+using controller::LatencyMonitor;
+using controller::LatencyReport;
+
+namespace {
+
+constexpr std::int64_t kProbeIntervalUs = 200000; // as WebRtcPeer sends them
+constexpr std::int64_t kFrameUs = 1000000 / 60;
+constexpr std::int64_t kHostClockOffsetUs = 3700000;
+
+// Sends a probe every kProbeIntervalUs for `durationUs` through the host and
+// feeds every echo back.
+void runProbes(LatencyMonitor &monitor, LatencyLoopbackHost &host, std::int64_t startUs, std::int64_t durationUs)
+{
+    std::uint8_t message[Protocol::kMaxLatencyProbeSize];
+    for (std::int64_t nowUs = startUs; nowUs < startUs + durationUs; nowUs += kProbeIntervalUs) {
+        const std::size_t size = Protocol::encodeLatencyProbe(Protocol::InputEventType::LatencyProbe,
+                                                              monitor.nextProbe(nowUs), message, sizeof(message));
+        const auto echo = host.onInputMessage(message, size, nowUs);
+        Protocol::InputEventType type;
+        Protocol::LatencyProbe probe;
+        if (echo && Protocol::decodeLatencyProbe(echo->data.data(), echo->data.size(), type, probe)
+            && type == Protocol::InputEventType::LatencyProbeEcho) {
+            monitor.onProbeEcho(probe, echo->arrivalUs);
+        }
+    }
+}
+
+// Captures a frame every kFrameUs and presents it `displayDelayUs` later,
+// going through the SEI the way the decode thread does.
+void runFrames(LatencyMonitor &monitor, const LatencyLoopbackHost &host, std::int64_t startUs, int frames,
+               std::int64_t displayDelayUs)
+{
+    for (int i = 0; i < frames; ++i) {
+        const std::int64_t captureUs = startUs + i * kFrameUs;
+        const auto rtpTimestamp = static_cast<std::uint32_t>(captureUs * 90 / 1000);
+        const std::vector<std::uint8_t> accessUnit = host.captureFrame(captureUs);
+        std::int64_t hostCaptureUs = 0;
+        if (controller::findCaptureTimestamp(accessUnit.data(), accessUnit.size(), hostCaptureUs)) {
+            monitor.onFrameCaptured(rtpTimestamp, hostCaptureUs);
+        }
+        monitor.onFramePresented(rtpTimestamp, captureUs + displayDelayUs);
+    }
+}
+
+bool near(double value, double expected, double tolerance)
+{
+    return std::abs(value - expected) <= tolerance;
+}
+
+} // namespace
+
+class LatencyMeasurementTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void symmetricLinkIsMeasuredExactly();
+    void jitteryAsymmetricLinkStaysWithinBounds();
+    void framesWaitForClockSync();
+    void strayEchoesAreIgnored();
+    void exportsEverySampleAsCsv();
+};
+
+void LatencyMeasurementTest::symmetricLinkIsMeasuredExactly()
+{
+    LatencyLoopbackConfig config;
+    config.hostClockOffsetUs = kHostClockOffsetUs;
+    config.uplinkUs = 15000;
+    config.downlinkUs = 15000;
+    LatencyLoopbackHost host(config);
+    LatencyMonitor monitor;
+    monitor.setEnabled(true);
+
+    runProbes(monitor, host, 1000000, 10000000);
+    runFrames(monitor, host, 11000000, 600, 45000);
+
+    const LatencyReport report = monitor.report();
+    QCOMPARE(report.probesSent, std::uint64_t(50));
+    QCOMPARE(report.probesAnswered, report.probesSent);
+    QCOMPARE(host.probesEchoed(), report.probesSent);
+    QVERIFY(report.clockSynchronized);
+    QCOMPARE(report.clockOffsetMs, kHostClockOffsetUs / 1000.0);
+    QCOMPARE(report.inputRtt.count, std::uint64_t(50));
+    QCOMPARE(report.inputRtt.p50Ms, 30.0);
+    QCOMPARE(report.inputRtt.p99Ms, 30.0);
+    QCOMPARE(report.framesStamped, std::uint64_t(600));
+    QCOMPARE(report.glassToGlass.count, std::uint64_t(600));
+    QCOMPARE(report.glassToGlass.p50Ms, 45.0);
+    QCOMPARE(report.glassToGlass.maxMs, 45.0);
+}
+
+void LatencyMeasurementTest::jitteryAsymmetricLinkStaysWithinBounds()
+{
+    LatencyLoopbackConfig config;
+    config.hostClockOffsetUs = -kHostClockOffsetUs;
+    config.uplinkUs = 8000;
+    config.downlinkUs = 12000;
+    config.jitterUs = 4000;
+    LatencyLoopbackHost host(config);
+    LatencyMonitor monitor;
+    monitor.setEnabled(true);
+
+    runProbes(monitor, host, 0, 20000000);
+    const LatencyReport probes = monitor.report();
+    // Round trips between 20 and 28 ms, spread over the range.
+    QVERIFY(probes.inputRtt.p50Ms > 20.0 && probes.inputRtt.p50Ms < 28.0);
+    QVERIFY(probes.inputRtt.p99Ms <= 28.0);
+    QVERIFY(probes.inputRtt.p99Ms >= probes.inputRtt.p95Ms && probes.inputRtt.p95Ms >= probes.inputRtt.p50Ms);
+    // The echo is assumed to be stamped halfway, so the offset is off by at
+    // most half the asymmetry plus half the jitter.
+    QVERIFY2(near(probes.clockOffsetMs, -kHostClockOffsetUs / 1000.0, 2.0 + 2.0),
+             qPrintable(QStringLiteral("offset %1 ms").arg(probes.clockOffsetMs)));
+
+    runFrames(monitor, host, 20000000, 600, 45000);
+    const LatencyReport frames = monitor.report();
+    QCOMPARE(frames.glassToGlass.count, std::uint64_t(600));
+    // The offset error carries over into glass-to-glass one for one.
+    const double offsetErrorMs = frames.clockOffsetMs + kHostClockOffsetUs / 1000.0;
+    QVERIFY(near(frames.glassToGlass.p50Ms, 45.0 + offsetErrorMs, 0.001));
+    QVERIFY(near(frames.glassToGlass.p50Ms, 45.0, 4.0));
+}
+
+void LatencyMeasurementTest::framesWaitForClockSync()
+{
+    LatencyLoopbackConfig config;
+    config.hostClockOffsetUs = kHostClockOffsetUs;
+    LatencyLoopbackHost host(config);
+    LatencyMonitor monitor;
+    monitor.setEnabled(true);
+
+    // Without an echo the host's capture times cannot be translated.
+    runFrames(monitor, host, 0, 10, 40000);
+    QCOMPARE(monitor.report().framesStamped, std::uint64_t(10));
+    QCOMPARE(monitor.report().glassToGlass.count, std::uint64_t(0));
+    QVERIFY(!monitor.report().clockSynchronized);
+
+    // Frames without the SEI are not stamped at all.
+    const std::vector<std::uint8_t> plain = {0x00, 0x00, 0x00, 0x01, 0x65, 0x88, 0x84, 0x00};
+    std::int64_t captureUs = 0;
+    QVERIFY(!controller::findCaptureTimestamp(plain.data(), plain.size(), captureUs));
+
+    runProbes(monitor, host, 1000000, 1000000);
+    runFrames(monitor, host, 2000000, 10, 40000);
+    QCOMPARE(monitor.report().glassToGlass.count, std::uint64_t(10));
+    QCOMPARE(monitor.report().glassToGlass.p50Ms, 40.0);
+}
+
+void LatencyMeasurementTest::strayEchoesAreIgnored()
+{
+    LatencyLoopbackHost host;
+    LatencyMonitor monitor;
+    monitor.setEnabled(true);
+
+    // Input events are consumed by the host, not echoed.
+    std::uint8_t message[Protocol::kMaxLatencyProbeSize];
+    Protocol::LatencyProbe probe;
+    probe.id = 1;
+    const std::size_t echoSize =
+        Protocol::encodeLatencyProbe(Protocol::InputEventType::LatencyProbeEcho, probe, message, sizeof(message));
+    QVERIFY(!host.onInputMessage(message, echoSize, 0));
+    const std::uint8_t notAProbe[] = {Protocol::kInputBinaryVersion, 1, 0, 0, 0, 0};
+    QVERIFY(!host.onInputMessage(notAProbe, sizeof(notAProbe), 0));
+
+    // An echo for a probe that was never sent, e.g. from a previous run.
+    probe.id = 42;
+    probe.sentUs = 0;
+    QVERIFY(!monitor.onProbeEcho(probe, 10000));
+    // One older than the matching window.
+    const Protocol::LatencyProbe sent = monitor.nextProbe(0);
+    QVERIFY(!monitor.onProbeEcho(sent, 11000000));
+    QVERIFY(monitor.onProbeEcho(sent, 30000).has_value());
+    QCOMPARE(monitor.report().probesAnswered, std::uint64_t(1));
+    QCOMPARE(monitor.report().inputRtt.count, std::uint64_t(1));
+}
+
+void LatencyMeasurementTest::exportsEverySampleAsCsv()
+{
+    LatencyLoopbackConfig config;
+    config.hostClockOffsetUs = kHostClockOffsetUs;
+    LatencyLoopbackHost host(config);
+    LatencyMonitor monitor;
+    monitor.setEnabled(true);
+    runProbes(monitor, host, 0, 2000000);
+    runFrames(monitor, host, 2000000, 30, 50000);
+
+    std::ostringstream csv;
+    monitor.writeCsv(csv);
+    std::istringstream lines(csv.str());
+    std::string line;
+    QVERIFY(std::getline(lines, line));
+    QCOMPARE(line, std::string("kind,time_us,latency_us"));
+    int rtt = 0;
+    int glass = 0;
+    while (std::getline(lines, line)) {
+        if (line.rfind("input_rtt,", 0) == 0) {
+            ++rtt;
+            QVERIFY(line.size() > 6 && line.compare(line.size() - 6, 6, ",20000") == 0);
+        } else if (line.rfind("glass_to_glass,", 0) == 0) {
+            ++glass;
+            QVERIFY(line.size() > 6 && line.compare(line.size() - 6, 6, ",50000") == 0);
+        } else {
+            QFAIL(qPrintable(QStringLiteral("unexpected row: %1").arg(QString::fromStdString(line))));
+        }
+    }
+    QCOMPARE(rtt, 10);
+    QCOMPARE(glass, 30);
+
+    // Nothing is recorded while the mode is off.
+    monitor.reset();
+    monitor.setEnabled(false);
+    runProbes(monitor, host, 4000000, 1000000);
+    QCOMPARE(monitor.report().inputRtt.count, std::uint64_t(0));
+}
+
+QTEST_APPLESS_MAIN(LatencyMeasurementTest)
+#include "LatencyMeasurementTest.moc"
@@ -0,0 +1,79 @@
+// SessionManager with several sessions over the in-process loopback: which
+// session is focused, and that only the focused one is heard.
+
+#include "controller/LocalRealtimeServer.h"
+#include "controller/SessionManager.h"
+#include "controller/WebRtcPeer.h"
+
+#include <QSignalSpy>
+#include <QtTest>
+
+#include <memory>
+
+using controller::LocalRealtimeServer;
+using controller::LoopbackSignalingTransport;
+using controller::SessionManager;
+
+namespace {
+
+RealtimeCredentials credentials(int index)
+{
+    return RealtimeCredentials{QUrl(QStringLiteral("http://127.0.0.1")), QStringLiteral("local"),
+                               QStringLiteral("realtime:remote:session-%1").arg(index), {}};
+}
+
+// The ids of the sessions that are not muted.
+std::vector<SessionManager::SessionId> audible(const SessionManager &manager)
+{
+    std::vector<SessionManager::SessionId> ids;
+    for (const SessionManager::SessionId id : manager.sessionIds()) {
+        if (!manager.peer(id)->audioMuted()) {
+            ids.push_back(id);
+        }
+    }
+    return ids;
+}
+
+} // namespace
+
+class SessionManagerTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void onlyFocusedSessionIsAudible();
+};
+
+void SessionManagerTest::onlyFocusedSessionIsAudible()
+{
+    LocalRealtimeServer server;
+    SessionManager manager;
+    manager.setTransportFactory([&server] { return std::make_unique<LoopbackSignalingTransport>(&server); });
+    QSignalSpy focusChanged(&manager, &SessionManager::focusedSessionChanged);
+
+    const SessionManager::SessionId first = manager.addSession(QStringLiteral("first"), credentials(1));
+    const SessionManager::SessionId second = manager.addSession(QStringLiteral("second"), credentials(2));
+    const SessionManager::SessionId third = manager.addSession(QStringLiteral("third"), credentials(3));
+    // The first session added takes focus; the ones after it join muted.
+    QCOMPARE(manager.focusedSession(), first);
+    QCOMPARE(audible(manager), std::vector<SessionManager::SessionId>{first});
+    QVERIFY(manager.peer(second)->videoThumbnail());
+
+    manager.setFocusedSession(third);
+    QCOMPARE(audible(manager), std::vector<SessionManager::SessionId>{third});
+    QVERIFY(manager.peer(first)->audioMuted());
+    QVERIFY(!manager.peer(third)->videoThumbnail());
+
+    // Focus moves on when the focused session goes, and its sound with it.
+    manager.removeSession(third);
+    QCOMPARE(manager.focusedSession(), first);
+    QCOMPARE(audible(manager), std::vector<SessionManager::SessionId>{first});
+
+    manager.setFocusedSession(SessionManager::kNoSession);
+    QVERIFY(audible(manager).empty());
+    QCOMPARE(focusChanged.count(), 4);
+    manager.removeAllSessions();
+}
+
+QTEST_GUILESS_MAIN(SessionManagerTest)
+#include "SessionManagerTest.moc"
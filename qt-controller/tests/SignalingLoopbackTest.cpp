@@ -0,0 +1,309 @@
+// Signalling over the in-process loopback: a controller and a host
+// SignalingClient on one LocalRealtimeServer topic, directly and through a
+// RealtimeMultiplexer. No network, no hosted service.
+
+#include "controller/IceCandidateBatcher.h"
+#include "controller/LocalRealtimeServer.h"
+#include "controller/RealtimeMultiplexer.h"
+#include "controller/SignalingClient.h"
+
+#include <QSignalSpy>
+#include <QtTest>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+using controller::IceBatcherStats;
+using controller::IceCandidateBatcher;
+using controller::LocalRealtimeServer;
+using controller::LoopbackSignalingTransport;
+using controller::RealtimeMultiplexer;
+
+namespace {
+
+constexpr int kTimeoutMs = 5000;
+
+RealtimeCredentials credentials(const QString &topic, const QString &apiKey = QStringLiteral("local"))
+{
+    return RealtimeCredentials{QUrl(QStringLiteral("http://127.0.0.1")), apiKey, topic, {}};
+}
+
+std::unique_ptr<SignalingClient> makeClient(LocalRealtimeServer &server, const QString &topic)
+{
+    auto client = std::make_unique<SignalingClient>();
+    client->setTransport(std::make_unique<LoopbackSignalingTransport>(&server));
+    client->setCredentials(credentials(topic));
+    return client;
+}
+
+// Everything `client` receives, in order.
+std::shared_ptr<std::vector<SignalEnvelope>> record(SignalingClient *client)
+{
+    auto received = std::make_shared<std::vector<SignalEnvelope>>();
+    QObject::connect(client, &SignalingClient::signalReceived, client,
+                     [received](const SignalEnvelope &env) { received->push_back(env); });
+    return received;
+}
+
+// Answers an offer with an answer and one candidate, as the host does; a host
+// without the "ice-batch" extension does not advertise it.
+void answerOffers(SignalingClient *host, bool advertiseBatching = true)
+{
+    QObject::connect(host, &SignalingClient::signalReceived, host, [host, advertiseBatching](const SignalEnvelope &env) {
+        if (env.type != QLatin1String("offer")) {
+            return;
+        }
+        QJsonObject answer{{QStringLiteral("sdp"), QStringLiteral("v=0 answer")}};
+        if (advertiseBatching) {
+            IceCandidateBatcher::advertise(answer);
+        }
+        host->sendSignal(SignalEnvelope{QStringLiteral("answer"), answer});
+        host->sendSignal(IceCandidateBatcher::makeSignal(
+            {{"candidate:1 1 UDP 2122252543 192.168.1.20 50812 typ host", "video", 0}}));
+    });
+}
+
+// The pre-warm flow as SessionManager wires it: once joined, the offer and
+// every candidate gathered meanwhile are released in one synchronous pass.
+// Returns the signals the host received.
+std::shared_ptr<std::vector<SignalEnvelope>> prewarmedOffer(LocalRealtimeServer &server, const QString &topic,
+                                                            bool hostBatches, IceBatcherStats &statsBeforeAnswer,
+                                                            IceBatcherStats &stats)
+{
+    auto host = makeClient(server, topic);
+    auto controller = makeClient(server, topic);
+    IceCandidateBatcher batcher;
+    QObject::connect(&batcher, &IceCandidateBatcher::signalReady, controller.get(), &SignalingClient::sendSignal);
+    QObject::connect(controller.get(), &SignalingClient::signalReceived, &batcher,
+                     &IceCandidateBatcher::peerSignalReceived);
+    answerOffers(host.get(), hostBatches);
+    const auto received = record(host.get());
+    host->connectToRealtime();
+    controller->connectToRealtime();
+    if (!QTest::qWaitFor([&] { return host->isJoined() && controller->isJoined(); }, kTimeoutMs)) {
+        return received;
+    }
+
+    QJsonObject offer{{QStringLiteral("sdp"), QStringLiteral("v=0")}};
+    IceCandidateBatcher::advertise(offer);
+    controller->sendSignal(SignalEnvelope{QStringLiteral("offer"), offer});
+    for (int i = 0; i < 4; ++i) {
+        batcher.addCandidate(QStringLiteral("candidate:%1 1 UDP 2122252543 10.0.0.%1 5000%1 typ host").arg(i + 1),
+                             QStringLiteral("video"), 0);
+    }
+    batcher.gatheringComplete();
+    statsBeforeAnswer = batcher.stats();
+
+    // The answer settles it. Signals arrive in order, so once a marker sent
+    // after that is in, so is everything the batcher released.
+    QTest::qWaitFor([&] { return batcher.peerKnown(); }, kTimeoutMs);
+    controller->sendSignal(SignalEnvelope{QStringLiteral("marker"), {}});
+    QTest::qWaitFor([&] { return !received->empty() && received->back().type == QLatin1String("marker"); },
+                    kTimeoutMs);
+    stats = batcher.stats();
+    return received;
+}
+
+int countType(const std::vector<SignalEnvelope> &received, const char *type)
+{
+    return static_cast<int>(std::count_if(received.begin(), received.end(),
+                                          [type](const SignalEnvelope &env) { return env.type == QLatin1String(type); }));
+}
+
+} // namespace
+
+class SignalingLoopbackTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void offerReachesHostAndAnswerComesBack();
+    void signalsSentBeforeJoinAreQueued();
+    void broadcastsAreNotEchoed();
+    void multiplexedSessionsShareOneConnection();
+    void multiplexerRefusesOtherCredentials();
+    void prewarmedCandidatesGoOutAsOneBatch();
+    void prewarmedCandidatesFallBackToIce();
+};
+
+void SignalingLoopbackTest::offerReachesHostAndAnswerComesBack()
+{
+    LocalRealtimeServer server;
+    const QString topic = QStringLiteral("realtime:remote:offer");
+    auto host = makeClient(server, topic);
+    auto controller = makeClient(server, topic);
+    answerOffers(host.get());
+
+    QSignalSpy hostJoined(host.get(), &SignalingClient::joined);
+    host->connectToRealtime();
+    QTRY_COMPARE_WITH_TIMEOUT(hostJoined.count(), 1, kTimeoutMs);
+
+    const auto received = record(controller.get());
+    controller->connectToRealtime();
+    QTRY_VERIFY_WITH_TIMEOUT(controller->isJoined(), kTimeoutMs);
+    controller->sendSignal(SignalEnvelope{QStringLiteral("offer"), {{QStringLiteral("sdp"), QStringLiteral("v=0")}}});
+    QTRY_COMPARE_WITH_TIMEOUT(received->size(), std::size_t(2), kTimeoutMs);
+
+    const SignalEnvelope &answer = received->at(0);
+    QCOMPARE(answer.type, QStringLiteral("answer"));
+    QCOMPARE(answer.data.value(QStringLiteral("sdp")).toString(), QStringLiteral("v=0 answer"));
+    QVERIFY(IceCandidateBatcher::peerAdvertised(answer));
+    const auto candidates = IceCandidateBatcher::candidatesFromSignal(received->at(1));
+    QCOMPARE(candidates.size(), std::size_t(1));
+    QCOMPARE(candidates[0].sdpMid, QStringLiteral("video"));
+
+    QCOMPARE(server.stats().joins, quint64(2));
+    QCOMPARE(server.stats().broadcasts, quint64(3));
+}
+
+void SignalingLoopbackTest::signalsSentBeforeJoinAreQueued()
+{
+    LocalRealtimeServer server;
+    const QString topic = QStringLiteral("realtime:remote:queued");
+    auto host = makeClient(server, topic);
+    auto controller = makeClient(server, topic);
+    host->connectToRealtime();
+    QTRY_VERIFY_WITH_TIMEOUT(host->isJoined(), kTimeoutMs);
+
+    const auto received = record(host.get());
+    controller->connectToRealtime();
+    for (int i = 0; i < 10; ++i) {
+        controller->sendSignal(SignalEnvelope{QStringLiteral("ice"), {{QStringLiteral("index"), i}}});
+    }
+    QCOMPARE(controller->queuedSignals(), 10);
+    QTRY_COMPARE_WITH_TIMEOUT(received->size(), std::size_t(10), kTimeoutMs);
+    for (int i = 0; i < 10; ++i) {
+        QCOMPARE(received->at(static_cast<std::size_t>(i)).data.value(QStringLiteral("index")).toInt(), i);
+    }
+    QCOMPARE(controller->queuedSignals(), 0);
+    QCOMPARE(controller->stats().queuedSignals, quint64(10));
+}
+
+void SignalingLoopbackTest::broadcastsAreNotEchoed()
+{
+    LocalRealtimeServer server;
+    const QString topic = QStringLiteral("realtime:remote:echo");
+    auto host = makeClient(server, topic);
+    auto controller = makeClient(server, topic);
+    host->connectToRealtime();
+    controller->connectToRealtime();
+    QTRY_VERIFY_WITH_TIMEOUT(host->isJoined() && controller->isJoined(), kTimeoutMs);
+
+    const auto hostReceived = record(host.get());
+    const auto controllerReceived = record(controller.get());
+    controller->sendSignal(SignalEnvelope{QStringLiteral("offer"), {}});
+    QTRY_COMPARE_WITH_TIMEOUT(hostReceived->size(), std::size_t(1), kTimeoutMs);
+    // One more round trip, so an echo would have arrived by now.
+    host->sendSignal(SignalEnvelope{QStringLiteral("answer"), {}});
+    QTRY_COMPARE_WITH_TIMEOUT(controllerReceived->size(), std::size_t(1), kTimeoutMs);
+    QCOMPARE(controllerReceived->at(0).type, QStringLiteral("answer"));
+    QCOMPARE(hostReceived->size(), std::size_t(1));
+}
+
+void SignalingLoopbackTest::multiplexedSessionsShareOneConnection()
+{
+    constexpr int kSessions = 8;
+    LocalRealtimeServer server;
+    RealtimeMultiplexer multiplexer;
+    multiplexer.setTransport(std::make_unique<LoopbackSignalingTransport>(&server));
+
+    std::vector<std::unique_ptr<SignalingClient>> hosts;
+    std::vector<std::unique_ptr<SignalingClient>> controllers;
+    std::vector<int> answers(kSessions, 0);
+    for (int i = 0; i < kSessions; ++i) {
+        const QString topic = QStringLiteral("realtime:remote:mux-%1").arg(i);
+        hosts.push_back(makeClient(server, topic));
+        answerOffers(hosts.back().get());
+        hosts.back()->connectToRealtime();
+
+        auto controller = std::make_unique<SignalingClient>();
+        controller->setTransport(multiplexer.createTransport());
+        controller->setCredentials(credentials(topic));
+        QObject::connect(controller.get(), &SignalingClient::signalReceived, controller.get(),
+                         [&answers, i](const SignalEnvelope &env) {
+                             answers[static_cast<std::size_t>(i)] += env.type == QLatin1String("answer") ? 1 : 0;
+                         });
+        controllers.push_back(std::move(controller));
+    }
+    QTRY_COMPARE_WITH_TIMEOUT(server.stats().joins, quint64(kSessions), kTimeoutMs);
+
+    for (const auto &controller : controllers) {
+        controller->connectToRealtime();
+        controller->sendSignal(SignalEnvelope{QStringLiteral("offer"), {}});
+    }
+    QTRY_COMPARE_WITH_TIMEOUT(std::count(answers.begin(), answers.end(), 1), std::ptrdiff_t(kSessions), kTimeoutMs);
+    // Each session got its own answer, none of the others'.
+    QCOMPARE(std::count(answers.begin(), answers.end(), 1), std::ptrdiff_t(kSessions));
+    QCOMPARE(server.clientCount(), kSessions + 1);
+    QCOMPARE(multiplexer.stats().connections, quint64(1));
+    QCOMPARE(multiplexer.sessionCount(), kSessions);
+    QCOMPARE(multiplexer.stats().unrouted, quint64(0));
+
+    // The last one out closes the shared connection.
+    controllers.clear();
+    QTRY_COMPARE_WITH_TIMEOUT(server.clientCount(), kSessions, kTimeoutMs);
+    QCOMPARE(multiplexer.sessionCount(), 0);
+}
+
+void SignalingLoopbackTest::multiplexerRefusesOtherCredentials()
+{
+    LocalRealtimeServer server;
+    RealtimeMultiplexer multiplexer;
+    multiplexer.setTransport(std::make_unique<LoopbackSignalingTransport>(&server));
+
+    SignalingClient first;
+    first.setTransport(multiplexer.createTransport());
+    first.setCredentials(credentials(QStringLiteral("realtime:remote:a")));
+    first.connectToRealtime();
+    QTRY_VERIFY_WITH_TIMEOUT(first.isJoined(), kTimeoutMs);
+
+    SignalingClient other;
+    other.setTransport(multiplexer.createTransport());
+    other.setCredentials(credentials(QStringLiteral("realtime:remote:b"), QStringLiteral("other-key")));
+    QSignalSpy errors(&other, &SignalingClient::errorOccurred);
+    other.connectToRealtime();
+    QTRY_VERIFY_WITH_TIMEOUT(errors.count() >= 1, kTimeoutMs);
+    QVERIFY(!other.isJoined());
+    QVERIFY(multiplexer.stats().refused >= 1);
+    QCOMPARE(multiplexer.sessionCount(), 1);
+    other.disconnectFromRealtime();
+}
+
+void SignalingLoopbackTest::prewarmedCandidatesGoOutAsOneBatch()
+{
+    LocalRealtimeServer server;
+    IceBatcherStats beforeAnswer;
+    IceBatcherStats stats;
+    const auto received = prewarmedOffer(server, QStringLiteral("realtime:remote:prewarm"), true, beforeAnswer, stats);
+    // Held while the host's support was unknown, then sent as one batch.
+    QCOMPARE(beforeAnswer.broadcasts, std::uint64_t(0));
+    QCOMPARE(stats.broadcasts, std::uint64_t(1));
+    QCOMPARE(stats.candidates, std::uint64_t(4));
+    QCOMPARE(received->front().type, QStringLiteral("offer"));
+    QCOMPARE(countType(*received, "ice-batch"), 1);
+    QCOMPARE(countType(*received, "ice"), 0);
+    for (const SignalEnvelope &env : *received) {
+        if (env.type == QLatin1String("ice-batch")) {
+            QCOMPARE(IceCandidateBatcher::candidatesFromSignal(env).size(), std::size_t(4));
+        }
+    }
+}
+
+void SignalingLoopbackTest::prewarmedCandidatesFallBackToIce()
+{
+    LocalRealtimeServer server;
+    IceBatcherStats beforeAnswer;
+    IceBatcherStats stats;
+    const auto received = prewarmedOffer(server, QStringLiteral("realtime:remote:legacy"), false, beforeAnswer, stats);
+    // A host that did not advertise "ice-batch" gets one "ice" each.
+    QCOMPARE(beforeAnswer.broadcasts, std::uint64_t(0));
+    QCOMPARE(stats.broadcasts, std::uint64_t(4));
+    QCOMPARE(countType(*received, "ice-batch"), 0);
+    QCOMPARE(countType(*received, "ice"), 4);
+}
+
+QTEST_GUILESS_MAIN(SignalingLoopbackTest)
+#include "SignalingLoopbackTest.moc"
@@ -0,0 +1,205 @@
+// SignalingClient recovery paths against a misbehaving LocalRealtimeServer,
+// over the in-process loopback with shortened timers: reconnect and rejoin
+// after a drop, the outbound queue across an outage, missed heartbeat acks,
+// and joins that are rejected or never answered.
+
+#include "controller/LocalRealtimeServer.h"
+#include "controller/PhoenixCodec.h"
+#include "controller/SignalingClient.h"
+
+#include <QSignalSpy>
+#include <QtTest>
+
+#include <memory>
+#include <string_view>
+#include <vector>
+
+using controller::LocalRealtimeServer;
+using controller::LoopbackSignalingTransport;
+
+namespace {
+
+constexpr int kHeartbeatIntervalMs = 100;
+constexpr int kHeartbeatTimeoutMs = 150;
+constexpr int kJoinTimeoutMs = 150;
+constexpr int kBackoffInitialMs = 20;
+constexpr int kBackoffMaxMs = 100;
+constexpr int kTimeoutMs = 5000;
+
+// A client on `server` with the shortened timers, and the `seq` field of
+// every signal the server relays, in arrival order.
+struct Fixture
+{
+    LocalRealtimeServer server;
+    SignalingClient client;
+    std::vector<int> received;
+
+    Fixture()
+    {
+        client.setTransport(std::make_unique<LoopbackSignalingTransport>(&server));
+        client.setReconnectBackoff(kBackoffInitialMs, kBackoffMaxMs);
+        client.setHeartbeat(kHeartbeatIntervalMs, kHeartbeatTimeoutMs);
+        client.setJoinTimeout(kJoinTimeoutMs);
+        client.setCredentials(
+            RealtimeCredentials{QUrl(QStringLiteral("http://127.0.0.1")), "local", "realtime:remote:test", {}});
+        QObject::connect(&server, &LocalRealtimeServer::broadcastReceived, &server,
+                         [this](const QString &, const QByteArray &payloadJson) {
+                             SignalEnvelope env;
+                             const std::string_view payload(payloadJson.constData(),
+                                                            static_cast<std::size_t>(payloadJson.size()));
+                             if (SignalingClient::decodeSignalPayload(controller::jsonField(payload, "payload"), env)) {
+                                 received.push_back(env.data.value(QStringLiteral("seq")).toInt(-1));
+                             }
+                         });
+    }
+
+    ~Fixture() { client.disconnectFromRealtime(); }
+};
+
+} // namespace
+
+class SignalingResilienceTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void joinsAndMeasuresHeartbeatRtt();
+    void rejoinsAfterOutageAndFlushesQueueInOrder();
+    void queueDropsOldestWhenFull();
+    void missedHeartbeatAckReconnects();
+    void rejectedJoinBacksOffAndRetries();
+    void unansweredJoinTimesOut();
+};
+
+void SignalingResilienceTest::joinsAndMeasuresHeartbeatRtt()
+{
+    Fixture f;
+    QSignalSpy joined(&f.client, &SignalingClient::joined);
+    QSignalSpy rtt(&f.client, &SignalingClient::heartbeatRtt);
+    f.client.connectToRealtime();
+    QTRY_COMPARE_WITH_TIMEOUT(joined.count(), 1, kTimeoutMs);
+    QTRY_VERIFY_WITH_TIMEOUT(rtt.count() >= 3, kTimeoutMs);
+    QVERIFY(f.client.stats().heartbeatRttUs >= 0);
+    QVERIFY(f.client.stats().smoothedRttUs >= 0);
+    QCOMPARE(f.client.stats().missedHeartbeats, quint64(0));
+    QCOMPARE(f.server.stats().joins, quint64(1));
+}
+
+void SignalingResilienceTest::rejoinsAfterOutageAndFlushesQueueInOrder()
+{
+    constexpr int kSignals = 50;
+    Fixture f;
+    QSignalSpy joined(&f.client, &SignalingClient::joined);
+    f.client.connectToRealtime();
+    QTRY_COMPARE_WITH_TIMEOUT(joined.count(), 1, kTimeoutMs);
+
+    f.server.setAcceptConnections(false);
+    f.server.dropConnections();
+    QTRY_VERIFY_WITH_TIMEOUT(!f.client.isJoined(), kTimeoutMs);
+    for (int seq = 0; seq < kSignals; ++seq) {
+        f.client.sendSignal(SignalEnvelope{QStringLiteral("ice"), QJsonObject{{QStringLiteral("seq"), seq}}});
+    }
+    QCOMPARE(f.client.queuedSignals(), kSignals);
+    // Refused for several backoff periods.
+    QTest::qWait(3 * kBackoffMaxMs);
+    QVERIFY(!f.client.isJoined());
+    QVERIFY(f.received.empty());
+
+    f.server.setAcceptConnections(true);
+    QTRY_COMPARE_WITH_TIMEOUT(joined.count(), 2, kTimeoutMs);
+    QTRY_COMPARE_WITH_TIMEOUT(f.received.size(), std::size_t(kSignals), kTimeoutMs);
+    for (int seq = 0; seq < kSignals; ++seq) {
+        QCOMPARE(f.received[static_cast<std::size_t>(seq)], seq);
+    }
+    QCOMPARE(f.client.queuedSignals(), 0);
+    QCOMPARE(f.client.stats().reconnects, quint64(1));
+    QCOMPARE(f.client.stats().droppedSignals, quint64(0));
+}
+
+void SignalingResilienceTest::queueDropsOldestWhenFull()
+{
+    constexpr int kSignals = SignalingClient::kMaxQueuedSignals + 10;
+    Fixture f;
+    // Never connected: everything queues.
+    for (int seq = 0; seq < kSignals; ++seq) {
+        f.client.sendSignal(SignalEnvelope{QStringLiteral("ice"), QJsonObject{{QStringLiteral("seq"), seq}}});
+    }
+    QCOMPARE(f.client.queuedSignals(), SignalingClient::kMaxQueuedSignals);
+    QCOMPARE(f.client.stats().droppedSignals, quint64(10));
+
+    f.client.connectToRealtime();
+    QTRY_COMPARE_WITH_TIMEOUT(f.received.size(), std::size_t(SignalingClient::kMaxQueuedSignals), kTimeoutMs);
+    QCOMPARE(f.received.front(), 10);
+    QCOMPARE(f.received.back(), kSignals - 1);
+}
+
+void SignalingResilienceTest::missedHeartbeatAckReconnects()
+{
+    Fixture f;
+    QSignalSpy joined(&f.client, &SignalingClient::joined);
+    f.client.connectToRealtime();
+    QTRY_COMPARE_WITH_TIMEOUT(joined.count(), 1, kTimeoutMs);
+
+    f.server.setAckHeartbeats(false);
+    QElapsedTimer timer;
+    timer.start();
+    QTRY_VERIFY_WITH_TIMEOUT(f.client.stats().missedHeartbeats >= 1, kTimeoutMs);
+    // Noticed by the ack timeout, not by a transport timeout.
+    QVERIFY2(timer.elapsed() <= kHeartbeatIntervalMs + kHeartbeatTimeoutMs + 200,
+             qPrintable(QStringLiteral("noticed after %1 ms").arg(timer.elapsed())));
+
+    f.server.setAckHeartbeats(true);
+    QTRY_COMPARE_WITH_TIMEOUT(joined.count(), 2, kTimeoutMs);
+    QVERIFY(f.server.stats().heartbeatsIgnored >= 1);
+}
+
+void SignalingResilienceTest::rejectedJoinBacksOffAndRetries()
+{
+    Fixture f;
+    f.server.setJoinReply(LocalRealtimeServer::JoinReply::Error);
+    QSignalSpy joined(&f.client, &SignalingClient::joined);
+    QSignalSpy reconnecting(&f.client, &SignalingClient::reconnecting);
+    QSignalSpy errors(&f.client, &SignalingClient::errorOccurred);
+    f.client.connectToRealtime();
+
+    QTRY_VERIFY_WITH_TIMEOUT(f.client.stats().joinFailures >= 3, kTimeoutMs);
+    QCOMPARE(joined.count(), 0);
+    QVERIFY(!f.client.isJoined());
+    QVERIFY(reconnecting.count() >= 3);
+    QVERIFY(errors.count() >= 3);
+    // Attempts are numbered from 1 and the delay stays within the backoff.
+    for (int i = 0; i < reconnecting.count(); ++i) {
+        QCOMPARE(reconnecting.at(i).at(0).toInt(), i + 1);
+        QVERIFY(reconnecting.at(i).at(1).toInt() <= kBackoffMaxMs);
+    }
+
+    f.server.setJoinReply(LocalRealtimeServer::JoinReply::Ok);
+    QTRY_COMPARE_WITH_TIMEOUT(joined.count(), 1, kTimeoutMs);
+    QVERIFY(f.server.stats().joinsRejected >= 3);
+}
+
+void SignalingResilienceTest::unansweredJoinTimesOut()
+{
+    Fixture f;
+    f.server.setJoinReply(LocalRealtimeServer::JoinReply::None);
+    QSignalSpy joined(&f.client, &SignalingClient::joined);
+    f.client.connectToRealtime();
+    f.client.sendSignal(SignalEnvelope{QStringLiteral("offer"), QJsonObject{{QStringLiteral("seq"), 0}}});
+
+    QElapsedTimer timer;
+    timer.start();
+    QTRY_VERIFY_WITH_TIMEOUT(f.client.stats().joinFailures >= 1, kTimeoutMs);
+    QVERIFY2(timer.elapsed() >= kJoinTimeoutMs - 20,
+             qPrintable(QStringLiteral("gave up after %1 ms").arg(timer.elapsed())));
+    QVERIFY(!f.client.isJoined());
+    // Still queued for the next join, not sent into a channel it is not in.
+    QCOMPARE(f.client.queuedSignals(), 1);
+    QVERIFY(f.received.empty());
+
+    f.server.setJoinReply(LocalRealtimeServer::JoinReply::Ok);
+    QTRY_COMPARE_WITH_TIMEOUT(joined.count(), 1, kTimeoutMs);
+    QTRY_COMPARE_WITH_TIMEOUT(f.received.size(), std::size_t(1), kTimeoutMs);
+}
+
+QTEST_GUILESS_MAIN(SignalingResilienceTest)
+#include "SignalingResilienceTest.moc"
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <vector>
+
+namespace controller {
+
+struct LatencyLoopbackConfig
+{
+    std::int64_t hostClockOffsetUs = 0; // host clock minus controller clock
+    std::int64_t uplinkUs = 10000;      // controller -> host, one way
+    std::int64_t downlinkUs = 10000;    // host -> controller, one way
+    std::int64_t jitterUs = 0;          // up to this much extra on each leg
+    std::uint32_t seed = 16;
+};
+
+// Host stand-in for the latency measurement mode. It runs the host halves of
+// the protocol on its own clock: LatencyProbe messages come back as
+// LatencyProbeEcho stamped on arrival, and captured frames are access units
+// led by a capture timestamp SEI. The links in between have known one-way
+// delays, so what LatencyMonitor measures can be checked against the truth.
+// Times are microseconds on the controller's clock; nothing runs by itself.
+class LatencyLoopbackHost
+{
+public:
+    struct Delivery
+    {
+        std::vector<std::uint8_t> data;
+        std::int64_t arrivalUs = 0; // at the controller
+    };
+
+    explicit LatencyLoopbackHost(const LatencyLoopbackConfig &config = LatencyLoopbackConfig());
+
+    std::int64_t hostClockUs(std::int64_t controllerUs) const;
+
+    // The controller sent `data` on the input channel at `sentUs`. Probes are
+    // answered; anything else is consumed without a reply.
+    std::optional<Delivery> onInputMessage(const std::uint8_t *data, std::size_t size, std::int64_t sentUs);
+
+    // Access unit for a frame captured at `captureUs`: the timestamp SEI (in
+    // host time) followed by a placeholder IDR slice.
+    std::vector<std::uint8_t> captureFrame(std::int64_t captureUs) const;
+
+    std::uint64_t probesEchoed() const { return m_probesEchoed; }
+
+private:
+    std::int64_t legDelayUs(std::int64_t baseUs);
+
+    LatencyLoopbackConfig m_config;
+    std::mt19937 m_random;
+    std::uint64_t m_probesEchoed = 0;
+};
+
+} // namespace controller
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <QObject>
+#include <QPointer>
+#include <QUrl>
+#include <QWebSocketServer>
+
+#include "controller/SignalingTransport.h"
+
+class QWebSocket;
+
+namespace controller {
+
+class LoopbackSignalingTransport;
+
+struct LocalRealtimeStats
+{
+    quint64 connections = 0;
+    quint64 joins = 0;
+    quint64 joinsRejected = 0; // answered with an error or not at all
+    quint64 heartbeats = 0;
+    quint64 heartbeatsIgnored = 0; // not acked because acking was off
+    quint64 broadcasts = 0;
+};
+
+// Supabase Realtime stand-in, so SignalingClient can be driven without the
+// hosted service. It speaks just the Phoenix v1 subset SignalingClient uses:
+// phx_join, phx_leave and heartbeat get an "ok" phx_reply, and a broadcast is
+// relayed to the other clients joined to the same topic (Realtime's default
+// self:false). A connection can join several topics, as a
+// RealtimeMultiplexer's does.
+//
+// Clients reach it either in process, through LoopbackSignalingTransport,
+// which needs no listen() and no network at all, or over WebSocket on the
+// loopback interface after listen(): point RealtimeCredentials at endpoint(),
+// any API key is accepted. Both kinds share topics.
+//
+// It can also be told to misbehave: drop every connection, refuse new ones,
+// swallow heartbeats, or reject or ignore joins, which is how the reconnect,
+// rejoin, outbound queue, heartbeat and join timeout paths are exercised.
+// GUI thread only.
+class LocalRealtimeServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum class JoinReply
+    {
+        Ok,
+        Error, // "status":"error", as for a bad token
+        None,  // no reply at all
+    };
+
+    explicit LocalRealtimeServer(QObject *parent = nullptr);
+    ~LocalRealtimeServer() override;
+
+    // 0 picks a free port.
+    bool listen(quint16 port = 0);
+    void close();
+    quint16 port() const;
+    // http://127.0.0.1:<port>
+    QUrl endpoint() const;
+
+    // Refused connections are closed right after the handshake.
+    void setAcceptConnections(bool accept) { m_acceptConnections = accept; }
+    void setAckHeartbeats(bool ack) { m_ackHeartbeats = ack; }
+    void setJoinReply(JoinReply reply) { m_joinReply = reply; }
+    // Aborts every client, as a dropped network path would.
+    void dropConnections();
+
+    int clientCount() const { return static_cast<int>(m_clients.size()); }
+    LocalRealtimeStats stats() const { return m_stats; }
+
+signals:
+    void clientJoined(const QString &topic);
+    // Payload of a relayed broadcast: {"type":"broadcast","event":...,"payload":...}
+    void broadcastReceived(const QString &topic, const QByteArray &payloadJson);
+
+private:
+    friend class LoopbackSignalingTransport;
+
+    struct Client
+    {
+        QObject *connection = nullptr;                 // the socket or the transport
+        QWebSocket *socket = nullptr;                  // set for WebSocket clients
+        LoopbackSignalingTransport *loopback = nullptr; // set for in-process clients
+        std::vector<std::string> topics;               // joined channels
+    };
+
+    void onNewConnection();
+    void onDisconnected(QWebSocket *socket);
+    // In-process clients; attach() is false while refusing connections.
+    bool attach(LoopbackSignalingTransport *transport);
+    void detach(LoopbackSignalingTransport *transport);
+    void handleText(QObject *connection, std::string_view text);
+    static bool joinedTo(const Client &client, std::string_view topic);
+    void removeClient(QObject *connection);
+    void reply(const Client &client, std::string_view topic, std::string_view ref, bool ok = true);
+    void send(const Client &client);
+
+    QWebSocketServer m_server;
+    std::vector<Client> m_clients;
+    std::string m_frame;
+    bool m_acceptConnections = true;
+    bool m_ackHeartbeats = true;
+    JoinReply m_joinReply = JoinReply::Ok;
+    LocalRealtimeStats m_stats;
+};
+
+// In-process SignalingTransport to a LocalRealtimeServer. Frames are handed
+// over through the event loop, one queued call per frame each way, so the
+// ordering and re-entrancy match a socket but nothing touches the network;
+// hundreds of sessions can connect in one process on a box with no network.
+class LoopbackSignalingTransport : public SignalingTransport
+{
+    Q_OBJECT
+
+public:
+    explicit LoopbackSignalingTransport(LocalRealtimeServer *server, QObject *parent = nullptr);
+    ~LoopbackSignalingTransport() override;
+
+    void open(const RealtimeCredentials &credentials, const QString &appToken) override;
+    void close() override;
+    void abort() override;
+    bool isOpen() const override { return m_open; }
+    void sendText(std::string_view utf8) override;
+
+private:
+    friend class LocalRealtimeServer;
+
+    // Server side: a frame for this client, or the server dropped it.
+    void deliver(const QByteArray &utf8);
+    void dropped();
+    void finish();
+    // Runs `fn` from the event loop unless the connection changed meanwhile.
+    void post(std::function<void()> fn);
+
+    QPointer<LocalRealtimeServer> m_server;
+    std::uint64_t m_generation = 0; // bumped per open()/close(); stale posts are dropped
+    bool m_active = false;          // between open() and closed()
+    bool m_attached = false;
+    bool m_open = false;
+};
+
+} // namespace controller
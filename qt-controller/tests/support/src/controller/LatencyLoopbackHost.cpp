@@ -0,0 +1,56 @@
+#include "controller/LatencyLoopbackHost.h"
+
+#include "common/InputProtocol.h"
+#include "controller/H264Sei.h"
+
+namespace controller {
+
+LatencyLoopbackHost::LatencyLoopbackHost(const LatencyLoopbackConfig &config)
+    : m_config(config)
+    , m_random(config.seed)
+{
+}
+
+std::int64_t LatencyLoopbackHost::hostClockUs(std::int64_t controllerUs) const
+{
+    return controllerUs + m_config.hostClockOffsetUs;
+}
+
+std::int64_t LatencyLoopbackHost::legDelayUs(std::int64_t baseUs)
+{
+    if (m_config.jitterUs <= 0) {
+        return baseUs;
+    }
+    return baseUs + std::uniform_int_distribution<std::int64_t>(0, m_config.jitterUs)(m_random);
+}
+
+std::optional<LatencyLoopbackHost::Delivery> LatencyLoopbackHost::onInputMessage(const std::uint8_t *data,
+                                                                                 std::size_t size, std::int64_t sentUs)
+{
+    Protocol::InputEventType type;
+    Protocol::LatencyProbe probe;
+    if (!Protocol::decodeLatencyProbe(data, size, type, probe) || type != Protocol::InputEventType::LatencyProbe) {
+        return std::nullopt;
+    }
+
+    const std::int64_t receivedUs = sentUs + legDelayUs(m_config.uplinkUs);
+    probe.hostUs = static_cast<std::uint64_t>(hostClockUs(receivedUs));
+    Delivery echo;
+    echo.data.resize(Protocol::kMaxLatencyProbeSize);
+    echo.data.resize(Protocol::encodeLatencyProbe(Protocol::InputEventType::LatencyProbeEcho, probe, echo.data.data(),
+                                                  echo.data.size()));
+    echo.arrivalUs = receivedUs + legDelayUs(m_config.downlinkUs);
+    ++m_probesEchoed;
+    return echo;
+}
+
+std::vector<std::uint8_t> LatencyLoopbackHost::captureFrame(std::int64_t captureUs) const
+{
+    std::vector<std::uint8_t> accessUnit;
+    appendCaptureTimestampSei(hostClockUs(captureUs), accessUnit);
+    // IDR slice NAL; its contents are never parsed.
+    accessUnit.insert(accessUnit.end(), {0x00, 0x00, 0x00, 0x01, 0x65, 0x88, 0x84, 0x00, 0x33, 0xff});
+    return accessUnit;
+}
+
+} // namespace controller
@@ -0,0 +1,314 @@
+#include "controller/LocalRealtimeServer.h"
+#include "controller/PhoenixCodec.h"
+
+#include <QHostAddress>
+#include <QMetaObject>
+#include <QWebSocket>
+
+#include <algorithm>
+
+namespace controller {
+
+namespace {
+std::string_view utf8View(const QByteArray &bytes)
+{
+    return std::string_view(bytes.constData(), static_cast<std::size_t>(bytes.size()));
+}
+} // namespace
+
+LocalRealtimeServer::LocalRealtimeServer(QObject *parent)
+    : QObject(parent)
+    , m_server(QStringLiteral("LocalRealtimeServer"), QWebSocketServer::NonSecureMode)
+{
+    connect(&m_server, &QWebSocketServer::newConnection, this, &LocalRealtimeServer::onNewConnection);
+}
+
+LocalRealtimeServer::~LocalRealtimeServer()
+{
+    close();
+}
+
+bool LocalRealtimeServer::listen(quint16 port)
+{
+    return m_server.listen(QHostAddress::LocalHost, port);
+}
+
+void LocalRealtimeServer::close()
+{
+    m_server.close();
+    dropConnections();
+}
+
+quint16 LocalRealtimeServer::port() const
+{
+    return m_server.serverPort();
+}
+
+QUrl LocalRealtimeServer::endpoint() const
+{
+    QUrl url;
+    url.setScheme(QStringLiteral("http"));
+    url.setHost(QStringLiteral("127.0.0.1"));
+    url.setPort(port());
+    return url;
+}
+
+void LocalRealtimeServer::dropConnections()
+{
+    // abort() emits disconnected synchronously, which edits m_clients.
+    const std::vector<Client> clients = std::move(m_clients);
+    m_clients.clear();
+    for (const Client &client : clients) {
+        if (client.socket) {
+            client.socket->abort();
+            client.socket->deleteLater();
+        } else {
+            client.loopback->dropped();
+        }
+    }
+}
+
+void LocalRealtimeServer::onNewConnection()
+{
+    while (QWebSocket *socket = m_server.nextPendingConnection()) {
+        if (!m_acceptConnections) {
+            socket->abort();
+            socket->deleteLater();
+            continue;
+        }
+        ++m_stats.connections;
+        m_clients.push_back(Client{socket, socket, nullptr, {}});
+        connect(socket, &QWebSocket::textMessageReceived, this, [this, socket](const QString &message) {
+            const QByteArray utf8 = message.toUtf8();
+            handleText(socket, utf8View(utf8));
+        });
+        connect(socket, &QWebSocket::disconnected, this, [this, socket] {
+            onDisconnected(socket);
+        });
+    }
+}
+
+void LocalRealtimeServer::onDisconnected(QWebSocket *socket)
+{
+    removeClient(socket);
+    socket->deleteLater();
+}
+
+bool LocalRealtimeServer::attach(LoopbackSignalingTransport *transport)
+{
+    if (!m_acceptConnections) {
+        return false;
+    }
+    ++m_stats.connections;
+    m_clients.push_back(Client{transport, nullptr, transport, {}});
+    return true;
+}
+
+void LocalRealtimeServer::detach(LoopbackSignalingTransport *transport)
+{
+    removeClient(transport);
+}
+
+void LocalRealtimeServer::removeClient(QObject *connection)
+{
+    m_clients.erase(std::remove_if(m_clients.begin(), m_clients.end(),
+                                   [connection](const Client &client) { return client.connection == connection; }),
+                    m_clients.end());
+}
+
+void LocalRealtimeServer::handleText(QObject *connection, std::string_view text)
+{
+    const auto sender = std::find_if(m_clients.begin(), m_clients.end(),
+                                     [connection](const Client &client) { return client.connection == connection; });
+    PhoenixFrame frame;
+    std::string topic;
+    std::string ref;
+    if (sender == m_clients.end() || !parsePhoenixFrame(text, frame) || !decodeJsonString(frame.topic, topic)) {
+        return;
+    }
+    decodeJsonString(frame.ref, ref); // a missing ref is echoed as null
+
+    if (jsonStringEquals(frame.event, "heartbeat")) {
+        ++m_stats.heartbeats;
+        if (!m_ackHeartbeats) {
+            ++m_stats.heartbeatsIgnored;
+            return;
+        }
+        reply(*sender, topic, ref);
+        return;
+    }
+
+    if (jsonStringEquals(frame.event, "phx_join")) {
+        ++m_stats.joins;
+        if (m_joinReply != JoinReply::Ok) {
+            ++m_stats.joinsRejected;
+            if (m_joinReply == JoinReply::Error) {
+                reply(*sender, topic, ref, false);
+            }
+            return;
+        }
+        if (!joinedTo(*sender, topic)) {
+            sender->topics.push_back(topic);
+        }
+        reply(*sender, topic, ref);
+        emit clientJoined(QString::fromStdString(topic));
+        return;
+    }
+
+    if (jsonStringEquals(frame.event, "phx_leave")) {
+        auto &topics = sender->topics;
+        topics.erase(std::remove(topics.begin(), topics.end(), topic), topics.end());
+        reply(*sender, topic, ref);
+        return;
+    }
+
+    if (jsonStringEquals(frame.event, "broadcast") && joinedTo(*sender, topic)) {
+        ++m_stats.broadcasts;
+        m_frame.clear();
+        appendPhoenixFrame(m_frame, topic, "broadcast", frame.payload, {});
+        for (const Client &client : m_clients) {
+            if (client.connection != connection && joinedTo(client, topic)) {
+                send(client);
+            }
+        }
+        emit broadcastReceived(QString::fromStdString(topic),
+                               QByteArray(frame.payload.data(), static_cast<int>(frame.payload.size())));
+    }
+}
+
+bool LocalRealtimeServer::joinedTo(const Client &client, std::string_view topic)
+{
+    return std::find(client.topics.begin(), client.topics.end(), topic) != client.topics.end();
+}
+
+void LocalRealtimeServer::reply(const Client &client, std::string_view topic, std::string_view ref, bool ok)
+{
+    m_frame.clear();
+    appendPhoenixFrame(m_frame, topic, "phx_reply",
+                       ok ? "{\"status\":\"ok\",\"response\":{}}"
+                          : "{\"status\":\"error\",\"response\":{\"reason\":\"rejected\"}}",
+                       ref);
+    send(client);
+}
+
+void LocalRealtimeServer::send(const Client &client)
+{
+    if (client.socket) {
+        client.socket->sendTextMessage(QString::fromUtf8(m_frame.data(), static_cast<int>(m_frame.size())));
+    } else {
+        client.loopback->deliver(QByteArray(m_frame.data(), static_cast<int>(m_frame.size())));
+    }
+}
+
+LoopbackSignalingTransport::LoopbackSignalingTransport(LocalRealtimeServer *server, QObject *parent)
+    : SignalingTransport(parent)
+    , m_server(server)
+{
+}
+
+LoopbackSignalingTransport::~LoopbackSignalingTransport()
+{
+    if (m_attached && m_server) {
+        m_server->detach(this);
+    }
+}
+
+void LoopbackSignalingTransport::open(const RealtimeCredentials &, const QString &)
+{
+    if (m_attached && m_server) {
+        m_server->detach(this);
+    }
+    ++m_generation;
+    m_attached = false;
+    m_open = false;
+    m_active = true;
+    // Connecting takes an event loop pass, as it would over a socket.
+    post([this] {
+        if (!m_server || !m_server->attach(this)) {
+            emit errorOccurred(QStringLiteral("Loopback Realtime refused the connection"));
+            finish();
+            return;
+        }
+        m_attached = true;
+        m_open = true;
+        emit opened();
+    });
+}
+
+void LoopbackSignalingTransport::close()
+{
+    if (m_attached && m_server) {
+        m_server->detach(this);
+    }
+    ++m_generation;
+    m_attached = false;
+    m_open = false;
+    post([this] { finish(); });
+}
+
+void LoopbackSignalingTransport::abort()
+{
+    if (m_attached && m_server) {
+        m_server->detach(this);
+    }
+    ++m_generation;
+    m_attached = false;
+    finish();
+}
+
+void LoopbackSignalingTransport::sendText(std::string_view utf8)
+{
+    if (!m_open || !m_server) {
+        return;
+    }
+    const QByteArray bytes(utf8.data(), static_cast<int>(utf8.size()));
+    const QPointer<LoopbackSignalingTransport> self(this);
+    const std::uint64_t generation = m_generation;
+    LocalRealtimeServer *server = m_server.data();
+    QMetaObject::invokeMethod(
+        server,
+        [server, self, generation, bytes] {
+            if (self && self->m_generation == generation && self->m_attached) {
+                server->handleText(self.data(), utf8View(bytes));
+            }
+        },
+        Qt::QueuedConnection);
+}
+
+void LoopbackSignalingTransport::deliver(const QByteArray &utf8)
+{
+    post([this, utf8] { emit textReceived(utf8); });
+}
+
+void LoopbackSignalingTransport::dropped()
+{
+    // The server has already forgotten this client.
+    ++m_generation;
+    m_attached = false;
+    m_open = false;
+    post([this] { finish(); });
+}
+
+void LoopbackSignalingTransport::finish()
+{
+    m_open = false;
+    if (m_active) {
+        m_active = false;
+        emit closed();
+    }
+}
+
+void LoopbackSignalingTransport::post(std::function<void()> fn)
+{
+    const std::uint64_t generation = m_generation;
+    QMetaObject::invokeMethod(
+        this,
+        [this, generation, fn = std::move(fn)] {
+            if (m_generation == generation) {
+                fn();
+            }
+        },
+        Qt::QueuedConnection);
+}
+
+} // namespace controller